@@ -0,0 +1,509 @@
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <numbers>
+
+#include "Benchmark.h"
+#include "allocation-counter/AllocationCounter.h"
+#include "memory-source/MemorySource.h"
+#include "src/heightmap/bilinear-patch/BilinearPatch.h"
+#include "src/heightmap/cell/Cell.h"
+#include "src/heightmap/digital-line/DigitalLine.h"
+#include "src/heightmap/heightmap-reader/MapReader.h"
+#include "src/illumination/Illumination.h"
+#include "src/rational/Rational.h"
+#include "src/thread-pool/ThreadPool.h"
+#include "src/triangle/Triangle.h"
+
+Benchmark::Benchmark(unsigned width, unsigned height, unsigned repetitions, std::ostream &out)
+  : width(width), height(height), repetitions(std::max(repetitions, 1u)), out(out) {}
+
+float Benchmark::getRandom(float low, float high) {
+  return std::uniform_real_distribution<float>(low, high)(random);
+}
+
+std::vector<Ray> Benchmark::getRandomRays(unsigned count) {
+  std::vector<Ray> rays;
+  for (unsigned i = 0; i < count; i++) {
+    auto origin = Point3d(getRandom(-.5f, 1.5f), 2.f, getRandom(-.5f, 1.5f));
+    auto target = Point3d(getRandom(0.f, 1.f), 0.f, getRandom(0.f, 1.f));
+    rays.emplace_back(origin, target.getVectorBetween(origin).normalized());
+  }
+  return rays;
+}
+
+void Benchmark::printMicro(const char *name, double milliseconds, unsigned long long result) const {
+  out << "  " << std::left << std::setw(42) << name << std::right << std::setw(8) << milliseconds * 1e6 / microIterations << " ns per call"
+    << " (result " << result << ")" << std::endl;
+}
+
+uint64_t Benchmark::countPixelAllocations(const Context &context, const RayTracing &rayTracing) {
+  // the frame was already rendered, so the lazily built structures exist and only the per-pixel work is counted
+  auto before = AllocationCounter::getThreadAllocations();
+  rayTracing.traceTilesInThread(0, 0, context.getWidth(), context.getHeight());
+  return AllocationCounter::getThreadAllocations() - before;
+}
+
+void Benchmark::checkPixelAllocations(const Context &context, const RayTracing &rayTracing) {
+  auto allocations = countPixelAllocations(context, rayTracing);
+  pixelAllocations += allocations;
+  out << "  heap allocations on the per-pixel path: " << allocations << (allocations == 0 ? "" : " (should be 0)") << std::endl;
+}
+
+std::vector<std::array<int, 3>> Benchmark::getRationalRuns(float major, float minor, float intercept, int fromMajor, int fromMinor, int majorCount, int minorCount) {
+  std::vector<std::array<int, 3>> runs;
+  auto alpha = Rational(long(minor * scene::precision), long(major * scene::precision));
+  int runLengthShort = std::floor((1 / alpha).getFloat());
+  int runLengthLong = std::ceil((1 / alpha).getFloat());
+  auto v = 1 - alpha * runLengthShort;
+  auto last = majorCount - 1;
+
+  auto beta = Rational(long(intercept * scene::precision), scene::precision);
+  auto currInterceptBeta = beta;
+  auto currMajor = fromMajor, currMinor = fromMinor, currRunLength = (currInterceptBeta < v) ? runLengthLong : runLengthShort;
+  if (beta >= alpha + v) { // if first run is truncated
+    int lengthOfTruncated = std::ceil(((1 - beta) / alpha).getFloat());
+    runs.push_back({fromMajor, std::min(fromMajor + lengthOfTruncated, last), currMinor});
+    currMajor += lengthOfTruncated;
+    currMinor++;
+    currInterceptBeta = (beta - v) - (alpha * std::floor(((beta - v) / alpha).getFloat()));
+    currRunLength = (currInterceptBeta < v) ? runLengthLong : runLengthShort;
+  }
+  while (currMajor < majorCount && currMinor < minorCount) {
+    runs.push_back({std::max(fromMajor, currMajor - 1), std::min(currMajor + currRunLength, last), currMinor});
+    currMajor += currRunLength;
+    currMinor++;
+    currInterceptBeta += alpha * currRunLength - 1;
+    currRunLength = (currInterceptBeta < v) ? runLengthLong : runLengthShort;
+  }
+  return runs;
+}
+
+void Benchmark::checkDigitalLine() {
+  std::uniform_int_distribution<int> counts(1, 600);
+  unsigned mismatches = 0;
+  for (unsigned i = 0; i < digitalLineChecks; i++) {
+    // directions of the normalized ray projected to the grid, the minor one is at most the major one and is not scaled to 0,
+    // every other line has all values in sixteenths, which are scaled exactly, so the intercepts also fall on the run borders
+    auto major = getRandom(.01f, 1.f);
+    auto minor = getRandom(float(2. / scene::precision), major);
+    auto intercept = getRandom(0.f, 1.f);
+    if (i % 2 == 1) {
+      major = std::max(std::floor(major * 16.f), 1.f) / 16.f;
+      minor = std::clamp(std::floor(minor * 16.f), 1.f, major * 16.f) / 16.f;
+      intercept = std::floor(intercept * 16.f) / 16.f;
+    }
+    auto majorCount = counts(random), minorCount = counts(random);
+    auto fromMajor = std::uniform_int_distribution<int>(0, majorCount - 1)(random), fromMinor = std::uniform_int_distribution<int>(0, minorCount - 1)(random);
+
+    auto expected = getRationalRuns(major, minor, intercept, fromMajor, fromMinor, majorCount, minorCount);
+    std::vector<std::array<int, 3>> runs;
+    DigitalLine line(major, minor, intercept, fromMajor, fromMinor, majorCount, minorCount);
+    int from, to, other;
+    while (runs.size() <= expected.size() && line.nextRun(from, to, other)) runs.push_back({from, to, other});
+    if (runs == expected) continue;
+    if (mismatches++ < 10) {
+      out << "  digital line differs from the rational runs: direction " << major << ", " << minor << ", intercept " << intercept
+        << ", start " << fromMajor << ", " << fromMinor << " of " << majorCount << "x" << minorCount << std::endl;
+    }
+  }
+  digitalLineMismatches += mismatches;
+  out << "digital line: " << digitalLineChecks << " random lines, " << mismatches << " differ from the rational runs" << (mismatches == 0 ? "" : " (should be 0)")
+    << std::endl;
+}
+
+unsigned Benchmark::countGridDifferences(const HeightMap &edited, const HeightMap &built) {
+  unsigned differences = 0;
+  auto min = built.getAabbMin(), max = built.getAabbMax();
+  auto gridWidth = built.getGridWidth(), gridDepth = built.getGridDepth();
+  auto getX = [&](float col) { return min.getX() + (max.getX() - min.getX()) * col / float(gridWidth); };
+  auto getZ = [&](float row) { return min.getZ() + (max.getZ() - min.getZ()) * row / float(gridDepth); };
+  for (unsigned row = 0; row <= gridDepth; row++) {
+    for (unsigned col = 0; col <= gridWidth; col++) {
+      differences += edited.getSampleHeight(row, col) != built.getSampleHeight(row, col);
+      if (row < gridDepth && col < gridWidth) differences += edited.getMaxHeight(row, col) != built.getMaxHeight(row, col);
+      if (!built.hasVertexNormals()) continue;
+      auto point = Point3d(getX(float(col)), built.getSampleHeight(row, col), getZ(float(row)));
+      auto editedNormal = edited.getVertexNormal(point), builtNormal = built.getVertexNormal(point);
+      differences += editedNormal.getX() != builtNormal.getX() || editedNormal.getY() != builtNormal.getY() || editedNormal.getZ() != builtNormal.getZ();
+    }
+  }
+  for (unsigned i = 0; i < heightEditChecks; i++) {
+    // areas from one cell to the whole map, so every level of the pyramid is read
+    auto size = std::exp2(getRandom(0.f, std::log2(float(std::max(gridWidth, gridDepth)))));
+    auto col = getRandom(-1.f, float(gridWidth)), row = getRandom(-1.f, float(gridDepth));
+    auto minX = getX(col), minZ = getZ(row), maxX = getX(col + size), maxZ = getZ(row + size);
+    differences += edited.getAreaMaxHeight(minX, minZ, maxX, maxZ) != built.getAreaMaxHeight(minX, minZ, maxX, maxZ);
+
+    // shallow rays from the top of the box cross many blocks of the ceiling
+    auto origin = Point3d(getRandom(min.getX(), max.getX()), max.getY(), getRandom(min.getZ(), max.getZ()));
+    auto target = Point3d(getRandom(min.getX(), max.getX()), min.getY(), getRandom(min.getZ(), max.getZ()));
+    auto ray = Ray(origin, target.getVectorBetween(origin).normalized());
+    float tLow, tHigh;
+    if (HeightMap::hasIntersectionWithBoundingBox(min, max, ray, tLow, tHigh)) differences += edited.getCeilingStart(ray, tLow, tHigh) != built.getCeilingStart(ray, tLow, tHigh);
+  }
+  return differences;
+}
+
+void Benchmark::checkHeightEdit() {
+  const auto &position = scene::heightMapPositions[heightEditScene];
+  const auto &size = scene::heightMapDimensions[heightEditScene];
+  const auto &material = scene::materials[heightEditScene];
+  const auto &center = scene::defaultCenter[heightEditScene];
+  auto original = MemorySource(MapReader(scene::heightMapPaths[heightEditScene]));
+  auto buildMap = [&](const HeightSource &source) {
+    auto heightMap = HeightMap(source, position, size, material);
+    heightMap.buildDetailLevels(2);
+    heightMap.buildVertexNormals();
+    heightMap.buildCeiling();
+    return heightMap;
+  };
+
+  // a bump at the center of the view and a pit in the corner, where the normals and the cells are clamped to the border
+  struct Edit {
+    unsigned firstRow, firstCol, rows, cols;
+    float base, peak; // height fraction of the map at the border of the edit and added at its center
+    std::vector<float> heights;
+  };
+  const auto originalMap = buildMap(original);
+  auto sample = originalMap.getGridCoordinates(center);
+  auto firstRow = unsigned(std::clamp(sample.getZ() - 12, 0, int(originalMap.getGridDepth()) - 23));
+  auto firstCol = unsigned(std::clamp(sample.getX() - 12, 0, int(originalMap.getGridWidth()) - 23));
+  std::vector<Edit> edits = {{firstRow, firstCol, 24, 24, .2f, .8f, {}}, {0, 0, 5, 7, 0.f, 0.f, {}}};
+  auto edited = original;
+  for (auto &edit : edits) {
+    std::vector<float> intensities(size_t(edit.rows) * edit.cols);
+    for (unsigned row = 0; row < edit.rows; row++) {
+      for (unsigned col = 0; col < edit.cols; col++) {
+        auto bump = std::sin(float(row) * std::numbers::pi_v<float> / float(edit.rows - 1)) * std::sin(float(col) * std::numbers::pi_v<float> / float(edit.cols - 1));
+        auto height = position.getY() + size.getY() * std::min(edit.base + edit.peak * bump, 1.f);
+        edit.heights.push_back(height);
+        // the same conversion as HeightMap::updateHeights, so both maps get the same intensities
+        intensities[size_t(row) * edit.cols + col] = (height - position.getY()) / size.getY();
+      }
+    }
+    edited.setIntensities(edit.firstRow, edit.firstCol, edit.rows, edit.cols, intensities);
+  }
+  std::vector<HeightMap> builtMaps;
+  builtMaps.push_back(buildMap(edited));
+
+  auto savedDetailLevels = scene::detailLevels;
+  auto savedReflectionDepth = scene::reflectionDepth;
+  scene::detailLevels = 2;
+  unsigned differences = 0, differingFrames = 0;
+  // the changed tiles alone are rendered again without the reflections, the whole frame with them
+  for (unsigned reflectionDepth : {0u, 2u}) {
+    scene::reflectionDepth = reflectionDepth;
+    std::vector<HeightMap> editedMaps;
+    editedMaps.push_back(buildMap(original));
+    Context editedContext(width, height, editedMaps, scene::defaultBgColor, center, scene::defaultEye[heightEditScene], scene::defaultUp);
+    for (const auto &edit : edits) editedContext.updateHeights(editedMaps[0], edit.firstRow, edit.firstCol, edit.rows, edit.cols, edit.heights);
+    Context builtContext(width, height, builtMaps, scene::defaultBgColor, center, scene::defaultEye[heightEditScene], scene::defaultUp);
+    if (editedContext.getColorBuffer().getChecksum() != builtContext.getColorBuffer().getChecksum()) {
+      differingFrames++;
+      out << "  frame of the edited map differs from the rebuilt map with reflection depth " << reflectionDepth << std::endl;
+    }
+    if (reflectionDepth > 0) continue;
+
+    differences += countGridDifferences(editedMaps[0], builtMaps[0]);
+    // the levels are found by the growing footprint, both maps have the same cells, so they switch to the next level together
+    auto footprint = std::min(size.getX() / float(builtMaps[0].getGridWidth()), size.getZ() / float(builtMaps[0].getGridDepth())) / scene::lodTolerance;
+    const auto *coarsest = &builtMaps[0].getDetailLevel(std::numeric_limits<float>::infinity());
+    for (const auto *previous = &builtMaps[0]; previous != coarsest; footprint *= 2.f) {
+      const auto &built = builtMaps[0].getDetailLevel(footprint);
+      if (&built == previous) continue;
+      differences += countGridDifferences(editedMaps[0].getDetailLevel(footprint), built);
+      previous = &built;
+    }
+  }
+  scene::detailLevels = savedDetailLevels;
+  scene::reflectionDepth = savedReflectionDepth;
+
+  heightEditDifferences += differences + differingFrames;
+  out << "height edit: " << differences << " values and " << differingFrames << " frames differ from the rebuilt map"
+    << (differences + differingFrames == 0 ? "" : " (should be 0)") << std::endl;
+}
+
+void Benchmark::checkScene(int sceneNumber) {
+  scene::sceneNumber = sceneNumber;
+  scene::heightMaps.clear();
+  const auto &path = scene::heightMapPaths[sceneNumber];
+  scene::heightMaps.emplace_back(HeightMap(MapReader(path), scene::heightMapPositions[sceneNumber], scene::heightMapDimensions[sceneNumber], scene::materials[sceneNumber]));
+  Context context(width, height, scene::heightMaps, scene::defaultBgColor, scene::defaultCenter[sceneNumber], scene::defaultEye[sceneNumber], scene::defaultUp);
+
+  Matrix4d inverseMatrix, inverseModelView;
+  context.getInverseMatrices(inverseMatrix, inverseModelView);
+  RayTracing rayTracing(inverseMatrix, inverseModelView, &context);
+  out << "scene " << sceneNumber << " (" << path << ")" << std::endl;
+  checkPixelAllocations(context, rayTracing);
+}
+
+void Benchmark::benchmarkScene(int sceneNumber) {
+  scene::sceneNumber = sceneNumber;
+  scene::heightMaps.clear();
+  const auto &path = scene::heightMapPaths[sceneNumber];
+  auto loadStart = std::chrono::steady_clock::now();
+  scene::heightMaps.emplace_back(HeightMap(MapReader(path), scene::heightMapPositions[sceneNumber], scene::heightMapDimensions[sceneNumber], scene::materials[sceneNumber]));
+  auto loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+  const auto &heightMap = scene::heightMaps[0];
+
+  // whole frames with the packet tracing and shading, the first one is rendered by the context constructor
+  std::unique_ptr<Context> context;
+  auto frameTime = measure([&] {
+    if (!context) {
+      context = std::make_unique<Context>(width, height, scene::heightMaps, scene::defaultBgColor, scene::defaultCenter[sceneNumber], scene::defaultEye[sceneNumber], scene::defaultUp);
+    } else {
+      context->rayTrace();
+    }
+  });
+
+  Matrix4d inverseMatrix, inverseModelView;
+  context->getInverseMatrices(inverseMatrix, inverseModelView);
+  RayTracing rayTracing(inverseMatrix, inverseModelView, context.get());
+  auto &pool = ThreadPool::getShared();
+
+  // primary rays alone, every row counts its traversal work (only with TRAVERSAL_STATISTICS)
+  std::vector<float> hitParameters(width * height);
+  std::vector<TraversalStatistics> rowStatistics(height);
+  auto primaryTime = measure([&] {
+    pool.parallelFor(height, [&](unsigned y) {
+      TraversalStatistics statistics;
+      TraversalStatistics::active = &statistics;
+      for (unsigned x = 0; x < width; x++) {
+        Intersection intersection;
+        auto hit = heightMap.findIntersection(rayTracing.getPrimaryRay(x, y), intersection);
+        hitParameters[y * width + x] = hit ? intersection.getT() : std::numeric_limits<float>::infinity();
+      }
+      TraversalStatistics::active = nullptr;
+      rowStatistics[y] = statistics;
+    });
+  });
+  TraversalStatistics statistics;
+  for (const auto &row : rowStatistics) statistics += row;
+  auto hits = std::count_if(hitParameters.begin(), hitParameters.end(), [](float t) { return t != std::numeric_limits<float>::infinity(); });
+
+  // shadow rays from the found intersections to all lights
+  std::vector<unsigned> rowOccluded(height);
+  auto shadowTime = measure([&] {
+    pool.parallelFor(height, [&](unsigned y) {
+      unsigned occluded = 0;
+      for (unsigned x = 0; x < width; x++) {
+        auto t = hitParameters[y * width + x];
+        if (t == std::numeric_limits<float>::infinity()) continue;
+        auto point = rayTracing.getPrimaryRay(x, y).getPointOnParameter(t);
+        for (const auto &light : context->getLights()) occluded += heightMap.isOccluded(point, light.getPosition());
+      }
+      rowOccluded[y] = occluded;
+    });
+  });
+  unsigned long long occluded = 0;
+  for (auto rowCount : rowOccluded) occluded += rowCount;
+
+  auto primaryRays = double(width) * double(height), shadowRays = double(hits) * double(context->getLights().size());
+  auto raysPerSecond = [](double rays, double milliseconds) { return rays / milliseconds / 1000.; };
+  out << "scene " << sceneNumber << " (" << path << ", " << heightMap.getGridWidth() + 1 << "x" << heightMap.getGridDepth() + 1 << " samples)" << std::endl;
+  out << "  load: " << loadTime << " ms" << std::endl;
+  out << "  frame: " << frameTime << " ms, " << raysPerSecond(primaryRays + shadowRays, frameTime) << " Mrays/s" << std::endl;
+  out << "  primary: " << primaryTime << " ms, " << raysPerSecond(primaryRays, primaryTime) << " Mrays/s, " << hits << " hits";
+#ifdef TRAVERSAL_STATISTICS
+  out << ", " << double(statistics.visitedCells) / primaryRays << " visited cells per ray";
+#endif
+  out << std::endl;
+  out << "  shadow: " << shadowTime << " ms, " << raysPerSecond(shadowRays, shadowTime) << " Mrays/s, " << occluded << " occluded" << std::endl;
+
+  checkPixelAllocations(*context, rayTracing);
+  benchmarkOctants(heightMap);
+}
+
+void Benchmark::benchmarkOctants(const HeightMap &heightMap) {
+#ifdef BLOCKED_LAYOUT
+  out << "  octants (samples in blocks, ns per ray):";
+#else
+  out << "  octants (samples by rows, ns per ray):";
+#endif
+  const auto &aabbMin = heightMap.getAabbMin(), &aabbMax = heightMap.getAabbMax();
+  auto mapHeight = aabbMax.getY() - aabbMin.getY();
+  for (unsigned octant = 0; octant < 8; octant++) {
+    auto signX = octant & 1 ? -1.f : 1.f, signY = octant & 2 ? -1.f : 1.f, signZ = octant & 4 ? -1.f : 1.f;
+    std::vector<Ray> rays;
+    for (unsigned i = 0; i < octantRays; i++) {
+      auto x = getRandom(aabbMin.getX(), aabbMax.getX()), z = getRandom(aabbMin.getZ(), aabbMax.getZ()), y = aabbMax.getY();
+      if (signY > 0.f) {
+        // rays going up enter through the side of the box against their direction, just above the border sample
+        if (i % 2 == 0) x = signX > 0.f ? aabbMin.getX() : aabbMax.getX();
+        else z = signZ > 0.f ? aabbMin.getZ() : aabbMax.getZ();
+        auto sample = heightMap.getGridCoordinates(Point3d(x, 0.f, z));
+        y = heightMap.getSampleHeight(sample.getZ(), sample.getX()) + mapHeight * .01f;
+      }
+      auto direction = Vector3d(signX * getRandom(.1f, 1.f), signY * getRandom(.05f, .3f), signZ * getRandom(.1f, 1.f));
+      rays.emplace_back(Point3d(x, y, z), direction.normalized());
+    }
+    unsigned long long hits = 0;
+    auto time = measure([&] {
+      for (const auto &ray : rays) {
+        Intersection intersection;
+        hits += heightMap.findIntersection(ray, intersection);
+      }
+    });
+    out << " " << (signX > 0.f ? '+' : '-') << (signY > 0.f ? '+' : '-') << (signZ > 0.f ? '+' : '-') << " " << time * 1e6 / double(octantRays);
+  }
+  out << std::endl;
+}
+
+void Benchmark::benchmarkManyLights() {
+  auto sceneNumber = scene::sceneNumber;
+  scene::lightSamples = manyLightSamples;
+  out << "many lights (scene " << sceneNumber << ", " << manyLightSamples << " samples per pixel)" << std::endl;
+  for (auto count : {0u, 64u, 1024u}) {
+    scene::cityLights = count;
+    std::unique_ptr<Context> context;
+    auto frameTime = measure([&] {
+      if (!context) {
+        context = std::make_unique<Context>(width, height, scene::heightMaps, scene::defaultBgColor, scene::defaultCenter[sceneNumber], scene::defaultEye[sceneNumber], scene::defaultUp);
+      } else {
+        context->rayTrace();
+      }
+    });
+    out << "  " << std::setw(5) << count << " city lights: " << frameTime << " ms";
+    if (context->getLightGrid()) out << ", " << context->getLightGrid()->getAverageLightCount() << " lights per terrain block";
+    out << std::endl;
+  }
+  scene::cityLights = 0;
+  scene::lightSamples = 0;
+}
+
+void Benchmark::benchmarkTriangle() {
+  std::vector<Triangle> triangles;
+  for (unsigned i = 0; i < microInputs; i++) {
+    triangles.emplace_back(Point3d(0.f, getRandom(0.f, 1.f), 0.f), Point3d(1.f, getRandom(0.f, 1.f), 0.f), Point3d(0.f, getRandom(0.f, 1.f), 1.f));
+  }
+  auto rays = getRandomRays(microInputs);
+  unsigned long long hits = 0;
+  auto time = measure([&] {
+    for (unsigned i = 0; i < microIterations; i++) {
+      float t;
+      hits += triangles[i % microInputs].getIntersection(rays[(i / microInputs + i) % microInputs], t);
+    }
+  });
+  printMicro("Triangle::getIntersection", time, hits);
+}
+
+void Benchmark::benchmarkCell() {
+  std::vector<Cell> cells;
+  for (unsigned i = 0; i < microInputs; i++) {
+    cells.emplace_back(getRandom(0.f, 1.f), getRandom(0.f, 1.f), getRandom(0.f, 1.f), getRandom(0.f, 1.f), 0.f, 0.f, 1.f, 1.f);
+  }
+  auto rays = getRandomRays(microInputs);
+  unsigned long long hits = 0;
+  auto time = measure([&] {
+    for (unsigned i = 0; i < microIterations; i++) {
+      Intersection intersection;
+      hits += cells[i % microInputs].findIntersection(rays[(i / microInputs + i) % microInputs], intersection);
+    }
+  });
+  printMicro("Cell::findIntersection", time, hits);
+}
+
+void Benchmark::benchmarkBilinearPatch() {
+  std::vector<float> corners;
+  for (unsigned i = 0; i < microInputs * 4; i++) corners.push_back(getRandom(0.f, 1.f));
+  auto rays = getRandomRays(microInputs);
+  unsigned long long hits = 0;
+  auto time = measure([&] {
+    for (unsigned i = 0; i < microIterations; i++) {
+      Intersection intersection;
+      const auto *cell = corners.data() + (i % microInputs) * 4;
+      const auto &ray = rays[(i / microInputs + i) % microInputs];
+      hits += BilinearPatch::findIntersection(ray, std::numeric_limits<float>::lowest(), std::numeric_limits<float>::infinity(), cell[0], cell[1], cell[2], cell[3],
+        0.f, 0.f, 1.f, 1.f, &intersection);
+    }
+  });
+  printMicro("BilinearPatch::findIntersection", time, hits);
+}
+
+void Benchmark::benchmarkBoundingBox() {
+  auto aabbMin = Point3d(.25f, 0.f, .25f), aabbMax = Point3d(.75f, .5f, .75f); // part of the rays misses the box
+  auto rays = getRandomRays(microInputs);
+  unsigned long long hits = 0;
+  auto time = measure([&] {
+    for (unsigned i = 0; i < microIterations; i++) {
+      float tLow, tHigh;
+      hits += HeightMap::hasIntersectionWithBoundingBox(aabbMin, aabbMax, rays[i % microInputs], tLow, tHigh);
+    }
+  });
+  printMicro("HeightMap::hasIntersectionWithBoundingBox", time, hits);
+}
+
+void Benchmark::benchmarkShading() {
+  auto rays = getRandomRays(microInputs);
+  std::vector<Intersection> intersections;
+  for (unsigned i = 0; i < microInputs; i++) {
+    auto normal = Vector3d(getRandom(-.5f, .5f), 1.f, getRandom(-.5f, .5f)).normalized();
+    intersections.emplace_back(getRandom(1.f, 2.f), normal);
+  }
+  auto materials = {Material(ColorChanging::FIELDS), Material(Color(.8f, .6f, .4f), .7f, .3f, 20.f)};
+  for (auto lightCount : {1u, 16u}) {
+    std::vector<Light> lights;
+    for (unsigned i = 0; i < lightCount; i++) lights.emplace_back(Point3d(getRandom(-1.f, 2.f), getRandom(2.f, 3.f), getRandom(-1.f, 2.f)), Color(.5f, .5f, .5f));
+    LightBatch batch(lights);
+    for (const auto &material : materials) {
+      unsigned long long bright = 0;
+      auto time = measure([&] {
+        for (unsigned i = 0; i < microIterations; i++) {
+          auto materialColor = material.isChangeColor() ? material.getColor(float(i % 100) / 100.f) : material.getColor();
+          auto color = Illumination::getDirectPhongIllumination(batch, material, materialColor, rays[i % microInputs], intersections[(i / microInputs + i) % microInputs]);
+          bright += color.getR() > .5f;
+        }
+      });
+      auto name = "Illumination, " + std::to_string(lightCount) + (lightCount == 1 ? " light, " : " lights, ") + (material.isChangeColor() ? "gradient" : "specular");
+      printMicro(name.c_str(), time, bright);
+    }
+  }
+}
+
+void Benchmark::benchmarkRational() {
+  std::vector<Rational> values;
+  std::uniform_int_distribution<long long> numerators(-1000, 1000), denominators(1, 1000);
+  for (unsigned i = 0; i < microInputs; i++) values.emplace_back(numerators(random), denominators(random));
+
+  auto measureOperation = [&](const char *name, auto operation) {
+    unsigned long long result = 0;
+    auto time = measure([&] {
+      for (unsigned i = 0; i < microIterations; i++) result += operation(values[i % microInputs], values[(i / microInputs + i + 1) % microInputs]);
+    });
+    printMicro(name, time, result);
+  };
+  measureOperation("Rational::operator+", [](const Rational &a, const Rational &b) { return (a + b) > 0; });
+  measureOperation("Rational::operator*", [](const Rational &a, const Rational &b) { return (a * b) > 0; });
+  measureOperation("Rational::operator/", [](const Rational &a, const Rational &b) { return b == 0 ? false : (a / b) > 0; });
+  measureOperation("Rational::operator<", [](const Rational &a, const Rational &b) { return a < b; });
+}
+
+bool Benchmark::run() {
+  scene::printTileStatistics = false;
+  scene::progressiveRendering = false;
+  out << std::fixed << std::setprecision(2);
+  out << "benchmark " << width << "x" << height << ", " << ThreadPool::getShared().getThreadCount() << " threads, best of " << repetitions << std::endl;
+  for (int sceneNumber = 0; sceneNumber < int(scene::heightMapPaths.size()); sceneNumber++) benchmarkScene(sceneNumber);
+  benchmarkManyLights();
+  checkDigitalLine();
+  checkHeightEdit();
+  out << "micro benchmarks" << std::endl;
+  benchmarkTriangle();
+  benchmarkCell();
+  benchmarkBilinearPatch();
+  benchmarkBoundingBox();
+  benchmarkShading();
+  benchmarkRational();
+  return pixelAllocations == 0 && digitalLineMismatches == 0 && heightEditDifferences == 0;
+}
+
+bool Benchmark::check() {
+  scene::printTileStatistics = false;
+  scene::progressiveRendering = false;
+  out << "checks " << width << "x" << height << ", " << ThreadPool::getShared().getThreadCount() << " threads" << std::endl;
+  for (int sceneNumber = 0; sceneNumber < int(scene::heightMapPaths.size()); sceneNumber++) checkScene(sceneNumber);
+  checkDigitalLine();
+  checkHeightEdit();
+  return pixelAllocations == 0 && digitalLineMismatches == 0 && heightEditDifferences == 0;
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "src/context/Context.h"
+#include "src/point/Point3d.h"
+#include "src/ray/Ray.h"
+#include "src/raytracing/RayTracing.h"
+
+/**
+ * Benchmark of the ray tracing core, renders scenes with fixed cameras without window and measures the hot functions alone
+ *
+ * For every scene it reports the whole frame time, rays per second, time of the primary and shadow rays measured in separate passes,
+ * and cells visited per primary ray (when built with TRAVERSAL_STATISTICS). Micro benchmarks measure triangle, cell and bounding box intersections, shading and rational arithmetic.
+ * The per-pixel path (primary ray, shading and shadow rays) is checked to do no heap allocation, the runs of the integer digital line
+ * are checked against the runs computed with Rational and the local rebuild of an edited map is checked against the whole rebuild.
+ */
+class Benchmark {
+  constexpr static const unsigned microIterations = 1u << 22; // calls of the measured function in one repetition
+  constexpr static const unsigned microInputs = 1024; // number of prepared inputs, the calls cycle over them
+  constexpr static const unsigned manyLightSamples = 4; // lights sampled per pixel by the many lights benchmark
+  constexpr static const unsigned octantRays = 1u << 14; // rays traced in every octant of the directions
+  constexpr static const unsigned digitalLineChecks = 1u << 16; // random lines whose runs are compared with the rational runs
+  constexpr static const unsigned heightEditChecks = 1u << 12; // random areas and rays compared between the edited and the rebuilt map
+  constexpr static const int heightEditScene = 2; // scene of the height editing check, its ice reflects
+
+  const unsigned width, height;
+  const unsigned repetitions;
+  std::ostream &out;
+  std::mt19937 random{2020}; // fixed seed, so every run measures the same inputs
+  uint64_t pixelAllocations = 0; // heap allocations found on the per-pixel path of all scenes
+  unsigned digitalLineMismatches = 0; // random lines whose runs differ from the rational runs
+  unsigned heightEditDifferences = 0; // values and frames of the edited map differing from the map built from the edited heights
+
+  /**
+   * Run the function repeatedly and get the shortest time
+   * @param function - measured function
+   * @return shortest time in milliseconds
+   */
+  template<typename Function>
+  [[nodiscard]] double measure(Function &&function) const {
+    auto best = std::numeric_limits<double>::infinity();
+    for (unsigned i = 0; i < repetitions; i++) {
+      auto start = std::chrono::steady_clock::now();
+      function();
+      best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+  }
+
+  /**
+   * Get random number in range
+   * @param low - lowest value
+   * @param high - highest value
+   * @return uniformly distributed number
+   */
+  [[nodiscard]] float getRandom(float low, float high);
+
+  /**
+   * Get rays from above the unit square at [0, 1] x [0, 1] going down through random points of the square
+   * @param count - number of rays
+   * @return random rays
+   */
+  [[nodiscard]] std::vector<Ray> getRandomRays(unsigned count);
+
+  /**
+   * Print time of one call of the micro benchmark
+   * @param name - name of the measured function
+   * @param milliseconds - time of all iterations
+   * @param result - result of the calls, printed so the calls can not be optimized out
+   */
+  void printMicro(const char *name, double milliseconds, unsigned long long result) const;
+
+  /**
+   * Trace and shade every tile of the frame by the path of the ray tracing, in the calling thread, and count its heap allocations
+   * @param context - context with the scene and camera
+   * @param rayTracing - ray tracing of the context camera
+   * @return number of allocations made by all pixels
+   */
+  [[nodiscard]] static uint64_t countPixelAllocations(const Context &context, const RayTracing &rayTracing);
+
+  /**
+   * Count heap allocations of the per-pixel path of the rendered frame and print them
+   * @param context - context with the scene and camera, its frame is rendered
+   * @param rayTracing - ray tracing of the context camera
+   */
+  void checkPixelAllocations(const Context &context, const RayTracing &rayTracing);
+
+  /**
+   * Get runs of the digital line by the Rational arithmetic, the computation DigitalLine replaced
+   * @param major - direction of the line in the major axis (positive)
+   * @param minor - direction of the line in the minor axis (positive, not scaled to 0)
+   * @param intercept - fractional part of minor coordinate of the line where it enters the start cell
+   * @param fromMajor - major coordinate of the start cell
+   * @param fromMinor - minor coordinate of the start cell
+   * @param majorCount - number of cells in the major axis
+   * @param minorCount - number of cells in the minor axis
+   * @return first major coordinate, last major coordinate and minor coordinate of every run
+   */
+  [[nodiscard]] static std::vector<std::array<int, 3>> getRationalRuns(float major, float minor, float intercept, int fromMajor, int fromMinor, int majorCount, int minorCount);
+
+  /**
+   * Compare runs of DigitalLine with the rational runs for random slopes, intercepts and start cells, print the differing lines
+   */
+  void checkDigitalLine();
+
+  /**
+   * Count values of the edited map differing from the map built from the edited samples: samples, vertex normals, maximal heights
+   * of the cells, maximal heights of random areas (levels of the pyramid) and ceiling starts of random rays
+   * @param edited - map whose samples were replaced by HeightMap::updateHeights
+   * @param built - map built from the samples after the edit, with the same structures
+   * @return number of differing values
+   */
+  [[nodiscard]] unsigned countGridDifferences(const HeightMap &edited, const HeightMap &built);
+
+  /**
+   * Edit two rectangles of the samples through Context::updateHeights, one in the view and one in the corner, and compare the map,
+   * its levels of detail and the re-rendered frame (without and with the reflections) with the map built from the edited samples
+   */
+  void checkHeightEdit();
+
+  /**
+   * Load the scene height map, render it without measuring and check the allocations of its per-pixel path
+   * @param sceneNumber - number of the scene
+   */
+  void checkScene(int sceneNumber);
+
+  /**
+   * Load the scene height map, render it and print measured times
+   * @param sceneNumber - number of the scene
+   */
+  void benchmarkScene(int sceneNumber);
+
+  /**
+   * Measure rays of every octant of the directions alone, in the calling thread, so the layout of the samples in memory
+   * can be compared between the builds (rows and BLOCKED_LAYOUT)
+   * Rays go at shallow slopes, down from the top of the bounding box or up from the side of the box just above the surface
+   * @param heightMap - traced height map
+   */
+  void benchmarkOctants(const HeightMap &heightMap);
+
+  /**
+   * Measure frames of the last benchmarked scene with growing number of the city lights, the lights are sampled per pixel
+   */
+  void benchmarkManyLights();
+
+  /**
+   * Measure Triangle::getIntersection
+   */
+  void benchmarkTriangle();
+
+  /**
+   * Measure Cell::findIntersection
+   */
+  void benchmarkCell();
+
+  /**
+   * Measure BilinearPatch::findIntersection on the same cells as the cell benchmark
+   */
+  void benchmarkBilinearPatch();
+
+  /**
+   * Measure HeightMap::hasIntersectionWithBoundingBox
+   */
+  void benchmarkBoundingBox();
+
+  /**
+   * Measure Illumination::getDirectPhongIllumination with one light and with many lights
+   */
+  void benchmarkShading();
+
+  /**
+   * Measure Rational arithmetic and comparison
+   */
+  void benchmarkRational();
+
+public:
+  /**
+   * Create benchmark
+   * @param width - width of the rendered images
+   * @param height - height of the rendered images
+   * @param repetitions - number of repetitions of every measurement, the shortest time is reported
+   * @param out - output for the results
+   */
+  explicit Benchmark(unsigned width, unsigned height, unsigned repetitions, std::ostream &out);
+
+  /**
+   * Run benchmarks of all scenes and all micro benchmarks
+   * @return false if the per-pixel path allocated memory, the digital line differs from the rational runs or the edited map differs
+   * from the rebuilt one
+   */
+  bool run();
+
+  /**
+   * Run only the checks of all scenes without the measurements: allocations of the per-pixel path, digital line and height editing
+   * @return false if any check failed
+   */
+  bool check();
+};
@@ -0,0 +1,49 @@
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+thread_local uint64_t AllocationCounter::threadAllocations = 0;
+
+void AllocationCounter::countAllocation() {
+  threadAllocations++;
+}
+
+uint64_t AllocationCounter::getThreadAllocations() {
+  return threadAllocations;
+}
+
+void *operator new(std::size_t size) {
+  AllocationCounter::countAllocation();
+  if (auto pointer = std::malloc(size == 0 ? 1 : size)) return pointer;
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  AllocationCounter::countAllocation();
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void *pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
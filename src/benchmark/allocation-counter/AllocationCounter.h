@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Counter of the heap allocations, the benchmark replaces the global operator new to count every call
+ */
+class AllocationCounter {
+  static thread_local uint64_t threadAllocations;
+
+public:
+  /**
+   * Count one allocation of the calling thread, called by the replaced operator new
+   */
+  static void countAllocation();
+
+  /**
+   * Get number of allocations made by the calling thread since it started
+   * @return number of allocations of the thread
+   */
+  [[nodiscard]] static uint64_t getThreadAllocations();
+};
@@ -0,0 +1,30 @@
+#include <iostream>
+#include <string>
+
+#include "Benchmark.h"
+#include "src/scene.h"
+
+/**
+ * Benchmark of the ray tracing core, run from the exe directory so the scene maps in ../data are found
+ * Usage: benchmark ?[repetitions] ?[width] ?[height], or benchmark --check ?[width] ?[height] to run only the checks without the measurements
+ * Returns 1 if the per-pixel path allocated memory, the digital line differs from the rational runs or the edited map differs
+ * from the rebuilt one, so it can be used as a check
+ */
+int main(int argc, char **argv) {
+  auto checkOnly = argc > 1 && std::string(argv[1]) == "--check";
+  unsigned values[] = {5, scene::defaultWidth, scene::defaultHeight};
+  unsigned next = checkOnly ? 1 : 0; // index of the next parsed value, the checks measure nothing, so they take only the size
+  for (int i = checkOnly ? 2 : 1; i < argc && next < 3; i++) {
+    try {
+      auto value = std::stoi(argv[i]);
+      if (value <= 0) throw std::invalid_argument("not positive");
+      values[next++] = unsigned(value);
+    } catch (const std::exception &) {
+      std::cerr << "usage: " << argv[0] << " ?[repetitions] ?[width] ?[height]" << std::endl;
+      std::cerr << "       " << argv[0] << " --check ?[width] ?[height]" << std::endl;
+      return 1;
+    }
+  }
+  Benchmark benchmark(values[1], values[2], values[0], std::cout);
+  return (checkOnly ? benchmark.check() : benchmark.run()) ? 0 : 1;
+}
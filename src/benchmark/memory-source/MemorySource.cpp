@@ -0,0 +1,30 @@
+#include <algorithm>
+
+#include "MemorySource.h"
+
+MemorySource::MemorySource(const HeightSource &source)
+  : width(source.getImageWidth()), depth(source.getImageHeight()), intensities(size_t(width) * depth) {
+  for (unsigned row = 0; row < depth; row++) source.readRow(row, 0, width, intensities.data() + size_t(row) * width);
+}
+
+void MemorySource::setIntensities(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const std::vector<float> &values) {
+  for (unsigned row = 0; row < rows; row++) {
+    std::copy_n(values.begin() + size_t(row) * cols, cols, intensities.begin() + size_t(firstRow + row) * width + firstCol);
+  }
+}
+
+unsigned MemorySource::getImageWidth() const {
+  return width;
+}
+
+unsigned MemorySource::getImageHeight() const {
+  return depth;
+}
+
+void MemorySource::readRow(unsigned row, unsigned firstCol, unsigned count, float *intensities) const {
+  std::copy_n(this->intensities.begin() + size_t(row) * width + firstCol, count, intensities);
+}
+
+size_t MemorySource::getMemorySize() const {
+  return intensities.size() * sizeof(float);
+}
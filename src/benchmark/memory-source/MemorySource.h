@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include "src/heightmap/heightmap-reader/HeightSource.h"
+
+/**
+ * Source of height samples held in memory, the check of the height editing builds the edited map from it again
+ */
+class MemorySource : public HeightSource {
+  unsigned width, depth; // number of samples in a row and number of rows
+  std::vector<float> intensities; // intensities of all samples row by row
+
+public:
+  /**
+   * Create source with all samples of the other source
+   * @param source - source whose samples are read
+   */
+  explicit MemorySource(const HeightSource &source);
+
+  /**
+   * Replace intensities of a rectangle of the samples
+   * @param firstRow - row of the first replaced sample
+   * @param firstCol - column of the first replaced sample
+   * @param rows - number of the replaced rows
+   * @param cols - number of the replaced columns
+   * @param values - rows * cols intensities row by row
+   */
+  void setIntensities(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const std::vector<float> &values);
+
+  /**
+   * Get width of the map
+   * @return number of samples in one row
+   */
+  [[nodiscard]] unsigned getImageWidth() const override;
+
+  /**
+   * Get height of the map
+   * @return number of rows
+   */
+  [[nodiscard]] unsigned getImageHeight() const override;
+
+  /**
+   * Read intensities of a part of one row
+   * @param row - row to read
+   * @param firstCol - first column to read
+   * @param count - number of columns to read
+   * @param intensities - array with count values, where the intensities are stored
+   */
+  void readRow(unsigned row, unsigned firstCol, unsigned count, float *intensities) const override;
+
+  /**
+   * Get memory held by the samples
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getMemorySize() const override;
+};
@@ -0,0 +1,63 @@
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "CameraPath.h"
+
+bool CameraPath::readTriple(std::istream &stream, float &x, float &y, float &z) {
+  char first = 0, second = 0;
+  stream >> x >> first >> y >> second >> z;
+  return !stream.fail() && first == ',' && second == ',';
+}
+
+float CameraPath::interpolate(float p0, float p1, float p2, float p3, float u) {
+  return 0.5f * (2.f * p1 + (p2 - p0) * u + (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * u * u + (3.f * p1 - p0 - 3.f * p2 + p3) * u * u * u);
+}
+
+CameraPath::CameraPath(const std::string &fileName) {
+  std::ifstream file(fileName);
+  if (!file) {
+    std::cerr << "camera path " << fileName << " can not be read" << std::endl;
+    throw std::invalid_argument("camera path can not be read");
+  }
+  std::string line;
+  unsigned lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    auto first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') continue;
+    std::istringstream stream(line);
+    float ex, ey, ez, cx, cy, cz;
+    if (!readTriple(stream, ex, ey, ez) || !readTriple(stream, cx, cy, cz)) {
+      std::cerr << "invalid camera on line " << lineNumber << " of " << fileName << ", expected ex,ey,ez cx,cy,cz" << std::endl;
+      throw std::invalid_argument("invalid camera path");
+    }
+    keys.push_back(Key{Vector3d(ex, ey, ez), Point3d(cx, cy, cz)});
+  }
+  if (keys.empty()) {
+    std::cerr << "camera path " << fileName << " has no cameras" << std::endl;
+    throw std::invalid_argument("empty camera path");
+  }
+}
+
+unsigned CameraPath::getKeyCount() const {
+  return keys.size();
+}
+
+void CameraPath::getCamera(unsigned frame, unsigned frameCount, Vector3d &eye, Point3d &center) const {
+  auto last = int(keys.size()) - 1;
+  auto position = frameCount > 1 ? float(frame) / float(frameCount - 1) * float(last) : 0.f;
+  auto segment = std::min(int(std::floor(position)), std::max(last - 1, 0));
+  auto u = position - float(segment);
+  // end points of the path are repeated
+  const auto &k0 = keys[std::max(segment - 1, 0)], &k1 = keys[segment];
+  const auto &k2 = keys[std::min(segment + 1, last)], &k3 = keys[std::min(segment + 2, last)];
+  float e[3], c[3];
+  for (unsigned d = 0; d < 3; d++) {
+    e[d] = interpolate(k0.eye.get(d), k1.eye.get(d), k2.eye.get(d), k3.eye.get(d), u);
+    c[d] = interpolate(k0.center.get(d), k1.center.get(d), k2.center.get(d), k3.center.get(d), u);
+  }
+  eye = Vector3d(e[0], e[1], e[2]);
+  center = Point3d(c[0], c[1], c[2]);
+}
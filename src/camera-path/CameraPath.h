@@ -0,0 +1,69 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "src/point/Point3d.h"
+#include "src/vector/Vector3d.h"
+
+/**
+ * Path of the camera for the fly-through, given by key positions of the eye and of the center of the view
+ *
+ * Camera between the key positions moves along Catmull-Rom spline, so the movement is smooth and goes through all key positions
+ */
+class CameraPath {
+  /**
+   * Key position of the camera
+   */
+  struct Key {
+    Vector3d eye;
+    Point3d center;
+  };
+
+  std::vector<Key> keys;
+
+  /**
+   * Parse three comma separated numbers
+   * @param stream - stream with text in format x,y,z
+   * @param x - parsed x
+   * @param y - parsed y
+   * @param z - parsed z
+   * @return true if the numbers were parsed
+   */
+  static bool readTriple(std::istream &stream, float &x, float &y, float &z);
+
+  /**
+   * Interpolate Catmull-Rom spline between p1 and p2
+   * @param p0 - point before the segment
+   * @param p1 - start of the segment
+   * @param p2 - end of the segment
+   * @param p3 - point after the segment
+   * @param u - position in the segment (0 - 1)
+   * @return interpolated value
+   */
+  [[nodiscard]] static float interpolate(float p0, float p1, float p2, float p3, float u);
+
+public:
+  /**
+   * Read the path from text file, every line holds one key position as eye and center separated by space: ex,ey,ez cx,cy,cz
+   * Empty lines and lines starting with # are skipped
+   * @param fileName - name of the file
+   */
+  explicit CameraPath(const std::string &fileName);
+
+  /**
+   * Get number of the key positions
+   * @return number of key positions
+   */
+  [[nodiscard]] unsigned getKeyCount() const;
+
+  /**
+   * Get camera of one frame, the first frame is in the first key position and the last frame in the last one
+   * @param frame - index of the frame
+   * @param frameCount - number of frames of the whole path
+   * @param eye - where the eye position is stored
+   * @param center - where the center of the view is stored
+   */
+  void getCamera(unsigned frame, unsigned frameCount, Vector3d &eye, Point3d &center) const;
+};
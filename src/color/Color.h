@@ -2,11 +2,13 @@
 
 #include <string>
 #include <ostream>
+#include <type_traits>
 
 /**
  * Type for rgb color.
  *
  * Provides basic meaningful operation (+, -, *, /) with rgb color.
+ * Operations are inline in the header, so temporaries on the per-pixel path stay in registers
  */
 class Color {
   float r, g, b;
@@ -14,7 +16,7 @@ public:
   /**
    * Create white color
    */
-  explicit Color();
+  constexpr explicit Color() : r(0.f), g(0.f), b(0.f) {}
 
   /**
    * Create color with provided rgb values
@@ -22,27 +24,105 @@ public:
    * @param g - green
    * @param b - blue
    */
-  explicit Color(float r, float g, float b);
+  constexpr explicit Color(float r, float g, float b) : r(r), g(g), b(b) {}
 
-  Color operator+(const Color &other) const;
-  Color operator+=(const Color &other);
+  constexpr Color operator+(const Color &other) const {
+    return Color(r + other.r, g + other.g, b + other.b);
+  }
 
-  Color operator-(const Color &other) const;
-  Color operator-=(const Color &other);
+  constexpr Color operator+=(const Color &other) {
+    r += other.r;
+    g += other.g;
+    b += other.b;
+    return *this;
+  }
 
-  Color operator*(const Color &other) const;
-  Color operator*=(const Color &other);
+  constexpr Color operator-(const Color &other) const {
+    return Color(r - other.r, g - other.g, b - other.b);
+  }
 
-  Color operator/(const Color &other) const;
-  Color operator/=(const Color &other);
+  constexpr Color operator-=(const Color &other) {
+    r -= other.r;
+    g -= other.g;
+    b -= other.b;
+    return *this;
+  }
 
-  Color operator*(float k) const;
-  friend Color operator*(float k, const Color &color);
-  Color operator*=(float k);
+  constexpr Color operator*(const Color &other) const {
+    return Color(r * other.r, g * other.g, b * other.b);
+  }
 
-  Color operator/(float k) const;
-  Color operator/=(float k);
+  constexpr Color operator*=(const Color &other) {
+    r *= other.r;
+    g *= other.g;
+    b *= other.b;
+    return *this;
+  }
+
+  constexpr Color operator/(const Color &other) const {
+    return Color(r / other.r, g / other.g, b / other.b);
+  }
+
+  constexpr Color operator/=(const Color &other) {
+    r /= other.r;
+    g /= other.g;
+    b /= other.b;
+    return *this;
+  }
+
+  constexpr Color operator*(float k) const {
+    return Color(r * k, g * k, b * k);
+  }
+
+  constexpr friend Color operator*(float k, const Color &color) {
+    return Color(color.r * k, color.g * k, color.b * k);
+  }
+
+  constexpr Color operator*=(float k) {
+    r *= k;
+    g *= k;
+    b *= k;
+    return *this;
+  }
+
+  constexpr Color operator/(float k) const {
+    return Color(r / k, g / k, b / k);
+  }
+
+  constexpr Color operator/=(float k) {
+    r /= k;
+    g /= k;
+    b /= k;
+    return *this;
+  }
 
   [[nodiscard]] std::string to_string() const;
   friend std::ostream &operator<<(std::ostream &out, const Color &c);
+
+  /**
+   * Get red component of the color
+   * @return red
+   */
+  [[nodiscard]] constexpr float getR() const {
+    return r;
+  }
+
+  /**
+   * Get green component of the color
+   * @return green
+   */
+  [[nodiscard]] constexpr float getG() const {
+    return g;
+  }
+
+  /**
+   * Get blue component of the color
+   * @return blue
+   */
+  [[nodiscard]] constexpr float getB() const {
+    return b;
+  }
 };
+
+static_assert(sizeof(Color) == 3 * sizeof(float), "color buffer is passed to OpenGL as packed GL_RGB floats");
+static_assert(std::is_trivially_copyable_v<Color>, "colors are copied as plain floats on the per-pixel path");
@@ -1,34 +1,96 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
 #include "Context.h"
+#include "src/counter-random/CounterRandom.h"
+#include "src/profiler/Profiler.h"
 #include "src/raytracing/RayTracing.h"
 
 
-Context::Context(unsigned int width, unsigned int height, const HeightMap *heightMap, const Color &bgColor)
-  : width(width), height(height), colorBuffer(height),
-  heightMap(heightMap),
+Context::Context(unsigned int width, unsigned int height, const std::vector<HeightMap> &heightMaps, const Color &bgColor)
+  : Context(width, height, heightMaps, bgColor, scene::defaultCenter[scene::sceneNumber], scene::defaultEye[scene::sceneNumber], scene::defaultUp) {}
+
+Context::Context(unsigned int width, unsigned int height, const std::vector<HeightMap> &heightMaps, const Color &bgColor, const Point3d &center, const Vector3d &eye, const Vector3d &up,
+  bool render)
+  : width(width), height(height),
+  lights(createLights(heightMaps)),
+  lightBatch(lights),
+  colorBuffer(size_t(width) * height, scene::framebufferFormat), depthBuffer(width * height, std::numeric_limits<float>::infinity()),
   bgColor(bgColor),
-  viewport(0, 0, float(width) / 2.f, float(height) / 2.f),
-  lights{scene::lights[scene::sceneNumber]} {
-  for (auto i = 0; i < height; i++) colorBuffer[i] = std::vector<Color>(width);
+  heightMaps(heightMaps),
+  viewport(0, 0, float(width) / 2.f, float(height) / 2.f) {
+  if (scene::cityLights > 0) lightGrid = std::make_unique<const LightGrid>(lights, this->heightMaps);
 
   auto fovRad = (scene::fov / 180.f) * std::numbers::pi;
   auto h = tan(fovRad / 2) * scene::zNear;
   auto w = h * float(width) / float(height);
   projection.multiplyTop(Matrix4d::getProjectionMatrix(-w, w, -h, h, scene::zNear, scene::zFar));
 
-  lookAt(scene::defaultCenter[scene::sceneNumber], scene::defaultEye[scene::sceneNumber], scene::defaultUp);
-  rayTrace();
+  if (scene::heatmap != TraversalStatistics::Counter::none) statisticsBuffer.resize(width * height);
+  lookAt(center, eye, up);
+  if (!render) return;
+  if (scene::progressiveRendering) {
+    startProgressiveRayTrace();
+  } else if (!scene::gpuTraversal) { // the gpu tracer of the window traces the frames itself
+    rayTrace();
+  }
+}
+
+Context::~Context() {
+  stopRenderThread();
 }
 
-Context::Context() : Context(scene::defaultWidth, scene::defaultHeight, &scene::heightMaps[0], scene::defaultBgColor) {}
+void Context::stopRenderThread() {
+  stopRendering = true;
+  if (renderThread.joinable()) renderThread.join();
+  rendering = false;
+}
+
+Context::Context() : Context(scene::defaultWidth, scene::defaultHeight, scene::heightMaps, scene::bgColor) {}
 
 const std::vector<Light> &Context::getLights() const {
   return lights;
 }
 
-const std::vector<std::vector<Color>> &Context::getColorBuffer() const {
+const LightBatch &Context::getLightBatch() const {
+  return lightBatch;
+}
+
+const LightGrid *Context::getLightGrid() const {
+  return lightGrid.get();
+}
+
+std::vector<Light> Context::createLights(const std::vector<HeightMap> &heightMaps) {
+  auto lights = scene::sceneLights.empty() ? std::vector<Light>{scene::lights[scene::sceneNumber]} : scene::sceneLights;
+  if (heightMaps.empty()) return lights;
+  // every property of the light has its own key, so the lights are the same with every standard library
+  for (unsigned i = 0; i < scene::cityLights; i++) {
+    auto mapIndex = std::min(size_t(CounterRandom::get(i, 0, cityLightSeed) * float(heightMaps.size())), heightMaps.size() - 1);
+    const auto &heightMap = heightMaps[mapIndex];
+    auto x = CounterRandom::get(i, 1, cityLightSeed, heightMap.getAabbMin().getX(), heightMap.getAabbMax().getX());
+    auto z = CounterRandom::get(i, 2, cityLightSeed, heightMap.getAabbMin().getZ(), heightMap.getAabbMax().getZ());
+    auto sample = heightMap.getGridCoordinates(Point3d(x, 0.f, z));
+    auto y = heightMap.getSampleHeight(sample.getZ(), sample.getX()) + cityLightHeight;
+    // warm street lights of random brightness
+    auto brightness = CounterRandom::get(i, 3, cityLightSeed, .5f, 1.f);
+    lights.emplace_back(Point3d(x, y, z), Color(1.f, .8f, .5f) * brightness, cityLightRange);
+  }
+  return lights;
+}
+
+const FrameBuffer &Context::getColorBuffer() const {
   return colorBuffer;
 }
 
+void Context::reportMemory(MemoryReport &report) const {
+  report.add("framebuffers", colorBuffer.getMemorySize() + (depthBuffer.size() + startBuffer.size()) * sizeof(float)
+    + statisticsBuffer.size() * sizeof(TraversalStatistics));
+  report.add("lights", lights.size() * sizeof(Light));
+  heightMaps.reportMemory(report);
+}
+
 unsigned Context::getWidth() const {
   return width;
 }
@@ -37,8 +99,8 @@ unsigned Context::getHeight() const {
   return height;
 }
 
-const HeightMap *Context::getHeightMap() const {
-  return heightMap;
+const HeightMapBvh &Context::getHeightMaps() const {
+  return heightMaps;
 }
 
 const Color &Context::getBgColor() const {
@@ -46,10 +108,55 @@ const Color &Context::getBgColor() const {
 }
 
 void Context::setToColorBuffer(unsigned int x, unsigned int y, const Color &color) {
-  colorBuffer[x][y] = color;
+  colorBuffer.set(y * width + x, color);
+}
+
+void Context::setToDepthBuffer(unsigned int x, unsigned int y, float t) {
+  depthBuffer[y * width + x] = t;
+}
+
+const std::vector<float> &Context::getDepthBuffer() const {
+  return depthBuffer;
+}
+
+void Context::setToStatisticsBuffer(unsigned int x, unsigned int y, const TraversalStatistics &statistics) {
+  if (!statisticsBuffer.empty()) statisticsBuffer[y * width + x] = statistics;
+}
+
+Color Context::getHeatColor(float value) {
+  const Color stops[] = {Color(0.f, 0.f, .3f), Color(0.f, 0.f, 1.f), Color(0.f, 1.f, 1.f), Color(0.f, 1.f, 0.f), Color(1.f, 1.f, 0.f), Color(1.f, 0.f, 0.f)};
+  constexpr auto last = sizeof(stops) / sizeof(stops[0]) - 1;
+  auto position = std::clamp(value, 0.f, 1.f) * float(last);
+  auto index = std::min(unsigned(position), unsigned(last) - 1);
+  auto fraction = position - float(index);
+  return stops[index] * (1.f - fraction) + stops[index + 1] * fraction;
+}
+
+void Context::showHeatmap() {
+  std::vector<uint64_t> values;
+  values.reserve(statisticsBuffer.size());
+  for (const auto &statistics : statisticsBuffer) values.push_back(statistics.get(scene::heatmap));
+  auto sorted = values;
+  auto percentile = sorted.begin() + std::ptrdiff_t(float(sorted.size() - 1) * heatmapPercentile);
+  std::nth_element(sorted.begin(), percentile, sorted.end());
+  auto scale = float(std::max(*percentile, uint64_t(1)));
+  for (size_t i = 0; i < values.size(); i++) colorBuffer.set(i, getHeatColor(float(values[i]) / scale));
+}
+
+float Context::getStartDistance(unsigned int x, unsigned int y) const {
+  return startBuffer.empty() ? std::numeric_limits<float>::lowest() : startBuffer[y * width + x];
+}
+
+void Context::markChanged() {
+  changeCount++;
+}
+
+unsigned Context::getChangeCount() const {
+  return changeCount;
 }
 
 void Context::lookAt(Point3d center, Vector3d eye, Vector3d up) {
+  Profiler::Scope scope("camera setup");
   auto z = (eye - center).normalized();
   auto x = up.crossProduct(z).normalized();
   auto y = z.crossProduct(x).normalized();
@@ -64,14 +171,193 @@ void Context::lookAt(Point3d center, Vector3d eye, Vector3d up) {
   modelView.multiplyTop(matrix);
 }
 
-void Context::rayTrace() {
+void Context::getInverseMatrices(Matrix4d &inverseMatrix, Matrix4d &inverseModelView) const {
   auto modelViewProjection = modelView.top();
   auto invertedModelViewProjection = modelViewProjection.getInverted();
 
   auto viewportProjection = viewport.getViewportMatrix() * projection.top();
   auto invertedViewportProjection = viewportProjection.getInverted();
 
-  RayTracing rayTracing(invertedModelViewProjection * invertedViewportProjection, invertedModelViewProjection, this);
+  inverseMatrix = invertedModelViewProjection * invertedViewportProjection;
+  inverseModelView = invertedModelViewProjection;
+}
+
+void Context::reprojectDepth(const Matrix4d &previousInverseMatrix, const Matrix4d &previousInverseModelView) {
+  RayTracing previous(previousInverseMatrix, previousInverseModelView, this);
+  auto toScreen = viewport.getViewportMatrix() * projection.top() * modelView.top();
+  Matrix4d inverseMatrix, inverseModelView;
+  getInverseMatrices(inverseMatrix, inverseModelView);
+  auto eye = (inverseModelView * Vector4d(0, 0, 0, 1)).divideByW();
+
+  startBuffer.assign(width * height, std::numeric_limits<float>::infinity());
+  for (unsigned y = 0; y < height; y++) {
+    for (unsigned x = 0; x < width; x++) {
+      auto t = depthBuffer[y * width + x];
+      if (t == std::numeric_limits<float>::infinity()) continue;
+      auto point = previous.getPrimaryRay(x, y).getPointOnParameter(t);
+      auto screen = toScreen * Vector4d(point.getX(), point.getY(), point.getZ());
+      if (screen.getW() <= 0.f) continue; // behind the camera
+      auto projected = screen.divideByW();
+      // pixel x, y is traced through its center x + 1/2, y + 1/2
+      auto column = int(std::floor(projected.getX())), row = int(std::floor(projected.getY()));
+      auto start = point.getVectorBetween(eye).length() * reprojectionMargin;
+      for (auto j = std::max(row - 1, 0); j <= std::min(row + 1, int(height) - 1); j++) {
+        for (auto i = std::max(column - 1, 0); i <= std::min(column + 1, int(width) - 1); i++) {
+          auto &pixelStart = startBuffer[j * width + i];
+          pixelStart = std::min(pixelStart, start);
+        }
+      }
+    }
+  }
+  for (auto &start : startBuffer) {
+    if (start == std::numeric_limits<float>::infinity()) start = std::numeric_limits<float>::lowest();
+  }
+}
+
+void Context::setCamera(const Point3d &center, const Vector3d &eye, const Vector3d &up) {
+  stopRenderThread();
+  Matrix4d previousInverseMatrix, previousInverseModelView;
+  getInverseMatrices(previousInverseMatrix, previousInverseModelView);
+
+  modelView.loadIdentity();
+  lookAt(center, eye, up);
+  if (scene::reprojectDepth) reprojectDepth(previousInverseMatrix, previousInverseModelView);
+}
+
+void Context::setHeightMaps(const std::vector<HeightMap> &heightMaps) {
+  stopRenderThread();
+
+  this->heightMaps = HeightMapBvh(heightMaps);
+  lights = createLights(heightMaps);
+  lightBatch = LightBatch(lights);
+  lightGrid.reset();
+  if (scene::cityLights > 0) lightGrid = std::make_unique<const LightGrid>(lights, this->heightMaps);
+  startBuffer.clear(); // intersections of the previous frame do not bound the rays into the new maps
+}
+
+void Context::findAffectedPixels(const Point3d &changedMin, const Point3d &changedMax, unsigned &minX, unsigned &minY, unsigned &maxX, unsigned &maxY) const {
+  minX = 0;
+  minY = 0;
+  maxX = width;
+  maxY = height;
+  auto bottom = heightMaps.getHeightMap(0).getAabbMin().getY();
+  for (unsigned i = 1; i < heightMaps.getHeightMapCount(); i++) bottom = std::min(bottom, heightMaps.getHeightMap(i).getAabbMin().getY());
+
+  std::vector<Point3d> points;
+  auto addBox = [&points](const Point3d &boxMin, const Point3d &boxMax) {
+    for (unsigned corner = 0; corner < 8; corner++) {
+      points.emplace_back(corner & 1 ? boxMax.getX() : boxMin.getX(), corner & 2 ? boxMax.getY() : boxMin.getY(), corner & 4 ? boxMax.getZ() : boxMin.getZ());
+    }
+  };
+  addBox(changedMin, changedMax);
+  auto range = 0.f;
+  for (const auto &light : lights) {
+    if (light.getRange() != std::numeric_limits<float>::infinity()) {
+      range = std::max(range, light.getRange());
+      continue;
+    }
+    const auto &position = light.getPosition();
+    if (position.getY() <= changedMax.getY()) return; // the shadow is not bounded by the bottom
+    for (unsigned corner = 0; corner < 8; corner++) {
+      auto point = points[corner]; // copied, the vector grows
+      auto scale = (position.getY() - bottom) / (position.getY() - point.getY());
+      points.emplace_back(position.getX() + (point.getX() - position.getX()) * scale, bottom, position.getZ() + (point.getZ() - position.getZ()) * scale);
+    }
+  }
+  if (range > 0.f) {
+    addBox(Point3d(changedMin.getX() - range, bottom, changedMin.getZ() - range), Point3d(changedMax.getX() + range, changedMax.getY() + range, changedMax.getZ() + range));
+  }
+
+  // projection of the convex hull of the points lies in the rectangle of the projected points, one pixel around covers the rounding
+  auto toScreen = viewport.getViewportMatrix() * projection.top() * modelView.top();
+  auto left = std::numeric_limits<int>::max(), top = left, right = std::numeric_limits<int>::lowest(), bottomRow = right;
+  for (const auto &point : points) {
+    auto screen = toScreen * Vector4d(point.getX(), point.getY(), point.getZ());
+    if (screen.getW() <= 0.f) return; // behind the camera, the rectangle is not bounded
+    auto projected = screen.divideByW();
+    auto column = int(std::floor(projected.getX())), row = int(std::floor(projected.getY()));
+    left = std::min(left, column - 1);
+    right = std::max(right, column + 2);
+    top = std::min(top, row - 1);
+    bottomRow = std::max(bottomRow, row + 2);
+  }
+  minX = unsigned(std::clamp(left, 0, int(width)));
+  maxX = unsigned(std::clamp(right, 0, int(width)));
+  minY = unsigned(std::clamp(top, 0, int(height)));
+  maxY = unsigned(std::clamp(bottomRow, 0, int(height)));
+}
+
+void Context::updateHeights(HeightMap &heightMap, unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const std::vector<float> &heights) {
+  stopRenderThread();
+
+  auto hadHorizonMap = heightMap.getHorizonMap() != nullptr;
+  Point3d changedMin, changedMax;
+  heightMap.updateHeights(firstRow, firstCol, rows, cols, heights, changedMin, changedMax);
+  // terrain blocks of the light grid bound the heights, so the lights reaching them are culled again
+  if (lightGrid) lightGrid = std::make_unique<const LightGrid>(lights, heightMaps);
+
+  unsigned minX = 0, minY = 0, maxX = width, maxY = height;
+  // reflected rays can show the change anywhere on the reflective terrain, only the direct and shadow rays are bounded
+  if (!hadHorizonMap && scene::reflectionDepth == 0) findAffectedPixels(changedMin, changedMax, minX, minY, maxX, maxY);
+  if (minX >= maxX || minY >= maxY) return;
+  // reprojected starts of the previous frame would skip the raised terrain
+  if (!startBuffer.empty()) {
+    for (auto y = minY; y < maxY; y++) std::fill(startBuffer.begin() + y * width + minX, startBuffer.begin() + y * width + maxX, std::numeric_limits<float>::lowest());
+  }
+
+  Matrix4d inverseMatrix, inverseModelView;
+  getInverseMatrices(inverseMatrix, inverseModelView);
+  RayTracing rayTracing(inverseMatrix, inverseModelView, this);
+  rayTracing.computeRayTrace(minX, minY, maxX, maxY);
+  if (!statisticsBuffer.empty()) showHeatmap();
+  if (scene::printTileStatistics) rayTracing.printTileStatistics(std::cout);
+}
+
+void Context::rayTrace() {
+  Matrix4d inverseMatrix, inverseModelView;
+  getInverseMatrices(inverseMatrix, inverseModelView);
+
+  RayTracing rayTracing(inverseMatrix, inverseModelView, this);
   rayTracing.computeRayTrace();
+  if (!statisticsBuffer.empty()) showHeatmap();
+  if (scene::printTileStatistics) rayTracing.printTileStatistics(std::cout);
+}
+
+void Context::rayTrace(unsigned minX, unsigned minY, unsigned maxX, unsigned maxY) {
+  Matrix4d inverseMatrix, inverseModelView;
+  getInverseMatrices(inverseMatrix, inverseModelView);
+
+  RayTracing rayTracing(inverseMatrix, inverseModelView, this);
+  rayTracing.computeRayTrace(minX, minY, maxX, maxY);
+  if (scene::printTileStatistics) rayTracing.printTileStatistics(std::cout);
+}
+
+void Context::startProgressiveRayTrace() {
+  Matrix4d inverseMatrix, inverseModelView;
+  getInverseMatrices(inverseMatrix, inverseModelView);
+
+  stopRenderThread();
+  stopRendering = false;
+  rendering = true;
+  renderThread = std::thread([this, inverseMatrix, inverseModelView] {
+    Profiler::setThreadName("progressive render");
+    auto start = std::chrono::steady_clock::now();
+    RayTracing rayTracing(inverseMatrix, inverseModelView, this);
+    rayTracing.computeProgressiveRayTrace(scene::progressiveStep, stopRendering, [this, start](unsigned step) {
+      if (!statisticsBuffer.empty()) showHeatmap();
+      finishedPasses++;
+      auto milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      if (scene::printTileStatistics) std::cout << "progressive pass with step " << step << " finished after " << milliseconds << " ms" << std::endl;
+    });
+    if (scene::printTileStatistics && !stopRendering) rayTracing.printTileStatistics(std::cout);
+    rendering = false;
+  });
+}
+
+bool Context::isRendering() const {
+  return rendering;
 }
 
+unsigned Context::getFinishedPasses() const {
+  return finishedPasses;
+}
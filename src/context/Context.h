@@ -1,10 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <numbers>
 
 #include "src/helper-types/Viewport.h"
+#include "src/heightmap/height-map-bvh/HeightMapBvh.h"
 #include "src/light/Light.h"
+#include "src/light-batch/LightBatch.h"
+#include "src/light-grid/LightGrid.h"
 #include "src/scene.h"
 #include "src/transform-stack/TransformStack.h"
 
@@ -17,41 +23,154 @@
 class Context {
   const unsigned width, height;
   std::vector<Light> lights;
-  std::vector<std::vector<Color>> colorBuffer;
+  LightBatch lightBatch; // lights for the shading, four at once
+  FrameBuffer colorBuffer; // colors of the pixels in the format of the scene
+  std::vector<float> depthBuffer; // parameter of the primary ray intersection of every pixel, infinity if the ray missed
+  std::vector<float> startBuffer; // where the primary rays start, reprojected from the previous frame, empty if not known
+  std::vector<TraversalStatistics> statisticsBuffer; // traversal counters of every pixel, empty if the heatmap is not shown
   TransformStack modelView;
   TransformStack projection;
   Color bgColor;
 
-  const HeightMap *heightMap;
+  HeightMapBvh heightMaps;
+  std::unique_ptr<const LightGrid> lightGrid; // lights culled to the terrain blocks, only with the city lights
 
   Viewport viewport;
 
+  std::thread renderThread;
+  std::atomic<bool> stopRendering = false;
+  std::atomic<unsigned> finishedPasses = 0;
+  std::atomic<bool> rendering = false;
+  std::atomic<unsigned> changeCount = 0;
+
+  constexpr static const float reprojectionMargin = 0.9f; // part of the reprojected distance where the ray starts
+  constexpr static const float heatmapPercentile = 0.99f; // part of the pixels below the value shown by the hottest color
+  constexpr static const float cityLightRange = 40.f; // distance where the city lights fade out
+  constexpr static const float cityLightHeight = 3.f; // height of the city lights above the terrain
+  constexpr static const unsigned cityLightSeed = 2020; // key of the random numbers of the city lights
+
+  /**
+   * Create lights of the scene, the light of the scene number followed by the city lights scattered randomly over the height maps
+   * Lights are scattered with the fixed seed, so every run places them the same
+   * @param heightMaps - height maps of the scene
+   * @return lights of the context
+   */
+  [[nodiscard]] static std::vector<Light> createLights(const std::vector<HeightMap> &heightMaps);
+
+  /**
+   * Get false color of the heatmap, from dark blue over cyan, green and yellow to red
+   * @param value - value in [0, 1]
+   * @return color of the value
+   */
+  [[nodiscard]] static Color getHeatColor(float value);
+
+  /**
+   * Replace the color buffer by the heatmap of the scene counter from the statistics buffer
+   * Counters are scaled by the percentile of the pixels, so few extreme pixels do not hide the rest
+   */
+  void showHeatmap();
+
+  /**
+   * Move the intersections of the previous frame to the current camera and find where its primary rays can start
+   * Every intersection bounds the start of the rays in its pixel and the neighbouring pixels, pixels without any stay unbounded
+   * @param previousInverseMatrix - inverted viewport projection * inverted model view projection of the previous frame
+   * @param previousInverseModelView - inverted model view of the previous frame
+   */
+  void reprojectDepth(const Matrix4d &previousInverseMatrix, const Matrix4d &previousInverseModelView);
+
+  /**
+   * Find the rectangle of the pixels whose rays can reach the changed box of the terrain, directly or by the shadow on other points
+   * The shadows of the lights without range lie in the box extruded away from the light down to the bottom of the height maps,
+   * the shadows of the lights with limited range lie within the range from the box
+   * @param changedMin - minimal corner of the changed box
+   * @param changedMax - maximal corner of the changed box
+   * @param minX - where the first column of the rectangle is stored
+   * @param minY - where the first row of the rectangle is stored
+   * @param maxX - where the column after the last column is stored
+   * @param maxY - where the row after the last row is stored
+   */
+  void findAffectedPixels(const Point3d &changedMin, const Point3d &changedMax, unsigned &minX, unsigned &minY, unsigned &maxX, unsigned &maxY) const;
+
+  /**
+   * Stop the progressive rendering and wait for its thread, so the buffers and the maps can be changed
+   */
+  void stopRenderThread();
+
 public:
   /**
-   * Create context of given width and height with given height map
+   * Create context of given width and height with given height maps
+   * @param width - width of the context
+   * @param height - height of the context
+   * @param heightMaps - heightmaps that should be rendered, they must not be moved while the context exists
+   * @param bgColor - color of the background
+   */
+  explicit Context(unsigned int width, unsigned int height, const std::vector<HeightMap> &heightMaps, const Color &bgColor);
+
+  /**
+   * Create context of given width and height with given height maps, looking from given camera
    * @param width - width of the context
    * @param height - height of the context
-   * @param heightMap - heightmap that should be rendered
+   * @param heightMaps - heightmaps that should be rendered, they must not be moved while the context exists
    * @param bgColor - color of the background
+   * @param center - center of the view
+   * @param eye - position of the eye
+   * @param up - up vector
+   * @param render - render the frame in the constructor (in the background with the progressive rendering), false if only regions
+   * of the frame are rendered later
    */
-  explicit Context(unsigned int width, unsigned int height, const HeightMap *heightMap, const Color &bgColor);
+  explicit Context(unsigned int width, unsigned int height, const std::vector<HeightMap> &heightMaps, const Color &bgColor, const Point3d &center, const Vector3d &eye, const Vector3d &up,
+    bool render = true);
 
   /**
    * Create context with default width and height (in scene.h)
    */
   explicit Context();
 
+  /**
+   * Stops the progressive rendering if it is still running
+   */
+  ~Context();
+
+  Context(const Context &) = delete;
+  Context &operator=(const Context &) = delete;
+
+  /**
+   * Get matrices for the ray tracing from the current camera
+   * @param inverseMatrix - where inverted viewport projection * inverted model view projection is stored
+   * @param inverseModelView - where inverted model view is stored
+   */
+  void getInverseMatrices(Matrix4d &inverseMatrix, Matrix4d &inverseModelView) const;
+
   /**
    * Get lights in context
    * @return lights in the context
    */
   [[nodiscard]] const std::vector<Light> &getLights() const;
 
+  /**
+   * Get lights in context prepared for the shading
+   * @return lights in packets of four
+   */
+  [[nodiscard]] const LightBatch &getLightBatch() const;
+
+  /**
+   * Get lights culled to the blocks of the terrain
+   * @return light grid, nullptr if the scene has no city lights and all lights are shaded in the batch
+   */
+  [[nodiscard]] const LightGrid *getLightGrid() const;
+
   /**
    * Get color buffer of the context
-   * @return color buffer - matrix of colors
+   * Buffer is contiguous and row-major (pixel x, y at index y * width + x), so it can be passed directly to OpenGL in the type of its format
+   * @return color buffer - colors of all pixels
+   */
+  [[nodiscard]] const FrameBuffer &getColorBuffer() const;
+
+  /**
+   * Report memory of the pixel buffers, the lights and the height maps of the context
+   * @param report - report where the memory is added
    */
-  [[nodiscard]] const std::vector<std::vector<Color>> &getColorBuffer() const;
+  void reportMemory(MemoryReport &report) const;
 
   /**
    * Get Context width
@@ -72,13 +191,60 @@ public:
   [[nodiscard]] const Color &getBgColor() const;
 
   /**
-   * Get height map in the context
-   * @return
+   * Get height maps in the context
+   * @return hierarchy of the height maps
    */
-  [[nodiscard]] const HeightMap *getHeightMap() const;
+  [[nodiscard]] const HeightMapBvh &getHeightMaps() const;
 
+  /**
+   * Set color of one pixel
+   * @param x - column of the pixel
+   * @param y - row of the pixel
+   * @param color - color of the pixel
+   */
   void setToColorBuffer(unsigned x, unsigned y, const Color &color);
 
+  /**
+   * Set parameter of the primary ray intersection of one pixel
+   * @param x - column of the pixel
+   * @param y - row of the pixel
+   * @param t - parameter of the intersection, infinity if the ray missed
+   */
+  void setToDepthBuffer(unsigned x, unsigned y, float t);
+
+  /**
+   * Get parameters of the primary ray intersections of the last frame, row-major as the color buffer
+   * @return depth buffer, infinity for pixels, where the ray missed the height maps
+   */
+  [[nodiscard]] const std::vector<float> &getDepthBuffer() const;
+
+  /**
+   * Set traversal counters of one pixel, ignored if the heatmap is not shown
+   * @param x - column of the pixel
+   * @param y - row of the pixel
+   * @param statistics - counters of the rays traced for the pixel
+   */
+  void setToStatisticsBuffer(unsigned x, unsigned y, const TraversalStatistics &statistics);
+
+  /**
+   * Get where the primary ray of the pixel starts, cells of the height maps before it are not tested
+   * @param x - column of the pixel
+   * @param y - row of the pixel
+   * @return parameter of the ray start, lowest float if the whole ray is traced
+   */
+  [[nodiscard]] float getStartDistance(unsigned x, unsigned y) const;
+
+  /**
+   * Mark that part of the color buffer was rendered again and should be presented
+   */
+  void markChanged();
+
+  /**
+   * Get number of changes of the color buffer, the buffer has to be presented again when it differs from the last presented one
+   * @return number of changes
+   */
+  [[nodiscard]] unsigned getChangeCount() const;
+
   /**
    * Set model-view matrix to look in eye direction
    * @param center - center of the view
@@ -87,8 +253,66 @@ public:
    */
   void lookAt(Point3d center, Vector3d eye, Vector3d up);
 
+  /**
+   * Replace the height maps of the context, for example by more of them when they are loaded in the background, the frame is not rendered
+   * Progressive rendering is stopped, the lights are created again for the new height maps
+   * @param heightMaps - heightmaps that should be rendered, they must not be moved while the context exists
+   */
+  void setHeightMaps(const std::vector<HeightMap> &heightMaps);
+
+  /**
+   * Replace heights of a rectangle of the samples of one height map and render again only the screen tiles whose rays can reach the change
+   * Progressive rendering is stopped and the tiles are rendered at once, the rest of the color buffer is kept
+   * If the height map had the horizon map, it is released and the whole frame is rendered with the traced shadows
+   * With the reflections the whole frame is rendered too, the reflected rays can reach the change from any reflective pixel
+   * @param heightMap - height map of the context read to memory
+   * @param firstRow - row of the first replaced sample
+   * @param firstCol - column of the first replaced sample
+   * @param rows - number of the replaced rows
+   * @param cols - number of the replaced columns
+   * @param heights - rows * cols new heights by rows
+   */
+  void updateHeights(HeightMap &heightMap, unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const std::vector<float> &heights);
+
+  /**
+   * Move the camera for the next frame, the frame is not rendered
+   * With scene depth reprojection, the intersections of the last frame bound where the primary rays of the next frame start
+   * @param center - center of the view
+   * @param eye - position of the eye
+   * @param up - up vector
+   */
+  void setCamera(const Point3d &center, const Vector3d &eye, const Vector3d &up);
+
   /**
    * Ray trace scene
    */
   void rayTrace();
+
+  /**
+   * Ray trace the screen tiles overlapping the rectangle of pixels, the rest of the color buffer is kept
+   * The heatmap is not shown, its colors are scaled by the counters of the whole frame
+   * @param minX - first column of the rectangle
+   * @param minY - first row of the rectangle
+   * @param maxX - column after the last column of the rectangle
+   * @param maxY - row after the last row of the rectangle
+   */
+  void rayTrace(unsigned minX, unsigned minY, unsigned maxX, unsigned maxY);
+
+  /**
+   * Start ray tracing of the scene in the background thread, from coarse to fine passes
+   * Color buffer can be read while it is rendered, it contains the result of the last finished pass or a newer one
+   */
+  void startProgressiveRayTrace();
+
+  /**
+   * Check if the background rendering is still running
+   * @return true until the last progressive pass is finished
+   */
+  [[nodiscard]] bool isRendering() const;
+
+  /**
+   * Get number of finished passes, grows every time the color buffer gets finer
+   * @return number of finished passes
+   */
+  [[nodiscard]] unsigned getFinishedPasses() const;
 };
\ No newline at end of file
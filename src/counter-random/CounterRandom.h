@@ -0,0 +1,40 @@
+#pragma once
+
+/**
+ * Counter-based random numbers - every number is a hash of its keys, so it does not depend on the order in which the numbers are drawn
+ *
+ * Pixels and samples rendered by any thread in any order get the same numbers, and the numbers are the same with every standard
+ * library, unlike the distributions of <random>.
+ */
+class CounterRandom {
+public:
+  /**
+   * Get random number of the keys, the finalizer of the murmur hash mixes the bits of the keys
+   * @param first - first key (e.g. x coordinate of the pixel)
+   * @param second - second key (e.g. y coordinate of the pixel)
+   * @param third - third key (e.g. index of the sample)
+   * @return random number in [0, 1)
+   */
+  [[nodiscard]] static float get(unsigned first, unsigned second, unsigned third) {
+    auto hash = first * 0x9e3779b1u ^ second * 0x85ebca77u ^ third * 0xc2b2ae3du;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return float(hash >> 8) * 0x1p-24f;
+  }
+
+  /**
+   * Get random number of the keys in the range
+   * @param first - first key
+   * @param second - second key
+   * @param third - third key
+   * @param low - lower bound of the range
+   * @param high - upper bound of the range
+   * @return random number in [low, high)
+   */
+  [[nodiscard]] static float get(unsigned first, unsigned second, unsigned third, float low, float high) {
+    return low + (high - low) * get(first, second, third);
+  }
+};
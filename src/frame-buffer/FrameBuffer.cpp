@@ -0,0 +1,52 @@
+#include "FrameBuffer.h"
+
+FrameBuffer::FrameBuffer(size_t count, Format format) : format(format), count(count), pixels(count * getPixelSize(format), 0) {
+  // black pixels of the packed formats have the alpha set too
+  if (format == Format::Rgba8 || format == Format::Rgb10A2) {
+    for (size_t i = 0; i < count; i++) set(i, Color(0.f, 0.f, 0.f));
+  }
+}
+
+size_t FrameBuffer::getPixelSize(Format format) {
+  switch (format) {
+    case Format::Rgba8: return sizeof(Rgba8Encoding::Pixel);
+    case Format::Rgb10A2: return sizeof(Rgb10A2Encoding::Pixel);
+    case Format::Half: return sizeof(HalfEncoding::Pixel);
+    default: return sizeof(FloatEncoding::Pixel);
+  }
+}
+
+bool FrameBuffer::parseFormat(const std::string &name, Format &format) {
+  const std::pair<const char *, Format> names[] = {
+    {"float", Format::Float}, {"rgba8", Format::Rgba8}, {"rgb10a2", Format::Rgb10A2}, {"half", Format::Half},
+  };
+  for (const auto &[formatName, value] : names) {
+    if (name == formatName) {
+      format = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+FrameBuffer::Format FrameBuffer::getFormat() const {
+  return format;
+}
+
+size_t FrameBuffer::size() const {
+  return count;
+}
+
+const unsigned char *FrameBuffer::data() const {
+  return pixels.data();
+}
+
+size_t FrameBuffer::getMemorySize() const {
+  return pixels.size();
+}
+
+uint64_t FrameBuffer::getChecksum() const {
+  auto hash = checksumOffset;
+  for (auto byte : pixels) hash = (hash ^ byte) * checksumPrime;
+  return hash;
+}
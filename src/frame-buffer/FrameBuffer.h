@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "src/color/Color.h"
+
+/**
+ * Color buffer of the screen in one of the storage formats, row-major like the depth buffer (pixel x, y at index y * width + x)
+ *
+ * Every format has its encoding with the stored pixel type, the buffer writes and reads the pixels through the encoding templates,
+ * so the renderer does not depend on the format. Stored pixels match the OpenGL formats, the window draws the buffer without a copy:
+ * float is GL_RGB/GL_FLOAT, rgba8 GL_RGBA/GL_UNSIGNED_BYTE, rgb10a2 GL_RGBA/GL_UNSIGNED_INT_2_10_10_10_REV and half GL_RGB/GL_HALF_FLOAT.
+ * Quantized formats clamp the colors to [0, 1], half keeps colors above 1 with 11 bits of precision.
+ */
+class FrameBuffer {
+public:
+  /**
+   * Storage format of the pixels
+   */
+  enum class Format { Float, Rgba8, Rgb10A2, Half };
+
+private:
+  /**
+   * Three floats, 12 bytes per pixel
+   */
+  struct FloatEncoding {
+    using Pixel = Color;
+    static Pixel encode(const Color &color) { return color; }
+    static Color decode(const Pixel &pixel) { return pixel; }
+  };
+
+  /**
+   * Four bytes with the alpha 255, 4 bytes per pixel
+   */
+  struct Rgba8Encoding {
+    struct Pixel {
+      uint8_t r, g, b, a;
+    };
+    static uint8_t quantize(float value) { return uint8_t(std::clamp(value, 0.f, 1.f) * 255.f + .5f); }
+    static Pixel encode(const Color &color) { return Pixel{quantize(color.getR()), quantize(color.getG()), quantize(color.getB()), 255}; }
+    static Color decode(const Pixel &pixel) { return Color(float(pixel.r), float(pixel.g), float(pixel.b)) * (1.f / 255.f); }
+  };
+
+  /**
+   * Ten bits of every channel and two bits of the alpha packed to one integer, red in the lowest bits, 4 bytes per pixel
+   */
+  struct Rgb10A2Encoding {
+    using Pixel = uint32_t;
+    static uint32_t quantize(float value) { return uint32_t(std::clamp(value, 0.f, 1.f) * 1023.f + .5f); }
+    static Pixel encode(const Color &color) { return quantize(color.getR()) | quantize(color.getG()) << 10 | quantize(color.getB()) << 20 | 3u << 30; }
+    static Color decode(Pixel pixel) { return Color(float(pixel & 1023u), float(pixel >> 10 & 1023u), float(pixel >> 20 & 1023u)) * (1.f / 1023.f); }
+  };
+
+  /**
+   * Three half floats, 6 bytes per pixel
+   */
+  struct HalfEncoding {
+    struct Pixel {
+      uint16_t r, g, b;
+    };
+    static Pixel encode(const Color &color) { return Pixel{toHalf(color.getR()), toHalf(color.getG()), toHalf(color.getB())}; }
+    static Color decode(const Pixel &pixel) { return Color(fromHalf(pixel.r), fromHalf(pixel.g), fromHalf(pixel.b)); }
+  };
+
+  constexpr static const uint64_t checksumOffset = 0xcbf29ce484222325u; // offset basis of the 64-bit FNV-1a hash
+  constexpr static const uint64_t checksumPrime = 0x100000001b3u;
+
+  Format format;
+  size_t count;
+  std::vector<unsigned char> pixels; // stored pixels of the format, without any padding
+
+  /**
+   * Get size of the stored pixel of the format
+   * @param format - storage format
+   * @return size in bytes
+   */
+  [[nodiscard]] static size_t getPixelSize(Format format);
+
+  /**
+   * Convert float to the nearest half float, values out of the range become infinity
+   * @param value - converted value
+   * @return bits of the half float
+   */
+  [[nodiscard]] static uint16_t toHalf(float value) {
+    auto bits = std::bit_cast<uint32_t>(value);
+    auto sign = uint16_t(bits >> 16 & 0x8000u);
+    auto mantissa = bits & 0x7fffffu;
+    if ((bits >> 23 & 0xffu) == 0xffu) return uint16_t(sign | 0x7c00u | (mantissa ? 0x200u : 0u)); // infinity or nan
+    auto exponent = int(bits >> 23 & 0xffu) - 127 + 15;
+    if (exponent >= 31) return uint16_t(sign | 0x7c00u);
+    if (exponent <= 0) { // subnormal half float, the implicit bit of the mantissa is shifted in
+      if (exponent < -10) return sign;
+      mantissa |= 0x800000u;
+      auto shift = unsigned(14 - exponent);
+      auto half = mantissa >> shift, rest = mantissa & ((1u << shift) - 1u), halfway = 1u << (shift - 1u);
+      if (rest > halfway || (rest == halfway && (half & 1u))) half++;
+      return uint16_t(sign | half);
+    }
+    // rounding to the nearest even, the carry of the mantissa moves to the exponent
+    auto half = uint32_t(sign) | uint32_t(exponent) << 10 | mantissa >> 13;
+    auto rest = mantissa & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) half++;
+    return uint16_t(half);
+  }
+
+  /**
+   * Convert half float to float
+   * @param half - bits of the half float
+   * @return converted value
+   */
+  [[nodiscard]] static float fromHalf(uint16_t half) {
+    auto sign = uint32_t(half & 0x8000u) << 16;
+    auto exponent = uint32_t(half >> 10 & 0x1fu), mantissa = uint32_t(half & 0x3ffu);
+    if (exponent == 0) return std::bit_cast<float>(sign) + (sign ? -1.f : 1.f) * float(mantissa) * 0x1p-24f;
+    if (exponent == 31) return std::bit_cast<float>(sign | 0x7f800000u | mantissa << 13);
+    return std::bit_cast<float>(sign | (exponent + 112u) << 23 | mantissa << 13);
+  }
+
+  /**
+   * Store color to the pixel through the encoding of the format
+   * @tparam Encoding - encoding of the buffer format
+   * @param index - index of the pixel
+   * @param color - stored color
+   */
+  template<class Encoding>
+  void setPixel(size_t index, const Color &color) {
+    auto pixel = Encoding::encode(color);
+    std::memcpy(pixels.data() + index * sizeof(pixel), &pixel, sizeof(pixel));
+  }
+
+  /**
+   * Read color of the pixel through the encoding of the format
+   * @tparam Encoding - encoding of the buffer format
+   * @param index - index of the pixel
+   * @return color of the pixel
+   */
+  template<class Encoding>
+  [[nodiscard]] Color getPixel(size_t index) const {
+    typename Encoding::Pixel pixel;
+    std::memcpy(&pixel, pixels.data() + index * sizeof(pixel), sizeof(pixel));
+    return Encoding::decode(pixel);
+  }
+
+public:
+  /**
+   * Create buffer with all pixels black
+   * @param count - number of the pixels
+   * @param format - storage format of the pixels
+   */
+  explicit FrameBuffer(size_t count, Format format);
+
+  /**
+   * Find storage format by its name
+   * @param name - one of float, rgba8, rgb10a2, half
+   * @param format - where the format is stored
+   * @return true if the name is known
+   */
+  static bool parseFormat(const std::string &name, Format &format);
+
+  /**
+   * Store color of the pixel in the format of the buffer
+   * @param index - index of the pixel
+   * @param color - new color
+   */
+  void set(size_t index, const Color &color) {
+    switch (format) {
+      case Format::Float: setPixel<FloatEncoding>(index, color); break;
+      case Format::Rgba8: setPixel<Rgba8Encoding>(index, color); break;
+      case Format::Rgb10A2: setPixel<Rgb10A2Encoding>(index, color); break;
+      case Format::Half: setPixel<HalfEncoding>(index, color); break;
+    }
+  }
+
+  /**
+   * Get color of the pixel as stored, quantized formats return the quantized color
+   * @param index - index of the pixel
+   * @return color of the pixel
+   */
+  [[nodiscard]] Color get(size_t index) const {
+    switch (format) {
+      case Format::Rgba8: return getPixel<Rgba8Encoding>(index);
+      case Format::Rgb10A2: return getPixel<Rgb10A2Encoding>(index);
+      case Format::Half: return getPixel<HalfEncoding>(index);
+      default: return getPixel<FloatEncoding>(index);
+    }
+  }
+
+  /**
+   * Get storage format of the buffer
+   * @return format of the pixels
+   */
+  [[nodiscard]] Format getFormat() const;
+
+  /**
+   * Get number of the pixels
+   * @return number of the pixels
+   */
+  [[nodiscard]] size_t size() const;
+
+  /**
+   * Get stored pixels, packed without padding in the OpenGL layout of the format
+   * @return pointer to the first pixel
+   */
+  [[nodiscard]] const unsigned char *data() const;
+
+  /**
+   * Get memory of the stored pixels
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getMemorySize() const;
+
+  /**
+   * Get FNV-1a hash of the stored pixels, the same image in the same format has the same checksum with any thread count
+   * @return 64-bit checksum
+   */
+  [[nodiscard]] uint64_t getChecksum() const;
+};
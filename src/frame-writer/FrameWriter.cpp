@@ -0,0 +1,119 @@
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <stdexcept>
+
+#include "FrameWriter.h"
+#include "src/image-writer/ImageWriter.h"
+#include "src/profiler/Profiler.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+FrameWriter::FrameWriter(const std::string &pipeCommand) {
+  if (!pipeCommand.empty()) {
+#ifdef _WIN32
+    pipe = popen(pipeCommand.c_str(), "wb");
+#else
+    // command which exits early is reported by the failed write instead of killing the renderer
+    std::signal(SIGPIPE, SIG_IGN);
+    pipe = popen(pipeCommand.c_str(), "w");
+#endif
+    if (!pipe) {
+      std::cerr << "cannot start frame pipe command " << pipeCommand << std::endl;
+      throw std::invalid_argument("cannot start frame pipe command");
+    }
+  }
+  thread = std::thread(&FrameWriter::writeLoop, this);
+}
+
+FrameWriter::~FrameWriter() {
+  close();
+}
+
+void FrameWriter::writeLoop() {
+  Profiler::setThreadName("frame writer");
+  std::unique_lock lock(mutex);
+  while (true) {
+    changed.wait(lock, [this] { return writtenFrames < submittedFrames || finished; });
+    if (writtenFrames == submittedFrames) return;
+    const auto &frame = frames[writtenFrames % frameBuffers];
+    auto failed = error != nullptr; // frames after the failure are dropped, so the renderer does not wait for them
+    lock.unlock();
+
+    auto start = std::chrono::steady_clock::now();
+    std::exception_ptr failure;
+    try {
+      if (!failed) write(frame);
+    } catch (...) {
+      failure = std::current_exception();
+    }
+    auto milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    lock.lock();
+    if (failure && !error) error = failure;
+    writeMilliseconds += milliseconds;
+    writtenFrames++;
+    changed.notify_all();
+  }
+}
+
+void FrameWriter::write(const Frame &frame) const {
+  Profiler::Scope scope("write frame");
+  if (!pipe) {
+    ImageWriter::save(frame.fileName, frame.width, frame.height, frame.pixels);
+    return;
+  }
+  if (std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), pipe) != frame.pixels.size() || std::fflush(pipe) != 0) {
+    std::cerr << "frame can not be written to the pipe command" << std::endl;
+    throw std::invalid_argument("cannot write frame to the pipe");
+  }
+}
+
+void FrameWriter::close() {
+  {
+    std::lock_guard lock(mutex);
+    finished = true;
+  }
+  changed.notify_all();
+  if (thread.joinable()) thread.join();
+  if (pipe) {
+    auto status = pclose(pipe);
+    pipe = nullptr;
+    if (status != 0 && !error) {
+      std::cerr << "frame pipe command failed with status " << status << std::endl;
+      error = std::make_exception_ptr(std::invalid_argument("frame pipe command failed"));
+    }
+  }
+}
+
+void FrameWriter::submit(const Context &context, const std::string &fileName) {
+  auto start = std::chrono::steady_clock::now();
+  std::unique_lock lock(mutex);
+  // buffer of this frame was used by the frame before the previous one, the previous frame can still be written from the other
+  changed.wait(lock, [this] { return writtenFrames + frameBuffers > submittedFrames; });
+  waitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  if (error) std::rethrow_exception(error);
+  auto &frame = frames[submittedFrames % frameBuffers];
+  lock.unlock();
+
+  ImageWriter::convertPixels(context, frame.pixels);
+  frame.width = context.getWidth();
+  frame.height = context.getHeight();
+  frame.fileName = pipe ? "" : fileName;
+
+  lock.lock();
+  submittedFrames++;
+  changed.notify_all();
+}
+
+void FrameWriter::finish() {
+  close();
+  if (error) std::rethrow_exception(error);
+}
+
+void FrameWriter::printStatistics(std::ostream &out) const {
+  out << "written " << writtenFrames << " frames in " << writeMilliseconds << " ms on the output thread, renderer waited " << waitMilliseconds << " ms" << std::endl;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/context/Context.h"
+
+/**
+ * Output stage of the fly-through, finished frames are written on its own thread while the next frame is rendered
+ *
+ * The color buffer is converted to 8-bit pixels to one of two frame buffers, the thread writes the other one, so the renderer waits
+ * only when writing a frame takes longer than rendering the next one. Frames are saved to the image files, or written as raw
+ * RGB to the standard input of a command (e.g. ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -i - video.mp4).
+ */
+class FrameWriter {
+  /**
+   * Converted frame waiting for the thread or being written
+   */
+  struct Frame {
+    std::vector<unsigned char> pixels;
+    unsigned width = 0, height = 0;
+    std::string fileName; // empty when the frame goes to the pipe
+  };
+
+  constexpr static const unsigned frameBuffers = 2; // frame converted by the renderer and frame written by the thread
+
+  std::FILE *pipe = nullptr; // standard input of the command, null when the frames are saved to files
+  Frame frames[frameBuffers];
+  unsigned submittedFrames = 0, writtenFrames = 0;
+  bool finished = false;
+  std::exception_ptr error; // first failure of the thread, thrown to the renderer
+  double writeMilliseconds = 0., waitMilliseconds = 0.;
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::thread thread;
+
+  /**
+   * Write the submitted frames in order until the writer is finished
+   */
+  void writeLoop();
+
+  /**
+   * Write one frame to its file or to the pipe
+   * @param frame - converted frame
+   */
+  void write(const Frame &frame) const;
+
+  /**
+   * Stop the thread after the submitted frames and close the pipe
+   */
+  void close();
+
+public:
+  /**
+   * Start the thread of the writer
+   * @param pipeCommand - command which receives the raw frames on its standard input, empty to save the frames to files
+   */
+  explicit FrameWriter(const std::string &pipeCommand = "");
+
+  FrameWriter(const FrameWriter &) = delete;
+  FrameWriter &operator=(const FrameWriter &) = delete;
+
+  /**
+   * Write the remaining frames and stop the thread, errors are reported only by the finish
+   */
+  ~FrameWriter();
+
+  /**
+   * Convert the color buffer of the context and pass it to the thread, waits while the thread still writes the frame before the previous one
+   * @param context - context with the rendered frame, its buffer can change as soon as the call returns
+   * @param fileName - file of the frame (.ppm, .png or .tga), ignored when the frames go to the pipe
+   */
+  void submit(const Context &context, const std::string &fileName);
+
+  /**
+   * Wait until all submitted frames are written and stop the thread, the first failure of the writing is thrown here
+   */
+  void finish();
+
+  /**
+   * Print number of the written frames, time of the writing and time the renderer waited for the thread, after the finish
+   * @param out - output stream
+   */
+  void printStatistics(std::ostream &out) const;
+};
@@ -0,0 +1,441 @@
+#ifdef GPU_TRAVERSAL
+
+#include <GL/freeglut.h>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include "GpuTracer.h"
+
+const char *const GpuTracer::shaderSource = R"(#version 430
+layout(local_size_x = 8, local_size_y = 8) in; // groupSize
+layout(rgba8, binding = 0) uniform writeonly image2D frame;
+layout(binding = 0) uniform sampler2D heights;
+layout(binding = 1) uniform sampler2D maxHeights;
+layout(binding = 2) uniform sampler2D gradient;
+
+struct Light {
+  vec4 position; // range in w, negative for the infinite range
+  vec4 color;
+};
+layout(std430, binding = 0) readonly buffer Lights {
+  Light lights[];
+};
+
+uniform ivec2 frameSize;
+uniform ivec2 gridSize;
+uniform int topLevel;
+uniform vec3 mapSize;
+uniform int instanceCount;
+uniform vec3 instancePositions[16];
+uniform vec3 rayOrigin, dirO, dirX, dirY;
+uniform vec3 bgColor;
+uniform vec3 materialColor;
+uniform int changingColor;
+uniform vec3 coefficients; // kd, ks, shine
+uniform int lightCount;
+uniform int rangedLights;
+
+const float infinity = 3.402823e38;
+const int maxSteps = 1 << 20;
+const float gradientSize = 769.0;
+
+bool intersectBox(vec3 o, vec3 d, vec3 low, vec3 high, out float tLow, out float tHigh) {
+  vec3 inverted = 1.0 / d;
+  vec3 t0 = (low - o) * inverted, t1 = (high - o) * inverted;
+  vec3 near = min(t0, t1), far = max(t0, t1);
+  tLow = max(max(near.x, near.y), near.z);
+  tHigh = min(min(far.x, far.y), far.z);
+  return tLow <= tHigh && tHigh >= 0.0;
+}
+
+bool intersectTriangle(vec3 o, vec3 d, vec3 base, vec3 v0, vec3 v1, out float t) {
+  vec3 s1 = cross(d, v1);
+  float divisor = dot(s1, v0);
+  if (divisor == 0.0) return false;
+  float inverted = 1.0 / divisor;
+  vec3 q = o - base;
+  float b1 = dot(q, s1) * inverted;
+  if (b1 < 0.0 || b1 > 1.0) return false;
+  vec3 s2 = cross(q, v0);
+  float b2 = dot(d, s2) * inverted;
+  if (b2 < 0.0 || b1 + b2 > 1.0) return false;
+  t = dot(v1, s2) * inverted;
+  return true;
+}
+
+// triangles of the cell as in Cell, tHit is lowered to the nearest intersection after tMin
+bool intersectCell(ivec2 cell, vec3 o, vec3 d, float tMin, inout float tHit, inout vec3 normal) {
+  vec2 cellSize = mapSize.xz / vec2(gridSize);
+  float topLeft = texelFetch(heights, cell, 0).r, topRight = texelFetch(heights, cell + ivec2(1, 0), 0).r;
+  float bottomLeft = texelFetch(heights, cell + ivec2(0, 1), 0).r, bottomRight = texelFetch(heights, cell + ivec2(1, 1), 0).r;
+  vec2 low = vec2(cell) * cellSize, high = low + cellSize;
+  vec3 p1 = vec3(low.x, topLeft, low.y), p2 = vec3(high.x, bottomRight, high.y);
+  vec3 pC1 = vec3(high.x, topRight, low.y), pC2 = vec3(low.x, bottomLeft, high.y);
+  bool found = false;
+  float t;
+  if (intersectTriangle(o, d, p1, pC2 - p1, pC1 - p1, t) && t >= tMin && t < tHit) {
+    tHit = t;
+    normal = cross(pC2 - p1, pC1 - p1);
+    found = true;
+  }
+  if (intersectTriangle(o, d, p2, pC1 - p2, pC2 - p2, t) && t >= tMin && t < tHit) {
+    tHit = t;
+    normal = cross(pC1 - p2, pC2 - p2);
+    found = true;
+  }
+  return found;
+}
+
+// nearest intersection with the height map at the position in [tMin, tHit)
+bool traceMap(vec3 position, vec3 origin, vec3 d, float tMin, inout float tHit, inout vec3 normal) {
+  vec3 o = origin - position;
+  float tLow, tHigh;
+  if (!intersectBox(o, d, vec3(0.0), mapSize, tLow, tHigh)) return false;
+  float t = max(tLow, tMin);
+  tHigh = min(tHigh, tHit);
+  if (t > tHigh) return false;
+
+  // x and z in cells, the parameter of the ray stays the same
+  vec2 cellSize = mapSize.xz / vec2(gridSize);
+  vec2 oc = o.xz / cellSize, dc = d.xz / cellSize;
+  ivec2 stepDirection = ivec2(dc.x >= 0.0 ? 1 : -1, dc.y >= 0.0 ? 1 : -1);
+  int level = topLevel;
+  ivec2 cell = ivec2(0);
+  for (int i = 0; i < maxSteps; i++) {
+    float side = float(1 << level);
+    vec2 low = vec2(cell) * side, high = low + side;
+    vec2 border = vec2(stepDirection.x > 0 ? high.x : low.x, stepDirection.y > 0 ? high.y : low.y);
+    vec2 tBorder = vec2(dc.x == 0.0 ? infinity : (border.x - oc.x) / dc.x, dc.y == 0.0 ? infinity : (border.y - oc.y) / dc.y);
+    float tExit = min(min(tBorder.x, tBorder.y), tHigh);
+    // the ray is a line, its lowest point in the cell is on one of the ends
+    float lowest = o.y + d.y * (d.y < 0.0 ? tExit : t);
+    if (lowest <= texelFetch(maxHeights, cell, level).r) {
+      if (level > 0) {
+        level--;
+        vec2 point = oc + dc * t;
+        cell = cell * 2 + ivec2(greaterThanEqual(point, low + float(1 << level)));
+        continue;
+      }
+      // cells are visited in the order along the ray, so the first hit is the nearest one
+      if (intersectCell(cell, o, d, tMin, tHit, normal)) return true;
+    }
+    if (tExit >= tHigh) return false;
+    ivec2 previous = cell;
+    if (tBorder.x < tBorder.y) cell.x += stepDirection.x;
+    else cell.y += stepDirection.y;
+    t = tExit;
+    ivec2 levelSize = ((gridSize - 1) >> level) + 1;
+    if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, levelSize))) return false;
+    // climb when the ray leaves the parent cell, the point on the border of the parent lies far from the middle
+    // where the child is chosen, so the descent does not return to the cell the ray just left
+    if (level < topLevel && (cell >> 1) != (previous >> 1)) {
+      level++;
+      cell >>= 1;
+    }
+  }
+  return false;
+}
+
+bool isOccluded(vec3 point, vec3 target) {
+  vec3 toTarget = target - point;
+  float distance = length(toTarget);
+  if (distance == 0.0) return false;
+  vec3 d = toTarget / distance;
+  // offset of the origin prevents finding the surface the origin lies on
+  vec2 cellSize = mapSize.xz / vec2(gridSize);
+  float tMin = min(cellSize.x, cellSize.y) * 1e-3;
+  vec3 normal;
+  for (int i = 0; i < instanceCount; i++) {
+    float tHit = distance;
+    if (traceMap(instancePositions[i], point, d, tMin, tHit, normal)) return true;
+  }
+  return false;
+}
+
+vec3 getPhong(vec3 lightColor, vec3 matColor, vec3 toLight, vec3 normal, vec3 d, float cosAlpha) {
+  vec3 color = lightColor * matColor * (coefficients.x * cosAlpha); // diffuse
+  if (coefficients.y != 0.0) {
+    float cosBeta = dot(normal * (2.0 * cosAlpha) - toLight, -d);
+    color += lightColor * coefficients.y * pow(max(cosBeta, 0.0), coefficients.z); // specular
+  }
+  return color;
+}
+
+vec3 shade(vec3 origin, vec3 d, float t, vec3 normal, vec3 position) {
+  vec3 point = origin + d * t;
+  float heightFactor = clamp((point.y - position.y) / mapSize.y, 0.0, 1.0);
+  vec3 matColor = changingColor != 0 ? texture(gradient, vec2((heightFactor * (gradientSize - 1.0) + 0.5) / gradientSize, 0.5)).rgb : materialColor;
+  vec3 color = vec3(0.0);
+  if (rangedLights == 0) {
+    // all lights as in the light batch, every shadow darkens the whole color
+    for (int i = 0; i < lightCount; i++) {
+      vec3 toLight = normalize(lights[i].position.xyz - point);
+      color += getPhong(lights[i].color.rgb, matColor, toLight, normal, d, dot(toLight, normal));
+    }
+    for (int i = 0; i < lightCount; i++) {
+      if (isOccluded(point, lights[i].position.xyz)) color *= 0.1; // leave some color
+    }
+    return color;
+  }
+  for (int i = 0; i < lightCount; i++) {
+    vec3 toLight = lights[i].position.xyz - point;
+    float squaredDistance = dot(toLight, toLight);
+    float range = lights[i].position.w;
+    float fraction = 1.0 - squaredDistance / (range * range);
+    float attenuation = range < 0.0 ? 1.0 : fraction > 0.0 ? fraction * fraction : 0.0;
+    toLight /= sqrt(squaredDistance);
+    float cosAlpha = dot(toLight, normal);
+    if (attenuation <= 0.0 || cosAlpha <= 0.0) continue;
+    vec3 lightColor = getPhong(lights[i].color.rgb * attenuation, matColor, toLight, normal, d, cosAlpha);
+    if (isOccluded(point, lights[i].position.xyz)) lightColor *= 0.1; // leave some color
+    color += lightColor;
+  }
+  return color;
+}
+
+void main() {
+  ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+  if (pixel.x >= frameSize.x || pixel.y >= frameSize.y) return;
+  vec3 d = normalize(dirO + dirY * float(pixel.y) + dirX * float(pixel.x));
+  float tHit = infinity;
+  vec3 normal = vec3(0.0, 1.0, 0.0);
+  int instance = -1;
+  for (int i = 0; i < instanceCount; i++) {
+    if (traceMap(instancePositions[i], rayOrigin, d, 0.0, tHit, normal)) instance = i;
+  }
+  vec3 color = instance < 0 ? bgColor : shade(rayOrigin, d, tHit, normalize(normal), instancePositions[instance]);
+  imageStore(frame, pixel, vec4(color, 1.0));
+}
+)";
+
+GpuTracer::GpuTracer(const std::vector<HeightMap> &heightMaps, const Context &context)
+  : width(context.getWidth()), height(context.getHeight()) {
+  if (!loadFunctions()) {
+    std::cerr << "gpu traversal needs OpenGL 4.3 compute shaders" << std::endl;
+    throw std::invalid_argument("OpenGL 4.3 not available");
+  }
+  if (heightMaps.empty() || heightMaps.size() > maxInstances) {
+    std::cerr << "gpu traversal needs 1 to " << maxInstances << " height maps" << std::endl;
+    throw std::invalid_argument("unsupported number of height maps");
+  }
+  const auto &first = heightMaps[0];
+  gridWidth = first.getGridWidth();
+  gridDepth = first.getGridDepth();
+  size = first.getAabbMax().getVectorBetween(first.getAabbMin());
+  for (const auto &heightMap : heightMaps) {
+    auto mapSize = heightMap.getAabbMax().getVectorBetween(heightMap.getAabbMin());
+    if (heightMap.isOutOfCore() || heightMap.getGridWidth() != gridWidth || heightMap.getGridDepth() != gridDepth
+      || mapSize.getX() != size.getX() || mapSize.getY() != size.getY() || mapSize.getZ() != size.getZ()) {
+      std::cerr << "gpu traversal needs height maps read to memory, all of them copies of the first one" << std::endl;
+      throw std::invalid_argument("unsupported height maps");
+    }
+    instancePositions.push_back(heightMap.getAabbMin().getX());
+    instancePositions.push_back(heightMap.getAabbMin().getY());
+    instancePositions.push_back(heightMap.getAabbMin().getZ());
+  }
+
+  createProgram();
+  uploadHeightMap(first);
+  uploadLights(context.getLights());
+
+  glGenTextures(1, &imageTexture);
+  glBindTexture(GL_TEXTURE_2D, imageTexture);
+  gl.texStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, GLsizei(width), GLsizei(height));
+  gl.genFramebuffers(1, &framebuffer);
+  gl.bindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  gl.framebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, imageTexture, 0);
+  gl.bindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+  // uniforms which do not change between the frames
+  const auto &material = first.getMaterial();
+  const auto &bgColor = context.getBgColor();
+  gl.useProgram(program);
+  gl.uniform1i(gl.getUniformLocation(program, "heights"), 0);
+  gl.uniform1i(gl.getUniformLocation(program, "maxHeights"), 1);
+  gl.uniform1i(gl.getUniformLocation(program, "gradient"), 2);
+  gl.uniform2i(gl.getUniformLocation(program, "frameSize"), GLint(width), GLint(height));
+  gl.uniform2i(gl.getUniformLocation(program, "gridSize"), GLint(gridWidth), GLint(gridDepth));
+  gl.uniform1i(gl.getUniformLocation(program, "topLevel"), GLint(topLevel));
+  setUniform("mapSize", size.getX(), size.getY(), size.getZ());
+  gl.uniform1i(gl.getUniformLocation(program, "instanceCount"), GLint(heightMaps.size()));
+  gl.uniform3fv(gl.getUniformLocation(program, "instancePositions"), GLsizei(heightMaps.size()), instancePositions.data());
+  setUniform("bgColor", bgColor.getR(), bgColor.getG(), bgColor.getB());
+  setUniform("materialColor", material.getColor().getR(), material.getColor().getG(), material.getColor().getB());
+  gl.uniform1i(gl.getUniformLocation(program, "changingColor"), material.isChangeColor());
+  setUniform("coefficients", material.getKd(), material.getKs(), material.getShine());
+  gl.uniform1i(gl.getUniformLocation(program, "lightCount"), GLint(context.getLights().size()));
+  gl.uniform1i(gl.getUniformLocation(program, "rangedLights"), context.getLightGrid() != nullptr);
+  gl.useProgram(0);
+}
+
+GpuTracer::~GpuTracer() {
+  if (gl.deleteFramebuffers) gl.deleteFramebuffers(1, &framebuffer);
+  if (gl.deleteBuffers) gl.deleteBuffers(1, &lightBuffer);
+  if (gl.deleteProgram) gl.deleteProgram(program);
+  GLuint textures[] = {heightTexture, maxHeightTexture, gradientTexture, imageTexture};
+  glDeleteTextures(4, textures);
+}
+
+bool GpuTracer::loadFunctions() {
+  auto load = [](auto &function, const char *name) {
+    function = reinterpret_cast<std::remove_reference_t<decltype(function)>>(glutGetProcAddress(name));
+    return function != nullptr;
+  };
+  return load(gl.activeTexture, "glActiveTexture") && load(gl.createShader, "glCreateShader") && load(gl.shaderSource, "glShaderSource")
+    && load(gl.compileShader, "glCompileShader") && load(gl.getShaderiv, "glGetShaderiv") && load(gl.getShaderInfoLog, "glGetShaderInfoLog")
+    && load(gl.deleteShader, "glDeleteShader") && load(gl.createProgram, "glCreateProgram") && load(gl.attachShader, "glAttachShader")
+    && load(gl.linkProgram, "glLinkProgram") && load(gl.getProgramiv, "glGetProgramiv") && load(gl.getProgramInfoLog, "glGetProgramInfoLog")
+    && load(gl.deleteProgram, "glDeleteProgram") && load(gl.useProgram, "glUseProgram") && load(gl.getUniformLocation, "glGetUniformLocation")
+    && load(gl.uniform1i, "glUniform1i") && load(gl.uniform2i, "glUniform2i")
+    && load(gl.uniform3f, "glUniform3f") && load(gl.uniform3fv, "glUniform3fv") && load(gl.dispatchCompute, "glDispatchCompute")
+    && load(gl.memoryBarrier, "glMemoryBarrier") && load(gl.bindImageTexture, "glBindImageTexture") && load(gl.texStorage2D, "glTexStorage2D")
+    && load(gl.genBuffers, "glGenBuffers") && load(gl.deleteBuffers, "glDeleteBuffers") && load(gl.bindBuffer, "glBindBuffer")
+    && load(gl.bufferData, "glBufferData") && load(gl.bindBufferBase, "glBindBufferBase") && load(gl.genFramebuffers, "glGenFramebuffers")
+    && load(gl.deleteFramebuffers, "glDeleteFramebuffers") && load(gl.bindFramebuffer, "glBindFramebuffer")
+    && load(gl.framebufferTexture2D, "glFramebufferTexture2D") && load(gl.blitFramebuffer, "glBlitFramebuffer");
+}
+
+void GpuTracer::createProgram() {
+  auto shader = gl.createShader(GL_COMPUTE_SHADER);
+  gl.shaderSource(shader, 1, &shaderSource, nullptr);
+  gl.compileShader(shader);
+  GLint status = 0;
+  gl.getShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (!status) {
+    char log[4096];
+    gl.getShaderInfoLog(shader, sizeof(log), nullptr, log);
+    gl.deleteShader(shader);
+    std::cerr << "gpu traversal shader can not be compiled:" << std::endl << log << std::endl;
+    throw std::invalid_argument("invalid compute shader");
+  }
+  program = gl.createProgram();
+  gl.attachShader(program, shader);
+  gl.linkProgram(program);
+  gl.deleteShader(shader);
+  gl.getProgramiv(program, GL_LINK_STATUS, &status);
+  if (!status) {
+    char log[4096];
+    gl.getProgramInfoLog(program, sizeof(log), nullptr, log);
+    std::cerr << "gpu traversal shader can not be linked:" << std::endl << log << std::endl;
+    throw std::invalid_argument("invalid compute shader");
+  }
+}
+
+void GpuTracer::uploadHeightMap(const HeightMap &heightMap) {
+  // heights relative to the bottom of the height map, so the copies at other positions share them
+  auto bottom = heightMap.getAabbMin().getY();
+  std::vector<float> heights(size_t(gridWidth + 1) * (gridDepth + 1));
+  for (unsigned row = 0; row <= gridDepth; row++) {
+    for (unsigned col = 0; col <= gridWidth; col++) heights[size_t(row) * (gridWidth + 1) + col] = heightMap.getSampleHeight(row, col) - bottom;
+  }
+  glGenTextures(1, &heightTexture);
+  glBindTexture(GL_TEXTURE_2D, heightTexture);
+  gl.texStorage2D(GL_TEXTURE_2D, 1, GL_R32F, GLsizei(gridWidth + 1), GLsizei(gridDepth + 1));
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GLsizei(gridWidth + 1), GLsizei(gridDepth + 1), GL_RED, GL_FLOAT, heights.data());
+
+  // mip levels are halved by OpenGL rounding down, so the first level is padded to powers of two by cells nothing can hit
+  unsigned paddedWidth = 1, paddedDepth = 1;
+  topLevel = 0;
+  while (paddedWidth < gridWidth) paddedWidth *= 2;
+  while (paddedDepth < gridDepth) paddedDepth *= 2;
+  while ((1u << topLevel) < std::max(paddedWidth, paddedDepth)) topLevel++;
+  std::vector<float> level(size_t(paddedWidth) * paddedDepth, std::numeric_limits<float>::lowest());
+  for (unsigned row = 0; row < gridDepth; row++) {
+    for (unsigned col = 0; col < gridWidth; col++) level[size_t(row) * paddedWidth + col] = heightMap.getMaxHeight(row, col) - bottom;
+  }
+  glGenTextures(1, &maxHeightTexture);
+  glBindTexture(GL_TEXTURE_2D, maxHeightTexture);
+  gl.texStorage2D(GL_TEXTURE_2D, GLsizei(topLevel + 1), GL_R32F, GLsizei(paddedWidth), GLsizei(paddedDepth));
+  auto levelWidth = paddedWidth, levelDepth = paddedDepth;
+  for (unsigned l = 0; l <= topLevel; l++) {
+    glTexSubImage2D(GL_TEXTURE_2D, GLint(l), 0, 0, GLsizei(levelWidth), GLsizei(levelDepth), GL_RED, GL_FLOAT, level.data());
+    if (l == topLevel) break;
+    auto nextWidth = std::max(levelWidth / 2, 1u), nextDepth = std::max(levelDepth / 2, 1u);
+    std::vector<float> next(size_t(nextWidth) * nextDepth, std::numeric_limits<float>::lowest());
+    for (unsigned row = 0; row < levelDepth; row++) {
+      for (unsigned col = 0; col < levelWidth; col++) {
+        auto &value = next[size_t(row / 2) * nextWidth + col / 2];
+        value = std::max(value, level[size_t(row) * levelWidth + col]);
+      }
+    }
+    level = std::move(next);
+    levelWidth = nextWidth;
+    levelDepth = nextDepth;
+  }
+
+  // gradient entries lie on the knots of the material table, linear filtering interpolates between them as the table does
+  const auto &material = heightMap.getMaterial();
+  std::vector<float> gradient;
+  for (unsigned i = 0; i < gradientSize; i++) {
+    auto color = material.isChangeColor() ? material.getColor(float(i) / float(gradientSize - 1)) : material.getColor();
+    gradient.insert(gradient.end(), {color.getR(), color.getG(), color.getB()});
+  }
+  glGenTextures(1, &gradientTexture);
+  glBindTexture(GL_TEXTURE_2D, gradientTexture);
+  gl.texStorage2D(GL_TEXTURE_2D, 1, GL_RGB32F, GLsizei(gradientSize), 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GLsizei(gradientSize), 1, GL_RGB, GL_FLOAT, gradient.data());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GpuTracer::uploadLights(const std::vector<Light> &lights) {
+  std::vector<float> values;
+  for (const auto &light : lights) {
+    auto range = light.getRange() == std::numeric_limits<float>::infinity() ? -1.f : light.getRange();
+    const auto &position = light.getPosition();
+    const auto &color = light.getColorIntensity();
+    values.insert(values.end(), {position.getX(), position.getY(), position.getZ(), range, color.getR(), color.getG(), color.getB(), 0.f});
+  }
+  gl.genBuffers(1, &lightBuffer);
+  gl.bindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+  gl.bufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(values.size() * sizeof(float)), values.data(), GL_STATIC_DRAW);
+  gl.bindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuTracer::setUniform(const char *name, float x, float y, float z) {
+  gl.uniform3f(gl.getUniformLocation(program, name), x, y, z);
+}
+
+void GpuTracer::render(const Context &context) {
+  // same rays as the CPU ray tracing of the context
+  Matrix4d inverseMatrix, inverseModelView;
+  context.getInverseMatrices(inverseMatrix, inverseModelView);
+  auto rayOrigin = (inverseModelView * Vector4d(0, 0, 0, 1)).divideByW();
+  auto dirX = (inverseMatrix * Vector4d(1.f, 0.f, 0.f, 0.f)).ignoreW();
+  auto dirY = (inverseMatrix * Vector4d(0.f, 1.f, 0.f, 0.f)).ignoreW();
+  auto dirO = (inverseMatrix * Vector4d(.5f, .5f, -1.f, 1.f)).divideByW().getVectorBetween(rayOrigin);
+
+  gl.useProgram(program);
+  setUniform("rayOrigin", rayOrigin.getX(), rayOrigin.getY(), rayOrigin.getZ());
+  setUniform("dirO", dirO.getX(), dirO.getY(), dirO.getZ());
+  setUniform("dirX", dirX.getX(), dirX.getY(), dirX.getZ());
+  setUniform("dirY", dirY.getX(), dirY.getY(), dirY.getZ());
+  gl.activeTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, heightTexture);
+  gl.activeTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, maxHeightTexture);
+  gl.activeTexture(GL_TEXTURE2);
+  glBindTexture(GL_TEXTURE_2D, gradientTexture);
+  gl.activeTexture(GL_TEXTURE0);
+  gl.bindImageTexture(0, imageTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+  gl.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lightBuffer);
+  gl.dispatchCompute((width + groupSize - 1) / groupSize, (height + groupSize - 1) / groupSize, 1);
+  gl.memoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+  gl.useProgram(0);
+
+  // rows of the texture go from the bottom as the color buffer drawn by glDrawPixels
+  gl.bindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  gl.blitFramebuffer(0, 0, GLint(width), GLint(height), 0, 0, GLint(width), GLint(height), GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  gl.bindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+GLuint GpuTracer::getImageTexture() const {
+  return imageTexture;
+}
+
+#endif
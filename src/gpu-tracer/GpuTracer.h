@@ -0,0 +1,143 @@
+#pragma once
+
+#ifdef GPU_TRAVERSAL
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <vector>
+
+#include "src/context/Context.h"
+#include "src/heightmap/HeightMap.h"
+
+/**
+ * Ray tracing of the height maps in the OpenGL 4.3 compute shader, the frame is written to a texture and copied to the window
+ * without reading it back to the CPU
+ *
+ * The heights of the first height map are uploaded as a float texture and its cell maximal heights as a mip chain, where every
+ * level keeps the maximum of 2 x 2 cells of the previous one, so the shader skips empty space as the CPU traversal of the pyramid.
+ * The other height maps have to be copies of the first one (patches), they share its textures and differ only in the position.
+ * Materials with changing color are uploaded as the gradient texture. Shading matches the flat shading of the CPU ray tracing
+ * with shadow rays, the smooth normals, levels of detail, horizon maps and antialiasing are not used.
+ */
+class GpuTracer {
+  /**
+   * OpenGL functions newer than 1.1, they are loaded at runtime
+   */
+  struct Functions {
+    PFNGLACTIVETEXTUREPROC activeTexture;
+    PFNGLCREATESHADERPROC createShader;
+    PFNGLSHADERSOURCEPROC shaderSource;
+    PFNGLCOMPILESHADERPROC compileShader;
+    PFNGLGETSHADERIVPROC getShaderiv;
+    PFNGLGETSHADERINFOLOGPROC getShaderInfoLog;
+    PFNGLDELETESHADERPROC deleteShader;
+    PFNGLCREATEPROGRAMPROC createProgram;
+    PFNGLATTACHSHADERPROC attachShader;
+    PFNGLLINKPROGRAMPROC linkProgram;
+    PFNGLGETPROGRAMIVPROC getProgramiv;
+    PFNGLGETPROGRAMINFOLOGPROC getProgramInfoLog;
+    PFNGLDELETEPROGRAMPROC deleteProgram;
+    PFNGLUSEPROGRAMPROC useProgram;
+    PFNGLGETUNIFORMLOCATIONPROC getUniformLocation;
+    PFNGLUNIFORM1IPROC uniform1i;
+    PFNGLUNIFORM2IPROC uniform2i;
+    PFNGLUNIFORM3FPROC uniform3f;
+    PFNGLUNIFORM3FVPROC uniform3fv;
+    PFNGLDISPATCHCOMPUTEPROC dispatchCompute;
+    PFNGLMEMORYBARRIERPROC memoryBarrier;
+    PFNGLBINDIMAGETEXTUREPROC bindImageTexture;
+    PFNGLTEXSTORAGE2DPROC texStorage2D;
+    PFNGLGENBUFFERSPROC genBuffers;
+    PFNGLDELETEBUFFERSPROC deleteBuffers;
+    PFNGLBINDBUFFERPROC bindBuffer;
+    PFNGLBUFFERDATAPROC bufferData;
+    PFNGLBINDBUFFERBASEPROC bindBufferBase;
+    PFNGLGENFRAMEBUFFERSPROC genFramebuffers;
+    PFNGLDELETEFRAMEBUFFERSPROC deleteFramebuffers;
+    PFNGLBINDFRAMEBUFFERPROC bindFramebuffer;
+    PFNGLFRAMEBUFFERTEXTURE2DPROC framebufferTexture2D;
+    PFNGLBLITFRAMEBUFFERPROC blitFramebuffer;
+  };
+
+  constexpr static const unsigned groupSize = 8; // work group of the shader traces groupSize x groupSize pixels
+  constexpr static const unsigned maxInstances = 16; // maximal number of the height maps sharing the textures
+  constexpr static const unsigned gradientSize = 769; // entries of the gradient texture, the material table has 3 * 256 segments
+
+  /**
+   * Compute shader tracing one pixel per invocation
+   * Traversal walks the mip chain of the maximal heights from the top level, it descends into the cell the ray gets below
+   * and climbs one level after every step. Cells of the first level are tested by their two triangles as in Cell.
+   */
+  static const char *const shaderSource;
+
+  Functions gl{};
+  unsigned width, height;
+  unsigned gridWidth, gridDepth, topLevel;
+  Vector3d size; // size of the height map in world units
+  std::vector<float> instancePositions; // x, y, z of the position of every height map
+  GLuint program = 0;
+  GLuint heightTexture = 0, maxHeightTexture = 0, gradientTexture = 0, imageTexture = 0;
+  GLuint lightBuffer = 0, framebuffer = 0;
+
+  /**
+   * Load the OpenGL functions of the current context
+   * @return true if all functions were found
+   */
+  bool loadFunctions();
+
+  /**
+   * Compile and link the compute shader
+   */
+  void createProgram();
+
+  /**
+   * Upload heights, maximal heights and gradient of the first height map
+   * @param heightMap - height map read to memory
+   */
+  void uploadHeightMap(const HeightMap &heightMap);
+
+  /**
+   * Upload positions, colors and ranges of the lights
+   * @param lights - lights of the context
+   */
+  void uploadLights(const std::vector<Light> &lights);
+
+  /**
+   * Set uniform vector of the program
+   * @param name - name of the uniform
+   * @param x - first component
+   * @param y - second component
+   * @param z - third component
+   */
+  void setUniform(const char *name, float x, float y, float z);
+
+public:
+  /**
+   * Upload the height maps and the lights of the context to the graphics card, the OpenGL 4.3 context has to be current
+   * @param heightMaps - height maps read to memory, all of them copies of the first one at different positions
+   * @param context - context with the lights, the size of the image and the background color
+   */
+  explicit GpuTracer(const std::vector<HeightMap> &heightMaps, const Context &context);
+
+  /**
+   * Delete the textures, buffers and the program
+   */
+  ~GpuTracer();
+
+  GpuTracer(const GpuTracer &) = delete;
+  GpuTracer &operator=(const GpuTracer &) = delete;
+
+  /**
+   * Trace the frame from the camera of the context and copy it to the bound draw framebuffer
+   * @param context - context with the camera, the lights uploaded in the constructor are used
+   */
+  void render(const Context &context);
+
+  /**
+   * Get texture with the traced frame, 8-bit rgba
+   * @return name of the texture
+   */
+  [[nodiscard]] GLuint getImageTexture() const;
+};
+
+#endif
@@ -1,34 +1,320 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
 #include "Grid.h"
+#include "src/profiler/Profiler.h"
+#include "src/thread-pool/ThreadPool.h"
+
+Grid::Grid(const HeightSource &reader, float height, float cellW, float cellD, const Point3d &position)
+  : gridWidth(reader.getImageWidth() - 1), gridDepth(reader.getImageHeight() - 1), cellWidth(cellW), cellDepth(cellD), position(position) {
+  Profiler::Scope scope("build grid");
+  sampleOffset = position.getY();
+  sampleScale = HeightTile::getSampleScale(height);
+  // the only tile covers the whole grid, so the whole pyramid is stored in it
+  while ((1u << tileLevel) < std::max(gridWidth, gridDepth)) tileLevel++;
+  residentTiles.push_back(loadTile(reader, 0));
+  pyramid = MaxHeightPyramid({residentTiles[0]->getMaxHeight()}, 1, 1, tileLevel);
+}
+
+Grid::Grid(const TerrainCache &cache, float cellW, float cellD, const Point3d &position)
+  : gridWidth(cache.getGridWidth()), gridDepth(cache.getGridDepth()), cellWidth(cellW), cellDepth(cellD), position(position) {
+  Profiler::Scope scope("map terrain cache");
+  while ((1u << tileLevel) < std::max(gridWidth, gridDepth)) tileLevel++;
+  residentTiles.push_back(cache.createTile(position, cellWidth, cellDepth));
+  pyramid = MaxHeightPyramid({residentTiles[0]->getMaxHeight()}, 1, 1, tileLevel);
+}
 
-Grid::Grid(const MapReader &reader, float height, float cellW, float cellD, const Point3d &position) : map(std::vector<std::vector<Cell>>(reader.getImageHeight() - 1)), cellWidth(cellW), cellDepth(cellD), position(position) {
-  auto imgHeight = reader.getImageHeight();
-  auto imgWidth = reader.getImageWidth();
-  map = std::vector<std::vector<Cell>>(imgHeight - 1);
-  for (auto row = 0; row < imgHeight - 1; row++) {
-    map[row] = std::vector<Cell>(imgWidth - 1);
-    for (auto col = 0; col < imgWidth - 1; col++) {
-      auto h = height;
-      auto y = position.getY();
-      float values[] = {
-        reader.getIntensityAt(row, col) * h + y,
-        reader.getIntensityAt(row, col + 1) * h + y,
-        reader.getIntensityAt(row + 1, col) * h + y,
-        reader.getIntensityAt(row + 1, col + 1) * h + y
-      };
-
-      auto xPos = position.getX() + cellWidth * col;
-      auto zPos = position.getZ() + cellDepth * row;
-      map[row][col] = Cell(values[0], values[1], values[2], values[3], xPos, zPos, cellWidth, cellDepth);
+Grid::Grid(const std::shared_ptr<const HeightSource> &source, unsigned tileSize, size_t cacheBudget, float height, float cellW, float cellD, const Point3d &position)
+  : gridWidth(source->getImageWidth() - 1), gridDepth(source->getImageHeight() - 1), cellWidth(cellW), cellDepth(cellD), position(position) {
+  sampleOffset = position.getY();
+  sampleScale = HeightTile::getSampleScale(height);
+  while (tileLevel < 16 && (2u << tileLevel) <= tileSize) tileLevel++;
+  auto size = 1u << tileLevel;
+  tileColumns = (gridWidth + size - 1) / size;
+  tileRows = (gridDepth + size - 1) / size;
+
+  // maximal heights of the tiles for the upper levels of the pyramid, every tile row is read by one task,
+  // samples on the border between tile rows are read by both of them
+  std::vector<float> tileMaxHeights(tileColumns * tileRows, std::numeric_limits<float>::lowest());
+  ThreadPool::getShared().parallelFor(tileRows, [&](unsigned tileRow) {
+    std::vector<float> intensities(gridWidth + 1);
+    auto rowMaxHeights = tileMaxHeights.data() + tileRow * tileColumns;
+    for (auto row = tileRow * size; row <= std::min((tileRow + 1) * size, gridDepth); row++) {
+      source->readRow(row, 0, gridWidth + 1, intensities.data());
+      for (unsigned col = 0; col <= gridWidth; col++) {
+        auto sampleHeight = sampleOffset + float(HeightTile::quantize(intensities[col])) * sampleScale;
+        auto lastTileCol = std::min(col >> tileLevel, tileColumns - 1);
+        auto firstTileCol = col > 0 && col % size == 0 && col >> tileLevel == lastTileCol ? lastTileCol - 1 : lastTileCol;
+        for (auto tileCol = firstTileCol; tileCol <= lastTileCol; tileCol++) rowMaxHeights[tileCol] = std::max(rowMaxHeights[tileCol], sampleHeight);
+      }
     }
-  }
+  });
+  pyramid = MaxHeightPyramid(std::move(tileMaxHeights), tileColumns, tileRows, tileLevel);
+
+  this->source = source;
+  tileCache = std::make_shared<TileCache>(cacheBudget);
+}
+
+const HeightTile *Grid::requestTile(unsigned index, std::shared_ptr<const HeightTile> &holder) const {
+  if (!tileCache) return residentTiles[index].get();
+  holder = tileCache->get(index, [this, index] { return loadTile(*source, index); });
+  return holder.get();
+}
+
+std::shared_ptr<HeightTile> Grid::loadTile(const HeightSource &reader, unsigned index) const {
+  auto firstRow = (index / tileColumns) << tileLevel, firstCol = (index % tileColumns) << tileLevel;
+  auto size = 1u << tileLevel;
+  auto width = std::min(size, gridWidth - firstCol), depth = std::min(size, gridDepth - firstRow);
+  return std::make_shared<HeightTile>(reader, firstRow, firstCol, width, depth, sampleScale, sampleOffset, position, cellWidth, cellDepth);
+}
+
+Cell Grid::buildCell(const HeightTile &tile, unsigned row, unsigned col) const {
+#ifdef STORED_TRIANGLES
+  if (tile.hasStoredCells()) return tile.getCell(row, col);
+#endif
+  auto xPos = position.getX() + cellWidth * float(col);
+  auto zPos = position.getZ() + cellDepth * float(row);
+  return Cell(tile.getSampleHeight(row, col), tile.getSampleHeight(row, col + 1), tile.getSampleHeight(row + 1, col), tile.getSampleHeight(row + 1, col + 1), xPos, zPos, cellWidth, cellDepth);
 }
 
 unsigned Grid::getGridDepth() const {
-  return map.size();
+  return gridDepth;
 }
 
 unsigned Grid::getGridWidth() const {
-  return map[0].size();
+  return gridWidth;
+}
+
+float Grid::getSampleHeight(unsigned row, unsigned col) const {
+  TileCursor cursor(*this);
+  return cursor.getTile(row, col).getSampleHeight(row, col);
+}
+
+Cell Grid::getCell(unsigned row, unsigned col) const {
+  TileCursor cursor(*this);
+  return buildCell(cursor.getTile(row, col), row, col);
+}
+
+void Grid::addCellToPacket(const HeightTile &tile, unsigned row, unsigned col, TrianglePacket &packet) const {
+#ifdef STORED_TRIANGLES
+  if (tile.hasStoredCells()) {
+    tile.getCell(row, col).addToPacket(packet);
+    return;
+  }
+#endif
+  auto xPos = position.getX() + cellWidth * float(col);
+  auto zPos = position.getZ() + cellDepth * float(row);
+  Cell::addToPacket(packet, tile.getSampleHeight(row, col), tile.getSampleHeight(row, col + 1), tile.getSampleHeight(row + 1, col), tile.getSampleHeight(row + 1, col + 1), xPos, zPos, cellWidth, cellDepth);
+}
+
+void Grid::updateSamples(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const float *intensities, float &minHeight, float &maxHeight) {
+  if (isOutOfCore()) {
+    std::cerr << "only height map read to memory can be edited" << std::endl;
+    throw std::invalid_argument("received out-of-core height map for editing");
+  }
+  if (rows == 0 || cols == 0 || firstRow + rows > gridDepth + 1 || firstCol + cols > gridWidth + 1) {
+    std::cerr << "edited samples " << rows << "x" << cols << " from " << firstRow << "," << firstCol << " are outside of the grid" << std::endl;
+    throw std::invalid_argument("received edited samples outside of the grid");
+  }
+  auto &tile = *residentTiles[0];
+  // the changed cells reach one sample around the replaced ones
+  auto beginRow = std::max(firstRow, 1u) - 1, endRow = std::min(firstRow + rows + 1, gridDepth + 1);
+  auto beginCol = std::max(firstCol, 1u) - 1, endCol = std::min(firstCol + cols + 1, gridWidth + 1);
+  minHeight = std::numeric_limits<float>::infinity();
+  maxHeight = std::numeric_limits<float>::lowest();
+  auto addHeights = [&] {
+    for (auto row = beginRow; row < endRow; row++) {
+      for (auto col = beginCol; col < endCol; col++) {
+        minHeight = std::min(minHeight, tile.getSampleHeight(row, col));
+        maxHeight = std::max(maxHeight, tile.getSampleHeight(row, col));
+      }
+    }
+  };
+  addHeights();
+  tile.updateSamples(firstRow, firstCol, rows, cols, intensities, position, cellWidth, cellDepth);
+  addHeights();
+  pyramid = MaxHeightPyramid({tile.getMaxHeight()}, 1, 1, tileLevel);
+
+  // central differences of the neighbouring samples use the replaced ones too
+  if (vertexNormals) computeVertexNormals(*vertexNormals, beginRow, endRow, beginCol, endCol);
+  if (ceiling) {
+    const auto &levels = tile.getPyramid();
+    auto level = std::min(ceilingLevel, levels.getLevelCount() - 1);
+    auto lastRow = std::min(endRow - 1, gridDepth - 1), lastCol = std::min(endCol - 1, gridWidth - 1);
+    for (auto row = beginRow >> level; row <= lastRow >> level; row++) {
+      for (auto col = beginCol >> level; col <= lastCol >> level; col++) ceiling->set(row, col, levels.getMaxHeight(level, row, col));
+    }
+  }
+  horizonMap.reset();
+}
+
+float Grid::getMaxHeight(unsigned row, unsigned col) const {
+  TileCursor cursor(*this);
+  return cursor.getTile(row, col).getCellMaxHeight(row, col);
+}
+
+float Grid::getAreaMaxHeight(float minX, float minZ, float maxX, float maxZ) const {
+  auto from = getGridPoint(Point3d(minX, 0.f, minZ)), to = getGridPoint(Point3d(maxX, 0.f, maxZ));
+  if (to.getX() < 0.f || to.getZ() < 0.f || from.getX() >= float(gridWidth) || from.getZ() >= float(gridDepth)) return std::numeric_limits<float>::lowest();
+  auto firstCol = unsigned(std::max(from.getX(), 0.f)), firstRow = unsigned(std::max(from.getZ(), 0.f));
+  auto lastCol = std::min(unsigned(to.getX()), gridWidth - 1), lastRow = std::min(unsigned(to.getZ()), gridDepth - 1);
+
+  // out-of-core grid has the pyramid from the tile level up, the grid read to memory has the whole pyramid in its only tile
+  const auto &levels = isOutOfCore() ? pyramid : residentTiles[0]->getPyramid();
+  auto level = levels.getFirstLevel();
+  while (level + 1 < levels.getLevelCount() && ((lastRow >> level) - (firstRow >> level) > 1 || (lastCol >> level) - (firstCol >> level) > 1)) level++;
+  auto maxHeight = std::numeric_limits<float>::lowest();
+  for (auto row = firstRow >> level; row <= lastRow >> level; row++) {
+    for (auto col = firstCol >> level; col <= lastCol >> level; col++) maxHeight = std::max(maxHeight, levels.getMaxHeight(level, row, col));
+  }
+  return maxHeight;
+}
+
+void Grid::computeVertexNormals(VertexNormals &normals, unsigned beginRow, unsigned endRow, unsigned beginCol, unsigned endCol) const {
+  const auto &tile = *residentTiles[0];
+  ThreadPool::getShared().parallelForChunks(endRow - beginRow, normalRowsPerTask, [&](unsigned begin, unsigned end) {
+    for (auto row = beginRow + begin; row < beginRow + end; row++) {
+      // one-sided differences on the border of the grid
+      auto up = row > 0 ? row - 1 : row, down = std::min(row + 1, gridDepth);
+      for (auto col = beginCol; col < endCol; col++) {
+        auto left = col > 0 ? col - 1 : col, right = std::min(col + 1, gridWidth);
+        auto slopeX = (tile.getSampleHeight(row, right) - tile.getSampleHeight(row, left)) / (cellWidth * float(right - left));
+        auto slopeZ = (tile.getSampleHeight(down, col) - tile.getSampleHeight(up, col)) / (cellDepth * float(down - up));
+        normals.set(row, col, Vector3d(-slopeX, 1.f, -slopeZ).normalized());
+      }
+    }
+  });
+}
+
+void Grid::buildVertexNormals() {
+  if (isOutOfCore()) return;
+  Profiler::Scope scope("build normals");
+  auto normals = std::make_shared<VertexNormals>(gridWidth, gridDepth);
+  computeVertexNormals(*normals, 0, gridDepth + 1, 0, gridWidth + 1);
+  vertexNormals = std::move(normals);
+}
+
+void Grid::loadVertexNormals(const TerrainCache &cache) {
+  Profiler::Scope scope("load normals");
+  vertexNormals = cache.createVertexNormals();
+}
+
+bool Grid::hasVertexNormals() const {
+  return vertexNormals != nullptr;
+}
+
+Vector3d Grid::getVertexNormal(const Point3d &pos) const {
+  auto gridPoint = getGridPoint(pos);
+  return vertexNormals->interpolate(gridPoint.getX(), gridPoint.getZ());
+}
+
+void Grid::buildCeiling() {
+  // out-of-core grid has the pyramid from the tile level up, the grid read to memory has the whole pyramid in its only tile
+  const auto &levels = isOutOfCore() ? pyramid : residentTiles[0]->getPyramid();
+  auto level = isOutOfCore() ? tileLevel : std::min(ceilingLevel, levels.getLevelCount() - 1);
+  auto blockCells = 1u << level;
+  auto columns = (gridWidth + blockCells - 1) >> level, rows = (gridDepth + blockCells - 1) >> level;
+  std::vector<float> maxHeights(columns * rows);
+  for (unsigned row = 0; row < rows; row++) {
+    for (unsigned col = 0; col < columns; col++) maxHeights[row * columns + col] = levels.getMaxHeight(level, row, col);
+  }
+  ceiling = std::make_shared<HeightCeiling>(std::move(maxHeights), columns, rows, cellWidth * float(blockCells), cellDepth * float(blockCells), position);
+}
+
+float Grid::getCeilingStart(const Ray &ray, float tLow, float tHigh) const {
+  return ceiling ? ceiling->getStart(ray, tLow, tHigh) : tLow;
+}
+
+void Grid::buildHorizonMap(unsigned directions) {
+  if (isOutOfCore() || directions == 0) return;
+  Profiler::Scope scope("build horizon map");
+  auto map = std::make_shared<HorizonMap>(gridWidth, gridDepth, directions);
+  const auto &tile = *residentTiles[0];
+  auto width = cellWidth * float(gridWidth), depth = cellDepth * float(gridDepth);
+  auto nearStep = std::min(cellWidth, cellDepth);
+  ThreadPool::getShared().parallelForChunks(gridDepth + 1, horizonRowsPerTask, [&](unsigned begin, unsigned end) {
+    for (auto row = begin; row < end; row++) {
+      for (unsigned col = 0; col <= gridWidth; col++) {
+        auto height = tile.getSampleHeight(row, col);
+        auto x = cellWidth * float(col), z = cellDepth * float(row);
+        for (unsigned direction = 0; direction < directions; direction++) {
+          auto azimuth = 2.f * std::numbers::pi_v<float> * float(direction) / float(directions);
+          auto dirX = std::cos(azimuth), dirZ = std::sin(azimuth);
+          auto maxSlope = -std::numeric_limits<float>::infinity();
+          auto distance = nearStep;
+          for (unsigned step = 1;; step++) {
+            auto sampleX = x + dirX * distance, sampleZ = z + dirZ * distance;
+            if (sampleX < 0.f || sampleZ < 0.f || sampleX > width || sampleZ > depth) break;
+            auto sampleHeight = tile.getSampleHeight(unsigned(std::lround(sampleZ / cellDepth)), unsigned(std::lround(sampleX / cellWidth)));
+            maxSlope = std::max(maxSlope, (sampleHeight - height) / distance);
+            distance = step < horizonNearSteps ? distance + nearStep : distance * horizonStepGrowth;
+          }
+          map->set(row, col, direction, std::atan(maxSlope));
+        }
+      }
+    }
+  });
+  horizonMap = std::move(map);
+}
+
+void Grid::setHorizonMap(const std::shared_ptr<const HorizonMap> &map) {
+  horizonMap = map;
+}
+
+const std::shared_ptr<const HorizonMap> &Grid::getHorizonMap() const {
+  return horizonMap;
+}
+
+bool Grid::isBelowHorizon(const Point3d &pos, const Point3d &lightPosition) const {
+  auto gridPoint = getGridPoint(pos);
+  return horizonMap->isBelowHorizon(gridPoint.getX(), gridPoint.getZ(), lightPosition.getVectorBetween(pos));
+}
+
+bool Grid::isOutOfCore() const {
+  return tileCache != nullptr;
+}
+
+void Grid::saveTerrainCache(const std::string &cachePath, const std::string &sourcePath) const {
+  if (residentTiles.size() != 1) {
+    std::cerr << "only height map read to memory can be saved to terrain cache" << std::endl;
+    throw std::invalid_argument("received out-of-core height map for terrain cache");
+  }
+  // the normals are always stored, so the runs with the smooth shading mapping the cache do not compute them
+  auto normals = vertexNormals;
+  if (!normals) {
+    normals = std::make_shared<VertexNormals>(gridWidth, gridDepth);
+    computeVertexNormals(*normals, 0, gridDepth + 1, 0, gridWidth + 1);
+  }
+  TerrainCache::save(cachePath, sourcePath, *residentTiles[0], sampleScale, sampleOffset, *normals);
+}
+
+void Grid::printTileCacheStatistics(std::ostream &out) const {
+  if (!tileCache) return;
+  out << "terrain tiles: " << tileColumns << "x" << tileRows << " tiles of " << (1u << tileLevel) << "x" << (1u << tileLevel) << " cells" << std::endl;
+  tileCache->printStatistics(out);
+}
+
+void Grid::reportMemory(MemoryReport &report) const {
+  for (const auto &tile : residentTiles) {
+    if (report.addShared(tile.get(), "height tiles", sizeof(HeightTile))) tile->reportMemory(report);
+  }
+  report.add("max-height pyramids", pyramid.getMemorySize());
+  if (source) report.addShared(source.get(), "map readers", source->getMemorySize());
+  if (tileCache) report.addShared(tileCache.get(), "tile caches", tileCache->getUsedMemory());
+  if (vertexNormals) report.addShared(vertexNormals.get(), "vertex normals", vertexNormals->getMemorySize());
+  if (ceiling) report.addShared(ceiling.get(), "height ceilings", ceiling->getMemorySize());
+  if (horizonMap) report.addShared(horizonMap.get(), "horizon maps", horizonMap->getMemorySize());
+}
+
+size_t Grid::estimateMemorySize(unsigned gridWidth, unsigned gridDepth, [[maybe_unused]] bool storedTriangles) {
+  auto size = sizeof(HeightTile) + HeightTile::getSampleCount(gridWidth, gridDepth) * sizeof(uint16_t)
+    + MaxHeightPyramid::getValueCount(gridWidth, gridDepth) * sizeof(float);
+#ifdef STORED_TRIANGLES
+  if (storedTriangles) size += size_t(gridWidth) * gridDepth * sizeof(Cell);
+#endif
+  return size;
 }
 
 Point2d Grid::getGridPoint(const Point3d &pos) const {
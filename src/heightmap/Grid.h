@@ -1,30 +1,167 @@
 #pragma once
 
+#include <cstddef>
+#include <limits>
+#include <memory>
 #include <vector>
 #include <utility>
 #include "cell/Cell.h"
+#include "height-ceiling/HeightCeiling.h"
+#include "height-tile/HeightTile.h"
+#include "pyramid/MaxHeightPyramid.h"
+#include "terrain-cache/TerrainCache.h"
+#include "tile-cache/TileCache.h"
+#include "horizon-map/HorizonMap.h"
+#include "vertex-normals/VertexNormals.h"
 #include "src/point/Point2d.h"
 #include "src/point/Point2i.h"
-#include "src/heightmap/heightmap-reader/MapReader.h"
+#include "src/heightmap/heightmap-reader/HeightSource.h"
+#include "src/memory-report/MemoryReport.h"
 
 /**
  * Class for grid underlying the height field
+ *
+ * Grid is split into square tiles of 2^l x 2^l cells. Every tile stores its height samples quantized to 16 bits and the lower levels
+ * of the pyramid of precomputed maximal heights of the cells and blocks of cells, the grid stores the levels from the tile level up.
+ * Triangles of the cell are built from its four corner samples when a ray reaches the cell,
+ * unless the project is built with STORED_TRIANGLES, which keeps all cells of the tile with their triangles in one contiguous array
+ *
+ * Grid read to memory is one tile covering all cells. Out-of-core grid keeps the source of the samples and loads the tiles
+ * when the rays reach them, tiles are kept in the cache with limited memory.
  */
 class Grid {
 protected:
-  std::vector<std::vector<Cell>> map;
+  /**
+   * Tile of the last accessed cell, the tile is requested from the grid only when the traversal crosses to the other tile
+   */
+  class TileCursor {
+    const Grid &grid;
+    const HeightTile *tile = nullptr;
+    std::shared_ptr<const HeightTile> cachedTile; // keeps the tile alive when it is released from the cache
+    unsigned firstRow = 0, firstCol = 0, rows = 0, cols = 0; // cells (and samples) belonging to the tile
+
+  public:
+    /**
+     * Create cursor without any tile
+     * @param grid - grid of the tiles
+     */
+    explicit TileCursor(const Grid &grid) : grid(grid) {}
+
+    /**
+     * Get tile containing the cell (or the sample)
+     * @param row - row of the cell
+     * @param col - column of the cell
+     * @return tile containing the cell
+     */
+    const HeightTile &getTile(unsigned row, unsigned col) {
+      if (row - firstRow >= rows || col - firstCol >= cols) { // unsigned difference wraps for lower coordinates
+        auto index = grid.getTileIndex(row, col);
+        tile = grid.requestTile(index, cachedTile);
+        firstRow = (index / grid.tileColumns) << grid.tileLevel;
+        firstCol = (index % grid.tileColumns) << grid.tileLevel;
+        rows = index / grid.tileColumns == grid.tileRows - 1 ? grid.gridDepth + 1 - firstRow : 1u << grid.tileLevel;
+        cols = index % grid.tileColumns == grid.tileColumns - 1 ? grid.gridWidth + 1 - firstCol : 1u << grid.tileLevel;
+      }
+      return *tile;
+    }
+  };
+
+  constexpr static const unsigned normalRowsPerTask = 32; // rows of the vertex normals computed by one task of the thread pool
+  constexpr static const unsigned ceilingLevel = 4; // level of the pyramid used for the ceiling of the grid read to memory, blocks of 16 x 16 cells
+  constexpr static const unsigned horizonRowsPerTask = 8; // rows of the horizon map computed by one task of the thread pool
+  constexpr static const unsigned horizonNearSteps = 8; // steps of one cell walked from the sample before the steps start growing
+  constexpr static const float horizonStepGrowth = 1.2f; // ratio of the following distances in the horizon search after the near steps
+
+  unsigned gridWidth, gridDepth;
+  unsigned tileLevel = 0; // tile has 2^tileLevel x 2^tileLevel cells
+  unsigned tileColumns = 1, tileRows = 1;
+  std::vector<std::shared_ptr<HeightTile>> residentTiles; // all tiles of the grid read to memory
+  std::shared_ptr<const HeightSource> source; // source of the out-of-core grid tiles
+  std::shared_ptr<TileCache> tileCache; // loaded tiles of the out-of-core grid, shared by the copies of the grid
+  float sampleScale = 0.f, sampleOffset = 0.f;
+  MaxHeightPyramid pyramid; // levels from the tile level up
+  std::shared_ptr<VertexNormals> vertexNormals; // normals for the smooth shading, shared by the copies of the grid
+  std::shared_ptr<HeightCeiling> ceiling; // coarse maximal heights where the rays start, shared by the copies of the grid
+  std::shared_ptr<const HorizonMap> horizonMap; // horizons of the samples for the shadows, shared by the copies of the grid
   const float cellWidth, cellDepth;
   const Point3d position;
 
   /**
-   * Create grid from given map reader
-   * @param reader - reader of the height map file
+   * Get index of the tile containing the cell, samples on the far border belong to the last tile
+   * @param row - row of the cell (z)
+   * @param col - column of the cell (x)
+   * @return index of the tile
+   */
+  [[nodiscard]] unsigned getTileIndex(unsigned row, unsigned col) const {
+    return std::min(row >> tileLevel, tileRows - 1) * tileColumns + std::min(col >> tileLevel, tileColumns - 1);
+  }
+
+  /**
+   * Get tile with given index, out-of-core grid loads it to the cache if it is needed
+   * @param index - index of the tile
+   * @param holder - where the tile from the cache is stored, so it is not released while it is used
+   * @return requested tile
+   */
+  [[nodiscard]] const HeightTile *requestTile(unsigned index, std::shared_ptr<const HeightTile> &holder) const;
+
+  /**
+   * Load tile from the source of the samples
+   * @param source - source of the samples of the whole grid
+   * @param index - index of the tile
+   * @return loaded tile
+   */
+  [[nodiscard]] std::shared_ptr<HeightTile> loadTile(const HeightSource &source, unsigned index) const;
+
+  /**
+   * Compute normals of a rectangle of the samples from the central differences of the heights, the rows are computed in parallel
+   * @param normals - where the normals are stored
+   * @param beginRow - first row of the samples
+   * @param endRow - row after the last row of the samples
+   * @param beginCol - first column of the samples
+   * @param endCol - column after the last column of the samples
+   */
+  void computeVertexNormals(VertexNormals &normals, unsigned beginRow, unsigned endRow, unsigned beginCol, unsigned endCol) const;
+
+  /**
+   * Build cell with triangles from the four corner samples of the cell
+   * @param tile - tile containing the cell
+   * @param row - row of the cell
+   * @param col - column of the cell
+   * @return built cell
+   */
+  [[nodiscard]] Cell buildCell(const HeightTile &tile, unsigned row, unsigned col) const;
+
+  /**
+   * Create grid from given source of height samples, the samples are read row by row to one tile in memory
+   * @param reader - source of the height samples (image or raw file reader)
    * @param height - height of the whole height map
    * @param cellW - width of the cell
    * @param cellD - depth of the cell
    * @param position - position of the grid (map)
    */
-  explicit Grid(const MapReader &reader, float height, float cellW, float cellD, const Point3d &position);
+  explicit Grid(const HeightSource &reader, float height, float cellW, float cellD, const Point3d &position);
+
+  /**
+   * Create grid from the terrain cache file, the grid uses the mapped samples and pyramid directly
+   * @param cache - mapped terrain cache file
+   * @param cellW - width of the cell
+   * @param cellD - depth of the cell
+   * @param position - position of the grid (map)
+   */
+  explicit Grid(const TerrainCache &cache, float cellW, float cellD, const Point3d &position);
+
+  /**
+   * Create out-of-core grid, tiles are read from the source when they are needed
+   * The source is read once at the start to find maximal heights of the tiles
+   * @param source - source of the height samples, it is kept by the grid
+   * @param tileSize - number of cells in the tile side (rounded down to power of two)
+   * @param cacheBudget - maximal memory of the cached tiles in bytes
+   * @param height - height of the whole height map
+   * @param cellW - width of the cell
+   * @param cellD - depth of the cell
+   * @param position - position of the grid (map)
+   */
+  explicit Grid(const std::shared_ptr<const HeightSource> &source, unsigned tileSize, size_t cacheBudget, float height, float cellW, float cellD, const Point3d &position);
 
 public:
   /**
@@ -39,6 +176,168 @@ public:
    */
   [[nodiscard]] unsigned getGridWidth() const;
 
+  /**
+   * Get height sample (y coordinate) in the corner of the cells
+   * @param row - row of the sample (0 to grid depth)
+   * @param col - column of the sample (0 to grid width)
+   * @return height at the sample
+   */
+  [[nodiscard]] float getSampleHeight(unsigned row, unsigned col) const;
+
+  /**
+   * Get cell with its triangles, built from its four corner samples unless the triangles are stored
+   * @param row - row of the cell
+   * @param col - column of the cell
+   * @return cell with its triangles
+   */
+  [[nodiscard]] Cell getCell(unsigned row, unsigned col) const;
+
+  /**
+   * Add both triangles of the cell to the packet
+   * @param tile - tile containing the cell
+   * @param row - row of the cell
+   * @param col - column of the cell
+   * @param packet - packet with at least two free lanes
+   */
+  void addCellToPacket(const HeightTile &tile, unsigned row, unsigned col, TrianglePacket &packet) const;
+
+  /**
+   * Get maximal height of the cell
+   * @param row - row of the cell
+   * @param col - column of the cell
+   * @return maximal height of the cell
+   */
+  [[nodiscard]] float getMaxHeight(unsigned row, unsigned col) const;
+
+  /**
+   * Get bound of the maximal height of the cells under the rectangle, from the pyramid level where the rectangle spans at most
+   * two blocks in both directions, so at most four blocks are read
+   * @param minX - lower x coordinate of the rectangle (in world units)
+   * @param minZ - lower z coordinate of the rectangle
+   * @param maxX - upper x coordinate of the rectangle
+   * @param maxZ - upper z coordinate of the rectangle
+   * @return maximal height of the blocks covering the rectangle, lowest float if the rectangle does not overlap the grid
+   */
+  [[nodiscard]] float getAreaMaxHeight(float minX, float minZ, float maxX, float maxZ) const;
+
+  /**
+   * Replace a rectangle of the samples of the grid read to memory, only the structures over the changed samples are built again:
+   * the cells touching them, the pyramid blocks above these cells, the normals of the samples and their neighbours and the ceiling blocks
+   * Horizon of every sample can depend on the changed samples, so the horizon map is released and shadows are traced instead
+   * The samples are shared by the copies of the grid, so the copies change too, they must not be rendered during the change
+   * @param firstRow - row of the first replaced sample
+   * @param firstCol - column of the first replaced sample
+   * @param rows - number of the replaced rows
+   * @param cols - number of the replaced columns
+   * @param intensities - rows * cols new intensities in range 0 - 1 by rows
+   * @param minHeight - where the minimal height of the changed surface is stored, before or after the change
+   * @param maxHeight - where the maximal height of the changed surface is stored, before or after the change
+   */
+  void updateSamples(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const float *intensities, float &minHeight, float &maxHeight);
+
+  /**
+   * Compute normals in the samples from the central differences of the heights, so the shading can interpolate them across the cells
+   * Out-of-core grid is left without them and is shaded with the normals of the triangles
+   */
+  void buildVertexNormals();
+
+  /**
+   * Copy the normals in the samples from the terrain cache the grid was mapped from, so they are not computed again
+   * @param cache - terrain cache of the grid
+   */
+  void loadVertexNormals(const TerrainCache &cache);
+
+  /**
+   * Check if the normals in the samples were built
+   * @return true if the smooth normals can be interpolated
+   */
+  [[nodiscard]] bool hasVertexNormals() const;
+
+  /**
+   * Interpolate the normals in the corners of the cell containing the point (only when the normals were built)
+   * @param pos - point on the surface of the grid
+   * @return smooth unit normal
+   */
+  [[nodiscard]] Vector3d getVertexNormal(const Point3d &pos) const;
+
+  /**
+   * Copy the maximal heights of the coarse blocks of cells from the pyramid to the ceiling, the rays then skip the cells before
+   * the first block they get under. Blocks of the grid read to memory have 16 x 16 cells, out-of-core grid uses its tiles as the blocks
+   */
+  void buildCeiling();
+
+  /**
+   * Find where the ray gets below the ceiling of the grid
+   * @param ray - investigated ray
+   * @param tLow - parameter where the ray enters the grid
+   * @param tHigh - parameter where the ray leaves the grid
+   * @return parameter of the first block under the ceiling, tHigh if the ray stays above, tLow if the ceiling was not built
+   */
+  [[nodiscard]] float getCeilingStart(const Ray &ray, float tLow, float tHigh) const;
+
+  /**
+   * Compute horizon angles of all samples in evenly spaced azimuth directions, the rows are computed in parallel
+   * The search walks from the sample by single cells first and then by growing steps up to the border of the grid
+   * Out-of-core grid is left without them and its shadows are traced
+   * @param directions - number of the azimuth directions
+   */
+  void buildHorizonMap(unsigned directions);
+
+  /**
+   * Use horizon map loaded from the cache file
+   * @param map - horizon map of the same grid
+   */
+  void setHorizonMap(const std::shared_ptr<const HorizonMap> &map);
+
+  /**
+   * Get horizon map of the grid
+   * @return horizon map, shared by the copies of the grid, nullptr if it was not built
+   */
+  [[nodiscard]] const std::shared_ptr<const HorizonMap> &getHorizonMap() const;
+
+  /**
+   * Find if the grid hides the light from the point by the horizon of the samples around it (only when the horizon map was built)
+   * @param pos - point on the surface of the grid
+   * @param lightPosition - position of the light
+   * @return true if the point is in the shadow
+   */
+  [[nodiscard]] bool isBelowHorizon(const Point3d &pos, const Point3d &lightPosition) const;
+
+  /**
+   * Check if the tiles are loaded on demand
+   * @return true for out-of-core grid
+   */
+  [[nodiscard]] bool isOutOfCore() const;
+
+  /**
+   * Write the grid read to memory to the terrain cache file, with the normals in the samples (computed for the file if they were not built)
+   * @param cachePath - path of the cache file
+   * @param sourcePath - path of the height map which the grid was read from
+   */
+  void saveTerrainCache(const std::string &cachePath, const std::string &sourcePath) const;
+
+  /**
+   * Print statistics of the tile cache of out-of-core grid to the output
+   * @param out - output stream
+   */
+  void printTileCacheStatistics(std::ostream &out) const;
+
+  /**
+   * Report memory of the tiles, the pyramid, the source of the out-of-core tiles and the optional structures, structures shared
+   * by the copies of the grid are reported once
+   * @param report - report where the memory is added
+   */
+  void reportMemory(MemoryReport &report) const;
+
+  /**
+   * Estimate memory of the grid read to memory, the same as reported after it is built
+   * @param gridWidth - number of the cell columns
+   * @param gridDepth - number of the cell rows
+   * @param storedTriangles - the triangles of the cells are stored (only when built with STORED_TRIANGLES)
+   * @return size in bytes
+   */
+  [[nodiscard]] static size_t estimateMemorySize(unsigned gridWidth, unsigned gridDepth, bool storedTriangles);
+
   /**
    * Get coordinates in the map grid (rows and columns)
    * @return 2d coordinate point
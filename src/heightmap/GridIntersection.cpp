@@ -1,159 +1,240 @@
 #include "GridIntersection.h"
-#include "src/scene.h"
-#include "src/rational/Rational.h"
+#include "bilinear-patch/BilinearPatch.h"
+#include "digital-line/DigitalLine.h"
 
-GridIntersection::Transformation::Transformation(bool horizontal, bool positive) : horizontal(horizontal), positive(positive) {}
+bool GridIntersection::findIntersectionInPacket(const TrianglePacket &packet, const Query &query) {
+  COUNT_TRAVERSAL(triangleTests, packet.getCount());
+  if (query.intersection) return packet.findNearestIntersection(query.ray, query.tMin, query.tMax, *query.intersection);
+  return packet.hasIntersection(query.ray, query.tMin, query.tMax);
+}
 
-bool GridIntersection::findIntersectionInRun(const Transformation &transformation, int from, int to, int otherCoord, float initY, float stepY, const Ray &ray, Intersection &intersection) const {
-  auto diff = from < to ? 1 : -1;
-  int i = stepY > 0 ? from : from + 1;
-  if (transformation.horizontal) {
-    auto z = transformation.positive ? otherCoord : int(getGridDepth()) - otherCoord - 1;
-    for (auto x = from; x != to + diff; x += diff, i++) { // until equals (including equals)
-      auto minHeight = initY + float(i) * stepY;
-      if (map[z][x].findIntersection(ray, intersection, minHeight)) {
-        return true;
-      }
-    }
-  } else {
-    auto x = transformation.positive ? otherCoord : int(getGridWidth()) - otherCoord - 1;
-    for (auto z = from; z != to + diff; z += diff, i++) { // until equals (including equals)
-      auto minHeight = initY + float(i) * stepY;
-      if (map[z][x].findIntersection(ray, intersection, minHeight)) {
-        return true;
-      }
-    }
-  }
-  return false;
+bool GridIntersection::findIntersectionInPatch(const HeightTile &tile, unsigned row, unsigned col, const Query &query) const {
+  COUNT_TRAVERSAL(triangleTests, 1);
+  auto xPos = position.getX() + cellWidth * float(col);
+  auto zPos = position.getZ() + cellDepth * float(row);
+  return BilinearPatch::findIntersection(query.ray, query.tMin, query.tMax, tile.getSampleHeight(row, col), tile.getSampleHeight(row, col + 1),
+    tile.getSampleHeight(row + 1, col), tile.getSampleHeight(row + 1, col + 1), xPos, zPos, cellWidth, cellDepth, query.intersection);
 }
 
-bool
-GridIntersection::findBasicRayIntersectionX(const Transformation &transformation, const Point2d &from, float initY, float stepY, const Point2d &gridRay, const Ray &ray, Intersection &intersection) const {
-  auto coordFrom = getGridCoordinates(from);
+float GridIntersection::getMajor(const Ray &ray, float t, bool horizontal, bool reversed) const {
+  auto point = getGridPoint(ray.getPointOnParameter(t));
+  auto major = horizontal ? point.getX() : point.getZ();
+  if (reversed) major = float(horizontal ? getGridWidth() : getGridDepth()) - major;
+  return major;
+}
 
-  auto alpha = Rational(long(gridRay.getZ() * scene::precision), long(gridRay.getX() * scene::precision));
-  int runLengthShort = std::floor((1 / alpha).getFloat());
-  int runLengthLong = std::ceil((1 / alpha).getFloat());
-  auto v = 1 - alpha * runLengthShort;
-  auto last = int(getGridWidth()) - 1;
-
-  auto beta = Rational(long((from.getZ() - float(coordFrom.getZ())) * scene::precision), scene::precision);
-  auto currInterceptBeta = beta;
-  auto currX = coordFrom.getX(), currZ = coordFrom.getZ(), currRunLength = (currInterceptBeta < v) ? runLengthLong : runLengthShort;
-  if (beta >= alpha + v) { // if first run is truncated
-    int lengthOfTruncated = std::ceil(((1 - beta) / alpha).getFloat());
-    if (findIntersectionInRun(transformation, coordFrom.getX(), std::min(lengthOfTruncated, last), currZ, initY, stepY, ray, intersection)) {
-      return true;
-    }
-    currX += lengthOfTruncated;
-    currZ++;
-    currInterceptBeta = (beta - v) - (alpha * std::floor(((beta - v) / alpha).getFloat()));
-    currRunLength = (currInterceptBeta < v) ? runLengthLong : runLengthShort;
+void GridIntersection::setMajorRange(Query &query, bool horizontal, bool reversed) const {
+  // one cell around, runs are widened by one cell
+  if (query.skipBefore != std::numeric_limits<float>::lowest()) {
+    query.firstMajor = int(std::floor(getMajor(query.ray, query.skipBefore, horizontal, reversed))) - 1;
   }
+  if (query.skipAfter != std::numeric_limits<float>::infinity()) {
+    query.lastMajor = int(std::floor(getMajor(query.ray, query.skipAfter, horizontal, reversed))) + 1;
+  }
+}
 
-  while (currX < getGridWidth() && currZ < getGridDepth()) {
-    if (findIntersectionInRun(transformation, std::max(coordFrom.getX(), currX - 1), std::min(currX + currRunLength, last), currZ, initY, stepY, ray, intersection)) {
-      return true;
-    }
-    currX += currRunLength;
-    currZ++;
-    currInterceptBeta += alpha * currRunLength - 1;
-    currRunLength = (currInterceptBeta < v) ? runLengthLong : runLengthShort;
+template<bool Horizontal, bool Ascending>
+int GridIntersection::getSkippedCells(const HeightTile &tile, int z, int x, int remaining, int i, float initY, float stepY) const {
+  auto major = Horizontal ? x : z;
+  auto skipped = 0;
+  for (unsigned level = 1; level < pyramid.getLevelCount(); level++) {
+    auto blockStart = (major >> level) << level;
+    auto blockEnd = blockStart + (1 << level) - 1;
+    auto inBlock = std::min(Ascending ? blockEnd - major : major - blockStart, remaining);
+    // ray height is linear in i, so the lowest point over the block cells is on one of its ends
+    auto minHeight = std::min(initY + float(i) * stepY, initY + float(i + inBlock) * stepY);
+    // blocks smaller than the tile are stored in the tile
+    auto maxHeight = level < pyramid.getFirstLevel() ? tile.getBlockMaxHeight(level, z, x) : pyramid.getMaxHeight(level, z >> level, x >> level);
+    if (minHeight <= maxHeight) break;
+    skipped = inBlock;
   }
-  return false;
+  return skipped;
 }
 
-bool GridIntersection::findBasicRayIntersectionZ(const GridIntersection::Transformation &transformation, const Point2d &from, float initY, float stepY, const Point2d &gridRay, const Ray &ray, Intersection &intersection) const {
-  auto coordFrom = getGridCoordinates(from);
+template<bool Horizontal>
+float GridIntersection::getRunMaxHeight(int first, int last, int other, TileCursor &cursor) const {
+  unsigned level = 0;
+  while (level + 1 < pyramid.getLevelCount() && (last >> level) - (first >> level) > 1) level++;
+  auto getBlock = [&](int major) {
+    auto z = Horizontal ? other : major, x = Horizontal ? major : other;
+    // blocks smaller than the tile are stored in the tile
+    return level < pyramid.getFirstLevel() ? cursor.getTile(z, x).getBlockMaxHeight(level, z, x) : pyramid.getMaxHeight(level, z >> level, x >> level);
+  };
+  return std::max(getBlock(first), getBlock(last));
+}
 
-  auto alpha = Rational(long(gridRay.getX() * scene::precision), long(gridRay.getZ() * scene::precision));
-  int runLengthShort = std::floor((1 / alpha).getFloat());
-  int runLengthLong = std::ceil((1 / alpha).getFloat());
-  auto v = 1 - alpha * runLengthShort;
-  auto last = int(getGridDepth()) - 1;
-
-  auto beta = Rational(long((from.getX() - float(coordFrom.getX())) * scene::precision), scene::precision);
-  auto currInterceptBeta = beta;
-  auto currZ = coordFrom.getZ(), currX = coordFrom.getX(), currRunLength = (currInterceptBeta < v) ? runLengthLong : runLengthShort;
-  if (beta >= alpha + v) { // if first run is truncated
-    int lengthOfTruncated = std::ceil(((1 - beta) / alpha).getFloat());
-    if (findIntersectionInRun(transformation, coordFrom.getZ(), std::min(lengthOfTruncated, last), currX, initY, stepY, ray, intersection)) {
-      return true;
+template<bool Horizontal, bool Positive, bool Reversed>
+bool GridIntersection::findIntersectionInRun(int from, int to, int otherCoord, float initY, float stepY, const Query &query) const {
+  int i = stepY > 0 ? from : from + 1;
+  if (query.firstMajor > from) { // cells before the ray origin
+    i += query.firstMajor - from;
+    from = query.firstMajor;
+    if (from > to) return false;
+  }
+  if (query.lastMajor < to) { // cells after the end of the tested part of the ray
+    to = query.lastMajor;
+    if (from > to) return false;
+  }
+  if constexpr (Reversed) {
+    auto last = int(Horizontal ? getGridWidth() : getGridDepth()) - 1;
+    from = last - from;
+    to = last - to;
+  }
+  // runs go from the lower major coordinate to the higher one, mirrored runs go down
+  constexpr auto diff = Reversed ? -1 : 1;
+  auto other = Positive ? otherCoord : int(Horizontal ? getGridDepth() : getGridWidth()) - otherCoord - 1;
+  auto &cursor = *query.tiles;
+  // ray height is linear in i, so its lowest point over the run is on one of its ends
+  auto length = std::abs(to - from);
+  auto runMinHeight = std::min(initY + float(i) * stepY, initY + float(i + length) * stepY);
+  if (runMinHeight > getRunMaxHeight<Horizontal>(std::min(from, to), std::max(from, to), other, cursor)) return false;
+  TrianglePacket packet; // candidate cells are tested two at once
+  for (auto major = from; major != to + diff; major += diff, i++) { // until equals (including equals)
+    auto z = Horizontal ? other : major, x = Horizontal ? major : other;
+    auto minHeight = initY + float(i) * stepY;
+    COUNT_TRAVERSAL(visitedCells, 1);
+    const auto &tile = cursor.getTile(z, x);
+    if (minHeight > tile.getCellMaxHeight(z, x)) {
+      auto skipped = getSkippedCells<Horizontal, !Reversed>(tile, z, x, std::abs(to - major), i, initY, stepY);
+      major += diff * skipped;
+      i += skipped;
+      continue;
+    }
+    // cells of the run are in the order along the ray and the patch is hit only within its cell, so the first hit is the nearest one
+    if (bilinearPatches) {
+      if (findIntersectionInPatch(tile, z, x, query)) return true;
+      continue;
+    }
+    addCellToPacket(tile, z, x, packet);
+    if (packet.isFull()) {
+      if (findIntersectionInPacket(packet, query)) return true;
+      packet.clear();
     }
-    currZ += lengthOfTruncated;
-    currX++;
-    currInterceptBeta = (beta - v) - (alpha * std::floor(((beta - v) / alpha).getFloat()));
-    currRunLength = (currInterceptBeta < v) ? runLengthLong : runLengthShort;
   }
+  return findIntersectionInPacket(packet, query);
+}
 
-  while (currZ < getGridDepth() && currX < getGridWidth()) {
-    if (findIntersectionInRun(transformation, std::max(coordFrom.getZ(), currZ - 1), std::min(currZ + currRunLength, last), currX, initY, stepY, ray, intersection)) {
+template<bool Horizontal, bool Positive, bool Reversed>
+bool GridIntersection::findBasicRayIntersection(const Point2d &from, float initY, float stepY, const Point2d &gridRay, const Query &query) const {
+  auto coordFrom = getGridCoordinates(from);
+  auto line = Horizontal
+    ? DigitalLine(gridRay.getX(), gridRay.getZ(), from.getZ() - float(coordFrom.getZ()), coordFrom.getX(), coordFrom.getZ(), int(getGridWidth()), int(getGridDepth()))
+    : DigitalLine(gridRay.getZ(), gridRay.getX(), from.getX() - float(coordFrom.getX()), coordFrom.getZ(), coordFrom.getX(), int(getGridDepth()), int(getGridWidth()));
+
+  int runFrom, runTo, runOther;
+  while (line.nextRun(runFrom, runTo, runOther)) {
+    if (runTo < query.firstMajor) continue;
+    if (runFrom > query.lastMajor) break;
+    COUNT_TRAVERSAL(runs, 1);
+    if (findIntersectionInRun<Horizontal, Positive, Reversed>(runFrom, runTo, runOther, initY, stepY, query)) {
       return true;
     }
-    currZ += currRunLength;
-    currX++;
-    currInterceptBeta += alpha * currRunLength - 1;
-    currRunLength = (currInterceptBeta < v) ? runLengthLong : runLengthShort;
   }
   return false;
 }
 
-GridIntersection::GridIntersection(const MapReader &reader, float height, float cellW, float cellD, const Point3d &position) : Grid(reader, height, cellW, cellD, position) {}
+template<bool Horizontal, bool Reversed>
+bool GridIntersection::findEntryRayIntersection(Point2d from, Point2d gridRay, float initY, float stepZY, float stepXY, const Query &query) const {
+  if constexpr (Reversed) {
+    from = Horizontal ? Point2d(float(getGridWidth()) - from.getX(), from.getZ()) : Point2d(from.getX(), float(getGridDepth()) - from.getZ());
+    gridRay = Horizontal ? gridRay.invertX() : gridRay.invertZ();
+  }
+  auto entryQuery = query;
+  setMajorRange(entryQuery, Horizontal, Reversed);
+
+  auto dMajor = DigitalLine::getScaled(Horizontal ? gridRay.getX() : gridRay.getZ());
+  auto dMinor = DigitalLine::getScaled(Horizontal ? gridRay.getZ() : gridRay.getX());
+  // the steeper step is the lower bound of the ray height for descending rays, the flatter one for ascending rays
+  auto minorShorter = std::abs(dMinor) < std::abs(dMajor);
+  auto steeperStep = Horizontal ? (minorShorter ? stepZY : stepXY) : (minorShorter ? stepXY : stepZY);
+  auto flatterStep = steeperStep == stepZY ? stepXY : stepZY;
+  auto stepY = query.ray.getDirection().getY() > 0 ? flatterStep : steeperStep;
+  if (dMinor != 0 && (dMinor > 0) == (dMajor > 0)) { // alpha > 0
+    return findBasicRayIntersection<Horizontal, true, Reversed>(from, initY, stepY, gridRay, entryQuery);
+  }
+  from = Horizontal ? Point2d(from.getX(), float(getGridDepth()) - from.getZ()) : Point2d(float(getGridWidth()) - from.getX(), from.getZ());
+  return findBasicRayIntersection<Horizontal, false, Reversed>(from, initY, stepY, Horizontal ? gridRay.invertZ() : gridRay.invertX(), entryQuery);
+}
+
+GridIntersection::GridIntersection(const HeightSource &reader, float height, float cellW, float cellD, const Point3d &position) : Grid(reader, height, cellW, cellD, position) {}
 
-int GridIntersection::checkVerticalAndHorizontalIntersection(const Point2d &gridPointFrom, const Point2d &gridPointTo, float initY, float toY, const Ray &ray, Intersection &intersection) const {
+GridIntersection::GridIntersection(const TerrainCache &cache, float cellW, float cellD, const Point3d &position) : Grid(cache, cellW, cellD, position) {}
+
+GridIntersection::GridIntersection(const std::shared_ptr<const HeightSource> &source, unsigned tileSize, size_t cacheBudget, float height, float cellW, float cellD, const Point3d &position)
+  : Grid(source, tileSize, cacheBudget, height, cellW, cellD, position) {}
+
+int GridIntersection::checkVerticalAndHorizontalIntersection(const Point2d &gridPointFrom, const Point2d &gridPointTo, float initY, float toY, const Query &query) const {
   auto gridCoordinateFrom = getGridCoordinates(gridPointFrom);
   auto gridCoordinateTo = getGridCoordinates(gridPointTo);
+  auto lastX = int(getGridWidth()) - 1, lastZ = int(getGridDepth()) - 1;
   if (gridCoordinateFrom.getZ() == gridCoordinateTo.getZ()
-    && ((gridCoordinateFrom.getX() == 0 && gridCoordinateTo.getX() == int(getGridWidth()) - 1) || (gridCoordinateFrom.getX() == int(getGridWidth()) - 1) && gridCoordinateTo.getX() == 0)) {
-    auto stepY = (initY - toY) / (gridPointFrom.getX() - gridPointTo.getX());
-    auto isIntersecting = findIntersectionInRun(Transformation(true, gridCoordinateFrom.getX() == 0), gridCoordinateFrom.getX(), gridCoordinateTo.getX(), gridCoordinateFrom.getZ(), initY, stepY, ray,
-      intersection);
+    && ((gridCoordinateFrom.getX() == 0 && gridCoordinateTo.getX() == lastX) || (gridCoordinateFrom.getX() == lastX && gridCoordinateTo.getX() == 0))) {
+    auto reversed = gridCoordinateFrom.getX() != 0;
+    auto stepY = (toY - initY) / std::abs(gridPointFrom.getX() - gridPointTo.getX());
+    auto runQuery = query;
+    setMajorRange(runQuery, true, reversed);
+    COUNT_TRAVERSAL(runs, 1);
+    auto isIntersecting = reversed
+      ? findIntersectionInRun<true, true, true>(0, lastX, gridCoordinateFrom.getZ(), initY, stepY, runQuery)
+      : findIntersectionInRun<true, true, false>(0, lastX, gridCoordinateFrom.getZ(), initY, stepY, runQuery);
     return isIntersecting ? 1 : -1;
   }
   if (gridCoordinateFrom.getX() == gridCoordinateTo.getX()
-    && ((gridCoordinateFrom.getZ() == 0 && gridCoordinateTo.getZ() == int(getGridWidth()) - 1) || (gridCoordinateFrom.getZ() == int(getGridWidth()) - 1) && gridCoordinateTo.getZ() == 0)) {
-    auto stepY = (initY - toY) / (gridPointFrom.getZ() - gridPointTo.getZ());
-    auto isIntersecting = findIntersectionInRun(Transformation(false, gridCoordinateFrom.getZ() == 0), gridCoordinateFrom.getZ(), gridCoordinateTo.getZ(), gridCoordinateFrom.getX(), initY, stepY, ray, intersection);
+    && ((gridCoordinateFrom.getZ() == 0 && gridCoordinateTo.getZ() == lastZ) || (gridCoordinateFrom.getZ() == lastZ && gridCoordinateTo.getZ() == 0))) {
+    auto reversed = gridCoordinateFrom.getZ() != 0;
+    auto stepY = (toY - initY) / std::abs(gridPointFrom.getZ() - gridPointTo.getZ());
+    auto runQuery = query;
+    setMajorRange(runQuery, false, reversed);
+    COUNT_TRAVERSAL(runs, 1);
+    auto isIntersecting = reversed
+      ? findIntersectionInRun<false, true, true>(0, lastZ, gridCoordinateFrom.getX(), initY, stepY, runQuery)
+      : findIntersectionInRun<false, true, false>(0, lastZ, gridCoordinateFrom.getX(), initY, stepY, runQuery);
     return isIntersecting ? 1 : -1;
   }
   return 0;
 }
 
-bool GridIntersection::findRayIntersection(const Point3d &from, const Point3d &to, const Ray &ray, Intersection &intersection) const {
+bool GridIntersection::findRayIntersection(const Point3d &from, const Point3d &to, const Query &rayQuery) const {
+  // one cursor for the whole traversal, tiles are requested only when the ray crosses to the other tile
+  TileCursor cursor(*this);
+  auto query = rayQuery;
+  query.tiles = &cursor;
+  COUNT_TRAVERSAL(rays, 1);
   auto gridPointFrom = getGridPoint(from);
   auto gridPointTo = getGridPoint(to);
   auto gridRay = gridPointTo - gridPointFrom;
   auto gridCoordinateFrom = getGridCoordinates(from);
   auto initY = from.getY();
+  const auto &ray = query.ray;
 
   // prevent dividing by 0
-  auto isIntersectingHorVer = checkVerticalAndHorizontalIntersection(gridPointFrom, gridPointTo, initY, to.getY(), ray, intersection);
+  auto isIntersectingHorVer = checkVerticalAndHorizontalIntersection(gridPointFrom, gridPointTo, initY, to.getY(), query);
   if (isIntersectingHorVer != 0) return isIntersectingHorVer == 1;
 
   auto stepZY = (ray.getDirection().getY() / std::abs(ray.getDirection().getZ())) * cellDepth;
   auto stepXY = (ray.getDirection().getY() / std::abs(ray.getDirection().getX())) * cellWidth;
 
-  if (gridCoordinateFrom.getX() == 0) {
-    auto alpha = Rational(long(gridRay.getZ() * scene::precision), long(gridRay.getX() * scene::precision));
-    if (alpha > 0) {
-      auto stepY = (alpha < 1) ? stepZY : stepXY;
-      return findBasicRayIntersectionX(Transformation(true, true), gridPointFrom, initY, stepY, gridRay, ray, intersection);
-    } else {
-      gridPointFrom = Point2d(gridPointFrom.getX(), float(getGridDepth()) - gridPointFrom.getZ());
-      auto stepY = (alpha > -1) ? stepZY : stepXY;
-      return findBasicRayIntersectionX(Transformation(true, false), gridPointFrom, initY, stepY, gridRay.invertZ(), ray, intersection);
-    }
+  // side of the grid through which the ray enters
+  auto dx = DigitalLine::getScaled(gridRay.getX()), dz = DigitalLine::getScaled(gridRay.getZ());
+  if (gridCoordinateFrom.getX() == 0 && dx >= 0) {
+    return findEntryRayIntersection<true, false>(gridPointFrom, gridRay, initY, stepZY, stepXY, query);
   }
-  if (gridCoordinateFrom.getZ() == 0) {
-    auto alpha = Rational(long(gridRay.getX() * scene::precision), long(gridRay.getZ() * scene::precision));
-    if (alpha > 0) {
-      auto stepY = (alpha < 1) ? stepXY : stepZY;
-      return findBasicRayIntersectionZ(Transformation(false, true), gridPointFrom, initY, stepY, gridRay, ray, intersection);
-    } else {
-      gridPointFrom = Point2d((float(getGridWidth()) - gridPointFrom.getX()), gridPointFrom.getZ());
-      auto stepY = (alpha > -1) ? stepXY : stepZY;
-      return findBasicRayIntersectionZ(Transformation(false, false), gridPointFrom, initY, stepY, gridRay.invertX(), ray, intersection);
-    }
+  if (gridCoordinateFrom.getZ() == 0 && dz >= 0) {
+    return findEntryRayIntersection<false, false>(gridPointFrom, gridRay, initY, stepZY, stepXY, query);
+  }
+  if (gridCoordinateFrom.getX() == int(getGridWidth()) - 1 && dx < 0) {
+    return findEntryRayIntersection<true, true>(gridPointFrom, gridRay, initY, stepZY, stepXY, query);
+  }
+  if (gridCoordinateFrom.getZ() == int(getGridDepth()) - 1 && dz < 0) {
+    return findEntryRayIntersection<false, true>(gridPointFrom, gridRay, initY, stepZY, stepXY, query);
   }
   return false;
 }
+
+void GridIntersection::setBilinearPatches(bool enabled) {
+  bilinearPatches = enabled;
+}
+
+bool GridIntersection::hasBilinearPatches() const {
+  return bilinearPatches;
+}
@@ -1,62 +1,151 @@
 #pragma once
 
+#include <limits>
+
 #include "Grid.h"
+#include "traversal-statistics/TraversalStatistics.h"
 #include "src/helper-types/Intersection.h"
 #include "src/point/Point3d.h"
 #include "src/ray/Ray.h"
 
 /**
  * Class expanding grid with intersection search operations
+ *
+ * Traversal is specialized at compile time for the direction of the runs, given by template parameters:
+ * Horizontal - runs go along x axis (otherwise z), Positive - the other coordinate grows (otherwise the grid is mirrored in it),
+ * Reversed - major axis is mirrored, ray enters the grid from the side with the highest coordinate.
+ * Ray is dispatched to its specialization once, the cell loops do not branch on the direction.
+ * Cells are tested as their two triangles, or as the bilinear patches through their corners when they are enabled.
  */
 class GridIntersection : public Grid {
+protected:
   /**
-   * Struct for storing transformation to be applied
+   * Struct describing what is searched on the ray
    */
-  struct Transformation {
-    bool horizontal;
-    bool positive;
-    Transformation(bool horizontal, bool positive);
+  struct Query {
+    const Ray &ray;
+    float tMin = std::numeric_limits<float>::lowest(); // only intersections with parameter in (tMin, tMax) are found
+    float tMax = std::numeric_limits<float>::infinity();
+    Intersection *intersection = nullptr; // where the nearest intersection is stored, nullptr if any intersection is enough
+    float skipBefore = std::numeric_limits<float>::lowest(); // cells before the cell of the point on this parameter are not tested
+    float skipAfter = std::numeric_limits<float>::infinity(); // cells after the cell of the point on this parameter are not tested
+    int firstMajor = std::numeric_limits<int>::min(); // first tested major coordinate of the runs, set during the traversal
+    int lastMajor = std::numeric_limits<int>::max(); // last tested major coordinate of the runs, set during the traversal
+    TileCursor *tiles = nullptr; // tile of the last tested cell, set during the traversal
   };
 
+private:
+  bool bilinearPatches = false; // cells are intersected as the bilinear patches instead of the triangles
+
+  /**
+   * Test all triangles of the packet with the query
+   * @param packet - tested triangles
+   * @param query - investigated ray and parameter range, the intersection is stored to the query if it is needed
+   * @return true if intersection is found
+   */
+  [[nodiscard]] static bool findIntersectionInPacket(const TrianglePacket &packet, const Query &query);
+
+  /**
+   * Test the bilinear patch of the cell with the query
+   * @param tile - tile containing the cell
+   * @param row - row of the cell
+   * @param col - column of the cell
+   * @param query - investigated ray and parameter range, the intersection is stored to the query if it is needed
+   * @return true if intersection is found
+   */
+  [[nodiscard]] bool findIntersectionInPatch(const HeightTile &tile, unsigned row, unsigned col, const Query &query) const;
+
+  /**
+   * Get major coordinate of the point on the ray after transformation
+   * @param ray - investigated ray
+   * @param t - parameter of the point
+   * @param horizontal - true if runs go along x axis
+   * @param reversed - true if major axis is mirrored
+   * @return major coordinate of the point (in coordinates after transformation)
+   */
+  [[nodiscard]] float getMajor(const Ray &ray, float t, bool horizontal, bool reversed) const;
+
+  /**
+   * Set the first and the last major coordinate of runs which have to be tested, from the part of the ray given by the query
+   * @param query - query where the coordinates are set
+   * @param horizontal - true if runs go along x axis
+   * @param reversed - true if major axis is mirrored
+   */
+  void setMajorRange(Query &query, bool horizontal, bool reversed) const;
+
+  /**
+   * Find how many following cells of the run can be skipped, because the ray is above the largest block of the max height pyramid
+   * containing them, cells are not skipped beyond the current block of the pyramid
+   * @tparam Horizontal - true if the run goes along x axis, false for z axis
+   * @tparam Ascending - true if the run goes in the direction of the growing coordinate
+   * @param tile - tile containing the current cell
+   * @param z - row of the current cell, which is already known to be under the ray
+   * @param x - column of the current cell, which is already known to be under the ray
+   * @param remaining - number of the run cells after the current one
+   * @param i - index of the current cell used for computing minimal ray height
+   * @param initY - Y at the point where ray enters the grid
+   * @param stepY - step how Y is changed with change of the index
+   * @return number of cells after the current one that can be skipped
+   */
+  template<bool Horizontal, bool Ascending>
+  [[nodiscard]] int getSkippedCells(const HeightTile &tile, int z, int x, int remaining, int i, float initY, float stepY) const;
+
+  /**
+   * Get bound of the maximal height of the run cells, from the pyramid level where the run spans at most two blocks
+   * @tparam Horizontal - true if the run goes along x axis, false for z axis
+   * @param first - lower major coordinate of the run cells
+   * @param last - higher major coordinate of the run cells
+   * @param other - other coordinate of the run cells
+   * @param cursor - tile of the last tested cell, it is moved to the tiles of the blocks
+   * @return maximal height of the blocks covering the run
+   */
+  template<bool Horizontal>
+  [[nodiscard]] float getRunMaxHeight(int first, int last, int other, TileCursor &cursor) const;
+
   /**
    * Finds intersection in given run
-   * @param transformation - transformation to be applied to run
+   * The whole run is rejected at once when the ray stays above the pyramid blocks covering it
+   * Cells which are not skipped are tested in pairs, the nearest intersection of the pair is taken
+   * Tiles of out-of-core grid are requested when the run crosses to them
+   * @tparam Horizontal, Positive, Reversed - direction of the run (see the class)
    * @param from - coordinate where the run starts (originally x)
    * @param to - coordinate where the run ends (originally x)
    * @param otherCoord other run coordinate (originally y)
    * @param initY - Y at the from point (when enters the grid)
    * @param stepY - step how Y is changed with change of the direction given by transformation
-   * @param ray - original ray we are investigating
-   * @param intersection - where found intersection is stored
+   * @param query - investigated ray and what is searched
    * @return true if intersection in run is found
    */
-  [[nodiscard]] bool findIntersectionInRun(const Transformation &transformation, int from, int to, int otherCoord, float initY, float stepY, const Ray &ray, Intersection &intersection) const;
+  template<bool Horizontal, bool Positive, bool Reversed>
+  [[nodiscard]] bool findIntersectionInRun(int from, int to, int otherCoord, float initY, float stepY, const Query &query) const;
 
   /**
-   * Find intersection between horizontal ray and height field
-   * @param transformation - transformation to be applied to run
+   * Find intersection between ray and height field walking runs of the digital line of the ray projected to the grid
+   * @tparam Horizontal, Positive, Reversed - direction of the runs (see the class), horizontal rays walk runs along x, others along z
    * @param from - point where ray traversal begins
    * @param initY - Y at the from point (when ray enters the grid)
    * @param stepY - step how Y is changed with change of the direction given by transformation
    * @param gridRay - ray projected to the grid
-   * @param ray - original ray we are investigating
-   * @param intersection - where found intersection is stored
+   * @param query - investigated ray and what is searched
    * @return true if intersection in run is found
    */
-  [[nodiscard]] bool findBasicRayIntersectionX(const Transformation &transformation, const Point2d &from, float initY, float stepY, const Point2d &gridRay, const Ray &ray, Intersection &intersection) const;
+  template<bool Horizontal, bool Positive, bool Reversed>
+  [[nodiscard]] bool findBasicRayIntersection(const Point2d &from, float initY, float stepY, const Point2d &gridRay, const Query &query) const;
 
   /**
-   * Find intersection between vertical ray and height field
-   * @param transformation - transformation to be applied to run
-   * @param from - point where ray traversal begins
-   * @param initY - Y at the from point (when ray enters the grid)
-   * @param stepY - step how Y is changed with change of the direction given by transformation
+   * Find intersection of ray entering the grid through given side, mirrors the grid so the ray goes in positive direction of both axes
+   * @tparam Horizontal - true if the ray enters through side x = 0 or x = width, false for z = 0 or z = depth
+   * @tparam Reversed - true if the ray enters through the side with the highest coordinate
+   * @param from - point where ray enters the grid
    * @param gridRay - ray projected to the grid
-   * @param ray - original ray we are investigating
-   * @param intersection - where found intersection is stored
-   * @return true if intersection in run is found
+   * @param initY - Y at the from point
+   * @param stepZY - change of Y when the ray moves by one cell in z
+   * @param stepXY - change of Y when the ray moves by one cell in x
+   * @param query - investigated ray and what is searched
+   * @return true if intersection is found
    */
-  [[nodiscard]] bool findBasicRayIntersectionZ(const Transformation &transformation, const Point2d &from, float initY, float stepY, const Point2d &gridRay, const Ray &ray, Intersection &intersection) const;
+  template<bool Horizontal, bool Reversed>
+  [[nodiscard]] bool findEntryRayIntersection(Point2d from, Point2d gridRay, float initY, float stepZY, float stepXY, const Query &query) const;
 
   /**
    * Looks if given points form vertical or horizontal line. If so, finds if there is any intersection between the ray on the vertical / horizontal line
@@ -64,29 +153,62 @@ class GridIntersection : public Grid {
    * @param gridPointTo - point where ray leaves the height field
    * @param initY - Y at the gridPointFrom point (when ray enters the grid)
    * @param toY - Y at the gridPointTo point (when ray leaves the grid)
-   * @param ray - original ray we are investigating
-   * @param intersection - where found intersection is stored
+   * @param query - investigated ray and what is searched
    * @return 0 if line is not vertical/horizontal, -1 if it is, but intersection is not found, 1 if intersection is found
    */
-  [[nodiscard]] int checkVerticalAndHorizontalIntersection(const Point2d &gridPointFrom, const Point2d &gridPointTo, float initY, float toY, const Ray &ray, Intersection &intersection) const;
+  [[nodiscard]] int checkVerticalAndHorizontalIntersection(const Point2d &gridPointFrom, const Point2d &gridPointTo, float initY, float toY, const Query &query) const;
 protected:
   /**
-   * Create grid from given map reader
-   * @param reader - reader of the height map file
+   * Create grid from given source of height samples
+   * @param reader - source of the height samples (image or raw file reader)
+   * @param height - height of the whole height map
+   * @param cellW - width of the cell
+   * @param cellD - depth of the cell
+   * @param position - position of the grid (map)
+   */
+  explicit GridIntersection(const HeightSource &reader, float height, float cellW, float cellD, const Point3d &position);
+
+  /**
+   * Create grid from the terrain cache file
+   * @param cache - mapped terrain cache file
+   * @param cellW - width of the cell
+   * @param cellD - depth of the cell
+   * @param position - position of the grid (map)
+   */
+  explicit GridIntersection(const TerrainCache &cache, float cellW, float cellD, const Point3d &position);
+
+  /**
+   * Create out-of-core grid, tiles are read from the source when the rays reach them
+   * @param source - source of the height samples, it is kept by the grid
+   * @param tileSize - number of cells in the tile side (rounded down to power of two)
+   * @param cacheBudget - maximal memory of the cached tiles in bytes
    * @param height - height of the whole height map
    * @param cellW - width of the cell
    * @param cellD - depth of the cell
    * @param position - position of the grid (map)
    */
-  explicit GridIntersection(const MapReader &reader, float height, float cellW, float cellD, const Point3d &position);
+  explicit GridIntersection(const std::shared_ptr<const HeightSource> &source, unsigned tileSize, size_t cacheBudget, float height, float cellW, float cellD, const Point3d &position);
 
   /**
    * Find intersection between ray and height map
+   * Ray can enter through any side of the grid, the points can lie behind the ray origin if the query does not accept such intersections
    * @param from - point where ray enters the height map bounding box
    * @param to - point where ray leaves the height map bounding box
-   * @param ray - ray we are investigating
-   * @param intersection - where found intersection is stored
+   * @param query - investigated ray and what is searched
    * @return true if intersection exists
    */
-  [[nodiscard]] bool findRayIntersection(const Point3d &from, const Point3d &to, const Ray &ray, Intersection &intersection) const;
+  [[nodiscard]] bool findRayIntersection(const Point3d &from, const Point3d &to, const Query &query) const;
+
+  /**
+   * Choose the cell primitive, the bilinear patch follows the samples smoothly, so a coarser grid gives the same surface quality
+   * @param enabled - true to intersect the bilinear patches, false for the two triangles of the cell
+   */
+  void setBilinearPatches(bool enabled);
+
+public:
+  /**
+   * Check if the cells are intersected as the bilinear patches
+   * @return true for the bilinear patches, false for the triangles
+   */
+  [[nodiscard]] bool hasBilinearPatches() const;
 };
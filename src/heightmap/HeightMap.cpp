@@ -1,4 +1,7 @@
 #include "HeightMap.h"
+#include "heightmap-reader/DownsampledSource.h"
+#include "src/profiler/Profiler.h"
+#include "src/scene.h"
 
 bool HeightMap::findIntersectionInAxis(unsigned d, const Vector3d &minToOrigin, const Vector3d &maxToOrigin, const Vector3d &direction, float &tLow, float &tHigh) {
   float tDimLow = minToOrigin.get(d) / direction.get(d);
@@ -23,6 +26,10 @@ bool HeightMap::hasHeightIntersection(const Vector3d &minToOrigin, const Vector3
 }
 
 bool HeightMap::hasIntersectionWithBoundingBox(const Ray &ray, float &tLow, float &tHigh) const {
+  return hasIntersectionWithBoundingBox(aabbMin, aabbMax, ray, tLow, tHigh);
+}
+
+bool HeightMap::hasIntersectionWithBoundingBox(const Point3d &aabbMin, const Point3d &aabbMax, const Ray &ray, float &tLow, float &tHigh) {
   tLow = std::numeric_limits<float>::lowest();
   tHigh = std::numeric_limits<float>::infinity();
   auto minToOrigin = aabbMin.getVectorBetween(ray.getOrigin());
@@ -31,15 +38,52 @@ bool HeightMap::hasIntersectionWithBoundingBox(const Ray &ray, float &tLow, floa
   auto dir = ray.getDirection();
   if (!findIntersectionInAxis(0, minToOrigin, maxToOrigin, dir, tLow, tHigh)
     || !findIntersectionInAxis(2, minToOrigin, maxToOrigin, dir, tLow, tHigh)) {
+    COUNT_TRAVERSAL(boundingBoxRejects, 1);
     return false;
   }
   // does not change parameters tLow, tHigh, so it have to be last
-  if (!hasHeightIntersection(minToOrigin, maxToOrigin, dir, tLow, tHigh)) return false;
+  if (!hasHeightIntersection(minToOrigin, maxToOrigin, dir, tLow, tHigh)) {
+    COUNT_TRAVERSAL(boundingBoxRejects, 1);
+    return false;
+  }
 
   return true;
 }
 
-HeightMap::HeightMap(const MapReader &reader, const Point3d &position, const Vector3d &size, const Material &material)
+int HeightMap::hasIntersectionWithBoundingBox(const RayPacket &packet, float tLow[RayPacket::size], float tHigh[RayPacket::size]) const {
+  return hasIntersectionWithBoundingBox(aabbMin, aabbMax, packet, tLow, tHigh);
+}
+
+int HeightMap::hasIntersectionWithBoundingBox(const Point3d &aabbMin, const Point3d &aabbMax, const RayPacket &packet, float tLow[RayPacket::size], float tHigh[RayPacket::size]) {
+  auto low = Float4(std::numeric_limits<float>::lowest());
+  auto high = Float4(std::numeric_limits<float>::infinity());
+  auto missed = Float4(0.f) > Float4(0.f);
+
+  // same steps as findIntersectionInAxis for x and z, rays that miss are only masked out
+  auto clipAxis = [&](float aabbMinD, float aabbMaxD, const Float4 &origin, const Float4 &direction) {
+    auto t1 = (Float4(aabbMinD) - origin) / direction;
+    auto t2 = (Float4(aabbMaxD) - origin) / direction;
+    auto tDimLow = min(t2, t1), tDimHigh = max(t1, t2);
+    missed = missed | (tDimHigh < low) | (tDimLow > high);
+    low = max(low, tDimLow);
+    high = min(high, tDimHigh);
+    missed = missed | (low > high);
+  };
+  clipAxis(aabbMin.getX(), aabbMax.getX(), packet.getOriginX(), packet.getDirectionX());
+  clipAxis(aabbMin.getZ(), aabbMax.getZ(), packet.getOriginZ(), packet.getDirectionZ());
+
+  // height only checks the intersection, as hasHeightIntersection
+  auto t1 = (Float4(aabbMin.getY()) - packet.getOriginY()) / packet.getDirectionY();
+  auto t2 = (Float4(aabbMax.getY()) - packet.getOriginY()) / packet.getDirectionY();
+  auto tDimLow = min(t2, t1), tDimHigh = max(t1, t2);
+  missed = missed | (tDimHigh < low) | (tDimLow > high) | (max(low, tDimLow) > min(high, tDimHigh));
+
+  low.store(tLow);
+  high.store(tHigh);
+  return ~getMask(missed) & ((1 << RayPacket::size) - 1);
+}
+
+HeightMap::HeightMap(const HeightSource &reader, const Point3d &position, const Vector3d &size, const Material &material)
   : GridIntersection(reader, size.getY(), float(size.getX()) / float(reader.getImageWidth() - 1),  float(size.getZ()) / float(reader.getImageHeight() - 1), position),
   height(size.getY()), width(size.getX()), depth(size.getZ()), material(material) {
   auto other = position + Point3d(width, height, depth);
@@ -47,13 +91,29 @@ HeightMap::HeightMap(const MapReader &reader, const Point3d &position, const Vec
   aabbMax = position.maximalCoords(other);
 }
 
+HeightMap::HeightMap(const TerrainCache &cache, const Point3d &position, const Vector3d &size, const Material &material)
+  : GridIntersection(cache, float(size.getX()) / float(cache.getGridWidth()), float(size.getZ()) / float(cache.getGridDepth()), position),
+  height(size.getY()), width(size.getX()), depth(size.getZ()), material(material) {
+  auto other = position + Point3d(width, height, depth);
+  aabbMin = position.minimalCoords(other);
+  aabbMax = position.maximalCoords(other);
+}
+
+HeightMap::HeightMap(const std::shared_ptr<const HeightSource> &source, unsigned tileSize, size_t cacheBudget, const Point3d &position, const Vector3d &size, const Material &material)
+  : GridIntersection(source, tileSize, cacheBudget, size.getY(), float(size.getX()) / float(source->getImageWidth() - 1), float(size.getZ()) / float(source->getImageHeight() - 1), position),
+  height(size.getY()), width(size.getX()), depth(size.getZ()), material(material) {
+  auto other = position + Point3d(width, height, depth);
+  aabbMin = position.minimalCoords(other);
+  aabbMax = position.maximalCoords(other);
+}
+
 std::string HeightMap::to_string() const {
   auto H = std::to_string(height), W = std::to_string(width), D = std::to_string(depth);
   std::string s = "heightMap(\r\n";
-  for (const auto &row : map) {
+  for (unsigned row = 0; row < getGridDepth(); row++) {
     s += "  ";
-    for (const auto &val : row) {
-      s += val.to_string() + " ";
+    for (unsigned col = 0; col < getGridWidth(); col++) {
+      s += getCell(row, col).to_string() + " ";
     }
     s += "\r\n";
   }
@@ -70,6 +130,14 @@ const Point3d &HeightMap::getPosition() const {
   return position;
 }
 
+const Point3d &HeightMap::getAabbMin() const {
+  return aabbMin;
+}
+
+const Point3d &HeightMap::getAabbMax() const {
+  return aabbMax;
+}
+
 const Material &HeightMap::getMaterial() const {
   return material;
 }
@@ -81,9 +149,162 @@ float HeightMap::getHeightFraction(float y) const {
 bool HeightMap::findIntersection(const Ray &ray, Intersection &intersection) const {
   float aabbTLow, aabbTHigh;
   if (!hasIntersectionWithBoundingBox(ray, aabbTLow, aabbTHigh)) return false;
-  const auto from = ray.getPointOnParameter(aabbTLow);
-  const auto to = ray.getPointOnParameter(aabbTHigh);
-  return findRayIntersection(from, to, ray, intersection);
+  return findIntersection(ray, aabbTLow, aabbTHigh, intersection);
+}
+
+bool HeightMap::findIntersection(const Ray &ray, float tLow, float tHigh, Intersection &intersection) const {
+  const auto from = ray.getPointOnParameter(tLow);
+  const auto to = ray.getPointOnParameter(tHigh);
+  return findRayIntersection(from, to, Query{ray, std::numeric_limits<float>::lowest(), std::numeric_limits<float>::infinity(), &intersection});
+}
+
+bool HeightMap::findIntersection(const Ray &ray, float tLow, float tHigh, float tStart, float footprint, Intersection &intersection, float tMin) const {
+  tLow = std::max(tLow, tMin); // the ray starting inside the box is traversed from its origin
+  if (tLow >= tHigh) return false;
+  if (ceiling) tStart = std::max(tStart, getCeilingStart(ray, tLow, tHigh)); // coarser levels are not higher, so the ceiling bounds them too
+  if (tStart >= tHigh) return false;
+  if (footprint <= 0.f || detailLevels.empty()) {
+    if (tStart == std::numeric_limits<float>::lowest() && tMin == std::numeric_limits<float>::lowest()) return findIntersection(ray, tLow, tHigh, intersection);
+    const auto from = ray.getPointOnParameter(tLow);
+    const auto to = ray.getPointOnParameter(tHigh);
+    return findRayIntersection(from, to, Query{ray, tMin, std::numeric_limits<float>::infinity(), &intersection, tStart});
+  }
+
+  // level is used from the distance where its cell is covered by the tolerated footprint, each level ends where the next begins
+  auto footprintSize = footprint * scene::lodTolerance;
+  auto getStart = [this, footprintSize](unsigned level) {
+    const auto &detail = *detailLevels[level - 1];
+    return std::max(detail.cellWidth, detail.cellDepth) / footprintSize;
+  };
+  const auto from = ray.getPointOnParameter(tLow);
+  const auto to = ray.getPointOnParameter(tHigh);
+  auto start = std::numeric_limits<float>::lowest();
+  for (unsigned level = 0; level <= detailLevels.size() && start < tHigh; level++) {
+    auto end = level == detailLevels.size() ? std::numeric_limits<float>::infinity() : getStart(level + 1);
+    if (end > tLow && end > tStart) {
+      const auto &grid = level == 0 ? *this : *detailLevels[level - 1];
+      auto query = Query{ray, tMin, std::numeric_limits<float>::infinity(), &intersection, std::max(start, tStart), end};
+      if (grid.findRayIntersection(from, to, query)) return true;
+    }
+    start = end;
+  }
+  return false;
+}
+
+void HeightMap::setBilinearPatches(bool enabled) {
+  GridIntersection::setBilinearPatches(enabled);
+  for (const auto &level : detailLevels) level->setBilinearPatches(enabled);
+}
+
+void HeightMap::buildDetailLevels(unsigned count) {
+  detailLevels.clear();
+  if (isOutOfCore()) return;
+  Profiler::Scope scope("build levels of detail");
+  const HeightMap *previous = this;
+  for (unsigned level = 0; level < count && DownsampledSource::canDownsample(*previous); level++) {
+    auto source = DownsampledSource(*previous, position.getY(), height);
+    detailLevels.push_back(std::make_shared<HeightMap>(source, position, Vector3d(width, height, depth), material));
+    detailLevels.back()->setBilinearPatches(hasBilinearPatches());
+    previous = detailLevels.back().get();
+  }
+}
+
+void HeightMap::updateHeights(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const std::vector<float> &heights, Point3d &changedMin, Point3d &changedMax) {
+  if (heights.size() != size_t(rows) * cols) {
+    std::cerr << "edit of " << rows << "x" << cols << " samples received " << heights.size() << " heights" << std::endl;
+    throw std::invalid_argument("received wrong number of edited heights");
+  }
+  std::vector<float> intensities(heights.size());
+  for (size_t i = 0; i < heights.size(); i++) intensities[i] = (heights[i] - position.getY()) / height;
+  float minHeight, maxHeight;
+  updateSamples(firstRow, firstCol, rows, cols, intensities.data(), minHeight, maxHeight);
+
+  auto minX = std::numeric_limits<float>::infinity(), maxX = std::numeric_limits<float>::lowest(), minZ = minX, maxZ = maxX;
+  // cells of the samples and the cells shaded by their normals lie within the margin of the samples
+  auto addCells = [&](const HeightMap &grid, unsigned beginRow, unsigned beginCol, unsigned endRow, unsigned endCol, unsigned margin) {
+    minX = std::min(minX, position.getX() + grid.cellWidth * float(std::max(beginCol, margin) - margin));
+    maxX = std::max(maxX, position.getX() + grid.cellWidth * float(std::min(endCol - 1 + margin, grid.gridWidth)));
+    minZ = std::min(minZ, position.getZ() + grid.cellDepth * float(std::max(beginRow, margin) - margin));
+    maxZ = std::max(maxZ, position.getZ() + grid.cellDepth * float(std::min(endRow - 1 + margin, grid.gridDepth)));
+  };
+  addCells(*this, firstRow, firstCol, firstRow + rows, firstCol + cols, 2);
+
+  // every level is interpolated from the previous one, so the changed samples are read from the already changed level
+  const HeightMap *previous = this;
+  unsigned beginRow = firstRow, beginCol = firstCol, endRow = firstRow + rows, endCol = firstCol + cols;
+  for (const auto &detail : detailLevels) {
+    auto source = DownsampledSource(*previous, position.getY(), height);
+    source.getAffectedSamples(beginRow, beginCol, endRow - beginRow, endCol - beginCol, beginRow, beginCol, endRow, endCol);
+    auto levelCols = endCol - beginCol;
+    std::vector<float> levelIntensities(size_t(endRow - beginRow) * levelCols);
+    for (auto row = beginRow; row < endRow; row++) source.readRow(row, beginCol, levelCols, levelIntensities.data() + size_t(row - beginRow) * levelCols);
+    float levelMinHeight, levelMaxHeight;
+    detail->updateSamples(beginRow, beginCol, endRow - beginRow, levelCols, levelIntensities.data(), levelMinHeight, levelMaxHeight);
+    minHeight = std::min(minHeight, levelMinHeight);
+    maxHeight = std::max(maxHeight, levelMaxHeight);
+    addCells(*detail, beginRow, beginCol, endRow, endCol, 1);
+    previous = detail.get();
+  }
+  changedMin = Point3d(minX, minHeight, minZ);
+  changedMax = Point3d(maxX, maxHeight, maxZ);
+}
+
+unsigned HeightMap::getDetailLevelCount() const {
+  return detailLevels.size();
+}
+
+const HeightMap &HeightMap::getDetailLevel(float footprintSize) const {
+  const HeightMap *level = this;
+  for (const auto &detail : detailLevels) {
+    if (std::max(detail->cellWidth, detail->cellDepth) > footprintSize * scene::lodTolerance) break;
+    level = detail.get();
+  }
+  return *level;
 }
 
+bool HeightMap::isOccluded(const Point3d &origin, const Point3d &target, float footprintSize) const {
+  if (footprintSize > 0.f && !detailLevels.empty()) {
+    const auto &level = getDetailLevel(footprintSize);
+    if (&level != this) return level.isOccluded(origin, target);
+  }
+  auto toTarget = target.getVectorBetween(origin);
+  auto distance = toTarget.length();
+  if (distance == 0.f) return false;
+  auto ray = Ray(origin, toTarget / distance);
+
+  float tLow, tHigh;
+  if (!hasIntersectionWithBoundingBox(ray, tLow, tHigh)) return false;
+  // offset of the origin prevents finding the surface the origin lies on
+  auto tMin = std::min(cellWidth, cellDepth) * 1e-3f;
+  if (tHigh <= tMin) return false;
 
+  // bounding box is entered behind the origin when the origin is inside, cells before the origin are skipped
+  const auto from = ray.getPointOnParameter(tLow);
+  const auto to = ray.getPointOnParameter(tHigh);
+  return findRayIntersection(from, to, Query{ray, tMin, distance, nullptr, 0.f});
+}
+
+void HeightMap::reportMemory(MemoryReport &report) const {
+  Grid::reportMemory(report);
+  for (const auto &detail : detailLevels) {
+    MemoryReport levelReport;
+    detail->Grid::reportMemory(levelReport);
+    report.addShared(detail.get(), "levels of detail", levelReport.getTotal());
+  }
+  if (const auto *texture = material.getTexture()) report.addShared(texture, "textures", texture->getMemorySize());
+}
+
+size_t HeightMap::estimateMemorySize(unsigned gridWidth, unsigned gridDepth, bool storedTriangles, unsigned detailLevels, bool vertexNormals,
+  unsigned horizonDirections) {
+  auto samples = size_t(gridWidth + 1) * (gridDepth + 1);
+  auto size = Grid::estimateMemorySize(gridWidth, gridDepth, storedTriangles);
+  if (vertexNormals) size += samples * sizeof(uint16_t);
+  size += samples * horizonDirections;
+  // every level halves the grid of the previous one, the same as the downsampled source
+  for (unsigned level = 0; level < detailLevels && gridWidth >= 2 && gridDepth >= 2; level++) {
+    gridWidth /= 2;
+    gridDepth /= 2;
+    size += Grid::estimateMemorySize(gridWidth, gridDepth, storedTriangles);
+  }
+  return size;
+}
@@ -1,12 +1,15 @@
 #pragma once
 
+#include <limits>
+#include <memory>
 #include <vector>
 
 #include "GridIntersection.h"
 #include "cell/Cell.h"
-#include "heightmap-reader/MapReader.h"
+#include "heightmap-reader/HeightSource.h"
 #include "src/material/Material.h"
 #include "src/ray/Ray.h"
+#include "src/ray/RayPacket.h"
 #include "src/helper-types/Intersection.h"
 #include "src/vector/Vector3d.h"
 #include "src/point/Point3d.h"
@@ -14,7 +17,7 @@
 #include "src/point/Point2i.h"
 
 /**
- * Class to store height map, that was read by HeightMapReader
+ * Class to store height map, that was read by MapReader or RawMapReader
  *
  * Provides height map data and functions for finding ray-heightmap intersections
  */
@@ -22,6 +25,7 @@ class HeightMap : public GridIntersection {
   const float height, width, depth;
   const Material material;
   Point3d aabbMin, aabbMax;
+  std::vector<std::shared_ptr<HeightMap>> detailLevels; // coarser levels of detail, every level halves resolution of the previous one
 
   /**
    * Find local parameters t low and t high in dimension given by d (0-x, 1-y, 2-z)
@@ -57,9 +61,31 @@ class HeightMap : public GridIntersection {
   [[nodiscard]] bool hasIntersectionWithBoundingBox(const Ray &ray, float &tLow, float &tHigh) const;
 
 public:
+  /**
+   * Find t low and t high between given AABB and ray, the parameters are clipped by x and z dimensions only
+   * @param aabbMin - minimal corner of the box
+   * @param aabbMax - maximal corner of the box
+   * @param ray - investigated ray
+   * @param tLow - variable where tLow is stored
+   * @param tHigh - variable where tHigh is stored
+   * @return true if intersection exists
+   */
+  [[nodiscard]] static bool hasIntersectionWithBoundingBox(const Point3d &aabbMin, const Point3d &aabbMax, const Ray &ray, float &tLow, float &tHigh);
+
+  /**
+   * Find t low and t high between given AABB and all rays of the packet at once, the parameters are clipped by x and z dimensions only
+   * @param aabbMin - minimal corner of the box
+   * @param aabbMax - maximal corner of the box
+   * @param packet - investigated rays
+   * @param tLow - array where tLow of every ray is stored
+   * @param tHigh - array where tHigh of every ray is stored
+   * @return bit mask of rays intersecting the bounding box (bit i set for i-th ray)
+   */
+  [[nodiscard]] static int hasIntersectionWithBoundingBox(const Point3d &aabbMin, const Point3d &aabbMax, const RayPacket &packet, float tLow[RayPacket::size], float tHigh[RayPacket::size]);
+
   /**
    * Create height map from height map reader with given parameters
-   * @param reader - HeightMapReader that was used to read file with heightmap
+   * @param reader - source of the height samples (MapReader or RawMapReader), it is only used during the construction
    * @param position - position of the height map
    * @param size - vector storing width, depth and height of the height map
    * @param width - width of the height map
@@ -67,7 +93,27 @@ public:
    * @param depth - depth of the height map
    * @param material - material of the heightmap
    */
-  explicit HeightMap(const MapReader &reader, const Point3d &position, const Vector3d &size, const Material &material);
+  explicit HeightMap(const HeightSource &reader, const Point3d &position, const Vector3d &size, const Material &material);
+
+  /**
+   * Create height map from the terrain cache file, which was saved from the height map with the same position and height
+   * @param cache - mapped terrain cache file
+   * @param position - position of the height map
+   * @param size - vector storing width, depth and height of the height map
+   * @param material - material of the heightmap
+   */
+  explicit HeightMap(const TerrainCache &cache, const Point3d &position, const Vector3d &size, const Material &material);
+
+  /**
+   * Create out-of-core height map, the samples are loaded in tiles when rays reach them
+   * @param source - source of the height samples, it is kept by the height map
+   * @param tileSize - number of cells in the tile side (rounded down to power of two)
+   * @param cacheBudget - maximal memory of the loaded tiles in bytes
+   * @param position - position of the height map
+   * @param size - vector storing width, depth and height of the height map
+   * @param material - material of the heightmap
+   */
+  explicit HeightMap(const std::shared_ptr<const HeightSource> &source, unsigned tileSize, size_t cacheBudget, const Point3d &position, const Vector3d &size, const Material &material);
 
   [[nodiscard]] std::string to_string() const;
   friend std::ostream &operator<<(std::ostream &out, const HeightMap &h);
@@ -78,6 +124,18 @@ public:
    */
   [[nodiscard]] const Point3d &getPosition() const;
 
+  /**
+   * Get minimal corner of the height map bounding box
+   * @return point with minimal coordinates of the box
+   */
+  [[nodiscard]] const Point3d &getAabbMin() const;
+
+  /**
+   * Get maximal corner of the height map bounding box
+   * @return point with maximal coordinates of the box
+   */
+  [[nodiscard]] const Point3d &getAabbMax() const;
+
   /**
    * Get material of the heightmap
    * @return material of the height map
@@ -90,6 +148,15 @@ public:
    */
   [[nodiscard]] float getHeightFraction(float y) const;
 
+  /**
+   * Find t low and t high between AABB of the height map and all rays of the packet at once
+   * @param packet - investigated rays
+   * @param tLow - array where tLow of every ray is stored
+   * @param tHigh - array where tHigh of every ray is stored
+   * @return bit mask of rays intersecting the bounding box (bit i set for i-th ray)
+   */
+  [[nodiscard]] int hasIntersectionWithBoundingBox(const RayPacket &packet, float tLow[RayPacket::size], float tHigh[RayPacket::size]) const;
+
   /**
    * Find intersection between ray and this height map
    * @param ray - investigated ray
@@ -97,4 +164,98 @@ public:
    * @return true if intersection is found
    */
   [[nodiscard]] bool findIntersection(const Ray &ray, Intersection &intersection) const;
+
+  /**
+   * Find intersection between ray and this height map, when parameters where the ray enters and leaves AABB are already known
+   * @param ray - investigated ray
+   * @param tLow - parameter where ray enters the bounding box
+   * @param tHigh - parameter where ray leaves the bounding box
+   * @param intersection - intersection, stays unchanged if none found
+   * @return true if intersection is found
+   */
+  [[nodiscard]] bool findIntersection(const Ray &ray, float tLow, float tHigh, Intersection &intersection) const;
+
+  /**
+   * Find intersection between ray and this height map, the coarser levels of detail are used where their cells are smaller than the pixel
+   * footprint times the scene tolerance, so the ray walks fewer cells far from the camera
+   * If the ceiling was built, cells before the ray gets under the ceiling are not tested either
+   * @param ray - investigated ray
+   * @param tLow - parameter where ray enters the bounding box
+   * @param tHigh - parameter where ray leaves the bounding box
+   * @param tStart - cells before the point on this parameter are not tested (lowest float to test all cells)
+   * @param footprint - size of the pixel footprint at distance 1 along the ray, 0 for the full resolution
+   * @param intersection - intersection, stays unchanged if none found
+   * @param tMin - only intersections farther than this parameter are found, for the rays starting on the surface
+   * @return true if intersection is found
+   */
+  [[nodiscard]] bool findIntersection(const Ray &ray, float tLow, float tHigh, float tStart, float footprint, Intersection &intersection,
+    float tMin = std::numeric_limits<float>::lowest()) const;
+
+  /**
+   * Choose the cell primitive of the height map and its levels of detail, the levels built later get it too
+   * @param enabled - true to intersect the cells as the bilinear patches through their corners, false for the two triangles
+   */
+  void setBilinearPatches(bool enabled);
+
+  /**
+   * Build coarser levels of detail from the height map, out-of-core height maps are left without them
+   * @param count - maximal number of the levels, fewer are built for small height maps
+   */
+  void buildDetailLevels(unsigned count);
+
+  /**
+   * Replace heights of a rectangle of the samples of the height map read to memory, only the structures over the changed samples
+   * are built again, including the samples of the coarser levels of detail interpolated from them (see Grid::updateSamples)
+   * @param firstRow - row of the first replaced sample
+   * @param firstCol - column of the first replaced sample
+   * @param rows - number of the replaced rows
+   * @param cols - number of the replaced columns
+   * @param heights - rows * cols new heights by rows, clamped to the height of the height map
+   * @param changedMin - where the minimal corner of the box around the changed surface and its shading is stored
+   * @param changedMax - where the maximal corner of the box is stored
+   */
+  void updateHeights(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const std::vector<float> &heights, Point3d &changedMin, Point3d &changedMax);
+
+  /**
+   * Get number of the coarser levels of detail
+   * @return number of levels without the full resolution one
+   */
+  [[nodiscard]] unsigned getDetailLevelCount() const;
+
+  /**
+   * Get the coarsest level of detail with cells smaller than the pixel footprint times the scene tolerance
+   * @param footprintSize - size of the pixel footprint
+   * @return level of detail, the height map itself if no coarser level is fine enough
+   */
+  [[nodiscard]] const HeightMap &getDetailLevel(float footprintSize) const;
+
+  /**
+   * Find if the segment between two points is blocked by the height map (any-hit query for shadow rays)
+   * Traversal starts at the origin cell and ends with the first found intersection, normal of the intersection is not computed
+   * @param origin - start of the segment, usually point on the height map surface
+   * @param target - end of the segment, usually light position
+   * @param footprintSize - size of the pixel footprint at the origin, the whole segment is tested in the level of detail of the origin,
+   * so the surface found in a coarser level does not shadow itself (0 for the full resolution)
+   * @return true if there is an intersection between origin and target
+   */
+  [[nodiscard]] bool isOccluded(const Point3d &origin, const Point3d &target, float footprintSize = 0.f) const;
+
+  /**
+   * Report memory of the grid, its levels of detail and the texture of the material, structures shared by the copies are reported once
+   * @param report - report where the memory is added
+   */
+  void reportMemory(MemoryReport &report) const;
+
+  /**
+   * Estimate memory of the height map read to memory with the optional structures, the same as reported after it is built
+   * @param gridWidth - number of the cell columns
+   * @param gridDepth - number of the cell rows
+   * @param storedTriangles - the triangles of the cells are stored (only when built with STORED_TRIANGLES)
+   * @param detailLevels - number of the coarser levels of detail
+   * @param vertexNormals - the normals in the samples are built
+   * @param horizonDirections - number of the directions of the horizon map, 0 without the horizon map
+   * @return size in bytes
+   */
+  [[nodiscard]] static size_t estimateMemorySize(unsigned gridWidth, unsigned gridDepth, bool storedTriangles, unsigned detailLevels, bool vertexNormals,
+    unsigned horizonDirections);
 };
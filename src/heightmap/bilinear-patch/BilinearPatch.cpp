@@ -0,0 +1,45 @@
+#include <cmath>
+#include <utility>
+
+#include "BilinearPatch.h"
+
+bool BilinearPatch::findIntersection(const Ray &ray, float tMin, float tMax, float topLeft, float topRight, float bottomLeft, float bottomRight,
+  float xPos, float zPos, float width, float depth, Intersection *intersection) {
+  // hits on the shared edge are accepted by both cells, so no ray slips between the patches
+  constexpr auto edgeTolerance = 1e-5;
+  const auto &origin = ray.getOrigin();
+  const auto &direction = ray.getDirection();
+  // the ray in the coordinates of the cell, computed in doubles because the origin can be far from the small cell
+  auto u0 = (double(origin.getX()) - xPos) / width, v0 = (double(origin.getZ()) - zPos) / depth;
+  auto du = double(direction.getX()) / width, dv = double(direction.getZ()) / depth;
+  auto a = double(topLeft), b = double(topRight) - topLeft, c = double(bottomLeft) - topLeft;
+  auto d = double(topLeft) - topRight - bottomLeft + bottomRight;
+
+  // height of the ray above the patch is A t^2 + B t + C
+  auto quadratic = -d * du * dv;
+  auto linear = direction.getY() - (b * du + c * dv + d * (u0 * dv + v0 * du));
+  auto constant = origin.getY() - (a + b * u0 + c * v0 + d * u0 * v0);
+  auto discriminant = linear * linear - 4. * quadratic * constant;
+  if (discriminant < 0.) return false;
+  // roots without the cancellation of the textbook formula, the second root is missing for the flat patches and axis aligned rays
+  auto q = -.5 * (linear + std::copysign(std::sqrt(discriminant), linear));
+  double roots[2];
+  unsigned count = 0;
+  if (q != 0.) roots[count++] = constant / q;
+  if (quadratic != 0.) roots[count++] = q / quadratic;
+  if (count == 2 && roots[1] < roots[0]) std::swap(roots[0], roots[1]);
+
+  for (unsigned i = 0; i < count; i++) {
+    auto t = roots[i];
+    if (t <= tMin || t >= tMax) continue;
+    auto u = u0 + t * du, v = v0 + t * dv;
+    if (u < -edgeTolerance || u > 1. + edgeTolerance || v < -edgeTolerance || v > 1. + edgeTolerance) continue;
+    if (intersection != nullptr) {
+      // normal is perpendicular to the gradient of the height, pointing up like the normals of the cell triangles
+      auto slopeX = (b + d * v) / width, slopeZ = (c + d * u) / depth;
+      *intersection = Intersection(float(t), Vector3d(float(-slopeX), 1.f, float(-slopeZ)).normalized());
+    }
+    return true;
+  }
+  return false;
+}
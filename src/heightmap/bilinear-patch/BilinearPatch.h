@@ -0,0 +1,33 @@
+#pragma once
+
+#include "src/helper-types/Intersection.h"
+#include "src/ray/Ray.h"
+
+/**
+ * Bilinear patch through the four corner heights of a cell, the smooth alternative to the two triangles of the Cell
+ *
+ * The height of the patch is h(u, v) = a + b u + c v + d u v for u, v in [0, 1] across the cell, along the ray it is a quadratic
+ * function of the ray parameter, so the intersection is the root of the quadratic equation. The patch is continuous with the patches
+ * of the neighbouring cells and it never rises above the highest corner, so the maximal heights of the cells bound it too.
+ */
+class BilinearPatch {
+public:
+  /**
+   * Find the nearest intersection of the ray with the patch of the cell with given height samples
+   * @param ray - investigated ray
+   * @param tMin - intersections with parameter lower or equal are ignored
+   * @param tMax - intersections with parameter higher or equal are ignored
+   * @param topLeft - y coordinate in top left corner
+   * @param topRight - y coordinate in top right corner
+   * @param bottomLeft - y coordinate in bottom left corner
+   * @param bottomRight - y coordinate in bottom right corner
+   * @param xPos - x coordinate of the cell top left corner
+   * @param zPos - z coordinate of the cell top left corner
+   * @param width - width of the cell (x)
+   * @param depth - depth of the cell (z)
+   * @param intersection - where the intersection is stored, null if any intersection is enough and the normal is not needed
+   * @return true if intersection is found
+   */
+  [[nodiscard]] static bool findIntersection(const Ray &ray, float tMin, float tMax, float topLeft, float topRight, float bottomLeft, float bottomRight,
+    float xPos, float zPos, float width, float depth, Intersection *intersection);
+};
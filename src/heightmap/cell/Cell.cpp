@@ -1,23 +1,20 @@
+#include <limits>
+
 #include "Cell.h"
 
 Cell::Cell(float topLeft, float topRight, float bottomLeft, float bottomRight, float xPos, float zPos, float width, float depth) {
-  maxHeight = std::max(std::max(topLeft, topRight), std::max(bottomLeft, bottomRight));
-
   auto p1 = Point3d(xPos, topLeft, zPos);
   auto p2 = Point3d(xPos + width, bottomRight, zPos + depth);
   auto pC1 = Point3d(xPos + width, topRight, zPos);
   auto pC2 = Point3d(xPos, bottomLeft, zPos + depth);
-  triangles = {
-    Triangle(p1, pC2.getVectorBetween(p1), pC1.getVectorBetween(p1)),
-    Triangle(p2, pC1.getVectorBetween(p2), pC2.getVectorBetween(p2))
-  };
+  triangles[0] = Triangle(p1, pC2.getVectorBetween(p1), pC1.getVectorBetween(p1));
+  triangles[1] = Triangle(p2, pC1.getVectorBetween(p2), pC2.getVectorBetween(p2));
 }
 
 std::string Cell::to_string() const {
   return "{"
     + triangles[0].to_string() + " "
-    + triangles[1].to_string() + " with max height "
-    + std::to_string(maxHeight)
+    + triangles[1].to_string()
     + "} ";
 }
 
@@ -26,16 +23,20 @@ std::ostream &operator<<(std::ostream &out, const Cell &cell) {
   return out;
 }
 
-bool Cell::findIntersection(const Ray &ray, Intersection &intersection, float minHeight) const {
-  if (minHeight > maxHeight) return false;
-  float t;
-  if (triangles[0].getIntersection(ray, t)) {
-    intersection = Intersection(t, triangles[0].getNormal());
-    return true;
-  }
-  if (triangles[1].getIntersection(ray, t)) {
-    intersection = Intersection(t, triangles[1].getNormal());
-    return true;
-  }
-  return false;
+void Cell::addToPacket(TrianglePacket &packet) const {
+  packet.add(triangles[0]);
+  packet.add(triangles[1]);
+}
+
+void Cell::addToPacket(TrianglePacket &packet, float topLeft, float topRight, float bottomLeft, float bottomRight, float xPos, float zPos, float width, float depth) {
+  // corners p1, p2, pC1, pC2 as in the constructor, vectors computed as the differences of the corners
+  auto x2 = xPos + width, z2 = zPos + depth;
+  packet.add(xPos, topLeft, zPos, xPos - xPos, bottomLeft - topLeft, z2 - zPos, x2 - xPos, topRight - topLeft, zPos - zPos);
+  packet.add(x2, bottomRight, z2, x2 - x2, topRight - bottomRight, zPos - z2, xPos - x2, bottomLeft - bottomRight, z2 - z2);
+}
+
+bool Cell::findIntersection(const Ray &ray, Intersection &intersection) const {
+  TrianglePacket packet;
+  addToPacket(packet);
+  return packet.findNearestIntersection(ray, std::numeric_limits<float>::lowest(), std::numeric_limits<float>::infinity(), intersection);
 }
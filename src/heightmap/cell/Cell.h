@@ -1,17 +1,17 @@
 #pragma once
 
-#include <vector>
 #include "src/helper-types/Intersection.h"
 #include "src/triangle/Triangle.h"
+#include "src/triangle/TrianglePacket.h"
 
 /**
  * Type for one cell of the height map
  *
  * Provide operation for finding intersection with cell triangles
+ * Triangles are stored inside the cell, maximal height of the cell is stored in the grid
  */
 class Cell {
-  float maxHeight = 0.f;
-  std::vector<Triangle> triangles;
+  Triangle triangles[2];
 
 public:
   /**
@@ -35,12 +35,25 @@ public:
   [[nodiscard]] std::string to_string() const;
   friend std::ostream &operator<<(std::ostream &out, const Cell &cell);
 
+  /**
+   * Add both triangles of the cell to the packet
+   * @param packet - packet with at least two free lanes
+   */
+  void addToPacket(TrianglePacket &packet) const;
+
+  /**
+   * Add both triangles of the cell with given height samples to the packet, without building the cell
+   * The triangles are the same as the ones built by the constructor with the same parameters
+   * @param packet - packet with at least two free lanes
+   */
+  static void addToPacket(TrianglePacket &packet, float topLeft, float topRight, float bottomLeft, float bottomRight, float xPos, float zPos, float width, float depth);
+
   /**
    * Find if there is an intersection between ray and the cell and store it if there is
+   * Both triangles are tested at once, the nearer intersection is stored if the ray hits both of them
    * @param ray - investigated ray
    * @param intersection - value where we store intersection if any is found
-   * @param minHeight - minimal ray height in the bounding box
    * @return true if intersection is found
    */
-  bool findIntersection(const Ray &ray, Intersection &intersection, float minHeight = -std::numeric_limits<float>::infinity()) const;
+  bool findIntersection(const Ray &ray, Intersection &intersection) const;
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include <algorithm>
+
+#include "DigitalLine.h"
+#include "src/scene.h"
+
+long long DigitalLine::getScaled(float value) {
+  return (long long) (value * scene::precision);
+}
+
+DigitalLine::DigitalLine(float major, float minor, float intercept, int fromMajor, int fromMinor, int majorCount, int minorCount)
+  : startMajor(fromMajor), currMajor(fromMajor), currMinor(fromMinor), majorCount(majorCount), minorCount(minorCount) {
+  auto precision = (long long) scene::precision;
+  auto minorScaled = getScaled(minor), majorScaled = std::max(getScaled(major), 1ll);
+
+  // alpha = minorScaled / majorScaled, beta = interceptScaled / precision, common denominator is majorScaled * precision
+  one = majorScaled * precision;
+  alpha = minorScaled * precision;
+  beta = getScaled(intercept) * majorScaled;
+
+  if (minorScaled == 0) { // line parallel with the major axis is one run
+    runLengthShort = runLengthLong = majorCount;
+  } else {
+    runLengthShort = int(majorScaled / minorScaled);
+    runLengthLong = int((majorScaled + minorScaled - 1) / minorScaled);
+  }
+  v = one - alpha * runLengthShort;
+  truncatedFirst = beta >= alpha + v;
+  currRunLength = beta < v ? runLengthLong : runLengthShort;
+}
+
+bool DigitalLine::nextRun(int &from, int &to, int &other) {
+  auto last = majorCount - 1;
+  if (truncatedFirst) {
+    truncatedFirst = false;
+    int lengthOfTruncated = int((one - beta + alpha - 1) / alpha);
+    from = currMajor;
+    to = std::min(currMajor + lengthOfTruncated, last);
+    other = currMinor;
+    currMajor += lengthOfTruncated;
+    currMinor++;
+    beta = (beta - v) % alpha;
+    currRunLength = beta < v ? runLengthLong : runLengthShort;
+    return true;
+  }
+
+  if (currMajor >= majorCount || currMinor >= minorCount) return false;
+  from = std::max(startMajor, currMajor - 1);
+  to = std::min(currMajor + currRunLength, last);
+  other = currMinor;
+  currMajor += currRunLength;
+  currMinor++;
+  beta += alpha * currRunLength - one;
+  currRunLength = beta < v ? runLengthLong : runLengthShort;
+  return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+/**
+ * Generator of runs of the digital line, for ray projected to the grid
+ *
+ * Line goes in positive direction of the major axis with slope alpha (0 <= alpha) of the minor axis. Run is a sequence
+ * of cells on the same minor coordinate, the runs have only two lengths (short and long) determined by alpha, the next
+ * length is given by the intercept beta of the line. Values are stored as integer numerators over one common denominator,
+ * so no normalization (gcd) is needed and the generator does not allocate.
+ */
+class DigitalLine {
+  long long alpha, one, v, beta;
+  int runLengthShort, runLengthLong;
+  int startMajor, currMajor, currMinor, majorCount, minorCount, currRunLength;
+  bool truncatedFirst;
+
+public:
+  /**
+   * Get number scaled by scene precision, as used for integer representation of the line
+   * @param value - real value
+   * @return scaled integer value
+   */
+  [[nodiscard]] static long long getScaled(float value);
+
+  /**
+   * Create digital line starting in the cell given by its major and minor coordinate
+   * @param major - direction of the line in the major axis (positive)
+   * @param minor - direction of the line in the minor axis (positive)
+   * @param intercept - fractional part of minor coordinate of the line where it enters the start cell
+   * @param fromMajor - major coordinate of the start cell
+   * @param fromMinor - minor coordinate of the start cell
+   * @param majorCount - number of cells in the major axis
+   * @param minorCount - number of cells in the minor axis
+   */
+  explicit DigitalLine(float major, float minor, float intercept, int fromMajor, int fromMinor, int majorCount, int minorCount);
+
+  /**
+   * Get next run of the line, runs are widened by one cell on both sides to cover all cells the ray passes through
+   * @param from - major coordinate where the run starts
+   * @param to - major coordinate where the run ends (including)
+   * @param other - minor coordinate of the run
+   * @return false if the line left the grid and there is no next run
+   */
+  bool nextRun(int &from, int &to, int &other);
+};
@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "HeightCeiling.h"
+
+HeightCeiling::HeightCeiling(std::vector<float> maxHeights, unsigned columns, unsigned rows, float blockWidth, float blockDepth, const Point3d &position)
+  : columns(columns), rows(rows), blockWidth(blockWidth), blockDepth(blockDepth), position(position), maxHeights(std::move(maxHeights)) {}
+
+void HeightCeiling::set(unsigned row, unsigned col, float maxHeight) {
+  maxHeights[row * columns + col] = maxHeight;
+}
+
+float HeightCeiling::getStart(const Ray &ray, float tLow, float tHigh) const {
+  const auto &origin = ray.getOrigin();
+  const auto &direction = ray.getDirection();
+  auto entry = ray.getPointOnParameter(tLow);
+  auto col = std::clamp(int((entry.getX() - position.getX()) / blockWidth), 0, int(columns) - 1);
+  auto row = std::clamp(int((entry.getZ() - position.getZ()) / blockDepth), 0, int(rows) - 1);
+
+  // parameters where the ray crosses the next block border in x and z and the parameter distance between the borders
+  auto stepCol = direction.getX() > 0.f ? 1 : -1, stepRow = direction.getZ() > 0.f ? 1 : -1;
+  auto infinity = std::numeric_limits<float>::infinity();
+  auto nextX = direction.getX() == 0.f ? infinity : (position.getX() + float(col + (stepCol > 0)) * blockWidth - origin.getX()) / direction.getX();
+  auto nextZ = direction.getZ() == 0.f ? infinity : (position.getZ() + float(row + (stepRow > 0)) * blockDepth - origin.getZ()) / direction.getZ();
+  auto deltaX = direction.getX() == 0.f ? infinity : blockWidth / std::abs(direction.getX());
+  auto deltaZ = direction.getZ() == 0.f ? infinity : blockDepth / std::abs(direction.getZ());
+
+  auto t = tLow;
+  while (true) {
+    auto blockEnd = std::min(std::min(nextX, nextZ), tHigh);
+    // the ray is a line, its lowest point in the block is on one of the ends
+    auto lowest = origin.getY() + direction.getY() * (direction.getY() < 0.f ? blockEnd : t);
+    if (lowest <= maxHeights[row * columns + col]) return t;
+    if (blockEnd >= tHigh) return tHigh;
+    if (nextX < nextZ) {
+      col += stepCol;
+      nextX += deltaX;
+    } else {
+      row += stepRow;
+      nextZ += deltaZ;
+    }
+    if (col < 0 || row < 0 || col >= int(columns) || row >= int(rows)) return tHigh;
+    t = blockEnd;
+  }
+}
+
+size_t HeightCeiling::getMemorySize() const {
+  return maxHeights.size() * sizeof(float);
+}
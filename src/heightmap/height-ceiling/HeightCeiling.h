@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "src/point/Point3d.h"
+#include "src/ray/Ray.h"
+
+/**
+ * Coarse ceiling above the height map - maximal height of every square block of cells in one small array
+ *
+ * The ray walks the blocks from the point where it enters the height map until the first block where it gets below the ceiling.
+ * Cells before that block can not be hit, so the grid traversal can skip them. The blocks are much coarser than the cells,
+ * so the walk takes few steps and its array stays in the cache for all rays of the frame.
+ */
+class HeightCeiling {
+  unsigned columns, rows; // number of the blocks
+  float blockWidth, blockDepth; // size of the block in world units
+  Point3d position; // corner of the height map
+  std::vector<float> maxHeights; // maximal heights of the blocks by rows
+
+public:
+  /**
+   * Create ceiling from maximal heights of the blocks
+   * @param maxHeights - maximal heights of the blocks by rows
+   * @param columns - number of the block columns
+   * @param rows - number of the block rows
+   * @param blockWidth - width of the block in world units
+   * @param blockDepth - depth of the block in world units
+   * @param position - position of the height map
+   */
+  explicit HeightCeiling(std::vector<float> maxHeights, unsigned columns, unsigned rows, float blockWidth, float blockDepth, const Point3d &position);
+
+  /**
+   * Replace maximal height of one block, when the height map under it changes
+   * @param row - row of the block
+   * @param col - column of the block
+   * @param maxHeight - new maximal height of the block
+   */
+  void set(unsigned row, unsigned col, float maxHeight);
+
+  /**
+   * Find where the ray gets below the ceiling for the first time
+   * @param ray - investigated ray
+   * @param tLow - parameter where the ray enters the height map
+   * @param tHigh - parameter where the ray leaves the height map
+   * @return parameter where the ray enters the first block in which it gets below the ceiling, tHigh if it stays above
+   */
+  [[nodiscard]] float getStart(const Ray &ray, float tLow, float tHigh) const;
+
+  /**
+   * Get memory used by the maximal heights of the blocks
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getMemorySize() const;
+};
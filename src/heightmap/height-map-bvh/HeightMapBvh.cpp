@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <limits>
+
+#include "HeightMapBvh.h"
+
+HeightMapBvh::HeightMapBvh(const std::vector<HeightMap> &heightMaps) {
+  for (const auto &heightMap : heightMaps) this->heightMaps.push_back(&heightMap);
+  if (this->heightMaps.empty()) return;
+  nodes.reserve(2 * this->heightMaps.size() - 1);
+  build(0, this->heightMaps.size());
+}
+
+void HeightMapBvh::build(unsigned first, unsigned count) {
+  auto aabbMin = heightMaps[first]->getAabbMin(), aabbMax = heightMaps[first]->getAabbMax();
+  auto centerMin = (aabbMin + aabbMax) / 2.f, centerMax = centerMin;
+  for (auto i = first + 1; i < first + count; i++) {
+    auto otherMin = heightMaps[i]->getAabbMin(), otherMax = heightMaps[i]->getAabbMax();
+    auto center = (otherMin + otherMax) / 2.f;
+    aabbMin = aabbMin.minimalCoords(otherMin);
+    aabbMax = aabbMax.maximalCoords(otherMax);
+    centerMin = centerMin.minimalCoords(center);
+    centerMax = centerMax.maximalCoords(center);
+  }
+
+  auto index = unsigned(nodes.size());
+  nodes.push_back(Node{aabbMin, aabbMax, first, 0});
+  if (count == 1) return;
+
+  // median of the centers along the axis where they are spread the most
+  unsigned axis = 0;
+  for (unsigned d = 1; d < 3; d++) {
+    if (centerMax.get(d) - centerMin.get(d) > centerMax.get(axis) - centerMin.get(axis)) axis = d;
+  }
+  auto begin = heightMaps.begin() + first;
+  std::nth_element(begin, begin + count / 2, begin + count, [axis](const HeightMap *a, const HeightMap *b) {
+    return a->getAabbMin().get(axis) + a->getAabbMax().get(axis) < b->getAabbMin().get(axis) + b->getAabbMax().get(axis);
+  });
+  build(first, count / 2);
+  nodes[index].secondChild = nodes.size();
+  build(first + count / 2, count - count / 2);
+}
+
+unsigned HeightMapBvh::getHeightMapCount() const {
+  return heightMaps.size();
+}
+
+const HeightMap &HeightMapBvh::getHeightMap(unsigned index) const {
+  return *heightMaps[index];
+}
+
+int HeightMapBvh::hasIntersectionWithBoundingBox(const RayPacket &packet, float tLow[RayPacket::size], float tHigh[RayPacket::size]) const {
+  if (nodes.empty()) return 0;
+  return HeightMap::hasIntersectionWithBoundingBox(nodes[0].aabbMin, nodes[0].aabbMax, packet, tLow, tHigh);
+}
+
+void HeightMapBvh::pushChildren(unsigned node, const Ray &ray, Entry stack[stackSize], unsigned &size) const {
+  Entry children[2];
+  unsigned hits = 0;
+  for (auto child : {node + 1, nodes[node].secondChild}) {
+    float tLow, tHigh;
+    if (HeightMap::hasIntersectionWithBoundingBox(nodes[child].aabbMin, nodes[child].aabbMax, ray, tLow, tHigh) && tHigh >= 0.f) {
+      children[hits++] = Entry{child, tLow, tHigh};
+    }
+  }
+  if (hits == 2 && std::max(children[0].tLow, 0.f) < std::max(children[1].tLow, 0.f)) std::swap(children[0], children[1]);
+  for (unsigned i = 0; i < hits; i++) stack[size++] = children[i];
+}
+
+bool HeightMapBvh::findIntersection(const Ray &ray, float tLow, float tHigh, float tStart, float footprint, Intersection &intersection, const HeightMap *&heightMap,
+  float tMin) const {
+  if (nodes.empty()) return false;
+  if (nodes.size() == 1) { // box of the hierarchy is the box of the only height map
+    if (!heightMaps[0]->findIntersection(ray, tLow, tHigh, tStart, footprint, intersection, tMin)) return false;
+    heightMap = heightMaps[0];
+    return true;
+  }
+
+  Entry stack[stackSize];
+  unsigned size = 0;
+  stack[size++] = Entry{0, tLow, tHigh};
+  auto nearest = std::numeric_limits<float>::infinity();
+  while (size > 0) {
+    auto entry = stack[--size];
+    if (std::max(entry.tLow, 0.f) >= nearest || entry.tHigh <= tStart) continue; // box is behind the nearest intersection or before the start
+    const auto &node = nodes[entry.node];
+    if (node.secondChild != 0) {
+      pushChildren(entry.node, ray, stack, size);
+      continue;
+    }
+    // traversal of the height map ends at the nearest found intersection
+    Intersection candidate;
+    const auto *candidateMap = heightMaps[node.heightMap];
+    if (candidateMap->findIntersection(ray, entry.tLow, std::min(entry.tHigh, nearest), tStart, footprint, candidate, tMin) && candidate.getT() < nearest) {
+      nearest = candidate.getT();
+      intersection = candidate;
+      heightMap = candidateMap;
+    }
+  }
+  return nearest != std::numeric_limits<float>::infinity();
+}
+
+bool HeightMapBvh::findIntersection(const Ray &ray, Intersection &intersection, const HeightMap *&heightMap, float tMin) const {
+  if (nodes.empty()) return false;
+  float tLow, tHigh;
+  if (!HeightMap::hasIntersectionWithBoundingBox(nodes[0].aabbMin, nodes[0].aabbMax, ray, tLow, tHigh)) return false;
+  return findIntersection(ray, tLow, tHigh, std::numeric_limits<float>::lowest(), 0.f, intersection, heightMap, tMin);
+}
+
+bool HeightMapBvh::isOccluded(const Point3d &origin, const Point3d &target, float footprintSize) const {
+  if (nodes.empty()) return false;
+  if (nodes.size() == 1) return heightMaps[0]->isOccluded(origin, target, footprintSize);
+
+  auto toTarget = target.getVectorBetween(origin);
+  auto distance = toTarget.length();
+  if (distance == 0.f) return false;
+  auto ray = Ray(origin, toTarget / distance);
+
+  Entry stack[stackSize];
+  unsigned size = 0;
+  float tLow, tHigh;
+  if (!HeightMap::hasIntersectionWithBoundingBox(nodes[0].aabbMin, nodes[0].aabbMax, ray, tLow, tHigh) || tHigh < 0.f) return false;
+  stack[size++] = Entry{0, tLow, tHigh};
+  while (size > 0) {
+    auto entry = stack[--size];
+    if (entry.tLow > distance) continue; // box is behind the target
+    const auto &node = nodes[entry.node];
+    if (node.secondChild != 0) {
+      pushChildren(entry.node, ray, stack, size);
+    } else if (heightMaps[node.heightMap]->isOccluded(origin, target, footprintSize)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void HeightMapBvh::reportMemory(MemoryReport &report) const {
+  report.add("height map hierarchy", nodes.size() * sizeof(Node) + heightMaps.size() * sizeof(const HeightMap *));
+  for (const auto *heightMap : heightMaps) heightMap->reportMemory(report);
+}
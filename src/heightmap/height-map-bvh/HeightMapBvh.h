@@ -0,0 +1,126 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include "src/heightmap/HeightMap.h"
+#include "src/helper-types/Intersection.h"
+#include "src/point/Point3d.h"
+#include "src/ray/Ray.h"
+#include "src/ray/RayPacket.h"
+
+/**
+ * Bounding volume hierarchy over the bounding boxes of the scene height maps
+ *
+ * Nodes are split by the median of the height map centers along the longest axis, so the tree depth grows logarithmically
+ * with the number of height maps. Rays visit only the height maps whose boxes they cross, nearest boxes first.
+ */
+class HeightMapBvh {
+  /**
+   * Node of the hierarchy, its first child directly follows it, leaf has no children and holds one height map
+   */
+  struct Node {
+    Point3d aabbMin, aabbMax;
+    unsigned heightMap = 0; // index of the height map of the leaf
+    unsigned secondChild = 0; // index of the second child, 0 for leaf
+  };
+
+  /**
+   * Node waiting for the traversal with parameters where the ray enters and leaves its box
+   */
+  struct Entry {
+    unsigned node;
+    float tLow, tHigh;
+  };
+
+  constexpr static const unsigned stackSize = 64; // more than the depth of the tree, which is logarithmic
+
+  std::vector<const HeightMap *> heightMaps; // ordered so every subtree has its height maps together
+  std::vector<Node> nodes;
+
+  /**
+   * Push children of the inner node which are crossed by the ray to the traversal stack, the nearer child is pushed last
+   * @param node - index of the inner node
+   * @param ray - investigated ray
+   * @param stack - traversal stack
+   * @param size - number of entries in the stack
+   */
+  void pushChildren(unsigned node, const Ray &ray, Entry stack[stackSize], unsigned &size) const;
+
+  /**
+   * Build subtree of the height maps in the range
+   * @param first - index of the first height map of the subtree
+   * @param count - number of the height maps in the subtree
+   */
+  void build(unsigned first, unsigned count);
+
+public:
+  /**
+   * Create hierarchy over the height maps, the height maps must not be moved while the hierarchy is used
+   * @param heightMaps - height maps of the scene
+   */
+  explicit HeightMapBvh(const std::vector<HeightMap> &heightMaps);
+
+  /**
+   * Get number of the height maps in the hierarchy
+   * @return number of height maps
+   */
+  [[nodiscard]] unsigned getHeightMapCount() const;
+
+  /**
+   * Get height map in the hierarchy
+   * @param index - index of the height map (in hierarchy order)
+   * @return height map
+   */
+  [[nodiscard]] const HeightMap &getHeightMap(unsigned index) const;
+
+  /**
+   * Find t low and t high between the box of all height maps and all rays of the packet at once
+   * @param packet - investigated rays
+   * @param tLow - array where tLow of every ray is stored
+   * @param tHigh - array where tHigh of every ray is stored
+   * @return bit mask of rays intersecting the bounding box (bit i set for i-th ray)
+   */
+  [[nodiscard]] int hasIntersectionWithBoundingBox(const RayPacket &packet, float tLow[RayPacket::size], float tHigh[RayPacket::size]) const;
+
+  /**
+   * Find the nearest intersection between ray and the height maps, when parameters where the ray enters and leaves box of all height maps are known
+   * @param ray - investigated ray
+   * @param tLow - parameter where ray enters the box of all height maps
+   * @param tHigh - parameter where ray leaves the box of all height maps
+   * @param tStart - parts of the ray before this parameter are not tested (lowest float to test the whole ray)
+   * @param footprint - size of the pixel footprint at distance 1 along the ray for the levels of detail, 0 for the full resolution
+   * @param intersection - intersection, stays unchanged if none found
+   * @param heightMap - height map of the intersection, stays unchanged if none found
+   * @param tMin - only intersections farther than this parameter are found, for the rays starting on the surface
+   * @return true if intersection is found
+   */
+  [[nodiscard]] bool findIntersection(const Ray &ray, float tLow, float tHigh, float tStart, float footprint, Intersection &intersection, const HeightMap *&heightMap,
+    float tMin = std::numeric_limits<float>::lowest()) const;
+
+  /**
+   * Find the nearest intersection between ray and the height maps
+   * @param ray - investigated ray
+   * @param intersection - intersection, stays unchanged if none found
+   * @param heightMap - height map of the intersection, stays unchanged if none found
+   * @param tMin - only intersections farther than this parameter are found, for the rays starting on the surface
+   * @return true if intersection is found
+   */
+  [[nodiscard]] bool findIntersection(const Ray &ray, Intersection &intersection, const HeightMap *&heightMap,
+    float tMin = std::numeric_limits<float>::lowest()) const;
+
+  /**
+   * Find if the segment between two points is blocked by any of the height maps
+   * @param origin - start of the segment, usually point on the height map surface
+   * @param target - end of the segment, usually light position
+   * @param footprintSize - size of the pixel footprint at the origin for the levels of detail, 0 for the full resolution
+   * @return true if there is an intersection between origin and target
+   */
+  [[nodiscard]] bool isOccluded(const Point3d &origin, const Point3d &target, float footprintSize = 0.f) const;
+
+  /**
+   * Report memory of the nodes and of the height maps
+   * @param report - report where the memory is added
+   */
+  void reportMemory(MemoryReport &report) const;
+};
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "HeightTile.h"
+#include "src/scene.h"
+#include "src/thread-pool/ThreadPool.h"
+
+HeightTile::HeightTile(const HeightSource &source, unsigned firstRow, unsigned firstCol, unsigned width, unsigned depth, float sampleScale, float sampleOffset,
+                       const Point3d &position, float cellWidth, float cellDepth)
+  : firstRow(firstRow), firstCol(firstCol), width(width), depth(depth), sampleScale(sampleScale), sampleOffset(sampleOffset) {
+  ownedSamples.resize(getSampleCount(width, depth));
+  samples = ownedSamples.data();
+  // rows are independent, they are read and quantized in parallel
+  ThreadPool::getShared().parallelForChunks(depth + 1, rowsPerTask, [&](unsigned begin, unsigned end) {
+    std::vector<float> intensities(width + 1);
+    for (auto row = begin; row < end; row++) {
+      source.readRow(firstRow + row, firstCol, width + 1, intensities.data());
+      for (unsigned col = 0; col <= width; col++) ownedSamples[getSampleIndex(row, col)] = quantize(intensities[col]);
+    }
+  });
+
+  std::vector<float> maxHeights(width * depth);
+  ThreadPool::getShared().parallelForChunks(depth, rowsPerTask, [&](unsigned begin, unsigned end) {
+    for (auto row = firstRow + begin; row < firstRow + end; row++) {
+      auto rowMaxHeights = maxHeights.data() + (row - firstRow) * width;
+      for (auto col = firstCol; col < firstCol + width; col++) {
+        rowMaxHeights[col - firstCol] = std::max(std::max(getSampleHeight(row, col), getSampleHeight(row, col + 1)), std::max(getSampleHeight(row + 1, col), getSampleHeight(row + 1, col + 1)));
+      }
+    }
+  });
+  pyramid = MaxHeightPyramid(std::move(maxHeights), width, depth);
+  buildCells(position, cellWidth, cellDepth);
+}
+
+HeightTile::HeightTile(std::shared_ptr<const void> mapping, const uint16_t *samples, const float *pyramid, unsigned firstRow, unsigned firstCol, unsigned width, unsigned depth,
+                       float sampleScale, float sampleOffset, const Point3d &position, float cellWidth, float cellDepth)
+  : firstRow(firstRow), firstCol(firstCol), width(width), depth(depth), sampleScale(sampleScale), sampleOffset(sampleOffset), samples(samples), mapping(std::move(mapping)),
+  pyramid(pyramid, width, depth) {
+  buildCells(position, cellWidth, cellDepth);
+}
+
+// the cells are stored only with STORED_TRIANGLES, otherwise they are built from the samples and the parameters are unused
+void HeightTile::buildCells([[maybe_unused]] const Point3d &position, [[maybe_unused]] float cellWidth, [[maybe_unused]] float cellDepth) {
+#ifdef STORED_TRIANGLES
+  if (scene::compactCells) return; // the cells are built from the samples as without the stored triangles
+  cells.resize(width * depth);
+  buildCells(position, cellWidth, cellDepth, firstRow, firstRow + depth, firstCol, firstCol + width);
+#endif
+}
+
+void HeightTile::buildCells([[maybe_unused]] const Point3d &position, [[maybe_unused]] float cellWidth, [[maybe_unused]] float cellDepth,
+  [[maybe_unused]] unsigned beginRow, [[maybe_unused]] unsigned endRow, [[maybe_unused]] unsigned beginCol, [[maybe_unused]] unsigned endCol) {
+#ifdef STORED_TRIANGLES
+  if (cells.empty()) return;
+  ThreadPool::getShared().parallelForChunks(endRow - beginRow, rowsPerTask, [&](unsigned begin, unsigned end) {
+    for (auto row = beginRow + begin; row < beginRow + end; row++) {
+      for (auto col = beginCol; col < endCol; col++) {
+        auto xPos = position.getX() + cellWidth * float(col);
+        auto zPos = position.getZ() + cellDepth * float(row);
+        cells[(row - firstRow) * width + col - firstCol] = Cell(getSampleHeight(row, col), getSampleHeight(row, col + 1), getSampleHeight(row + 1, col), getSampleHeight(row + 1, col + 1), xPos, zPos, cellWidth, cellDepth);
+      }
+    }
+  });
+#endif
+}
+
+void HeightTile::updateSamples(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const float *intensities, const Point3d &position, float cellWidth, float cellDepth) {
+  if (ownedSamples.empty()) {
+    ownedSamples.assign(samples, samples + getSampleCount(width, depth));
+    samples = ownedSamples.data();
+  }
+  for (unsigned row = 0; row < rows; row++) {
+    for (unsigned col = 0; col < cols; col++) {
+      ownedSamples[getSampleIndex(firstRow + row - this->firstRow, firstCol + col - this->firstCol)] = quantize(intensities[row * cols + col]);
+    }
+  }
+
+  // cells on both sides of the changed samples, clipped to the tile
+  auto beginRow = std::max(firstRow, this->firstRow + 1) - 1, endRow = std::min(firstRow + rows, this->firstRow + depth);
+  auto beginCol = std::max(firstCol, this->firstCol + 1) - 1, endCol = std::min(firstCol + cols, this->firstCol + width);
+  std::vector<float> maxHeights((endRow - beginRow) * (endCol - beginCol));
+  for (auto row = beginRow; row < endRow; row++) {
+    for (auto col = beginCol; col < endCol; col++) {
+      maxHeights[(row - beginRow) * (endCol - beginCol) + col - beginCol] =
+        std::max(std::max(getSampleHeight(row, col), getSampleHeight(row, col + 1)), std::max(getSampleHeight(row + 1, col), getSampleHeight(row + 1, col + 1)));
+    }
+  }
+  pyramid.update(beginRow - this->firstRow, beginCol - this->firstCol, endRow - beginRow, endCol - beginCol, maxHeights.data());
+  mapping.reset(); // both the samples and the pyramid are in memory now
+  buildCells(position, cellWidth, cellDepth, beginRow, endRow, beginCol, endCol);
+}
+
+size_t HeightTile::getSampleCount(unsigned width, unsigned depth) {
+#ifdef BLOCKED_LAYOUT
+  // partial blocks on the far borders are padded to whole blocks
+  constexpr auto mask = (1u << blockLevel) - 1;
+  return size_t((width + 1 + mask) >> blockLevel) * ((depth + 1 + mask) >> blockLevel) << (2 * blockLevel);
+#else
+  return size_t(width + 1) * (depth + 1);
+#endif
+}
+
+float HeightTile::getSampleScale(float height) {
+  return height / float(std::numeric_limits<uint16_t>::max());
+}
+
+uint16_t HeightTile::quantize(float intensity) {
+  return uint16_t(std::lround(std::clamp(intensity, 0.f, 1.f) * float(std::numeric_limits<uint16_t>::max())));
+}
+
+size_t HeightTile::getMemorySize() const {
+  auto size = sizeof(HeightTile) + ownedSamples.size() * sizeof(uint16_t) + pyramid.getMemorySize();
+#ifdef STORED_TRIANGLES
+  size += cells.size() * sizeof(Cell);
+#endif
+  return size;
+}
+
+void HeightTile::reportMemory(MemoryReport &report) const {
+  auto sampleBytes = getSampleCount(width, depth) * sizeof(uint16_t);
+  report.add(ownedSamples.empty() ? "mapped terrain caches" : "height samples", sampleBytes);
+  report.add("max-height pyramids", pyramid.getMemorySize());
+  report.add("mapped terrain caches", pyramid.getValueCount() * sizeof(float) - pyramid.getMemorySize());
+#ifdef STORED_TRIANGLES
+  report.add("stored triangles", cells.size() * sizeof(Cell));
+#endif
+}
+
+unsigned HeightTile::getWidth() const {
+  return width;
+}
+
+unsigned HeightTile::getDepth() const {
+  return depth;
+}
+
+const uint16_t *HeightTile::getSamples() const {
+  return samples;
+}
+
+const MaxHeightPyramid &HeightTile::getPyramid() const {
+  return pyramid;
+}
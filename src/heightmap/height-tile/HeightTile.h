@@ -0,0 +1,252 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "src/heightmap/cell/Cell.h"
+#include "src/heightmap/heightmap-reader/HeightSource.h"
+#include "src/heightmap/pyramid/MaxHeightPyramid.h"
+#include "src/memory-report/MemoryReport.h"
+#include "src/point/Point3d.h"
+
+/**
+ * Square part of the grid with its height samples and the lower levels of the max height pyramid
+ *
+ * Tile of n x n cells stores (n + 1) x (n + 1) samples, so the samples on the border are shared with the neighbouring tiles
+ * and every cell can be built from one tile. All coordinates are the coordinates in the whole grid.
+ * Samples and pyramid are either read from the source of the samples or mapped from the terrain cache file.
+ *
+ * Samples are stored by rows, unless the project is built with BLOCKED_LAYOUT, which stores them in square blocks of 8 x 8 samples
+ * (128 bytes) ordered by rows of the blocks. Neighbouring samples in both x and z then mostly share the cache line,
+ * so the rays walking along z do not load a new line on every step, at the cost of a few more operations per access.
+ */
+class HeightTile {
+  constexpr static const unsigned rowsPerTask = 32; // rows of the tile built by one task of the thread pool
+#ifdef BLOCKED_LAYOUT
+  constexpr static const unsigned blockLevel = 3; // blocks of the samples have 2^blockLevel x 2^blockLevel samples
+#endif
+
+  unsigned firstRow, firstCol, width, depth;
+  float sampleScale, sampleOffset;
+  std::vector<uint16_t> ownedSamples;
+  const uint16_t *samples; // in the layout of the tile, height = sampleOffset + sample * sampleScale
+  std::shared_ptr<const void> mapping; // keeps the mapped samples and pyramid alive
+  MaxHeightPyramid pyramid;
+#ifdef STORED_TRIANGLES
+  std::vector<Cell> cells;
+#endif
+
+  /**
+   * Build triangles of all cells if they are stored
+   * @param position - position of the grid
+   * @param cellWidth - width of the cell
+   * @param cellDepth - depth of the cell
+   */
+  void buildCells(const Point3d &position, float cellWidth, float cellDepth);
+
+  /**
+   * Get index of the sample in the array of the samples
+   * @param row - row of the sample in the tile
+   * @param col - column of the sample in the tile
+   * @return index in the layout of the tile
+   */
+  [[nodiscard]] size_t getSampleIndex(unsigned row, unsigned col) const {
+#ifdef BLOCKED_LAYOUT
+    constexpr auto mask = (1u << blockLevel) - 1;
+    auto blockColumns = (width + 1 + mask) >> blockLevel;
+    return ((size_t(row >> blockLevel) * blockColumns + (col >> blockLevel)) << (2 * blockLevel)) + ((row & mask) << blockLevel) + (col & mask);
+#else
+    return size_t(row) * (width + 1) + col;
+#endif
+  }
+
+  /**
+   * Build triangles of a rectangle of the cells if they are stored
+   * @param position - position of the grid
+   * @param cellWidth - width of the cell
+   * @param cellDepth - depth of the cell
+   * @param beginRow - first row of the cells in the grid
+   * @param endRow - row after the last row of the cells
+   * @param beginCol - first column of the cells in the grid
+   * @param endCol - column after the last column of the cells
+   */
+  void buildCells(const Point3d &position, float cellWidth, float cellDepth, unsigned beginRow, unsigned endRow, unsigned beginCol, unsigned endCol);
+
+public:
+  /**
+   * Read the tile from the source of the height samples
+   * @param source - source of the height samples of the whole grid
+   * @param firstRow - row of the first cell of the tile
+   * @param firstCol - column of the first cell of the tile
+   * @param width - number of the cell columns
+   * @param depth - number of the cell rows
+   * @param sampleScale - height of one quantization step of the samples
+   * @param sampleOffset - height of the zero sample
+   * @param position - position of the grid
+   * @param cellWidth - width of the cell
+   * @param cellDepth - depth of the cell
+   */
+  explicit HeightTile(const HeightSource &source, unsigned firstRow, unsigned firstCol, unsigned width, unsigned depth, float sampleScale, float sampleOffset,
+                      const Point3d &position, float cellWidth, float cellDepth);
+
+  /**
+   * Create tile from already built samples and pyramid, the arrays are not copied
+   * @param mapping - owner of the arrays, kept by the tile
+   * @param samples - getSampleCount samples in the layout of the tile
+   * @param pyramid - all levels of the maximal heights pyramid of the tile cells
+   * @param firstRow - row of the first cell of the tile
+   * @param firstCol - column of the first cell of the tile
+   * @param width - number of the cell columns
+   * @param depth - number of the cell rows
+   * @param sampleScale - height of one quantization step of the samples
+   * @param sampleOffset - height of the zero sample
+   * @param position - position of the grid
+   * @param cellWidth - width of the cell
+   * @param cellDepth - depth of the cell
+   */
+  explicit HeightTile(std::shared_ptr<const void> mapping, const uint16_t *samples, const float *pyramid, unsigned firstRow, unsigned firstCol, unsigned width, unsigned depth,
+                      float sampleScale, float sampleOffset, const Point3d &position, float cellWidth, float cellDepth);
+
+  HeightTile(const HeightTile &) = delete;
+  HeightTile &operator=(const HeightTile &) = delete;
+
+#ifdef BLOCKED_LAYOUT
+  constexpr static const uint32_t sampleLayout = 1; // layout of the samples written to the terrain cache, blocks of 8 x 8 samples
+#else
+  constexpr static const uint32_t sampleLayout = 0; // layout of the samples written to the terrain cache, rows
+#endif
+
+  /**
+   * Get number of the stored samples of the tile with given size, including the padding of the layout
+   * @param width - number of the cell columns
+   * @param depth - number of the cell rows
+   * @return length of the array of the samples
+   */
+  [[nodiscard]] static size_t getSampleCount(unsigned width, unsigned depth);
+
+  /**
+   * Quantize intensity of the height map to the 16-bit sample
+   * @param intensity - intensity in range 0 - 1 (clamped)
+   * @return sample
+   */
+  [[nodiscard]] static uint16_t quantize(float intensity);
+
+  /**
+   * Get height of one quantization step of the samples
+   * @param height - height of the whole height map
+   * @return scale of the samples
+   */
+  [[nodiscard]] static float getSampleScale(float height);
+
+  /**
+   * Replace a rectangle of the samples and compute again only the cells touching them and the pyramid blocks above these cells
+   * Mapped samples and pyramid are copied to memory before the first change, so the terrain cache file is never written
+   * @param firstRow - row of the first replaced sample in the grid
+   * @param firstCol - column of the first replaced sample in the grid
+   * @param rows - number of the replaced rows
+   * @param cols - number of the replaced columns
+   * @param intensities - rows * cols new intensities in range 0 - 1 by rows
+   * @param position - position of the grid
+   * @param cellWidth - width of the cell
+   * @param cellDepth - depth of the cell
+   */
+  void updateSamples(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const float *intensities, const Point3d &position, float cellWidth, float cellDepth);
+
+  /**
+   * Get height of the sample in the corner of the cells
+   * @param row - row of the sample in the grid
+   * @param col - column of the sample in the grid
+   * @return height at the sample
+   */
+  [[nodiscard]] float getSampleHeight(unsigned row, unsigned col) const {
+    return sampleOffset + float(samples[getSampleIndex(row - firstRow, col - firstCol)]) * sampleScale;
+  }
+
+  /**
+   * Get maximal height of the cell
+   * @param row - row of the cell in the grid
+   * @param col - column of the cell in the grid
+   * @return maximal height of the cell
+   */
+  [[nodiscard]] float getCellMaxHeight(unsigned row, unsigned col) const {
+    return pyramid.getCellMaxHeight(row - firstRow, col - firstCol);
+  }
+
+  /**
+   * Get maximal height of the block of the pyramid containing the cell, levels above the tile give the maximum of the whole tile
+   * @param level - level of the pyramid
+   * @param row - row of the cell in the grid
+   * @param col - column of the cell in the grid
+   * @return maximal height of the block
+   */
+  [[nodiscard]] float getBlockMaxHeight(unsigned level, unsigned row, unsigned col) const {
+    if (level >= pyramid.getLevelCount()) return pyramid.getTopMaxHeight();
+    return pyramid.getMaxHeight(level, (row - firstRow) >> level, (col - firstCol) >> level);
+  }
+
+  /**
+   * Get maximal height of the whole tile
+   * @return maximal height
+   */
+  [[nodiscard]] float getMaxHeight() const {
+    return pyramid.getTopMaxHeight();
+  }
+
+#ifdef STORED_TRIANGLES
+  /**
+   * Check if the triangles of the cells are stored, tiles loaded with the compact cells build them from the samples
+   * @return true if the cells can be taken from the tile
+   */
+  [[nodiscard]] bool hasStoredCells() const {
+    return !cells.empty();
+  }
+
+  /**
+   * Get stored cell
+   * @param row - row of the cell in the grid
+   * @param col - column of the cell in the grid
+   * @return cell with its triangles
+   */
+  [[nodiscard]] const Cell &getCell(unsigned row, unsigned col) const {
+    return cells[(row - firstRow) * width + col - firstCol];
+  }
+#endif
+
+  /**
+   * Get number of the cell columns
+   * @return width of the tile
+   */
+  [[nodiscard]] unsigned getWidth() const;
+
+  /**
+   * Get number of the cell rows
+   * @return depth of the tile
+   */
+  [[nodiscard]] unsigned getDepth() const;
+
+  /**
+   * Get quantized samples
+   * @return getSampleCount samples in the layout of the tile
+   */
+  [[nodiscard]] const uint16_t *getSamples() const;
+
+  /**
+   * Get pyramid of the maximal heights of the cells
+   * @return pyramid of the tile
+   */
+  [[nodiscard]] const MaxHeightPyramid &getPyramid() const;
+
+  /**
+   * Get memory used by the tile data
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getMemorySize() const;
+
+  /**
+   * Report memory of the samples, the pyramid and the stored triangles, the arrays mapped from the terrain cache are reported separately
+   * @param report - report where the memory is added
+   */
+  void reportMemory(MemoryReport &report) const;
+};
@@ -0,0 +1,48 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "DownsampledSource.h"
+
+DownsampledSource::DownsampledSource(const Grid &grid, float baseY, float height)
+  : grid(grid), baseY(baseY), height(height), width(grid.getGridWidth() / 2 + 1), depth(grid.getGridDepth() / 2 + 1) {}
+
+bool DownsampledSource::canDownsample(const Grid &grid) {
+  return grid.getGridWidth() >= 2 && grid.getGridDepth() >= 2;
+}
+
+void DownsampledSource::getAffectedRange(unsigned first, unsigned last, unsigned gridSize, unsigned size, unsigned &begin, unsigned &end) {
+  // sample i interpolates grid samples floor(i * gridSize / (size - 1)) and the following one, one sample more on both sides covers the rounding
+  auto previous = first > 0 ? uint64_t(first - 1) * (size - 1) / gridSize : 0;
+  begin = unsigned(previous > 0 ? previous - 1 : 0);
+  end = unsigned(std::min(uint64_t(size), (uint64_t(last) + 1) * (size - 1) / gridSize + 2));
+}
+
+void DownsampledSource::getAffectedSamples(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, unsigned &beginRow, unsigned &beginCol, unsigned &endRow, unsigned &endCol) const {
+  getAffectedRange(firstRow, firstRow + rows - 1, grid.getGridDepth(), depth, beginRow, endRow);
+  getAffectedRange(firstCol, firstCol + cols - 1, grid.getGridWidth(), width, beginCol, endCol);
+}
+
+unsigned DownsampledSource::getImageWidth() const {
+  return width;
+}
+
+unsigned DownsampledSource::getImageHeight() const {
+  return depth;
+}
+
+void DownsampledSource::readRow(unsigned row, unsigned firstCol, unsigned count, float *intensities) const {
+  // position of the sample in the grid samples, odd number of cells leaves the coarse cells slightly larger than two grid cells
+  auto z = float(row) * float(grid.getGridDepth()) / float(depth - 1);
+  auto row0 = std::min(unsigned(z), grid.getGridDepth() - 1);
+  auto fz = z - float(row0);
+  for (unsigned i = 0; i < count; i++) {
+    auto x = float(firstCol + i) * float(grid.getGridWidth()) / float(width - 1);
+    auto col0 = std::min(unsigned(x), grid.getGridWidth() - 1);
+    auto fx = x - float(col0);
+    auto near = grid.getSampleHeight(row0, col0) * (1.f - fx) + grid.getSampleHeight(row0, col0 + 1) * fx;
+    auto far = grid.getSampleHeight(row0 + 1, col0) * (1.f - fx) + grid.getSampleHeight(row0 + 1, col0 + 1) * fx;
+    auto intensity = ((near * (1.f - fz) + far * fz) - baseY) / height;
+    intensities[i] = std::min(std::max(intensity, 0.f), 1.f);
+  }
+}
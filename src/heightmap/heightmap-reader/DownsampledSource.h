@@ -0,0 +1,77 @@
+#pragma once
+
+#include "HeightSource.h"
+#include "src/heightmap/Grid.h"
+
+/**
+ * Source of height samples with half resolution of the grid, for the coarser levels of detail
+ *
+ * New samples cover the same area as the grid samples and are interpolated bilinearly between them
+ */
+class DownsampledSource : public HeightSource {
+  const Grid &grid;
+  const float baseY, height;
+  const unsigned width, depth; // number of samples in a row and number of rows
+
+  /**
+   * Find the samples interpolated from a range of the grid samples in one direction
+   * @param first - first grid sample of the range
+   * @param last - last grid sample of the range
+   * @param gridSize - number of the grid cells in the direction
+   * @param size - number of the samples of the source in the direction
+   * @param begin - where the first sample of the source is stored
+   * @param end - where the sample after the last sample of the source is stored
+   */
+  static void getAffectedRange(unsigned first, unsigned last, unsigned gridSize, unsigned size, unsigned &begin, unsigned &end);
+
+public:
+  /**
+   * Create source reading the grid, the grid has to exist while the source is read
+   * @param grid - grid with the full resolution samples
+   * @param baseY - height of the intensity 0
+   * @param height - difference of heights of intensities 0 and 1
+   */
+  explicit DownsampledSource(const Grid &grid, float baseY, float height);
+
+  /**
+   * Check if the grid has enough cells to be downsampled
+   * @param grid - grid with the full resolution samples
+   * @return true if there are at least two cells in both directions
+   */
+  [[nodiscard]] static bool canDownsample(const Grid &grid);
+
+  /**
+   * Find the rectangle of the samples interpolated from a rectangle of the grid samples, so only they are read again when the grid changes
+   * The rectangle can be slightly larger than needed, the additional samples are read unchanged
+   * @param firstRow - first row of the grid samples
+   * @param firstCol - first column of the grid samples
+   * @param rows - number of the rows of the grid samples
+   * @param cols - number of the columns of the grid samples
+   * @param beginRow - where the first row of the samples of the source is stored
+   * @param beginCol - where the first column of the samples of the source is stored
+   * @param endRow - where the row after the last row is stored
+   * @param endCol - where the column after the last column is stored
+   */
+  void getAffectedSamples(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, unsigned &beginRow, unsigned &beginCol, unsigned &endRow, unsigned &endCol) const;
+
+  /**
+   * Get width of the map
+   * @return number of samples in one row
+   */
+  [[nodiscard]] unsigned getImageWidth() const override;
+
+  /**
+   * Get height of the map
+   * @return number of rows
+   */
+  [[nodiscard]] unsigned getImageHeight() const override;
+
+  /**
+   * Read intensities of a part of one row, interpolated from the grid samples
+   * @param row - row to read
+   * @param firstCol - first column to read
+   * @param count - number of columns to read
+   * @param intensities - array with count values, where the intensities are stored
+   */
+  void readRow(unsigned row, unsigned firstCol, unsigned count, float *intensities) const override;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Source of height samples of the height map, that provides the samples row by row
+ *
+ * The grid reads the rows (or their parts for tiles of the grid) one after another, so the source does not need to keep the whole map in memory
+ */
+class HeightSource {
+public:
+  virtual ~HeightSource() = default;
+
+  /**
+   * Get width of the map in samples
+   * @return number of samples in one row
+   */
+  [[nodiscard]] virtual unsigned getImageWidth() const = 0;
+
+  /**
+   * Get height of the map in samples
+   * @return number of rows
+   */
+  [[nodiscard]] virtual unsigned getImageHeight() const = 0;
+
+  /**
+   * Read intensities (heights scaled to 0 - 1) of a part of one row
+   * @param row - row to read
+   * @param firstCol - first column to read
+   * @param count - number of columns to read
+   * @param intensities - array with count values, where the intensities are stored
+   */
+  virtual void readRow(unsigned row, unsigned firstCol, unsigned count, float *intensities) const = 0;
+
+  /**
+   * Get memory held by the source for the samples
+   * @return size in bytes, 0 for the sources reading the samples on demand
+   */
+  [[nodiscard]] virtual size_t getMemorySize() const {
+    return 0;
+  }
+};
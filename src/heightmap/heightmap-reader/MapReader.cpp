@@ -1,16 +1,77 @@
 #include "MapReader.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+#include "src/profiler/Profiler.h"
+#include "src/thread-pool/ThreadPool.h"
 
 void MapReader::readFormat(unsigned width, unsigned height, const unsigned char *pixels, const unsigned step) {
-  for (unsigned i = 0; i < width * height; ++i) {
-    unsigned char v = *pixels;
-    unsigned x = i / width;
-    unsigned y = i % width;
-    imageMatrix[x][y] = (float)v / (float)std::numeric_limits<unsigned char>::max();
-    pixels += step;
+  ThreadPool::getShared().parallelForChunks(height, rowsPerTask, [&](unsigned begin, unsigned end) {
+    for (auto i = size_t(begin) * width; i < size_t(end) * width; ++i) {
+      unsigned char v = pixels[i * step];
+      // 8-bit value v is scaled exactly to v / 255 of the 16-bit range
+      samples[i] = uint16_t(v * (std::numeric_limits<uint16_t>::max() / std::numeric_limits<unsigned char>::max()));
+    }
+  });
+}
+
+bool MapReader::isPgmFile(const std::string &fileName) {
+  auto dot = fileName.find_last_of('.');
+  if (dot == std::string::npos) return false;
+  auto extension = fileName.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+  return extension == "pgm";
+}
+
+void MapReader::readPgm(const std::string &fileName) {
+  std::ifstream file(fileName, std::ios::binary);
+  std::string magic;
+  file >> magic;
+  // header values may be separated by comments
+  auto readValue = [&file]() {
+    file >> std::ws;
+    while (file.peek() == '#') {
+      file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+      file >> std::ws;
+    }
+    long value = -1;
+    file >> value;
+    return value;
+  };
+  auto width = readValue(), height = readValue(), maxValue = readValue();
+  if (!file || magic != "P5" || width <= 0 || height <= 0 || maxValue <= 0 || maxValue > std::numeric_limits<uint16_t>::max()) {
+    std::cerr << "invalid file" << std::endl;
+    throw std::invalid_argument("received invalid file");
+  }
+  file.get(); // single whitespace before the pixels
+
+  imageWidth = unsigned(width);
+  imageHeight = unsigned(height);
+  samples.resize(size_t(imageWidth) * imageHeight);
+  auto sampleSize = maxValue > std::numeric_limits<unsigned char>::max() ? 2 : 1;
+  std::vector<unsigned char> row(size_t(imageWidth) * sampleSize);
+  for (unsigned y = 0; y < imageHeight; y++) {
+    if (!file.read(reinterpret_cast<char *>(row.data()), std::streamsize(row.size()))) {
+      std::cerr << "invalid file" << std::endl;
+      throw std::invalid_argument("received truncated file");
+    }
+    for (unsigned x = 0; x < imageWidth; x++) {
+      // 16-bit values are big endian
+      unsigned value = sampleSize == 2 ? unsigned(row[2 * x]) << 8u | row[2 * x + 1] : row[x];
+      value = std::min(unsigned(value), unsigned(maxValue));
+      samples[size_t(y) * imageWidth + x] = uint16_t((value * std::numeric_limits<uint16_t>::max() + unsigned(maxValue) / 2) / unsigned(maxValue));
+    }
   }
 }
 
 MapReader::MapReader(const std::string &fileName) {
+  Profiler::Scope scope("decode height map");
+  if (isPgmFile(fileName)) {
+    readPgm(fileName);
+    return;
+  }
+
   const auto fileName_c = fileName.c_str();
   corona::Image *img = corona::OpenImage(fileName_c);
   if (!img) {
@@ -22,8 +83,9 @@ MapReader::MapReader(const std::string &fileName) {
   int height = img->getHeight();
   auto *pixels = (unsigned char *) img->getPixels();
 
-  imageMatrix = std::vector<std::vector<float>>(height);
-  for (int i = 0; i < height; i++) imageMatrix[i] = std::vector<float>(width);
+  imageWidth = width;
+  imageHeight = height;
+  samples = std::vector<uint16_t>(size_t(width) * height);
 
   corona::PixelFormat format = img->getFormat();
   switch (format) {
@@ -39,6 +101,7 @@ MapReader::MapReader(const std::string &fileName) {
       readFormat(width, height, pixels, 4);
       break;
     default:
+      delete img;
       std::cerr << "invalid file type" << std::endl;
       throw std::invalid_argument("received invalid file type");
   }
@@ -46,13 +109,20 @@ MapReader::MapReader(const std::string &fileName) {
   delete img;
 }
 unsigned MapReader::getImageHeight() const {
-  if (imageMatrix.empty()) return 0;
-  return imageMatrix.size();
+  return imageHeight;
 }
 
 unsigned MapReader::getImageWidth() const {
-  return imageMatrix[0].size();
+  return imageWidth;
 }
 float MapReader::getIntensityAt(unsigned row, unsigned col) const {
-  return imageMatrix[row][col];
+  return float(samples[size_t(row) * imageWidth + col]) / float(std::numeric_limits<uint16_t>::max());
+}
+
+void MapReader::readRow(unsigned row, unsigned firstCol, unsigned count, float *intensities) const {
+  for (unsigned i = 0; i < count; i++) intensities[i] = getIntensityAt(row, firstCol + i);
+}
+
+size_t MapReader::getMemorySize() const {
+  return samples.size() * sizeof(uint16_t);
 }
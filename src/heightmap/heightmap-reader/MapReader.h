@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <utility>
@@ -7,11 +8,20 @@
 #include <iostream>
 #include <corona.h>
 
+#include "HeightSource.h"
+
 /**
- * Class for reading height map from file
+ * Class for reading height map from image file
+ *
+ * The whole image is decoded and kept in memory as 16-bit samples. Images are decoded by corona (8 bits per channel),
+ * binary PGM files (.pgm) with 8 or 16 bits per sample are read directly, so the 16-bit heights are not quantized.
  */
-class MapReader {
-  std::vector<std::vector<float>> imageMatrix;
+class MapReader : public HeightSource {
+  constexpr static const unsigned rowsPerTask = 64; // rows of the image converted by one task of the thread pool
+
+  unsigned imageWidth = 0, imageHeight = 0;
+  std::vector<uint16_t> samples; // by rows, 0 - 65535 is scaled to intensity 0 - 1
+
   /**
    * Reads intensities of pixels from gray / one of rgb channel determined by step
    * @param width - width of image
@@ -21,6 +31,19 @@ class MapReader {
    */
   void readFormat(unsigned width, unsigned height, const unsigned char *pixels, unsigned step);
 
+  /**
+   * Check if the file has extension of binary PGM
+   * @param fileName - name of the file
+   * @return true if the file should be read as PGM
+   */
+  static bool isPgmFile(const std::string &fileName);
+
+  /**
+   * Reads samples from binary (P5) PGM file with maximal value up to 65535
+   * @param fileName - name of the file
+   */
+  void readPgm(const std::string &fileName);
+
 public:
   /**
    * Reads map from given file and stores it inside imageMap;
@@ -32,13 +55,13 @@ public:
    * Get width of image
    * @return width of image (pixel width of file)
    */
-  [[nodiscard]] unsigned getImageWidth() const;
+  [[nodiscard]] unsigned getImageWidth() const override;
 
   /**
    * Get height of image
    * @return height of image (pixel height of file)
    */
-  [[nodiscard]] unsigned getImageHeight() const;
+  [[nodiscard]] unsigned getImageHeight() const override;
 
   /**
    * get intensity on queried position
@@ -47,4 +70,19 @@ public:
    * @return intensity at position
    */
   [[nodiscard]] float getIntensityAt(unsigned row, unsigned col) const;
+
+  /**
+   * Read intensities of a part of one row
+   * @param row - row to read
+   * @param firstCol - first column to read
+   * @param count - number of columns to read
+   * @param intensities - array with count values, where the intensities are stored
+   */
+  void readRow(unsigned row, unsigned firstCol, unsigned count, float *intensities) const override;
+
+  /**
+   * Get memory of the decoded samples
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getMemorySize() const override;
 };
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "RawMapReader.h"
+#include "src/thread-pool/ThreadPool.h"
+
+float RawMapReader::getSample(size_t index) const {
+  if (format == Format::UInt16) {
+    auto bytes = data + index * 2;
+    return float(unsigned(bytes[0]) | unsigned(bytes[1]) << 8u);
+  }
+  auto bytes = data + index * 4;
+  uint32_t bits = uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8u | uint32_t(bytes[2]) << 16u | uint32_t(bytes[3]) << 24u;
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+RawMapReader::RawMapReader(const std::string &fileName, Format format, unsigned width, unsigned height)
+  : format(format), file(fileName, true), data(file.getData()) {
+  size_t sampleSize = format == Format::UInt16 ? 2 : 4;
+  auto samples = file.getSize() / sampleSize;
+  if (width == 0) width = unsigned(std::lround(std::sqrt(double(samples))));
+  if (height == 0 && width != 0) height = unsigned(samples / width);
+  if (width < 2 || height < 2 || samples != size_t(width) * height) {
+    std::cerr << "size of the raw file does not match " << width << "x" << height << " samples" << std::endl;
+    throw std::invalid_argument("received raw file of invalid size");
+  }
+  this->width = width;
+  this->height = height;
+
+  if (format == Format::UInt16) {
+    scale = 1.f / float(std::numeric_limits<uint16_t>::max());
+    return;
+  }
+  // float samples are in meters, one pass finds range to scale them to intensities, rows are split between the tasks
+  std::vector<float> rowLow(height, std::numeric_limits<float>::infinity()), rowHigh(height, -std::numeric_limits<float>::infinity());
+  ThreadPool::getShared().parallelForChunks(height, rowsPerTask, [&](unsigned begin, unsigned end) {
+    for (auto row = begin; row < end; row++) {
+      for (auto i = size_t(row) * width; i < size_t(row + 1) * width; i++) {
+        auto sample = getSample(i);
+        if (!std::isfinite(sample)) continue;
+        rowLow[row] = std::min(rowLow[row], sample);
+        rowHigh[row] = std::max(rowHigh[row], sample);
+      }
+    }
+  });
+  auto low = *std::min_element(rowLow.begin(), rowLow.end()), high = *std::max_element(rowHigh.begin(), rowHigh.end());
+  if (low > high) {
+    std::cerr << "raw file does not contain any valid height" << std::endl;
+    throw std::invalid_argument("received raw file without heights");
+  }
+  minValue = low;
+  scale = high > low ? 1.f / (high - low) : 0.f;
+}
+
+bool RawMapReader::isRawFile(const std::string &fileName, Format &format) {
+  auto dot = fileName.find_last_of('.');
+  if (dot == std::string::npos) return false;
+  auto extension = fileName.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+  if (extension == "r16" || extension == "raw") {
+    format = Format::UInt16;
+    return true;
+  }
+  if (extension == "f32") {
+    format = Format::Float32;
+    return true;
+  }
+  return false;
+}
+
+unsigned RawMapReader::getImageWidth() const {
+  return width;
+}
+
+unsigned RawMapReader::getImageHeight() const {
+  return height;
+}
+
+void RawMapReader::readRow(unsigned row, unsigned firstCol, unsigned count, float *intensities) const {
+  auto first = size_t(row) * width + firstCol;
+  for (unsigned i = 0; i < count; i++) {
+    auto sample = getSample(first + i);
+    intensities[i] = std::isfinite(sample) ? (sample - minValue) * scale : 0.f; // missing data lie on the lowest height
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <iostream>
+
+#include "HeightSource.h"
+#include "src/mapped-file/MappedFile.h"
+
+/**
+ * Class for reading height map from raw file of 16-bit unsigned integers or 32-bit floats (little endian, by rows, without header)
+ *
+ * The file is memory-mapped and rows are converted only when they are read, so the samples are not held in memory
+ * by the reader - the operating system pages in the parts of the file that are being read
+ */
+class RawMapReader : public HeightSource {
+public:
+  /**
+   * Type of one sample in the file
+   */
+  enum class Format {
+    UInt16, Float32
+  };
+
+private:
+  constexpr static const unsigned rowsPerTask = 64; // rows of the file scanned by one task of the thread pool
+
+  const Format format;
+  MappedFile file;
+  const unsigned char *data;
+  unsigned width = 0, height = 0;
+  float minValue = 0.f, scale = 1.f;
+
+  /**
+   * Read one sample as stored in the file
+   * @param index - index of the sample (row * width + column)
+   * @return sample value
+   */
+  [[nodiscard]] float getSample(size_t index) const;
+
+public:
+  /**
+   * Map the raw height map file
+   * 16-bit samples are scaled from the whole 0 - 65535 range, float samples from the minimum - maximum of the file
+   * @param fileName - name of the file
+   * @param format - type of the samples
+   * @param width - number of samples in a row, 0 if the map is square
+   * @param height - number of rows, 0 to compute it from the file size and the width
+   */
+  explicit RawMapReader(const std::string &fileName, Format format, unsigned width = 0, unsigned height = 0);
+
+  /**
+   * Check if the file has an extension of the raw height map (.r16, .raw for 16-bit, .f32 for float samples)
+   * @param fileName - name of the file
+   * @param format - where the format given by the extension is stored
+   * @return true if the file is raw height map
+   */
+  static bool isRawFile(const std::string &fileName, Format &format);
+
+  /**
+   * Get width of the map
+   * @return number of samples in one row
+   */
+  [[nodiscard]] unsigned getImageWidth() const override;
+
+  /**
+   * Get height of the map
+   * @return number of rows
+   */
+  [[nodiscard]] unsigned getImageHeight() const override;
+
+  /**
+   * Read intensities of a part of one row, converted from the mapped file
+   * @param row - row to read
+   * @param firstCol - first column to read
+   * @param count - number of columns to read
+   * @param intensities - array with count values, where the intensities are stored
+   */
+  void readRow(unsigned row, unsigned firstCol, unsigned count, float *intensities) const override;
+};
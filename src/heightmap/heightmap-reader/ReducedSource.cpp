@@ -0,0 +1,47 @@
+#include <algorithm>
+#include <vector>
+
+#include "ReducedSource.h"
+
+ReducedSource::ReducedSource(std::shared_ptr<const HeightSource> source, unsigned factor)
+  : source(std::move(source)), width((this->source->getImageWidth() - 1) / factor + 1), depth((this->source->getImageHeight() - 1) / factor + 1) {}
+
+bool ReducedSource::canReduce(const HeightSource &source, unsigned factor) {
+  return source.getImageWidth() > factor && source.getImageHeight() > factor;
+}
+
+unsigned ReducedSource::getImageWidth() const {
+  return width;
+}
+
+unsigned ReducedSource::getImageHeight() const {
+  return depth;
+}
+
+void ReducedSource::readRow(unsigned row, unsigned firstCol, unsigned count, float *intensities) const {
+  if (count == 0) return;
+  auto sourceWidth = source->getImageWidth(), sourceDepth = source->getImageHeight();
+  // position of the sample in the source samples, the last sample lies on the last sample of the source
+  auto z = float(row) * float(sourceDepth - 1) / float(depth - 1);
+  auto row0 = std::min(unsigned(z), sourceDepth - 2);
+  auto fz = z - float(row0);
+  auto getX = [&](unsigned col) { return float(col) * float(sourceWidth - 1) / float(width - 1); };
+  auto begin = std::min(unsigned(getX(firstCol)), sourceWidth - 2);
+  auto end = std::min(unsigned(getX(firstCol + count - 1)), sourceWidth - 2) + 2;
+  std::vector<float> near(end - begin), far(end - begin);
+  source->readRow(row0, begin, end - begin, near.data());
+  source->readRow(row0 + 1, begin, end - begin, far.data());
+  for (unsigned i = 0; i < count; i++) {
+    auto x = getX(firstCol + i);
+    auto col0 = std::min(unsigned(x), sourceWidth - 2);
+    auto fx = x - float(col0);
+    auto index = col0 - begin;
+    auto top = near[index] * (1.f - fx) + near[index + 1] * fx;
+    auto bottom = far[index] * (1.f - fx) + far[index + 1] * fx;
+    intensities[i] = top * (1.f - fz) + bottom * fz;
+  }
+}
+
+size_t ReducedSource::getMemorySize() const {
+  return source->getMemorySize();
+}
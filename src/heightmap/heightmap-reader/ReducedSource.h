@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "HeightSource.h"
+
+/**
+ * Source of height samples with the resolution of another source reduced by a factor, for the maps which do not fit the memory budget
+ *
+ * New samples cover the same area as the samples of the source and are interpolated bilinearly between them. Rows are read from the source
+ * on demand, so the reduced grid is built without the full resolution grid.
+ */
+class ReducedSource : public HeightSource {
+  std::shared_ptr<const HeightSource> source;
+  unsigned width, depth; // number of samples in a row and number of rows
+
+public:
+  /**
+   * Create source reading the other source, the source has to be reducible by the factor
+   * @param source - source with the full resolution samples, it is kept by the reduced source
+   * @param factor - number of the source cells in one cell of the reduced source
+   */
+  explicit ReducedSource(std::shared_ptr<const HeightSource> source, unsigned factor);
+
+  /**
+   * Check if the source keeps at least one cell in both directions after the reduction
+   * @param source - source with the full resolution samples
+   * @param factor - number of the source cells in one reduced cell
+   * @return true if the source can be reduced
+   */
+  [[nodiscard]] static bool canReduce(const HeightSource &source, unsigned factor);
+
+  /**
+   * Get width of the map
+   * @return number of samples in one row
+   */
+  [[nodiscard]] unsigned getImageWidth() const override;
+
+  /**
+   * Get height of the map
+   * @return number of rows
+   */
+  [[nodiscard]] unsigned getImageHeight() const override;
+
+  /**
+   * Read intensities of a part of one row, interpolated from the samples of the source
+   * @param row - row to read
+   * @param firstCol - first column to read
+   * @param count - number of columns to read
+   * @param intensities - array with count values, where the intensities are stored
+   */
+  void readRow(unsigned row, unsigned firstCol, unsigned count, float *intensities) const override;
+
+  /**
+   * Get memory held by the full resolution source
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getMemorySize() const override;
+};
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numbers>
+#include <stdexcept>
+
+#include "HorizonMap.h"
+#include "src/heightmap/terrain-cache/TerrainCache.h"
+
+HorizonMap::HorizonMap(unsigned width, unsigned depth, unsigned directions)
+  : width(width), depth(depth), directions(directions), angles(size_t(width + 1) * (depth + 1) * directions, 0) {}
+
+HorizonMap::HorizonMap(const std::string &cachePath) {
+  std::ifstream in(cachePath, std::ios::binary);
+  Header header{};
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) || std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0
+    || header.version != version || header.byteOrder != byteOrderMark) {
+    std::cerr << "invalid horizon cache file " << cachePath << std::endl;
+    throw std::invalid_argument("received invalid horizon cache file");
+  }
+  width = header.gridWidth;
+  depth = header.gridDepth;
+  directions = header.directions;
+  angles.resize(size_t(width + 1) * (depth + 1) * directions);
+  if (!in.read(reinterpret_cast<char *>(angles.data()), std::streamsize(angles.size()))) {
+    std::cerr << "invalid horizon cache file " << cachePath << std::endl;
+    throw std::invalid_argument("received invalid horizon cache file");
+  }
+}
+
+bool HorizonMap::isValid(const std::string &cachePath, const std::string &sourcePath, unsigned gridWidth, unsigned gridDepth, unsigned directions, const Vector3d &size) {
+  std::ifstream in(cachePath, std::ios::binary);
+  Header stored{};
+  if (!in.read(reinterpret_cast<char *>(&stored), sizeof(stored))) return false;
+  uint64_t sourceSize;
+  int64_t sourceTime;
+  if (!TerrainCache::getSourceStamp(sourcePath, sourceSize, sourceTime)) return false;
+  return std::memcmp(stored.magic, fileMagic, sizeof(fileMagic)) == 0 && stored.version == version && stored.byteOrder == byteOrderMark
+    && stored.sourceSize == sourceSize && stored.sourceTime == sourceTime
+    && stored.gridWidth == gridWidth && stored.gridDepth == gridDepth && stored.directions == directions
+    && stored.width == size.getX() && stored.height == size.getY() && stored.depth == size.getZ();
+}
+
+void HorizonMap::save(const std::string &cachePath, const std::string &sourcePath, const Vector3d &size) const {
+  Header header{};
+  std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+  header.version = version;
+  header.byteOrder = byteOrderMark;
+  header.gridWidth = width;
+  header.gridDepth = depth;
+  header.directions = directions;
+  header.width = size.getX();
+  header.height = size.getY();
+  header.depth = size.getZ();
+  if (!TerrainCache::getSourceStamp(sourcePath, header.sourceSize, header.sourceTime)) {
+    std::cerr << "source of the horizon cache " << sourcePath << " does not exist" << std::endl;
+    throw std::invalid_argument("received invalid horizon cache source");
+  }
+
+  // written to the temporary file first, so the interrupted write does not leave broken cache
+  auto temporaryPath = cachePath + ".tmp";
+  {
+    std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(angles.data()), std::streamsize(angles.size()));
+    if (!out) {
+      std::cerr << "horizon cache " << cachePath << " can not be written" << std::endl;
+      throw std::invalid_argument("received horizon cache path that can not be written");
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporaryPath, cachePath, error);
+  if (error) {
+    std::filesystem::remove(temporaryPath, error);
+    std::cerr << "horizon cache " << cachePath << " can not be written" << std::endl;
+    throw std::invalid_argument("received horizon cache path that can not be written");
+  }
+}
+
+unsigned HorizonMap::getDirections() const {
+  return directions;
+}
+
+bool HorizonMap::hasGridSize(unsigned gridWidth, unsigned gridDepth) const {
+  return width == gridWidth && depth == gridDepth;
+}
+
+void HorizonMap::set(unsigned row, unsigned col, unsigned direction, float angle) {
+  auto normalized = std::clamp(angle / std::numbers::pi_v<float> + .5f, 0.f, 1.f);
+  angles[(size_t(row) * (width + 1) + col) * directions + direction] = uint8_t(std::lround(normalized * quantizationScale));
+}
+
+float HorizonMap::getAngle(unsigned row, unsigned col, unsigned direction) const {
+  auto quantized = angles[(size_t(row) * (width + 1) + col) * directions + direction];
+  return (float(quantized) / quantizationScale - .5f) * std::numbers::pi_v<float>;
+}
+
+float HorizonMap::getAngle(unsigned row, unsigned col, unsigned direction, float fraction) const {
+  auto next = direction + 1 == directions ? 0 : direction + 1;
+  return getAngle(row, col, direction) * (1.f - fraction) + getAngle(row, col, next) * fraction;
+}
+
+bool HorizonMap::isBelowHorizon(float x, float z, const Vector3d &toLight) const {
+  auto horizontal = std::sqrt(toLight.getX() * toLight.getX() + toLight.getZ() * toLight.getZ());
+  auto elevation = std::atan2(toLight.getY(), horizontal);
+
+  auto azimuth = std::atan2(toLight.getZ(), toLight.getX());
+  if (azimuth < 0.f) azimuth += 2.f * std::numbers::pi_v<float>;
+  auto position = azimuth / (2.f * std::numbers::pi_v<float>) * float(directions);
+  auto direction = std::min(unsigned(position), directions - 1);
+  auto fraction = position - float(direction);
+
+  x = std::clamp(x, 0.f, float(width));
+  z = std::clamp(z, 0.f, float(depth));
+  auto col = std::min(unsigned(x), width - 1), row = std::min(unsigned(z), depth - 1);
+  auto fx = x - float(col), fz = z - float(row);
+  auto top = getAngle(row, col, direction, fraction) * (1.f - fx) + getAngle(row, col + 1, direction, fraction) * fx;
+  auto bottom = getAngle(row + 1, col, direction, fraction) * (1.f - fx) + getAngle(row + 1, col + 1, direction, fraction) * fx;
+  return elevation < top * (1.f - fz) + bottom * fz;
+}
+
+size_t HorizonMap::getMemorySize() const {
+  return angles.size();
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/vector/Vector3d.h"
+
+/**
+ * Horizon angles of the grid samples in evenly spaced azimuth directions, so the shadow of the terrain is found without a traversal
+ *
+ * Horizon angle is the maximal elevation of the terrain seen from the sample in the direction, quantized to 8 bits over [-pi/2, pi/2].
+ * The light is treated as lying beyond the whole height map, terrain between the light and the far border can shadow the point too.
+ * Directions of every sample are stored together, direction d has azimuth 2 pi d / directions measured from x towards z.
+ *
+ * Horizon map can be saved to the cache file, which stores the source file stamp and the map size, so it is rebuilt when either changes.
+ */
+class HorizonMap {
+  /**
+   * Header at the start of the cache file, the angles follow it
+   */
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder; // byteOrderMark written in the order of the machine which created the file
+    uint32_t gridWidth, gridDepth, directions;
+    float width, height, depth;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+  };
+
+  constexpr static const char fileMagic[8] = "HFHORZ1";
+  constexpr static const uint32_t version = 1;
+  constexpr static const uint32_t byteOrderMark = 0x01020304;
+  constexpr static const float quantizationScale = 255.f; // maximal quantized angle
+
+  unsigned width, depth, directions; // width and depth in cells, angles are stored for (width + 1) x (depth + 1) samples
+  std::vector<uint8_t> angles; // quantized angles by rows of the samples, all directions of the sample together
+
+  /**
+   * Get angle stored in the sample
+   * @param row - row of the sample
+   * @param col - column of the sample
+   * @param direction - index of the direction
+   * @return horizon angle in radians
+   */
+  [[nodiscard]] float getAngle(unsigned row, unsigned col, unsigned direction) const;
+
+  /**
+   * Get horizon angle of the sample between two stored directions
+   * @param row - row of the sample
+   * @param col - column of the sample
+   * @param direction - first direction
+   * @param fraction - part of the way to the following direction
+   * @return interpolated horizon angle in radians
+   */
+  [[nodiscard]] float getAngle(unsigned row, unsigned col, unsigned direction, float fraction) const;
+
+public:
+  /**
+   * Create horizon map of given size with all angles pointing down, so all points are lit
+   * @param width - number of the cell columns
+   * @param depth - number of the cell rows
+   * @param directions - number of the azimuth directions
+   */
+  explicit HorizonMap(unsigned width, unsigned depth, unsigned directions);
+
+  /**
+   * Read the horizon map from the cache file, the file has to be valid
+   * @param cachePath - path of the cache file
+   */
+  explicit HorizonMap(const std::string &cachePath);
+
+  /**
+   * Check that the cache file exists and was built with the current format from the current source with the same grid and size
+   * @param cachePath - path of the cache file
+   * @param sourcePath - path of the height map which was used to build the horizon map
+   * @param gridWidth - number of the cell columns
+   * @param gridDepth - number of the cell rows
+   * @param directions - number of the azimuth directions
+   * @param size - vector storing width, depth and height of the height map
+   * @return true if the cache can be used
+   */
+  static bool isValid(const std::string &cachePath, const std::string &sourcePath, unsigned gridWidth, unsigned gridDepth, unsigned directions, const Vector3d &size);
+
+  /**
+   * Write the horizon map to the cache file
+   * @param cachePath - path of the cache file
+   * @param sourcePath - path of the height map which the horizon map was built from
+   * @param size - vector storing width, depth and height of the height map
+   */
+  void save(const std::string &cachePath, const std::string &sourcePath, const Vector3d &size) const;
+
+  /**
+   * Get number of the azimuth directions
+   * @return number of the directions
+   */
+  [[nodiscard]] unsigned getDirections() const;
+
+  /**
+   * Check if the horizon map was built for the grid of given size
+   * @param gridWidth - number of the cell columns
+   * @param gridDepth - number of the cell rows
+   * @return true if the map has the samples of the grid
+   */
+  [[nodiscard]] bool hasGridSize(unsigned gridWidth, unsigned gridDepth) const;
+
+  /**
+   * Store horizon angle of the sample
+   * @param row - row of the sample (0 to grid depth)
+   * @param col - column of the sample (0 to grid width)
+   * @param direction - index of the direction
+   * @param angle - horizon angle in radians
+   */
+  void set(unsigned row, unsigned col, unsigned direction, float angle);
+
+  /**
+   * Find if the light in given direction is below the horizon, the horizon is interpolated from the four corners of the cell
+   * and the two nearest directions
+   * @param x - column coordinate in the grid (in cells)
+   * @param z - row coordinate in the grid (in cells)
+   * @param toLight - vector from the point to the light (in world units)
+   * @return true if the horizon hides the light
+   */
+  [[nodiscard]] bool isBelowHorizon(float x, float z, const Vector3d &toLight) const;
+
+  /**
+   * Get memory used by the quantized angles
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getMemorySize() const;
+};
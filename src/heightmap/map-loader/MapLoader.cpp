@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "MapLoader.h"
+#include "src/heightmap/heightmap-reader/MapReader.h"
+#include "src/heightmap/heightmap-reader/RawMapReader.h"
+#include "src/heightmap/heightmap-reader/ReducedSource.h"
+#include "src/memory-report/MemoryReport.h"
+#include "src/profiler/Profiler.h"
+#include "src/scene.h"
+
+MapLoader::MapLoader(std::vector<Request> requests, unsigned rawWidth, unsigned rawHeight, std::string horizonCachePath)
+  : requests(std::move(requests)), rawWidth(rawWidth), rawHeight(rawHeight), horizonCachePath(std::move(horizonCachePath)) {
+  readThread = std::thread(&MapLoader::readLoop, this);
+  buildThread = std::thread(&MapLoader::buildLoop, this);
+}
+
+MapLoader::~MapLoader() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  changed.notify_all();
+  readThread.join();
+  buildThread.join();
+}
+
+unsigned MapLoader::getMapCount() const {
+  return requests.size();
+}
+
+void MapLoader::fail() {
+  {
+    std::lock_guard lock(mutex);
+    if (!error) error = std::current_exception();
+    finished = true;
+  }
+  changed.notify_all();
+}
+
+void MapLoader::readLoop() {
+  Profiler::setThreadName("map reader");
+  try {
+    Decoded previous{};
+    for (unsigned i = 0; i < requests.size(); i++) {
+      auto item = decode(i, i > 0 ? &previous : nullptr);
+      std::unique_lock lock(mutex);
+      changed.wait(lock, [this] { return stopping || finished || decoded.size() < decodedQueueLength; });
+      if (stopping || finished) return;
+      decoded.push_back(item);
+      updatePeakSourceMemory();
+      lock.unlock();
+      changed.notify_all();
+      previous = std::move(item);
+    }
+  } catch (...) {
+    fail();
+  }
+}
+
+void MapLoader::buildLoop() {
+  Profiler::setThreadName("map builder");
+  try {
+    std::shared_ptr<const HorizonMap> horizonMap;
+    for (unsigned i = 0; i < requests.size(); i++) {
+      Decoded item;
+      {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [this] { return stopping || finished || !decoded.empty(); });
+        if (stopping || finished) return;
+        item = std::move(decoded.front());
+        decoded.pop_front();
+        buildingSource = item.source.get();
+        buildingSourceMemory = item.source ? item.source->getMemorySize() : 0;
+      }
+      changed.notify_all();
+      auto heightMap = build(item, horizonMap);
+      item = Decoded{}; // decoded samples are not kept while the next map is waited for
+      {
+        std::lock_guard lock(mutex);
+        buildingSource = nullptr;
+        buildingSourceMemory = 0;
+        readyMaps.emplace_back(std::move(heightMap));
+        finished = i + 1 == requests.size();
+      }
+      changed.notify_all();
+    }
+  } catch (...) {
+    fail();
+  }
+}
+
+MapLoader::Decoded MapLoader::decode(unsigned request, const Decoded *previous) const {
+  const auto &[path, position, size, material, terrainCachePath, bilinearPatches] = requests[request];
+  Decoded item{request, nullptr, nullptr};
+  if (scene::terrainTileSize == 0 && !terrainCachePath.empty() && TerrainCache::isValid(terrainCachePath, path, position, size)) {
+    item.cache = std::make_shared<const TerrainCache>(terrainCachePath);
+    return item;
+  }
+  if (previous != nullptr && previous->source && requests[previous->request].path == path) {
+    item.source = previous->source;
+    return item;
+  }
+  // raw maps are memory-mapped, the grid streams them row by row and the tiles read only the used parts from the disk
+  RawMapReader::Format rawFormat;
+  if (RawMapReader::isRawFile(path, rawFormat)) item.source = std::make_shared<const RawMapReader>(path, rawFormat, rawWidth, rawHeight);
+  else item.source = std::make_shared<const MapReader>(path);
+  return item;
+}
+
+HeightMap MapLoader::build(const Decoded &item, std::shared_ptr<const HorizonMap> &horizonMap) {
+  const auto &[path, position, size, material, terrainCachePath, bilinearPatches] = requests[item.request];
+  auto plan = planMemory(item);
+  if (plan.compactCells) scene::compactCells = true; // tiles of the following maps are compact too, they would not fit either
+  auto heightMap = [&] {
+    if (item.cache) return HeightMap(*item.cache, position, size, material);
+    auto source = plan.reduction > 1 ? std::make_shared<const ReducedSource>(item.source, plan.reduction) : item.source;
+    if (plan.outOfCore) return HeightMap(source, plan.tileSize, plan.cacheBudget, position, size, material);
+    return HeightMap(*source, position, size, material);
+  }();
+  heightMap.setBilinearPatches(bilinearPatches);
+  if (plan.optionalStructures && scene::smoothNormals) {
+    // normals of the mapped cache are copied, the built ones are saved with the new cache below
+    if (item.cache) heightMap.loadVertexNormals(*item.cache);
+    else heightMap.buildVertexNormals();
+  }
+  // reduced grid would be taken for the full resolution one by the next run
+  if (!item.cache && !plan.outOfCore && plan.reduction == 1 && !terrainCachePath.empty()) {
+    heightMap.saveTerrainCache(terrainCachePath, path);
+    std::cout << "terrain cache saved to " << terrainCachePath << std::endl;
+  }
+
+  if (plan.optionalStructures && scene::detailLevels > 0) heightMap.buildDetailLevels(scene::detailLevels);
+  if (scene::heightCeiling) heightMap.buildCeiling();
+  if (plan.optionalStructures && scene::horizonDirections > 0) {
+    // copies of the first grid share its horizon map, other maps of the scene build their own without the cache
+    const auto &first = requests[0];
+    if (item.request == 0) {
+      loadHorizonMap(path, size, heightMap);
+      horizonMap = heightMap.getHorizonMap();
+    } else if (path == first.path && size.getX() == first.size.getX() && size.getY() == first.size.getY() && size.getZ() == first.size.getZ()
+      && horizonMap && horizonMap->hasGridSize(heightMap.getGridWidth(), heightMap.getGridDepth())) {
+      heightMap.setHorizonMap(horizonMap);
+    } else {
+      heightMap.buildHorizonMap(scene::horizonDirections);
+    }
+  }
+  MemoryReport report;
+  heightMap.reportMemory(report);
+  // out-of-core map takes its whole cache budget when the tiles are loaded
+  auto memory = report.getTotal();
+  if (plan.outOfCore) memory = std::max(memory, estimateMemorySize(*item.source, plan));
+  builtMemory += memory;
+  return heightMap;
+}
+
+size_t MapLoader::estimateMemorySize(const HeightSource &source, const Plan &plan) {
+  if (plan.outOfCore) return source.getMemorySize() + plan.cacheBudget;
+  auto gridWidth = (source.getImageWidth() - 1) / plan.reduction, gridDepth = (source.getImageHeight() - 1) / plan.reduction;
+  auto optional = plan.optionalStructures;
+  return HeightMap::estimateMemorySize(gridWidth, gridDepth, !plan.compactCells, optional ? scene::detailLevels : 0, optional && scene::smoothNormals,
+    optional ? scene::horizonDirections : 0);
+}
+
+MapLoader::Plan MapLoader::planMemory(const Decoded &item) const {
+  Plan plan;
+  plan.outOfCore = scene::terrainTileSize > 0;
+  plan.tileSize = scene::terrainTileSize;
+  plan.cacheBudget = size_t(scene::tileCacheMegabytes) * 1024 * 1024;
+  plan.compactCells = scene::compactCells;
+  // mapped terrain cache is paged in by the operating system, it is not limited by the budget
+  if (scene::memoryBudgetMegabytes == 0 || item.cache) return plan;
+
+  const auto &path = requests[item.request].path;
+  const auto &source = *item.source;
+  auto budget = size_t(scene::memoryBudgetMegabytes) * 1024 * 1024;
+  auto available = budget > builtMemory ? budget - builtMemory : 0;
+  auto fits = [&](const char *representation) {
+    if (estimateMemorySize(source, plan) > available) return false;
+    if (representation != nullptr) std::cout << "height map " << path << " is loaded " << representation << " to fit the memory budget" << std::endl;
+    return true;
+  };
+  if (fits(nullptr)) return plan;
+  plan.optionalStructures = false;
+  if (fits("without the levels of detail, normals and horizon map")) return plan;
+#ifdef STORED_TRIANGLES
+  plan.compactCells = true;
+  if (fits("with the cells built from the samples")) return plan;
+#endif
+
+  // tiles are read from the source on demand, the cache gets the memory the source leaves
+  auto sourceMemory = source.getMemorySize();
+  if (!plan.outOfCore) plan.tileSize = budgetTileSize;
+  auto tileMemory = Grid::estimateMemorySize(plan.tileSize, plan.tileSize, !plan.compactCells);
+  if (available > sourceMemory && available - sourceMemory >= minimalCachedTiles * tileMemory) {
+    plan.outOfCore = true;
+    plan.cacheBudget = std::min(plan.cacheBudget, available - sourceMemory);
+    if (fits("in the out-of-core tiles")) return plan;
+  }
+
+  plan.outOfCore = false;
+  for (plan.reduction = 2; ReducedSource::canReduce(source, plan.reduction); plan.reduction *= 2) {
+    auto representation = "with 1/" + std::to_string(plan.reduction) + " of the resolution";
+    if (fits(representation.c_str())) return plan;
+  }
+  std::cerr << "height map " << path << " does not fit the memory budget of " << scene::memoryBudgetMegabytes << " MB" << std::endl;
+  throw std::invalid_argument("received memory budget too small for the height map");
+}
+
+void MapLoader::updatePeakSourceMemory() {
+  auto memory = buildingSourceMemory;
+  const void *previous = buildingSource;
+  for (const auto &item : decoded) {
+    // requests of the same path hold one source
+    if (!item.source || item.source.get() == previous || item.source.get() == buildingSource) continue;
+    memory += item.source->getMemorySize();
+    previous = item.source.get();
+  }
+  peakSourceMemory = std::max(peakSourceMemory, memory);
+}
+
+size_t MapLoader::getPeakSourceMemory() {
+  std::lock_guard lock(mutex);
+  return peakSourceMemory;
+}
+
+void MapLoader::loadHorizonMap(const std::string &path, const Vector3d &size, HeightMap &heightMap) const {
+  if (heightMap.isOutOfCore()) return;
+  if (!horizonCachePath.empty() && HorizonMap::isValid(horizonCachePath, path, heightMap.getGridWidth(), heightMap.getGridDepth(), scene::horizonDirections, size)) {
+    heightMap.setHorizonMap(std::make_shared<const HorizonMap>(horizonCachePath));
+    return;
+  }
+  heightMap.buildHorizonMap(scene::horizonDirections);
+  if (!horizonCachePath.empty()) {
+    heightMap.getHorizonMap()->save(horizonCachePath, path, size);
+    std::cout << "horizon cache saved to " << horizonCachePath << std::endl;
+  }
+}
+
+bool MapLoader::takeReadyMaps(std::vector<HeightMap> &heightMaps) {
+  std::lock_guard lock(mutex);
+  if (error) std::rethrow_exception(error);
+  if (readyMaps.empty()) return false;
+  for (auto &heightMap : readyMaps) heightMaps.emplace_back(std::move(heightMap));
+  takenMaps += readyMaps.size();
+  readyMaps.clear();
+  return true;
+}
+
+void MapLoader::waitForMaps(std::vector<HeightMap> &heightMaps, unsigned count) {
+  std::unique_lock lock(mutex);
+  changed.wait(lock, [this, count] { return error || takenMaps + readyMaps.size() >= count; });
+  lock.unlock();
+  takeReadyMaps(heightMaps);
+}
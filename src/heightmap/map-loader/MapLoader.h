@@ -0,0 +1,191 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/heightmap/HeightMap.h"
+#include "src/heightmap/heightmap-reader/HeightSource.h"
+#include "src/heightmap/terrain-cache/TerrainCache.h"
+#include "src/material/Material.h"
+#include "src/point/Point3d.h"
+
+/**
+ * Loader of the scene height maps in the background, decoding of the next map overlaps the grid building of the previous one
+ *
+ * The read thread decodes the height map files (or reads the terrain caches) in the order of the requests, the build thread builds
+ * the grids and the optional structures of the scene options (levels of detail, normals, ceiling and horizon map) from them.
+ * Requests with the same path share one decoded source. Ready maps are taken in the order of the requests, so the rendering can
+ * start with the first map while the others are still loaded.
+ *
+ * With the memory budget every map is built in the first representation which fits the memory left by the previous maps: as requested,
+ * without the optional structures, with the compact cells, in the out-of-core tiles and finally with the resolution halved until it fits.
+ * The decoded image is needed while the grid is built, so the budget bounds the memory of the built maps, not the peak of the loading.
+ */
+class MapLoader {
+public:
+  /**
+   * Height map to load
+   */
+  struct Request {
+    std::string path;
+    Point3d position;
+    Vector3d size; // width, height and depth of the map
+    Material material;
+    std::string terrainCachePath; // binary file with the built grid, empty if it should not be used
+    bool bilinearPatches = false; // cells are intersected as the bilinear patches instead of the triangles
+  };
+
+private:
+  /**
+   * Decoded height map waiting for the build thread
+   */
+  struct Decoded {
+    unsigned request;
+    std::shared_ptr<const HeightSource> source; // null when the grid is read from the terrain cache
+    std::shared_ptr<const TerrainCache> cache;
+  };
+
+  /**
+   * Representation of the height map chosen by the memory budget
+   */
+  struct Plan {
+    unsigned reduction = 1; // number of the source cells in one cell of the grid
+    bool outOfCore = false;
+    unsigned tileSize = 0; // cells in the side of the out-of-core tile
+    size_t cacheBudget = 0; // memory of the out-of-core tiles in bytes
+    bool optionalStructures = true; // levels of detail, normals and horizon map of the scene options
+    bool compactCells = false; // triangles are built from the samples even when built with STORED_TRIANGLES
+  };
+
+  constexpr static const unsigned decodedQueueLength = 2; // decoded maps waiting for the build, limits the memory of the decoded samples
+  constexpr static const unsigned budgetTileSize = 256; // tile size of the out-of-core maps chosen by the budget without --terrain-tiles
+  constexpr static const unsigned minimalCachedTiles = 4; // out-of-core representation is used only if the cache holds this number of tiles
+
+  std::vector<Request> requests;
+  unsigned rawWidth, rawHeight;
+  std::string horizonCachePath;
+
+  std::deque<Decoded> decoded;
+  std::vector<HeightMap> readyMaps; // built maps not taken yet
+  unsigned takenMaps = 0;
+  bool finished = false; // all maps were built or the loading failed
+  bool stopping = false;
+  std::exception_ptr error;
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::thread readThread, buildThread;
+  size_t builtMemory = 0; // reported memory of the maps built so far, used only by the build thread
+  const void *buildingSource = nullptr; // source of the map being built, only compared with the decoded sources
+  size_t buildingSourceMemory = 0;
+  size_t peakSourceMemory = 0; // the most memory of the decoded sources held at once
+
+  /**
+   * Decode the requested files in order and pass them to the build thread
+   */
+  void readLoop();
+
+  /**
+   * Build the decoded maps in order and make them ready
+   */
+  void buildLoop();
+
+  /**
+   * Decode one height map, the source is shared with the previous request of the same path
+   * @param request - index of the request
+   * @param previous - the last decoded request, its source is reused for the same path
+   * @return decoded height map
+   */
+  [[nodiscard]] Decoded decode(unsigned request, const Decoded *previous) const;
+
+  /**
+   * Build the height map and its structures required by the scene options
+   * @param item - decoded height map
+   * @param horizonMap - horizon map of the first height map, it is stored when the first map is built and shared by its copies
+   * @return built height map
+   */
+  [[nodiscard]] HeightMap build(const Decoded &item, std::shared_ptr<const HorizonMap> &horizonMap);
+
+  /**
+   * Estimate memory of the height map built in the representation
+   * @param source - source of the height map
+   * @param plan - representation of the height map
+   * @return size in bytes
+   */
+  [[nodiscard]] static size_t estimateMemorySize(const HeightSource &source, const Plan &plan);
+
+  /**
+   * Choose the first representation of the height map which fits the memory left in the budget, failure is reported
+   * @param item - decoded height map
+   * @return representation of the scene options if there is no budget or it fits
+   */
+  [[nodiscard]] Plan planMemory(const Decoded &item) const;
+
+  /**
+   * Update the peak memory of the decoded sources, has to be called with the locked mutex
+   */
+  void updatePeakSourceMemory();
+
+  /**
+   * Build the horizon map of the height map or load it from the cache file
+   * @param path - path of the height map
+   * @param size - size of the height map
+   * @param heightMap - height map read from the path
+   */
+  void loadHorizonMap(const std::string &path, const Vector3d &size, HeightMap &heightMap) const;
+
+  /**
+   * Store the error of the thread and wake the waiting threads, the loading stops
+   */
+  void fail();
+
+public:
+  /**
+   * Start loading the height maps of the scene in the background
+   * @param requests - height maps in the order they should be taken
+   * @param rawWidth - number of samples in row of the raw height maps, 0 for square maps
+   * @param rawHeight - number of rows of the raw height maps, 0 for square maps
+   * @param horizonCachePath - binary file with the horizon map of the first height map, empty if it should not be used
+   */
+  explicit MapLoader(std::vector<Request> requests, unsigned rawWidth, unsigned rawHeight, std::string horizonCachePath);
+
+  /**
+   * Stop the loading and wait for the threads
+   */
+  ~MapLoader();
+
+  MapLoader(const MapLoader &) = delete;
+  MapLoader &operator=(const MapLoader &) = delete;
+
+  /**
+   * Get number of the requested height maps
+   * @return number of the maps
+   */
+  [[nodiscard]] unsigned getMapCount() const;
+
+  /**
+   * Move the maps built so far to the vector, error of the loading is rethrown
+   * @param heightMaps - vector where the maps are appended in the order of the requests, its capacity has to be reserved for all maps
+   * when it is rendered while the maps are added
+   * @return true if any map was added
+   */
+  bool takeReadyMaps(std::vector<HeightMap> &heightMaps);
+
+  /**
+   * Wait until the given number of maps was taken, the maps are moved to the vector, error of the loading is rethrown
+   * @param heightMaps - vector where the maps are appended in the order of the requests
+   * @param count - number of all taken maps, at most the number of the requests
+   */
+  void waitForMaps(std::vector<HeightMap> &heightMaps, unsigned count);
+
+  /**
+   * Get the most memory of the decoded height map sources held at once during the loading
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getPeakSourceMemory();
+};
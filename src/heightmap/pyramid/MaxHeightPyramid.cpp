@@ -0,0 +1,110 @@
+#include <algorithm>
+
+#include "MaxHeightPyramid.h"
+#include "src/thread-pool/ThreadPool.h"
+
+void MaxHeightPyramid::createLevels(unsigned width, unsigned depth) {
+  size_t offset = 0;
+  levels.push_back(Level{width, depth, offset});
+  while (levels.back().width > 1 || levels.back().depth > 1) {
+    const auto &previous = levels.back();
+    offset += previous.width * previous.depth;
+    levels.push_back(Level{(previous.width + 1) / 2, (previous.depth + 1) / 2, offset});
+  }
+}
+
+MaxHeightPyramid::MaxHeightPyramid(std::vector<float> cellMaxHeights, unsigned width, unsigned depth, unsigned firstLevel) : firstLevel(firstLevel) {
+  createLevels(width, depth);
+  storage = std::move(cellMaxHeights);
+  storage.resize(getValueCount(width, depth));
+  for (unsigned l = 1; l < levels.size(); l++) {
+    const auto &level = levels[l];
+    // rows of one level are independent, the levels are built one after another
+    ThreadPool::getShared().parallelForChunks(level.depth, rowsPerTask, [&](unsigned begin, unsigned end) {
+      for (auto row = begin; row < end; row++) {
+        for (unsigned col = 0; col < level.width; col++) storage[level.offset + row * level.width + col] = computeBlock(l, row, col);
+      }
+    });
+  }
+  values = storage.data();
+}
+
+float MaxHeightPyramid::computeBlock(unsigned level, unsigned row, unsigned col) const {
+  const auto &previous = levels[level - 1];
+  auto lastRow = std::min(2 * row + 1, previous.depth - 1), lastCol = std::min(2 * col + 1, previous.width - 1);
+  auto max = storage[previous.offset + 2 * row * previous.width + 2 * col];
+  for (auto r = 2 * row; r <= lastRow; r++) {
+    for (auto c = 2 * col; c <= lastCol; c++) max = std::max(max, storage[previous.offset + r * previous.width + c]);
+  }
+  return max;
+}
+
+MaxHeightPyramid::MaxHeightPyramid(const float *values, unsigned width, unsigned depth, unsigned firstLevel) : firstLevel(firstLevel), values(values) {
+  createLevels(width, depth);
+}
+
+MaxHeightPyramid::MaxHeightPyramid(const MaxHeightPyramid &other)
+  : levels(other.levels), firstLevel(other.firstLevel), storage(other.storage), values(storage.empty() ? other.values : storage.data()) {}
+
+MaxHeightPyramid::MaxHeightPyramid(MaxHeightPyramid &&other) noexcept
+  : levels(std::move(other.levels)), firstLevel(other.firstLevel), storage(std::move(other.storage)), values(other.values) {}
+
+MaxHeightPyramid &MaxHeightPyramid::operator=(const MaxHeightPyramid &other) {
+  if (this == &other) return *this;
+  levels = other.levels;
+  firstLevel = other.firstLevel;
+  storage = other.storage;
+  values = storage.empty() ? other.values : storage.data();
+  return *this;
+}
+
+MaxHeightPyramid &MaxHeightPyramid::operator=(MaxHeightPyramid &&other) noexcept {
+  levels = std::move(other.levels);
+  firstLevel = other.firstLevel;
+  storage = std::move(other.storage);
+  values = other.values;
+  return *this;
+}
+
+void MaxHeightPyramid::update(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const float *maxHeights) {
+  if (storage.empty()) {
+    storage.assign(values, values + getValueCount());
+    values = storage.data();
+  }
+  const auto &first = levels[0];
+  for (unsigned row = 0; row < rows; row++) {
+    std::copy(maxHeights + row * cols, maxHeights + (row + 1) * cols, storage.begin() + std::ptrdiff_t(first.offset + (firstRow + row) * first.width + firstCol));
+  }
+  // changed blocks of every level lie above the changed blocks of the previous one, so the rectangle halves level by level
+  auto lastRow = firstRow + rows - 1, lastCol = firstCol + cols - 1;
+  for (unsigned l = 1; l < levels.size(); l++) {
+    firstRow /= 2;
+    firstCol /= 2;
+    lastRow /= 2;
+    lastCol /= 2;
+    const auto &level = levels[l];
+    for (auto row = firstRow; row <= lastRow; row++) {
+      for (auto col = firstCol; col <= lastCol; col++) storage[level.offset + row * level.width + col] = computeBlock(l, row, col);
+    }
+  }
+}
+
+size_t MaxHeightPyramid::getValueCount(unsigned width, unsigned depth) {
+  size_t count = size_t(width) * depth;
+  while (width > 1 || depth > 1) {
+    width = (width + 1) / 2;
+    depth = (depth + 1) / 2;
+    count += size_t(width) * depth;
+  }
+  return count;
+}
+
+size_t MaxHeightPyramid::getValueCount() const {
+  if (levels.empty()) return 0;
+  const auto &top = levels.back();
+  return top.offset + top.width * top.depth;
+}
+
+size_t MaxHeightPyramid::getMemorySize() const {
+  return storage.size() * sizeof(float);
+}
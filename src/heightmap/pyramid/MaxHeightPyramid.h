@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Hierarchy of maximal heights above the grid cells (maximum mipmap)
+ *
+ * Level 0 stores maximal height of every cell, every next level stores maximum of 2x2 blocks of the previous level,
+ * so one value on level l bounds heights of a block of 2^l x 2^l cells. Last level contains one value for the whole grid.
+ * Pyramid can start on a higher level than 0, if the lower levels are stored elsewhere (in tiles of the grid).
+ * All levels are stored in one array one after another, the array can be owned by the pyramid or mapped from the terrain cache file.
+ */
+class MaxHeightPyramid {
+  constexpr static const unsigned rowsPerTask = 32; // rows of the level built by one task of the thread pool
+
+  /**
+   * One level of the pyramid, values are stored by rows from the offset in the array of all levels
+   */
+  struct Level {
+    unsigned width, depth;
+    size_t offset;
+  };
+
+  std::vector<Level> levels;
+  unsigned firstLevel = 0;
+  std::vector<float> storage;
+  const float *values = nullptr; // storage or external array
+
+  /**
+   * Compute sizes of the levels above the first level
+   * @param width - number of the blocks columns on the first level
+   * @param depth - number of the blocks rows on the first level
+   */
+  void createLevels(unsigned width, unsigned depth);
+
+  /**
+   * Compute maximum of the 2x2 blocks of the previous level under the block, from the owned storage
+   * @param level - index of the level in the stored levels (at least 1)
+   * @param row - row of the block on the level
+   * @param col - column of the block on the level
+   * @return maximal height of the block
+   */
+  [[nodiscard]] float computeBlock(unsigned level, unsigned row, unsigned col) const;
+
+public:
+  /**
+   * Create empty pyramid
+   */
+  explicit MaxHeightPyramid() = default;
+
+  /**
+   * Create pyramid from maximal heights of the cells or of the blocks on the first level
+   * @param cellMaxHeights - maximal heights of the cells (blocks of the first level) stored by rows
+   * @param width - number of the cell (block) columns
+   * @param depth - number of the cell (block) rows
+   * @param firstLevel - level of the given maximal heights, 0 for cells
+   */
+  explicit MaxHeightPyramid(std::vector<float> cellMaxHeights, unsigned width, unsigned depth, unsigned firstLevel = 0);
+
+  /**
+   * Create pyramid using already computed levels, the array is not copied and has to live as long as the pyramid
+   * @param values - array of all levels, as returned by getValues
+   * @param width - number of the cell (block) columns
+   * @param depth - number of the cell (block) rows
+   * @param firstLevel - level of the first stored values, 0 for cells
+   */
+  explicit MaxHeightPyramid(const float *values, unsigned width, unsigned depth, unsigned firstLevel = 0);
+
+  MaxHeightPyramid(const MaxHeightPyramid &other);
+  MaxHeightPyramid(MaxHeightPyramid &&other) noexcept;
+  MaxHeightPyramid &operator=(const MaxHeightPyramid &other);
+  MaxHeightPyramid &operator=(MaxHeightPyramid &&other) noexcept;
+
+  /**
+   * Replace maximal heights of a rectangle of the cells (blocks of the first level) and compute again only the blocks above them
+   * Levels in the external array are copied to the owned storage first, so the mapped file is never written
+   * @param firstRow - first row of the replaced cells (blocks)
+   * @param firstCol - first column of the replaced cells (blocks)
+   * @param rows - number of the replaced rows
+   * @param cols - number of the replaced columns
+   * @param maxHeights - rows * cols new maximal heights by rows
+   */
+  void update(unsigned firstRow, unsigned firstCol, unsigned rows, unsigned cols, const float *maxHeights);
+
+  /**
+   * Get number of values in all levels of the pyramid with given size
+   * @param width - number of the cell (block) columns
+   * @param depth - number of the cell (block) rows
+   * @return number of values
+   */
+  [[nodiscard]] static size_t getValueCount(unsigned width, unsigned depth);
+
+  /**
+   * Get array of all levels, level after level
+   * @return stored values
+   */
+  [[nodiscard]] const float *getValues() const {
+    return values;
+  }
+
+  /**
+   * Get number of all stored values
+   * @return number of values
+   */
+  [[nodiscard]] size_t getValueCount() const;
+
+  /**
+   * Get number of levels of the pyramid
+   * @return number of levels, including the level of cells (or the levels under the first level)
+   */
+  [[nodiscard]] unsigned getLevelCount() const {
+    return firstLevel + levels.size();
+  }
+
+  /**
+   * Get the lowest stored level
+   * @return first level, 0 if cells are stored
+   */
+  [[nodiscard]] unsigned getFirstLevel() const {
+    return firstLevel;
+  }
+
+  /**
+   * Get maximal height of the block on given level
+   * @param level - level of the pyramid, 0 for cells (at least the first level)
+   * @param row - row of the block on the level (cell row >> level)
+   * @param col - column of the block on the level (cell column >> level)
+   * @return maximal height of the block
+   */
+  [[nodiscard]] float getMaxHeight(unsigned level, unsigned row, unsigned col) const {
+    const auto &l = levels[level - firstLevel];
+    return values[l.offset + row * l.width + col];
+  }
+
+  /**
+   * Get maximal height of the block on the highest level
+   * @return maximal height of the whole grid
+   */
+  [[nodiscard]] float getTopMaxHeight() const {
+    return values[levels.back().offset];
+  }
+
+  /**
+   * Get memory used by the stored levels, levels in the external array are not counted
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getMemorySize() const;
+
+  /**
+   * Get maximal height of the cell
+   * @param row - row of the cell
+   * @param col - column of the cell
+   * @return maximal height of the cell
+   */
+  [[nodiscard]] float getCellMaxHeight(unsigned row, unsigned col) const {
+    return getMaxHeight(0, row, col);
+  }
+};
@@ -0,0 +1,118 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "TerrainCache.h"
+
+uint64_t TerrainCache::getNormalCount(unsigned gridWidth, unsigned gridDepth) {
+  return uint64_t(gridWidth + 1) * (gridDepth + 1);
+}
+
+bool TerrainCache::getSourceStamp(const std::string &sourcePath, uint64_t &size, int64_t &time) {
+  std::error_code error;
+  size = std::filesystem::file_size(sourcePath, error);
+  if (error) return false;
+  auto writeTime = std::filesystem::last_write_time(sourcePath, error);
+  if (error) return false;
+  time = int64_t(writeTime.time_since_epoch().count());
+  return true;
+}
+
+TerrainCache::TerrainCache(const std::string &cachePath) : file(std::make_shared<const MappedFile>(cachePath)) {
+  header = reinterpret_cast<const Header *>(file->getData());
+  auto isComplete = file->getSize() >= sizeof(Header);
+  auto samplesEnd = isComplete ? header->samplesOffset + HeightTile::getSampleCount(header->gridWidth, header->gridDepth) * sizeof(uint16_t) : 0;
+  auto pyramidEnd = isComplete ? header->pyramidOffset + header->pyramidCount * sizeof(float) : 0;
+  auto normalsEnd = isComplete ? header->normalsOffset + getNormalCount(header->gridWidth, header->gridDepth) * sizeof(uint16_t) : 0;
+  if (!isComplete || std::memcmp(header->magic, fileMagic, sizeof(fileMagic)) != 0 || header->version != version || header->byteOrder != byteOrderMark
+    || header->sampleLayout != HeightTile::sampleLayout || samplesEnd > file->getSize() || pyramidEnd > file->getSize() || header->pyramidOffset % alignof(float) != 0
+    || normalsEnd > file->getSize() || header->normalsOffset % alignof(uint16_t) != 0
+    || header->pyramidCount != MaxHeightPyramid::getValueCount(header->gridWidth, header->gridDepth)) {
+    std::cerr << "invalid terrain cache file " << cachePath << std::endl;
+    throw std::invalid_argument("received invalid terrain cache file");
+  }
+}
+
+bool TerrainCache::isValid(const std::string &cachePath, const std::string &sourcePath, const Point3d &position, const Vector3d &size) {
+  std::ifstream in(cachePath, std::ios::binary);
+  Header stored{};
+  if (!in.read(reinterpret_cast<char *>(&stored), sizeof(stored))) return false;
+  uint64_t sourceSize;
+  int64_t sourceTime;
+  if (!getSourceStamp(sourcePath, sourceSize, sourceTime)) return false;
+  return std::memcmp(stored.magic, fileMagic, sizeof(fileMagic)) == 0 && stored.version == version && stored.byteOrder == byteOrderMark
+    && stored.sampleLayout == HeightTile::sampleLayout && stored.sourceSize == sourceSize && stored.sourceTime == sourceTime
+    && stored.sampleScale == HeightTile::getSampleScale(size.getY()) && stored.sampleOffset == position.getY();
+}
+
+void TerrainCache::save(const std::string &cachePath, const std::string &sourcePath, const HeightTile &tile, float sampleScale, float sampleOffset,
+  const VertexNormals &normals) {
+  Header header{};
+  std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+  header.version = version;
+  header.byteOrder = byteOrderMark;
+  header.gridWidth = tile.getWidth();
+  header.gridDepth = tile.getDepth();
+  header.sampleLayout = HeightTile::sampleLayout;
+  header.sampleScale = sampleScale;
+  header.sampleOffset = sampleOffset;
+  if (!getSourceStamp(sourcePath, header.sourceSize, header.sourceTime)) {
+    std::cerr << "source of the terrain cache " << sourcePath << " does not exist" << std::endl;
+    throw std::invalid_argument("received invalid terrain cache source");
+  }
+  // arrays are aligned to 64 bytes, so they can be used directly from the mapped file
+  auto align = [](uint64_t offset) { return (offset + 63) / 64 * 64; };
+  auto samplesSize = uint64_t(HeightTile::getSampleCount(header.gridWidth, header.gridDepth)) * sizeof(uint16_t);
+  header.samplesOffset = align(sizeof(Header));
+  header.pyramidOffset = align(header.samplesOffset + samplesSize);
+  header.pyramidCount = tile.getPyramid().getValueCount();
+  auto pyramidSize = header.pyramidCount * sizeof(float);
+  header.normalsOffset = align(header.pyramidOffset + pyramidSize);
+  auto normalsSize = getNormalCount(header.gridWidth, header.gridDepth) * sizeof(uint16_t);
+
+  // written to the temporary file first, so the interrupted write does not leave broken cache
+  auto temporaryPath = cachePath + ".tmp";
+  {
+    std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+    std::vector<char> padding(64, 0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(padding.data(), std::streamsize(header.samplesOffset - sizeof(header)));
+    out.write(reinterpret_cast<const char *>(tile.getSamples()), std::streamsize(samplesSize));
+    out.write(padding.data(), std::streamsize(header.pyramidOffset - header.samplesOffset - samplesSize));
+    out.write(reinterpret_cast<const char *>(tile.getPyramid().getValues()), std::streamsize(pyramidSize));
+    out.write(padding.data(), std::streamsize(header.normalsOffset - header.pyramidOffset - pyramidSize));
+    out.write(reinterpret_cast<const char *>(normals.getData()), std::streamsize(normalsSize));
+    if (!out) {
+      std::cerr << "terrain cache " << cachePath << " can not be written" << std::endl;
+      throw std::invalid_argument("received terrain cache path that can not be written");
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporaryPath, cachePath, error);
+  if (error) {
+    std::filesystem::remove(temporaryPath, error);
+    std::cerr << "terrain cache " << cachePath << " can not be written" << std::endl;
+    throw std::invalid_argument("received terrain cache path that can not be written");
+  }
+}
+
+unsigned TerrainCache::getGridWidth() const {
+  return header->gridWidth;
+}
+
+unsigned TerrainCache::getGridDepth() const {
+  return header->gridDepth;
+}
+
+std::shared_ptr<HeightTile> TerrainCache::createTile(const Point3d &position, float cellWidth, float cellDepth) const {
+  auto data = file->getData();
+  auto samples = reinterpret_cast<const uint16_t *>(data + header->samplesOffset);
+  auto pyramid = reinterpret_cast<const float *>(data + header->pyramidOffset);
+  return std::make_shared<HeightTile>(file, samples, pyramid, 0, 0, header->gridWidth, header->gridDepth, header->sampleScale, header->sampleOffset, position, cellWidth, cellDepth);
+}
+
+std::shared_ptr<VertexNormals> TerrainCache::createVertexNormals() const {
+  auto normals = reinterpret_cast<const uint16_t *>(file->getData() + header->normalsOffset);
+  return std::make_shared<VertexNormals>(header->gridWidth, header->gridDepth, normals);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <iostream>
+
+#include "src/heightmap/height-tile/HeightTile.h"
+#include "src/heightmap/vertex-normals/VertexNormals.h"
+#include "src/mapped-file/MappedFile.h"
+#include "src/point/Point3d.h"
+#include "src/vector/Vector3d.h"
+
+/**
+ * Binary file with the built grid of the height map - quantized samples, the maximal heights pyramid and the encoded vertex normals
+ *
+ * The file is memory-mapped and the grid uses the arrays directly, so loading needs no decoding of the image and no building of the pyramid.
+ * The normals are copied from the file only for the smooth shading, they are edited with the heights.
+ * File starts with a header identifying the format version and the source file (its size and modification time)
+ * together with the scale of the heights, the file is rebuilt when any of them changes.
+ */
+class TerrainCache {
+  /**
+   * Header at the start of the file, arrays follow at the given offsets
+   */
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder; // byteOrderMark written in the order of the machine which created the file
+    uint32_t gridWidth, gridDepth;
+    uint32_t sampleLayout; // HeightTile::sampleLayout of the build which created the file
+    float sampleScale, sampleOffset;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t samplesOffset, pyramidOffset, pyramidCount, normalsOffset;
+  };
+
+  constexpr static const char fileMagic[8] = "HFGRID1";
+  constexpr static const uint32_t version = 3;
+  constexpr static const uint32_t byteOrderMark = 0x01020304;
+
+  std::shared_ptr<const MappedFile> file;
+  const Header *header;
+
+  /**
+   * Get number of the vertex normals stored for the grid
+   * @param gridWidth - number of the cell columns
+   * @param gridDepth - number of the cell rows
+   * @return number of the samples
+   */
+  [[nodiscard]] static uint64_t getNormalCount(unsigned gridWidth, unsigned gridDepth);
+
+public:
+  /**
+   * Get stamp identifying version of the source file, it is stored in the cache files built from the source
+   * @param sourcePath - path of the source file
+   * @param size - where size of the file is stored
+   * @param time - where the modification time of the file is stored
+   * @return false if the file does not exist
+   */
+  static bool getSourceStamp(const std::string &sourcePath, uint64_t &size, int64_t &time);
+
+  /**
+   * Map the cache file, the file has to be valid
+   * @param cachePath - path of the cache file
+   */
+  explicit TerrainCache(const std::string &cachePath);
+
+  /**
+   * Check that the cache file exists and was created with the current format from the current source with the same height scale
+   * @param cachePath - path of the cache file
+   * @param sourcePath - path of the height map which was used to create the cache
+   * @param position - position of the height map
+   * @param size - vector storing width, depth and height of the height map
+   * @return true if the cache can be used
+   */
+  static bool isValid(const std::string &cachePath, const std::string &sourcePath, const Point3d &position, const Vector3d &size);
+
+  /**
+   * Write the grid of the height map to the cache file
+   * @param cachePath - path of the cache file
+   * @param sourcePath - path of the height map which the grid was built from
+   * @param tile - tile covering the whole grid
+   * @param sampleScale - height of one quantization step of the samples
+   * @param sampleOffset - height of the zero sample
+   * @param normals - vertex normals of the grid
+   */
+  static void save(const std::string &cachePath, const std::string &sourcePath, const HeightTile &tile, float sampleScale, float sampleOffset,
+    const VertexNormals &normals);
+
+  /**
+   * Get width of the grid
+   * @return number of the cell columns
+   */
+  [[nodiscard]] unsigned getGridWidth() const;
+
+  /**
+   * Get depth of the grid
+   * @return number of the cell rows
+   */
+  [[nodiscard]] unsigned getGridDepth() const;
+
+  /**
+   * Create tile covering the whole grid, which uses the mapped arrays
+   * @param position - position of the grid
+   * @param cellWidth - width of the cell
+   * @param cellDepth - depth of the cell
+   * @return tile of the whole grid
+   */
+  [[nodiscard]] std::shared_ptr<HeightTile> createTile(const Point3d &position, float cellWidth, float cellDepth) const;
+
+  /**
+   * Create vertex normals of the grid from the stored ones
+   * @return copy of the normals
+   */
+  [[nodiscard]] std::shared_ptr<VertexNormals> createVertexNormals() const;
+};
@@ -0,0 +1,63 @@
+#include <iomanip>
+
+#include "TileCache.h"
+
+TileCache::TileCache(size_t memoryBudget) : memoryBudget(memoryBudget) {}
+
+void TileCache::evict() {
+  while (usedMemory > memoryBudget && recentTiles.size() > 1) {
+    auto entry = tiles.find(recentTiles.back());
+    usedMemory -= entry->second.tile->getMemorySize();
+    tiles.erase(entry);
+    recentTiles.pop_back();
+    evictions++;
+  }
+}
+
+std::shared_ptr<const HeightTile> TileCache::find(unsigned index) {
+  std::lock_guard lock(mutex);
+  auto entry = tiles.find(index);
+  if (entry == tiles.end()) return nullptr;
+  hits++;
+  recentTiles.splice(recentTiles.begin(), recentTiles, entry->second.recent);
+  return entry->second.tile;
+}
+
+std::shared_ptr<const HeightTile> TileCache::insert(unsigned index, std::shared_ptr<const HeightTile> tile) {
+  std::lock_guard lock(mutex);
+  auto entry = tiles.find(index);
+  if (entry != tiles.end()) return entry->second.tile; // loaded by other thread in the meantime
+  recentTiles.push_front(index);
+  tiles.emplace(index, Entry{tile, recentTiles.begin()});
+  usedMemory += tile->getMemorySize();
+  evict();
+  return tile;
+}
+
+uint64_t TileCache::getHits() const {
+  return hits;
+}
+
+uint64_t TileCache::getMisses() const {
+  return misses;
+}
+
+uint64_t TileCache::getEvictions() const {
+  return evictions;
+}
+
+size_t TileCache::getUsedMemory() const {
+  std::lock_guard lock(mutex);
+  return usedMemory;
+}
+
+void TileCache::printStatistics(std::ostream &out) const {
+  auto requests = hits + misses;
+  auto flags = out.flags();
+  auto precision = out.precision();
+  out << std::fixed << std::setprecision(1);
+  out << "tile cache: " << hits << " hits, " << misses << " misses (" << (requests ? 100. * double(hits) / double(requests) : 0.) << " % hits), "
+      << evictions << " evictions, " << double(getUsedMemory()) / (1024. * 1024.) << " of " << double(memoryBudget) / (1024. * 1024.) << " MB used" << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+}
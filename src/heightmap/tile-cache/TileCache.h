@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "src/heightmap/height-tile/HeightTile.h"
+
+/**
+ * Cache of the grid tiles loaded on demand, least recently used tiles are released when the memory budget is exceeded
+ *
+ * Tiles are shared with the rays that use them, so the released tile lives until the last ray leaves it. Cache is thread-safe.
+ */
+class TileCache {
+  /**
+   * Loaded tile with its position in the list of recently used tiles
+   */
+  struct Entry {
+    std::shared_ptr<const HeightTile> tile;
+    std::list<unsigned>::iterator recent;
+  };
+
+  size_t memoryBudget;
+  size_t usedMemory = 0;
+  std::list<unsigned> recentTiles; // most recently used first
+  std::unordered_map<unsigned, Entry> tiles;
+  mutable std::mutex mutex;
+  std::atomic<uint64_t> hits = 0, misses = 0, evictions = 0;
+
+  /**
+   * Release the least recently used tiles until the used memory fits the budget, the most recent tile is always kept
+   */
+  void evict();
+
+  /**
+   * Find cached tile and mark it as the most recently used
+   * @param index - index of the tile
+   * @return cached tile or nullptr if the tile is not cached
+   */
+  [[nodiscard]] std::shared_ptr<const HeightTile> find(unsigned index);
+
+  /**
+   * Add loaded tile to the cache and release old tiles if the budget is exceeded
+   * @param index - index of the tile
+   * @param tile - loaded tile
+   * @return tile in the cache (tile loaded by other thread in the meantime is kept)
+   */
+  [[nodiscard]] std::shared_ptr<const HeightTile> insert(unsigned index, std::shared_ptr<const HeightTile> tile);
+
+public:
+  /**
+   * Create empty cache
+   * @param memoryBudget - maximal memory used by the cached tiles in bytes
+   */
+  explicit TileCache(size_t memoryBudget);
+
+  TileCache(const TileCache &) = delete;
+  TileCache &operator=(const TileCache &) = delete;
+
+  /**
+   * Get tile from the cache, the tile is loaded if it is not cached
+   * Other tiles can be requested while the tile is loaded
+   * @param index - index of the tile
+   * @param load - function returning the loaded tile (std::shared_ptr<const HeightTile>)
+   * @return requested tile
+   */
+  template<typename Load>
+  [[nodiscard]] std::shared_ptr<const HeightTile> get(unsigned index, Load &&load) {
+    if (auto tile = find(index)) return tile;
+    misses++;
+    return insert(index, load());
+  }
+
+  /**
+   * Get number of requests for tiles that were cached
+   * @return number of hits
+   */
+  [[nodiscard]] uint64_t getHits() const;
+
+  /**
+   * Get number of requests for tiles that had to be loaded
+   * @return number of misses
+   */
+  [[nodiscard]] uint64_t getMisses() const;
+
+  /**
+   * Get number of tiles released because of the memory budget
+   * @return number of evictions
+   */
+  [[nodiscard]] uint64_t getEvictions() const;
+
+  /**
+   * Get memory used by the cached tiles
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getUsedMemory() const;
+
+  /**
+   * Print hits, misses and memory of the cache to the output
+   * @param out - output stream
+   */
+  void printStatistics(std::ostream &out) const;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+/**
+ * Add value to the counter of the statistics of the current thread, compiles to nothing without TRAVERSAL_STATISTICS
+ * @param counter - name of the TraversalStatistics member
+ * @param value - added value
+ */
+#ifdef TRAVERSAL_STATISTICS
+#define COUNT_TRAVERSAL(counter, value) do { if (TraversalStatistics::active) TraversalStatistics::active->counter += (value); } while (false)
+#else
+#define COUNT_TRAVERSAL(counter, value) do {} while (false)
+#endif
+
+/**
+ * Counters of the work done by the height map traversal, summed over the traced rays
+ *
+ * Traversal adds the counters to the statistics set as active for the calling thread (only with TRAVERSAL_STATISTICS)
+ */
+struct TraversalStatistics {
+  /**
+   * Counter that can be shown in the heatmap
+   */
+  enum class Counter {
+    none, rays, visitedCells, triangleTests, runs, boundingBoxRejects, shadowRays
+  };
+
+  uint64_t rays = 0; // traversed rays
+  uint64_t visitedCells = 0; // cells compared with the ray height
+  uint64_t triangleTests = 0; // triangles (or bilinear patches of the cells) tested for the intersection with the ray
+  uint64_t runs = 0; // runs of cells of the digital line walked by the ray
+  uint64_t boundingBoxRejects = 0; // rays which missed the tested bounding box
+  uint64_t shadowRays = 0; // rays from the intersections to the lights
+
+  /**
+   * Statistics where the traversal of the current thread adds its counters, nullptr if they are not counted
+   */
+  inline static thread_local TraversalStatistics *active = nullptr;
+
+  /**
+   * Add counters of other statistics
+   * @param other - added statistics
+   * @return this statistics
+   */
+  TraversalStatistics &operator+=(const TraversalStatistics &other) {
+    rays += other.rays;
+    visitedCells += other.visitedCells;
+    triangleTests += other.triangleTests;
+    runs += other.runs;
+    boundingBoxRejects += other.boundingBoxRejects;
+    shadowRays += other.shadowRays;
+    return *this;
+  }
+
+  /**
+   * Get value of the counter
+   * @param counter - returned counter, none returns 0
+   * @return value of the counter
+   */
+  [[nodiscard]] uint64_t get(Counter counter) const {
+    switch (counter) {
+      case Counter::rays: return rays;
+      case Counter::visitedCells: return visitedCells;
+      case Counter::triangleTests: return triangleTests;
+      case Counter::runs: return runs;
+      case Counter::boundingBoxRejects: return boundingBoxRejects;
+      case Counter::shadowRays: return shadowRays;
+      default: return 0;
+    }
+  }
+
+  /**
+   * Find counter by its name used on the command line
+   * @param name - one of rays, cells, triangles, runs, aabb, shadows
+   * @param counter - where the found counter is stored
+   * @return true if the name is known
+   */
+  static bool parseCounter(const std::string &name, Counter &counter) {
+    const std::pair<const char *, Counter> names[] = {
+      {"rays", Counter::rays}, {"cells", Counter::visitedCells}, {"triangles", Counter::triangleTests},
+      {"runs", Counter::runs}, {"aabb", Counter::boundingBoxRejects}, {"shadows", Counter::shadowRays},
+    };
+    for (const auto &[counterName, value] : names) {
+      if (name == counterName) {
+        counter = value;
+        return true;
+      }
+    }
+    return false;
+  }
+};
@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <cmath>
+
+#include "VertexNormals.h"
+
+VertexNormals::VertexNormals(unsigned width, unsigned depth)
+  : width(width), depth(depth), normals(size_t(width + 1) * (depth + 1), encode(Vector3d(0.f, 1.f, 0.f))) {}
+
+VertexNormals::VertexNormals(unsigned width, unsigned depth, const uint16_t *encoded)
+  : width(width), depth(depth), normals(encoded, encoded + size_t(width + 1) * (depth + 1)) {}
+
+void VertexNormals::fold(float &u, float &v) {
+  auto foldedU = (1.f - std::abs(v)) * (u >= 0.f ? 1.f : -1.f);
+  auto foldedV = (1.f - std::abs(u)) * (v >= 0.f ? 1.f : -1.f);
+  u = foldedU;
+  v = foldedV;
+}
+
+uint16_t VertexNormals::encode(const Vector3d &normal) {
+  auto length = std::abs(normal.getX()) + std::abs(normal.getY()) + std::abs(normal.getZ());
+  auto u = normal.getX() / length, v = normal.getZ() / length;
+  if (normal.getY() < 0.f) fold(u, v);
+  auto quantize = [](float value) { return unsigned(std::lround((std::clamp(value, -1.f, 1.f) * .5f + .5f) * quantizationScale)); };
+  return uint16_t(quantize(u) << 8 | quantize(v));
+}
+
+Vector3d VertexNormals::decode(uint16_t encoded) {
+  auto u = float(encoded >> 8) / quantizationScale * 2.f - 1.f;
+  auto v = float(encoded & 0xff) / quantizationScale * 2.f - 1.f;
+  auto y = 1.f - std::abs(u) - std::abs(v);
+  if (y < 0.f) fold(u, v);
+  return Vector3d(u, y, v).normalized();
+}
+
+Vector3d VertexNormals::interpolate(float x, float z) const {
+  x = std::clamp(x, 0.f, float(width));
+  z = std::clamp(z, 0.f, float(depth));
+  auto col = std::min(unsigned(x), width - 1), row = std::min(unsigned(z), depth - 1);
+  auto fx = x - float(col), fz = z - float(row);
+  auto top = get(row, col) * (1.f - fx) + get(row, col + 1) * fx;
+  auto bottom = get(row + 1, col) * (1.f - fx) + get(row + 1, col + 1) * fx;
+  return (top * (1.f - fz) + bottom * fz).normalized();
+}
+
+const uint16_t *VertexNormals::getData() const {
+  return normals.data();
+}
+
+size_t VertexNormals::getMemorySize() const {
+  return normals.size() * sizeof(uint16_t);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "src/vector/Vector3d.h"
+
+/**
+ * Normals in the samples (vertices) of the grid, every normal is stored in 16 bits with the octahedral mapping
+ *
+ * Unit vector is projected to the octahedron |x| + |y| + |z| = 1 and the octahedron is unfolded to the square, y is the axis
+ * of the upper hemisphere, so the normals of the terrain use the inner part of the square. Both coordinates of the square are quantized to 8 bits.
+ */
+class VertexNormals {
+  constexpr static const float quantizationScale = 255.f; // maximal quantized coordinate of the square
+
+  unsigned width = 0, depth = 0; // number of cells, the normals are stored for (width + 1) x (depth + 1) samples
+  std::vector<uint16_t> normals; // encoded normals by rows
+
+  /**
+   * Fold the coordinates of the lower hemisphere to the outer triangles of the square
+   * @param u - x coordinate on the octahedron, replaced by the folded one
+   * @param v - z coordinate on the octahedron, replaced by the folded one
+   */
+  static void fold(float &u, float &v);
+
+public:
+  /**
+   * Create storage of the normals for given grid size, all normals point up
+   * @param width - number of columns of the cells
+   * @param depth - number of rows of the cells
+   */
+  explicit VertexNormals(unsigned width, unsigned depth);
+
+  /**
+   * Create normals of given grid size from the encoded normals, e.g. stored in the terrain cache
+   * @param width - number of columns of the cells
+   * @param depth - number of rows of the cells
+   * @param encoded - (width + 1) x (depth + 1) encoded normals by rows, they are copied
+   */
+  explicit VertexNormals(unsigned width, unsigned depth, const uint16_t *encoded);
+
+  /**
+   * Encode unit vector to 16 bits
+   * @param normal - unit vector
+   * @return x coordinate of the square in the high byte, z coordinate in the low byte
+   */
+  [[nodiscard]] static uint16_t encode(const Vector3d &normal);
+
+  /**
+   * Decode vector stored in 16 bits
+   * @param encoded - encoded vector
+   * @return unit vector
+   */
+  [[nodiscard]] static Vector3d decode(uint16_t encoded);
+
+  /**
+   * Store normal in the sample
+   * @param row - row of the sample (0 to grid depth)
+   * @param col - column of the sample (0 to grid width)
+   * @param normal - unit vector
+   */
+  void set(unsigned row, unsigned col, const Vector3d &normal) {
+    normals[size_t(row) * (width + 1) + col] = encode(normal);
+  }
+
+  /**
+   * Get normal in the sample
+   * @param row - row of the sample (0 to grid depth)
+   * @param col - column of the sample (0 to grid width)
+   * @return unit vector
+   */
+  [[nodiscard]] Vector3d get(unsigned row, unsigned col) const {
+    return decode(normals[size_t(row) * (width + 1) + col]);
+  }
+
+  /**
+   * Interpolate the normals of the four corners of the cell containing the point
+   * @param x - column coordinate in the grid (in cells), clamped to the grid
+   * @param z - row coordinate in the grid (in cells), clamped to the grid
+   * @return interpolated unit vector
+   */
+  [[nodiscard]] Vector3d interpolate(float x, float z) const;
+
+  /**
+   * Get encoded normals
+   * @return (width + 1) x (depth + 1) encoded normals by rows
+   */
+  [[nodiscard]] const uint16_t *getData() const;
+
+  /**
+   * Get memory used by the normals
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getMemorySize() const;
+};
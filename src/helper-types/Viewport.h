@@ -23,5 +23,5 @@ public:
    * Create viewport matrix and return it
    * @return viewport matrix
    */
-  Matrix4d getViewportMatrix();
+  Matrix4d getViewportMatrix() const;
 };
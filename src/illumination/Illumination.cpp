@@ -1,22 +1,56 @@
-#include <iostream>
+#include <cmath>
+
 #include "Illumination.h"
 
-Color Illumination::getDirectPhongIllumination(const std::vector<Light> &lights, const Material &material, const Ray &ray, const Intersection &intersection, float heightFactor) {
+Color Illumination::getDirectPhongIllumination(const LightBatch &lights, const Material &material, const Color &matColor, const Ray &ray, const Intersection &intersection) {
   auto color = Color(0, 0, 0);
   auto intersectPoint = ray.getPointOnParameter(intersection.getT());
   auto normal = intersection.getNormal();
+  auto directionToViewer = -ray.getDirection();
 
-  for (auto light : lights) {
-    auto directionToViewer = -ray.getDirection();
-    auto directionToLight = light.getPosition().getNormalizedVectorBetween(intersectPoint);
-    auto directionOfReflectedLight = (normal * (2.f * directionToLight.dotProduct(normal))) - directionToLight;
+  // highlights are skipped for materials without them
+  auto kd = material.getKd(), ks = material.getKs(), shine = material.getShine();
+  auto normalX = Float4(normal.getX()), normalY = Float4(normal.getY()), normalZ = Float4(normal.getZ());
+  auto pointX = Float4(intersectPoint.getX()), pointY = Float4(intersectPoint.getY()), pointZ = Float4(intersectPoint.getZ());
 
-    auto cosAlpha = normal.dotProduct(directionToLight);
-    auto cosBeta = std::max(directionToViewer.dotProduct(directionOfReflectedLight), 0.f);
+  float cosAlpha[LightBatch::packetSize], cosBeta[LightBatch::packetSize];
+  for (unsigned packet = 0; packet < lights.getPacketCount(); packet++) {
+    // directions to four lights at once, same operations as Vector3d::normalized and dotProduct
+    auto toLightX = lights.getPositionX(packet) - pointX, toLightY = lights.getPositionY(packet) - pointY, toLightZ = lights.getPositionZ(packet) - pointZ;
+    auto length = sqrt(toLightX * toLightX + toLightY * toLightY + toLightZ * toLightZ);
+    toLightX = toLightX / length;
+    toLightY = toLightY / length;
+    toLightZ = toLightZ / length;
+    auto cosine = toLightX * normalX + toLightY * normalY + toLightZ * normalZ;
+    auto twiceCosine = Float4(2.f) * cosine;
+    auto reflectedX = normalX * twiceCosine - toLightX, reflectedY = normalY * twiceCosine - toLightY, reflectedZ = normalZ * twiceCosine - toLightZ;
+    auto toViewer = Float4(directionToViewer.getX()) * reflectedX + Float4(directionToViewer.getY()) * reflectedY + Float4(directionToViewer.getZ()) * reflectedZ;
+    cosine.store(cosAlpha);
+    toViewer.store(cosBeta);
 
-    auto matColor = material.isChangeColor() ? material.getColor(heightFactor) : material.getColor();
-    color += light.getColorIntensity() * matColor * (material.getKd() * cosAlpha); // diffuse
-    color += light.getColorIntensity() * material.getKs() * std::pow(cosBeta, material.getShine()); // specular
+    auto first = packet * LightBatch::packetSize;
+    for (unsigned lane = 0; lane < LightBatch::packetSize && first + lane < lights.getCount(); lane++) {
+      const auto &lightColor = lights.getColorIntensity(first + lane);
+      color += lightColor * matColor * (kd * cosAlpha[lane]); // diffuse
+      if (ks != 0.f) color += lightColor * ks * std::pow(std::max(cosBeta[lane], 0.f), shine); // specular
+    }
   }
   return color;
 }
+
+bool Illumination::getPhongIllumination(const Light &light, const Material &material, const Color &materialColor, const Ray &ray, const Point3d &point, const Vector3d &normal, Color &color) {
+  auto toLight = light.getPosition().getVectorBetween(point);
+  auto squaredDistance = toLight.dotProduct(toLight);
+  auto attenuation = light.getAttenuation(squaredDistance);
+  toLight = toLight / std::sqrt(squaredDistance);
+  auto cosAlpha = toLight.dotProduct(normal);
+  if (attenuation <= 0.f || cosAlpha <= 0.f) return false;
+
+  auto lightColor = light.getColorIntensity() * attenuation;
+  color = lightColor * materialColor * (material.getKd() * cosAlpha); // diffuse
+  if (material.getKs() != 0.f) {
+    auto cosBeta = (normal * (2.f * cosAlpha) - toLight).dotProduct(-ray.getDirection());
+    color += lightColor * material.getKs() * std::pow(std::max(cosBeta, 0.f), material.getShine()); // specular
+  }
+  return true;
+}
@@ -1,8 +1,6 @@
 #pragma once
 
-#include <vector>
-
-#include "src/light/Light.h"
+#include "src/light-batch/LightBatch.h"
 #include "src/material/Material.h"
 #include "src/color/Color.h"
 #include "src/ray/Ray.h"
@@ -16,11 +14,26 @@ public:
   Illumination() = delete; // static singleton
   /**
    * Get direct phong illumination at ray-triangle intersection
+   * Directions to the lights are computed for four lights at once, the material color is looked up once for all lights
    * @param lights - scene lights
    * @param material - material of the triangle
+   * @param materialColor - color of the material at the intersection
    * @param ray - intersected ray
    * @param intersection - intersection determined by parameter t and normal
    * @return color at the intersection
    */
-  static Color getDirectPhongIllumination(const std::vector<Light> &lights, const Material &material, const Ray &ray, const Intersection &t, float heightFactor = 0.f);
+  static Color getDirectPhongIllumination(const LightBatch &lights, const Material &material, const Color &materialColor, const Ray &ray, const Intersection &intersection);
+
+  /**
+   * Get phong illumination of one light faded by its range, used when the lights are picked separately for every shaded point
+   * @param light - shading light
+   * @param material - material of the triangle
+   * @param materialColor - color of the material at the intersection
+   * @param ray - intersected ray
+   * @param point - intersection point
+   * @param normal - normal at the intersection
+   * @param color - where the color is stored
+   * @return false if the light is behind the surface or out of its range, the color is not stored then
+   */
+  static bool getPhongIllumination(const Light &light, const Material &material, const Color &materialColor, const Ray &ray, const Point3d &point, const Vector3d &normal, Color &color);
 };
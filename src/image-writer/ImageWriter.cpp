@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <corona.h>
+
+#include "ImageWriter.h"
+#include "src/profiler/Profiler.h"
+#include "src/simd/Float4.h"
+
+void ImageWriter::convertPixels(const Context &context, std::vector<unsigned char> &pixels) {
+  const auto &colors = context.getColorBuffer();
+  auto width = size_t(context.getWidth()), height = size_t(context.getHeight());
+  auto rowSize = width * 3;
+  pixels.resize(colors.size() * 3);
+  // row 0 of the color buffer is the bottom one (as drawn by glDrawPixels), the image files start with the top row
+  if (colors.getFormat() == FrameBuffer::Format::Rgba8) { // the bytes are stored already, only the alpha is dropped
+    const auto *stored = colors.data();
+    for (size_t row = 0; row < height; row++) {
+      const auto *in = stored + (height - 1 - row) * width * 4;
+      auto *out = pixels.data() + row * rowSize;
+      for (size_t x = 0; x < width; x++) std::copy_n(in + x * 4, 3, out + x * 3);
+    }
+    return;
+  }
+  auto toByte = [](float value) { return (unsigned char) (std::clamp(value, 0.f, 1.f) * 255.f + .5f); };
+  if (colors.getFormat() != FrameBuffer::Format::Float) {
+    for (size_t row = 0; row < height; row++) {
+      auto *out = pixels.data() + row * rowSize;
+      for (size_t x = 0; x < width; x++) {
+        auto color = colors.get((height - 1 - row) * width + x);
+        *out++ = toByte(color.getR());
+        *out++ = toByte(color.getG());
+        *out++ = toByte(color.getB());
+      }
+    }
+    return;
+  }
+
+  // colors are stored as three floats, so every row is converted as one array of the channels
+  const auto *channels = reinterpret_cast<const float *>(colors.data());
+  auto zero = Float4(0.f), one = Float4(1.f), scale = Float4(255.f), half = Float4(.5f);
+  for (size_t row = 0; row < height; row++) {
+    const auto *in = channels + (height - 1 - row) * rowSize;
+    auto *out = pixels.data() + row * rowSize;
+    size_t i = 0;
+    for (; i + 4 <= rowSize; i += 4) (min(max(Float4(in + i), zero), one) * scale + half).storeBytes(out + i);
+    for (; i < rowSize; i++) out[i] = toByte(in[i]);
+  }
+}
+
+void ImageWriter::convertPixels(const Context &context, unsigned minX, unsigned minY, unsigned maxX, unsigned maxY, std::vector<unsigned char> &pixels) {
+  const auto &colors = context.getColorBuffer();
+  auto toByte = [](float value) { return (unsigned char) (std::clamp(value, 0.f, 1.f) * 255.f + .5f); };
+  pixels.resize(size_t(maxX - minX) * (maxY - minY) * 3);
+  auto *out = pixels.data();
+  // from the top row as the whole image
+  for (auto y = maxY; y-- > minY;) {
+    for (auto x = minX; x < maxX; x++) {
+      auto color = colors.get(size_t(y) * context.getWidth() + x);
+      *out++ = toByte(color.getR());
+      *out++ = toByte(color.getG());
+      *out++ = toByte(color.getB());
+    }
+  }
+}
+
+void ImageWriter::writePpm(const std::string &fileName, unsigned width, unsigned height, const std::vector<unsigned char> &pixels) {
+  std::ofstream out(fileName, std::ios::binary);
+  if (!out) {
+    std::cerr << "cannot open output file " << fileName << std::endl;
+    throw std::invalid_argument("cannot open output file");
+  }
+  out << "P6\n" << width << " " << height << "\n255\n";
+  out.write(reinterpret_cast<const char *>(pixels.data()), std::streamsize(pixels.size()));
+}
+
+std::string ImageWriter::getExtension(const std::string &fileName) {
+  auto dot = fileName.find_last_of('.');
+  auto extension = dot == std::string::npos ? "" : fileName.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+  return extension;
+}
+
+bool ImageWriter::isSupported(const std::string &fileName) {
+  auto extension = getExtension(fileName);
+  return extension == "ppm" || extension == "png" || extension == "tga";
+}
+
+void ImageWriter::save(const Context &context, const std::string &fileName) {
+  std::vector<unsigned char> pixels;
+  convertPixels(context, pixels);
+  save(fileName, context.getWidth(), context.getHeight(), pixels);
+}
+
+void ImageWriter::save(const std::string &fileName, unsigned width, unsigned height, const std::vector<unsigned char> &pixels) {
+  Profiler::Scope scope("save image");
+  auto extension = getExtension(fileName);
+  if (extension == "ppm") {
+    writePpm(fileName, width, height, pixels);
+    return;
+  }
+
+  corona::FileFormat format;
+  if (extension == "png") {
+    format = corona::FF_PNG;
+  } else if (extension == "tga") {
+    format = corona::FF_TGA;
+  } else {
+    std::cerr << "unsupported output format " << extension << " (use ppm, png or tga)" << std::endl;
+    throw std::invalid_argument("unsupported output format");
+  }
+
+  corona::Image *image = corona::CreateImage(int(width), int(height), corona::PF_R8G8B8, const_cast<unsigned char *>(pixels.data()));
+  if (!image) {
+    std::cerr << "cannot create output image" << std::endl;
+    throw std::invalid_argument("cannot create output image");
+  }
+  auto saved = corona::SaveImage(fileName.c_str(), format, image);
+  delete image;
+  if (!saved) {
+    std::cerr << "cannot save output file " << fileName << std::endl;
+    throw std::invalid_argument("cannot save output file");
+  }
+}
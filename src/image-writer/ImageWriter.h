@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "src/context/Context.h"
+
+/**
+ * Class for saving the color buffer of the context to an image file
+ *
+ * Format is chosen by the file extension - PPM is written directly, PNG and TGA through corona
+ */
+class ImageWriter {
+  /**
+   * Get lower case extension of the file
+   * @param fileName - name of the file
+   * @return extension without the dot, empty if there is none
+   */
+  [[nodiscard]] static std::string getExtension(const std::string &fileName);
+
+  /**
+   * Write pixels as binary PPM (P6)
+   * @param fileName - name of the output file
+   * @param width - width of the image
+   * @param height - height of the image
+   * @param pixels - pixels of the image, row by row
+   */
+  static void writePpm(const std::string &fileName, unsigned width, unsigned height, const std::vector<unsigned char> &pixels);
+
+public:
+  /**
+   * Convert color buffer to 8-bit RGB pixels, colors are clamped to [0, 1] and rounded, float buffer four channels at once
+   * @param context - context with the rendered color buffer
+   * @param pixels - where the pixels are stored (3 bytes per pixel, from the top row as in the image files,
+   * while the color buffer starts with the bottom row), its memory is reused
+   */
+  static void convertPixels(const Context &context, std::vector<unsigned char> &pixels);
+
+  /**
+   * Convert a rectangle of the color buffer to 8-bit RGB pixels, rounded the same as the whole buffer
+   * @param context - context with the rendered color buffer
+   * @param minX - first column of the rectangle
+   * @param minY - first row of the rectangle
+   * @param maxX - column after the last column of the rectangle
+   * @param maxY - row after the last row of the rectangle
+   * @param pixels - where the pixels of the rectangle are stored row by row from the top row maxY - 1 (3 bytes per pixel), its memory is reused
+   */
+  static void convertPixels(const Context &context, unsigned minX, unsigned minY, unsigned maxX, unsigned maxY, std::vector<unsigned char> &pixels);
+
+  /**
+   * Check if the image can be saved to the file with given name
+   * @param fileName - name of the output file
+   * @return true if the extension is one of the supported formats
+   */
+  [[nodiscard]] static bool isSupported(const std::string &fileName);
+
+  /**
+   * Save rendered color buffer of the context to the file, colors are clamped to [0, 1]
+   * @param context - context with the rendered color buffer
+   * @param fileName - name of the output file (.ppm, .png or .tga)
+   */
+  static void save(const Context &context, const std::string &fileName);
+
+  /**
+   * Save converted pixels to the file
+   * @param fileName - name of the output file (.ppm, .png or .tga)
+   * @param width - width of the image
+   * @param height - height of the image
+   * @param pixels - pixels of the image, row by row (3 bytes per pixel)
+   */
+  static void save(const std::string &fileName, unsigned width, unsigned height, const std::vector<unsigned char> &pixels);
+};
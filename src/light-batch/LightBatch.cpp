@@ -0,0 +1,17 @@
+#include "LightBatch.h"
+
+LightBatch::LightBatch(const std::vector<Light> &lights) {
+  for (unsigned first = 0; first < lights.size(); first += packetSize) {
+    float x[packetSize] = {}, y[packetSize] = {}, z[packetSize] = {};
+    for (unsigned lane = 0; lane < packetSize && first + lane < lights.size(); lane++) {
+      const auto &position = lights[first + lane].getPosition();
+      x[lane] = position.getX();
+      y[lane] = position.getY();
+      z[lane] = position.getZ();
+    }
+    positionX.emplace_back(x);
+    positionY.emplace_back(y);
+    positionZ.emplace_back(z);
+  }
+  for (const auto &light : lights) colors.push_back(light.getColorIntensity());
+}
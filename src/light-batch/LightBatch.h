@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+
+#include "src/color/Color.h"
+#include "src/light/Light.h"
+#include "src/simd/Float4.h"
+
+/**
+ * Lights of the scene stored as structure of arrays, so the shading computes directions to four lights at once
+ *
+ * Positions are stored in packets of four lights, the last packet is padded by lights in the origin, which are never shaded
+ * Getters are inline, they are called for every shaded pixel
+ */
+class LightBatch {
+  std::vector<Float4> positionX, positionY, positionZ;
+  std::vector<Color> colors;
+
+public:
+  constexpr static const unsigned packetSize = 4;
+
+  /**
+   * Create batch of the lights
+   * @param lights - lights in the order they are shaded
+   */
+  explicit LightBatch(const std::vector<Light> &lights);
+
+  /**
+   * Get number of lights in the batch
+   * @return number of lights
+   */
+  [[nodiscard]] unsigned getCount() const {
+    return colors.size();
+  }
+
+  /**
+   * Get number of packets of four lights, the last one can be partially filled
+   * @return number of packets
+   */
+  [[nodiscard]] unsigned getPacketCount() const {
+    return positionX.size();
+  }
+
+  /**
+   * Get x coordinates of the lights in the packet
+   * @param packet - index of the packet
+   * @return x coordinates of four lights
+   */
+  [[nodiscard]] const Float4 &getPositionX(unsigned packet) const {
+    return positionX[packet];
+  }
+
+  /**
+   * Get y coordinates of the lights in the packet
+   * @param packet - index of the packet
+   * @return y coordinates of four lights
+   */
+  [[nodiscard]] const Float4 &getPositionY(unsigned packet) const {
+    return positionY[packet];
+  }
+
+  /**
+   * Get z coordinates of the lights in the packet
+   * @param packet - index of the packet
+   * @return z coordinates of four lights
+   */
+  [[nodiscard]] const Float4 &getPositionZ(unsigned packet) const {
+    return positionZ[packet];
+  }
+
+  /**
+   * Get color intensity of the light
+   * @param light - index of the light
+   * @return rgb color of the light
+   */
+  [[nodiscard]] const Color &getColorIntensity(unsigned light) const {
+    return colors[light];
+  }
+};
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <limits>
+
+#include "LightGrid.h"
+#include "src/thread-pool/ThreadPool.h"
+
+LightGrid::LightGrid(const std::vector<Light> &lights, const HeightMapBvh &heightMaps)
+  : minimal(heightMaps.getHeightMap(0).getAabbMin()), maximal(heightMaps.getHeightMap(0).getAabbMax()) {
+  for (unsigned i = 1; i < heightMaps.getHeightMapCount(); i++) {
+    minimal = minimal.minimalCoords(heightMaps.getHeightMap(i).getAabbMin());
+    maximal = maximal.maximalCoords(heightMaps.getHeightMap(i).getAabbMax());
+  }
+  for (unsigned light = 0; light < lights.size(); light++) {
+    if (lights[light].getRange() == std::numeric_limits<float>::infinity()) infiniteLights.push_back(light);
+  }
+  blockWidth = (maximal.getX() - minimal.getX()) / float(blocksPerSide);
+  blockDepth = (maximal.getZ() - minimal.getZ()) / float(blocksPerSide);
+
+  // every task fills one block, the blocks are joined to the flat arrays afterwards
+  std::vector<std::vector<unsigned>> blockLights(blocksPerSide * blocksPerSide);
+  std::vector<std::vector<float>> blockWeights(blocksPerSide * blocksPerSide);
+  ThreadPool::getShared().parallelFor(blocksPerSide * blocksPerSide, [&](unsigned block) {
+    auto row = block / blocksPerSide, col = block % blocksPerSide;
+    auto boxMin = Point3d(minimal.getX() + blockWidth * float(col), minimal.getY(), minimal.getZ() + blockDepth * float(row));
+    auto boxMax = Point3d(boxMin.getX() + blockWidth, minimal.getY(), boxMin.getZ() + blockDepth);
+    auto maxHeight = minimal.getY();
+    for (unsigned i = 0; i < heightMaps.getHeightMapCount(); i++) {
+      const auto &heightMap = heightMaps.getHeightMap(i);
+      if (heightMap.getAabbMax().getX() < boxMin.getX() || heightMap.getAabbMin().getX() > boxMax.getX()) continue;
+      if (heightMap.getAabbMax().getZ() < boxMin.getZ() || heightMap.getAabbMin().getZ() > boxMax.getZ()) continue;
+      maxHeight = std::max(maxHeight, getMaxHeight(heightMap, boxMin, boxMax));
+    }
+    boxMax = Point3d(boxMax.getX(), maxHeight, boxMax.getZ());
+
+    for (unsigned light = 0; light < lights.size(); light++) {
+      if (lights[light].getRange() == std::numeric_limits<float>::infinity()) continue;
+      const auto &color = lights[light].getColorIntensity();
+      auto weight = std::max(std::max(color.getR(), color.getG()), color.getB()) * lights[light].getAttenuation(getSquaredDistance(lights[light].getPosition(), boxMin, boxMax));
+      if (weight <= 0.f) continue;
+      blockLights[block].push_back(light);
+      blockWeights[block].push_back(weight);
+    }
+  });
+
+  firstLight.reserve(blockLights.size() + 1);
+  for (unsigned block = 0; block < blockLights.size(); block++) {
+    firstLight.push_back(lightIndices.size());
+    lightIndices.insert(lightIndices.end(), blockLights[block].begin(), blockLights[block].end());
+    auto sum = 0.f;
+    for (auto weight : blockWeights[block]) cumulativeWeights.push_back(sum += weight);
+  }
+  firstLight.push_back(lightIndices.size());
+}
+
+float LightGrid::getMaxHeight(const HeightMap &heightMap, const Point3d &boxMin, const Point3d &boxMax) {
+  if (heightMap.isOutOfCore()) return heightMap.getAabbMax().getY();
+  auto from = heightMap.getGridCoordinates(boxMin.maximalCoords(heightMap.getAabbMin()));
+  auto to = heightMap.getGridCoordinates(boxMax.minimalCoords(heightMap.getAabbMax()));
+  auto maxHeight = std::numeric_limits<float>::lowest();
+  for (auto row = std::max(from.getZ(), 0); row <= to.getZ(); row++) {
+    for (auto col = std::max(from.getX(), 0); col <= to.getX(); col++) maxHeight = std::max(maxHeight, heightMap.getMaxHeight(row, col));
+  }
+  return maxHeight;
+}
+
+float LightGrid::getSquaredDistance(const Point3d &point, const Point3d &boxMin, const Point3d &boxMax) {
+  auto dx = std::max(std::max(boxMin.getX() - point.getX(), point.getX() - boxMax.getX()), 0.f);
+  auto dy = std::max(std::max(boxMin.getY() - point.getY(), point.getY() - boxMax.getY()), 0.f);
+  auto dz = std::max(std::max(boxMin.getZ() - point.getZ(), point.getZ() - boxMax.getZ()), 0.f);
+  return dx * dx + dy * dy + dz * dz;
+}
+
+unsigned LightGrid::getBlock(const Point3d &point) const {
+  auto col = std::clamp(int((point.getX() - minimal.getX()) / blockWidth), 0, int(blocksPerSide - 1));
+  auto row = std::clamp(int((point.getZ() - minimal.getZ()) / blockDepth), 0, int(blocksPerSide - 1));
+  return row * blocksPerSide + col;
+}
+
+unsigned LightGrid::sampleLight(unsigned block, float random, float &probability) const {
+  auto first = cumulativeWeights.begin() + firstLight[block], end = cumulativeWeights.begin() + firstLight[block + 1];
+  auto total = *(end - 1);
+  auto picked = std::min(std::upper_bound(first, end, random * total), end - 1);
+  probability = (*picked - (picked == first ? 0.f : *(picked - 1))) / total;
+  return lightIndices[picked - cumulativeWeights.begin()];
+}
+
+float LightGrid::getAverageLightCount() const {
+  return float(lightIndices.size()) / float(firstLight.size() - 1);
+}
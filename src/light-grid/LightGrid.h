@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+
+#include "src/heightmap/height-map-bvh/HeightMapBvh.h"
+#include "src/light/Light.h"
+#include "src/point/Point3d.h"
+
+/**
+ * Lights culled to the blocks of the terrain, so the shading visits only lights which can reach the shaded point
+ *
+ * Box covering all height maps is split to square blocks in x and z. Every block is bounded in y by the lowest height map bottom
+ * and the maximal height of the cells in the block, it keeps the lights whose range reaches the box.
+ * Every block light has a weight - the strongest color channel faded by the distance to the box, the shading can pick
+ * the lights randomly with probability proportional to the weight instead of visiting all of them.
+ * Lights with infinite range reach all blocks, they are kept separately and always shaded.
+ */
+class LightGrid {
+  constexpr static const unsigned blocksPerSide = 32;
+
+  Point3d minimal, maximal; // box of all height maps
+  float blockWidth, blockDepth;
+  std::vector<unsigned> infiniteLights; // indices of the lights with infinite range
+  std::vector<unsigned> firstLight; // offset of the first light of every block by rows, one more offset for the end
+  std::vector<unsigned> lightIndices; // indices of the block lights in the light vector
+  std::vector<float> cumulativeWeights; // running sum of the weights of the block lights, starting from 0 in every block
+
+  /**
+   * Find maximal height of the height map cells inside the box
+   * Out-of-core height map is bounded by its bounding box, so the tiles are not loaded
+   * @param heightMap - height map overlapping the box
+   * @param boxMin - minimal corner of the box (y is ignored)
+   * @param boxMax - maximal corner of the box (y is ignored)
+   * @return maximal height
+   */
+  [[nodiscard]] static float getMaxHeight(const HeightMap &heightMap, const Point3d &boxMin, const Point3d &boxMax);
+
+  /**
+   * Get squared distance from the point to the box
+   * @param point - point outside or inside the box
+   * @param boxMin - minimal corner of the box
+   * @param boxMax - maximal corner of the box
+   * @return squared distance, 0 for the point in the box
+   */
+  [[nodiscard]] static float getSquaredDistance(const Point3d &point, const Point3d &boxMin, const Point3d &boxMax);
+
+public:
+  /**
+   * Create grid of blocks over the height maps and assign the lights to the blocks, blocks are built in parallel
+   * @param lights - all lights of the scene
+   * @param heightMaps - height maps of the scene
+   */
+  explicit LightGrid(const std::vector<Light> &lights, const HeightMapBvh &heightMaps);
+
+  /**
+   * Get block containing the point, points outside of the height maps belong to the nearest block
+   * @param point - shaded point
+   * @return index of the block
+   */
+  [[nodiscard]] unsigned getBlock(const Point3d &point) const;
+
+  /**
+   * Get lights with infinite range, they are not in the blocks
+   * @return indices of the lights in the scene lights
+   */
+  [[nodiscard]] const std::vector<unsigned> &getInfiniteLights() const {
+    return infiniteLights;
+  }
+
+  /**
+   * Get number of the lights with finite range which can reach the block
+   * @param block - index of the block
+   * @return number of the lights
+   */
+  [[nodiscard]] unsigned getLightCount(unsigned block) const {
+    return firstLight[block + 1] - firstLight[block];
+  }
+
+  /**
+   * Get light of the block
+   * @param block - index of the block
+   * @param i - index of the light in the block
+   * @return index of the light in the scene lights
+   */
+  [[nodiscard]] unsigned getLight(unsigned block, unsigned i) const {
+    return lightIndices[firstLight[block] + i];
+  }
+
+  /**
+   * Pick light of the block with probability proportional to its weight
+   * @param block - index of the block with at least one light
+   * @param random - random number in [0, 1)
+   * @param probability - where the probability of the picked light is stored
+   * @return index of the light in the scene lights
+   */
+  [[nodiscard]] unsigned sampleLight(unsigned block, float random, float &probability) const;
+
+  /**
+   * Get average number of the lights in the blocks
+   * @return lights per block
+   */
+  [[nodiscard]] float getAverageLightCount() const;
+};
@@ -1,13 +1,14 @@
 #include "Light.h"
 
 
-Light::Light(const Point3d &position, const Color &colorIntensity) : position(position), colorIntensity(colorIntensity) {}
+Light::Light(const Point3d &position, const Color &colorIntensity, float range) : position(position), colorIntensity(colorIntensity), range(range) {}
 
 std::string Light::to_string() const {
   const std::string nl = "\r\n";
   auto s = "light(" + nl;
   s += "  position: " + position.to_string() + nl;
   s += "  color: " + colorIntensity.to_string() + nl;
+  s += "  range: " + std::to_string(range) + nl;
   s += ")";
   return s;
 }
@@ -24,3 +25,7 @@ const Color &Light::getColorIntensity() const {
 const Point3d &Light::getPosition() const {
   return position;
 }
+
+float Light::getRange() const {
+  return range;
+}
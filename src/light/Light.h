@@ -1,22 +1,28 @@
 #pragma once
 
+#include <limits>
+
 #include "src/color/Color.h"
 #include "src/point/Point3d.h"
 
 /**
  * Type for storing point light. Stores color and position as 3D point.
+ *
+ * Light with finite range fades out smoothly to zero at the range, so it can be skipped for points farther away
  */
 class Light {
   Point3d position;
   Color colorIntensity;
+  float range;
 
 public:
   /**
    * Create light on given position with given color intensity or white if none given
    * @param position - light position
    * @param colorIntensity - intensity of rgb colors
+   * @param range - distance where the light fades out, infinity for the light which does not fade
    */
-  explicit Light(const Point3d &position, const Color &colorIntensity = Color(1.f, 1.f, 1.f));
+  explicit Light(const Point3d &position, const Color &colorIntensity = Color(1.f, 1.f, 1.f), float range = std::numeric_limits<float>::infinity());
 
   [[nodiscard]] std::string to_string() const;
   friend std::ostream &operator<<(std::ostream &out, const Light &l);
@@ -32,4 +38,20 @@ public:
    * @return 3d point, where the light is located
    */
   [[nodiscard]] const Point3d &getPosition() const;
+
+  /**
+   * Get distance where the light fades out
+   * @return range of the light, infinity if the light does not fade
+   */
+  [[nodiscard]] float getRange() const;
+
+  /**
+   * Get fading of the light with the distance, (1 - (d / range)^2)^2 falls smoothly from 1 in the light position to 0 at the range
+   * @param squaredDistance - squared distance from the light
+   * @return multiplier of the light intensity in [0, 1]
+   */
+  [[nodiscard]] float getAttenuation(float squaredDistance) const {
+    auto fraction = 1.f - squaredDistance / (range * range);
+    return fraction > 0.f ? fraction * fraction : 0.f;
+  }
 };
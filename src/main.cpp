@@ -1,40 +1,130 @@
 #include <GL/glut.h>
+#ifdef GPU_TRAVERSAL
+#include <GL/freeglut.h>
+#endif
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <vector>
 #include <chrono>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <thread>
 
 #include "scene.h"
+#include "src/camera-path/CameraPath.h"
 #include "src/context/Context.h"
+#include "src/frame-writer/FrameWriter.h"
+#include "src/gpu-tracer/GpuTracer.h"
+#include "src/heightmap/map-loader/MapLoader.h"
+#include "src/image-writer/ImageWriter.h"
+#include "src/memory-report/MemoryReport.h"
+#include "src/profiler/Profiler.h"
+#include "src/render-coordinator/RenderCoordinator.h"
+#include "src/render-server/RenderServer.h"
+#include "src/render-worker/RenderWorker.h"
+#include "src/scene-file/SceneFile.h"
 
 
-struct Bitmap {
-  unsigned width, height;
-  std::vector<Color> image;
-
-  Bitmap(unsigned int width, unsigned int height)
-    : width(width), height(height) {
-    image.resize(width * height);
-  }
+/**
+ * Parameters given on the command line
+ */
+struct Arguments {
+  int sceneNumber = scene::sceneNumber;
+  std::string heightMapPath;
+  std::string outputPath; // headless render when set
+  unsigned width = scene::defaultWidth, height = scene::defaultHeight;
+  Point3d center = scene::defaultCenter[scene::sceneNumber];
+  Vector3d eye = scene::defaultEye[scene::sceneNumber];
+  Vector3d up = scene::defaultUp;
+  bool hasCenter = false, hasEye = false;
+  unsigned rawWidth = 0, rawHeight = 0; // size of raw height map, 0 for square map
+  std::string terrainCachePath; // binary file with the built grid
+  std::string horizonCachePath; // binary file with the horizon map
+  std::vector<Point3d> patchPositions; // positions of the other copies of the height map
+  std::string cameraPathPath; // key positions of the camera for the fly-through
+  unsigned frameCount = 0; // number of frames of the fly-through, 0 for one frame per key position
+  std::string pipeCommand; // command receiving the raw frames of the fly-through instead of the files
+  bool printChecksum = false; // print checksum of the color buffer of every rendered image
+  std::string expectedChecksum; // checksum the rendered image has to match, empty without the check
+  unsigned batchJobs = 0; // number of jobs rendered at once by the batch server, 0 without the server
+  std::string sceneFilePath; // scene file with the maps, lights and cameras used instead of the scene number tables
+  std::string cameraName; // camera of the scene file used as the default view
+  std::string texturePath; // image draped over the height maps without their own texture
+  bool printMemory = false; // print memory of the height maps, their structures and the pixel buffers
+  std::vector<std::string> nodeCommands; // commands starting the workers of the distributed rendering, empty to render in this process
+  unsigned regionSize = 128; // size of the regions the distributed rendering splits the frame into
+  bool worker = false; // render the regions requested on the standard input
+  std::string tracePath; // Chrome trace JSON with the timeline of the rendering stages, empty without the profiler
 };
 
-Bitmap bitmap(scene::defaultWidth, scene::defaultHeight);
 Context *pContext;
+MapLoader *pLoader; // height maps still loaded for the window
+unsigned presentedChanges = 0;
+#ifdef GPU_TRAVERSAL
+std::unique_ptr<GpuTracer> gpuTracer; // traces the frames instead of the context with the gpu traversal
+#endif
+
+/**
+ * Draw the color buffer of the context in the OpenGL type of its storage format, so the stored pixels are read without a copy
+ * @param context - context with the color buffer
+ */
+void drawColorBuffer(const Context &context) {
+  const auto &colors = context.getColorBuffer();
+  GLenum format = GL_RGB, type = GL_FLOAT;
+  switch (colors.getFormat()) {
+    case FrameBuffer::Format::Rgba8:
+      format = GL_RGBA;
+      type = GL_UNSIGNED_BYTE;
+      break;
+    case FrameBuffer::Format::Rgb10A2:
+      format = GL_RGBA;
+      type = GL_UNSIGNED_INT_2_10_10_10_REV;
+      break;
+    case FrameBuffer::Format::Half:
+      type = GL_HALF_FLOAT;
+      break;
+    default:
+      break;
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows of the half floats are not padded to four bytes
+  glDrawPixels((int) context.getWidth(), (int) context.getHeight(), format, type, colors.data());
+}
 
 void drawImage() {
   glClearColor(0.0, 0.0, 0.0, 1.0);
   glClear(GL_COLOR_BUFFER_BIT);
 
-  glDrawPixels(bitmap.width, bitmap.height, GL_RGB, GL_FLOAT, bitmap.image.data());
+#ifdef GPU_TRAVERSAL
+  if (gpuTracer) {
+    gpuTracer->render(*pContext);
+    glutSwapBuffers();
+    return;
+  }
+#endif
+  if (pContext != nullptr) {
+    presentedChanges = pContext->getChangeCount();
+    Profiler::Scope scope("framebuffer upload");
+    drawColorBuffer(*pContext);
+  }
 
   glutSwapBuffers();
 }
 
 void onFrame() {
-  if (pContext == nullptr) return;
-  for (int y = 0; y < bitmap.width; y++) {
-    for (int x = 0; x < bitmap.height; x++) {
-      auto color = pContext->getColorBuffer()[x][y];
-      bitmap.image[x + bitmap.height * y] = color;
-    }
+  if (pLoader != nullptr && pLoader->takeReadyMaps(scene::heightMaps)) {
+    // rendering starts again with the newly loaded maps
+    pContext->setHeightMaps(scene::heightMaps);
+    pContext->startProgressiveRayTrace();
+    if (scene::heightMaps.size() == pLoader->getMapCount()) pLoader = nullptr;
+  }
+  if (pContext == nullptr || pContext->getChangeCount() == presentedChanges) {
+    // nothing new to show, do not spin in the idle callback
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return;
   }
   glutPostRedisplay();
 }
@@ -42,50 +132,611 @@ void onFrame() {
 void onKeys(unsigned char key, int x, int y) {
   switch (key) {
     case 27:// ESC
+#ifdef GPU_TRAVERSAL
+      gpuTracer.reset(); // textures are deleted while the OpenGL context exists
+#endif
       exit(0);
   }
 }
 
-int main(int argc, char **argv) {
-  if (argc > 1) {
-    int sn = 0;
-    auto s = argv[1];
-    if (s[0] == '0') {
-      sn = 0;
-    } else if (s[0] == '1') {
-      sn = 1;
-    } else if (s[0] == '2') {
-      sn = 2;
+void printUsage() {
+  std::cout << "If you want to run program with arguments, use:"
+    << std::endl << "[scene_numer] ?[heightmap_path] ?[options]" << std::endl
+    << "where:" << std::endl <<
+    " [scene_numer] = number of scene, you want to run" << std::endl <<
+    " ?[heightmap_path] = {optional}, the path to heightmap you want to display (grayscale image, .r16 / .raw 16-bit or .f32 float raw file)" << std::endl <<
+    " ?[options] = {optional}, any of:" << std::endl <<
+    "   --output [file] = render without window and save the image to the file (.ppm, .png or .tga)" << std::endl <<
+    "   --width [pixels], --height [pixels] = size of the image" << std::endl <<
+    "   --eye [x,y,z], --center [x,y,z], --up [x,y,z] = camera position, point it looks at and up vector" << std::endl <<
+    "   --raw-size [width]x[height] = number of samples in row and number of rows of the raw heightmap (default square map)" << std::endl <<
+    "   --terrain-cache [file] = load the built grid from the binary file, the file is created (or rebuilt when the heightmap changes) if it can not be used" << std::endl <<
+    "   --horizon-shadows [directions] = find the shadows in the horizon map precomputed in the directions instead of the shadow rays (not for --terrain-tiles)" << std::endl <<
+    "   --horizon-cache [file] = load the horizon map from the binary file, the file is created (or rebuilt when the heightmap changes) if it can not be used" << std::endl <<
+    "   --patch [x,y,z] = add another patch of the same heightmap at the position, can be repeated" << std::endl <<
+    "   --ceiling = start primary rays where they get under the coarse blocks of the maximal heights, skipping the cells above the terrain" << std::endl <<
+    "   --lod [levels] = trace far parts of the heightmap in coarser levels of detail, each level halves the resolution" << std::endl <<
+    "   --lod-tolerance [pixels] = coarser level is used where its cell is smaller than the pixels (default " << scene::lodTolerance << ")" << std::endl <<
+    "   --smooth-normals = shade with the normals interpolated from the heightmap samples instead of the flat triangles (not for --terrain-tiles)" << std::endl <<
+    "   --bilinear = intersect the cells as the bilinear patches through their corner samples instead of two triangles, smooth surface" << std::endl <<
+    "     without the diagonal edges from a coarser heightmap (not for --gpu)" << std::endl <<
+    "   --antialiasing [samples] = supersample pixels differing from their neighbours in color or depth by samples x samples rays" << std::endl <<
+    "   --reflections depth = trace reflection rays from the reflective materials (ice) up to this number of bounces" << std::endl <<
+    "   --city-lights [count] = scatter lights with limited range over the heightmap, each pixel is shaded by the lights reaching its terrain block" << std::endl <<
+    "   --light-samples [count] = shade each pixel by this number of the lights picked randomly by their weight (default 0 shades all of them)" << std::endl <<
+    "   --terrain-tiles [cells] = load the heightmap in tiles of cells x cells when rays reach them, instead of reading it whole to memory" << std::endl <<
+    "   --tile-cache [MB] = memory for the loaded terrain tiles (default " << scene::tileCacheMegabytes << ")" << std::endl <<
+    "   --memory-budget [MB] = memory for the heightmaps, maps which do not fit are loaded without the optional structures," << std::endl <<
+    "     with the cells built from the samples, in terrain tiles or with lower resolution" << std::endl <<
+    "   --memory-report = print memory of the heightmaps, their structures and the framebuffers after the rendering (after the loading with --batch," << std::endl <<
+    "     batch line memory prints it again)" << std::endl <<
+    "   --camera-path [file] = render frames of the fly-through along the camera path to the --output files numbered by the frame," << std::endl <<
+    "     every line of the file holds eye and center separated by space: ex,ey,ez cx,cy,cz" << std::endl <<
+    "   --frames [count] = number of frames of the fly-through (default one per line of the camera path)" << std::endl <<
+    "   --pipe [command] = write the fly-through frames as raw rgb24 to the standard input of the command instead of the --output files," << std::endl <<
+    "     e.g. \"ffmpeg -f rawvideo -pix_fmt rgb24 -s 512x512 -i - fly.mp4\"" << std::endl <<
+    "   --batch [jobs] = keep the heightmaps loaded and render jobs read from the standard input, this number of them at once," << std::endl <<
+    "     every line holds one job as eye, center, output file and optionally the image size: ex,ey,ez cx,cy,cz file [width] [height]" << std::endl <<
+    "   --reproject = start rays of every fly-through frame near the intersections of the previous frame, skipping space above the terrain" << std::endl <<
+    "   --beam = walk the frustum of every tile through the max-height pyramids first, its rays start after the empty space common to the tile" << std::endl <<
+    "   --wavefront = trace every pass stage by stage: primary rays of all tiles, shading of their hits, shadow rays of each light sorted by origin," << std::endl <<
+    "     output with the reflections (the image is the same)" << std::endl <<
+    "   --heatmap [counter] = show traversal counter of every pixel as false-color heatmap instead of the shading (needs TRAVERSAL_STATISTICS build)," << std::endl <<
+    "     counter is one of rays, cells, triangles, runs, aabb, shadows" << std::endl <<
+    "   --gpu = trace the window in the OpenGL 4.3 compute shader with the flat shading (needs GPU_TRAVERSAL build, not for --terrain-tiles," << std::endl <<
+    "     all heightmaps have to be patches of the same map)" << std::endl <<
+    "   --framebuffer [format] = storage of the color buffer, one of float, rgba8, rgb10a2, half (default float)" << std::endl <<
+    "   --threads [count] = number of the rendering threads (default all hardware threads)" << std::endl <<
+    "   --checksum = print checksum of the color buffer of the rendered image (of every frame with --camera-path)," << std::endl <<
+    "     it does not depend on the thread count" << std::endl <<
+    "   --expect-checksum [hex] = fail with exit code 1 when the checksum of the --output image differs" << std::endl <<
+    "   --scene [file] = read the height maps, lights, cameras and background from the scene file instead of the scene number, every line is one of:" << std::endl <<
+    "     map path x,y,z width,height,depth [fields|lava|ice] [terrain-cache], cells triangles|bilinear, light x,y,z [r,g,b] [range], camera name ex,ey,ez cx,cy,cz," << std::endl <<
+    "     background r,g,b" << std::endl <<
+    "   --texture [file] = drape the color image over every heightmap (without a texture of the scene file) instead of its material color," << std::endl <<
+    "     the image is sampled from its mip-map levels matching the pixel footprint" << std::endl <<
+    "   --camera [name] = view from the camera of the scene file (default the first camera), batch jobs can use the names instead of ex,ey,ez cx,cy,cz" << std::endl <<
+    "   --progressive-step [pixels] = distance between pixels traced by the first coarse pass in the window (default " << scene::progressiveStep << ")" << std::endl <<
+    "   --node [command] = render the --output image in regions by the workers started by the command (e.g. \"ssh host /path/HeightField\"," << std::endl <<
+    "     the other arguments and --worker are added to it), can be repeated to distribute the regions over several nodes" << std::endl <<
+    "   --region-size [pixels] = size of the regions rendered by the nodes, rounded up to the screen tiles (default 128)" << std::endl <<
+    "   --worker = load the heightmaps and render the regions requested by the coordinator on the standard input (started by --node)" << std::endl <<
+    "   --trace [file] = save the timeline of the stages (decoding, grid builds, passes, tiles with their shading and shadow times, output)" << std::endl <<
+    "     of every thread as Chrome trace JSON when the program exits, for chrome://tracing or Perfetto" << std::endl
+    << "example:" << std::endl << " 2 ../data/Simple.png" << std::endl
+    << " 2 ../data/Simple.png --output simple.png --width 1024 --height 768 --eye 275,350,-1000" << std::endl;
+}
+
+/**
+ * Parse three comma separated numbers
+ * @param value - text in format x,y,z
+ * @param x - parsed x
+ * @param y - parsed y
+ * @param z - parsed z
+ */
+void parseTriple(const std::string &value, float &x, float &y, float &z) {
+  size_t first = 0, second = 0;
+  try {
+    x = std::stof(value, &first);
+    if (value[first] != ',') throw std::invalid_argument("missing comma");
+    y = std::stof(value.substr(first + 1), &second);
+    second += first + 1;
+    if (value[second] != ',') throw std::invalid_argument("missing comma");
+    z = std::stof(value.substr(second + 1));
+  } catch (const std::exception &) {
+    std::cerr << "invalid coordinates " << value << ", expected x,y,z" << std::endl;
+    throw std::invalid_argument("invalid coordinates");
+  }
+}
+
+unsigned parseSize(const std::string &value) {
+  try {
+    auto size = std::stoi(value);
+    if (size > 0) return unsigned(size);
+  } catch (const std::exception &) {}
+  std::cerr << "invalid image size " << value << std::endl;
+  throw std::invalid_argument("invalid image size");
+}
+
+float parsePositive(const std::string &value) {
+  try {
+    auto number = std::stof(value);
+    if (number > 0.f) return number;
+  } catch (const std::exception &) {}
+  std::cerr << "invalid positive number " << value << std::endl;
+  throw std::invalid_argument("invalid positive number");
+}
+
+/**
+ * Parse command line arguments
+ * @return false if the arguments are not valid and usage should be printed
+ */
+bool parseArguments(int argc, char **argv, Arguments &arguments) {
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; i++) {
+    std::string argument = argv[i];
+    if (argument.rfind("--", 0) != 0) {
+      positional.push_back(argument);
+      continue;
+    }
+    if (argument == "--reproject") {
+      scene::reprojectDepth = true;
+      continue;
+    }
+    if (argument == "--checksum") {
+      arguments.printChecksum = true;
+      continue;
+    }
+    if (argument == "--memory-report") {
+      arguments.printMemory = true;
+      continue;
+    }
+    if (argument == "--worker") {
+      arguments.worker = true;
+      continue;
+    }
+    if (argument == "--beam") {
+      scene::beamTraversal = true;
+      continue;
+    }
+    if (argument == "--wavefront") {
+      scene::wavefront = true;
+      continue;
+    }
+    if (argument == "--smooth-normals") {
+      scene::smoothNormals = true;
+      continue;
+    }
+    if (argument == "--bilinear") {
+      scene::bilinearPatches = true;
+      continue;
+    }
+    if (argument == "--ceiling") {
+      scene::heightCeiling = true;
+      continue;
+    }
+    if (argument == "--gpu") {
+#ifndef GPU_TRAVERSAL
+      std::cerr << "gpu traversal needs the compute shader backend, build with GPU_TRAVERSAL" << std::endl;
+      throw std::invalid_argument("gpu traversal disabled");
+#endif
+      scene::gpuTraversal = true;
+      continue;
+    }
+    if (i + 1 >= argc) return false;
+    std::string value = argv[++i];
+    float x, y, z;
+    if (argument == "--output") {
+      if (!ImageWriter::isSupported(value)) {
+        std::cerr << "unsupported output format of " << value << " (use ppm, png or tga)" << std::endl;
+        throw std::invalid_argument("unsupported output format");
+      }
+      arguments.outputPath = value;
+    } else if (argument == "--width") {
+      arguments.width = parseSize(value);
+    } else if (argument == "--height") {
+      arguments.height = parseSize(value);
+    } else if (argument == "--eye") {
+      parseTriple(value, x, y, z);
+      arguments.eye = Vector3d(x, y, z);
+      arguments.hasEye = true;
+    } else if (argument == "--center") {
+      parseTriple(value, x, y, z);
+      arguments.center = Point3d(x, y, z);
+      arguments.hasCenter = true;
+    } else if (argument == "--raw-size") {
+      auto separator = value.find('x');
+      if (separator == std::string::npos) {
+        std::cerr << "invalid raw size " << value << ", expected [width]x[height]" << std::endl;
+        throw std::invalid_argument("invalid raw size");
+      }
+      arguments.rawWidth = parseSize(value.substr(0, separator));
+      arguments.rawHeight = parseSize(value.substr(separator + 1));
+    } else if (argument == "--terrain-cache") {
+      arguments.terrainCachePath = value;
+    } else if (argument == "--horizon-shadows") {
+      scene::horizonDirections = parseSize(value);
+    } else if (argument == "--horizon-cache") {
+      arguments.horizonCachePath = value;
+    } else if (argument == "--patch") {
+      parseTriple(value, x, y, z);
+      arguments.patchPositions.emplace_back(x, y, z);
+    } else if (argument == "--reflections") {
+      scene::reflectionDepth = parseSize(value);
+    } else if (argument == "--antialiasing") {
+      scene::antialiasing = parseSize(value);
+    } else if (argument == "--city-lights") {
+      scene::cityLights = parseSize(value);
+    } else if (argument == "--light-samples") {
+      scene::lightSamples = parseSize(value);
+    } else if (argument == "--lod") {
+      scene::detailLevels = parseSize(value);
+    } else if (argument == "--lod-tolerance") {
+      scene::lodTolerance = parsePositive(value);
+    } else if (argument == "--terrain-tiles") {
+      scene::terrainTileSize = parseSize(value);
+    } else if (argument == "--tile-cache") {
+      scene::tileCacheMegabytes = parseSize(value);
+    } else if (argument == "--memory-budget") {
+      scene::memoryBudgetMegabytes = parseSize(value);
+    } else if (argument == "--camera-path") {
+      arguments.cameraPathPath = value;
+    } else if (argument == "--frames") {
+      arguments.frameCount = parseSize(value);
+    } else if (argument == "--pipe") {
+      arguments.pipeCommand = value;
+    } else if (argument == "--threads") {
+      scene::threadCount = parseSize(value);
+    } else if (argument == "--expect-checksum") {
+      arguments.expectedChecksum = value;
+      std::transform(arguments.expectedChecksum.begin(), arguments.expectedChecksum.end(), arguments.expectedChecksum.begin(), [](unsigned char c) { return std::tolower(c); });
+    } else if (argument == "--scene") {
+      arguments.sceneFilePath = value;
+    } else if (argument == "--texture") {
+      arguments.texturePath = value;
+    } else if (argument == "--camera") {
+      arguments.cameraName = value;
+    } else if (argument == "--batch") {
+      arguments.batchJobs = parseSize(value);
+    } else if (argument == "--framebuffer") {
+      if (!FrameBuffer::parseFormat(value, scene::framebufferFormat)) {
+        std::cerr << "unknown framebuffer format " << value << " (use float, rgba8, rgb10a2 or half)" << std::endl;
+        throw std::invalid_argument("unknown framebuffer format");
+      }
+    } else if (argument == "--heatmap") {
+      if (!TraversalStatistics::parseCounter(value, scene::heatmap)) {
+        std::cerr << "unknown heatmap counter " << value << " (use rays, cells, triangles, runs, aabb or shadows)" << std::endl;
+        throw std::invalid_argument("unknown heatmap counter");
+      }
+#ifndef TRAVERSAL_STATISTICS
+      std::cerr << "heatmap needs the traversal counters, build with TRAVERSAL_STATISTICS" << std::endl;
+      throw std::invalid_argument("traversal statistics disabled");
+#endif
+    } else if (argument == "--node") {
+      arguments.nodeCommands.push_back(value);
+    } else if (argument == "--region-size") {
+      arguments.regionSize = parseSize(value);
+    } else if (argument == "--trace") {
+      arguments.tracePath = value;
+    } else if (argument == "--progressive-step") {
+      scene::progressiveStep = parseSize(value);
+    } else if (argument == "--up") {
+      parseTriple(value, x, y, z);
+      arguments.up = Vector3d(x, y, z);
     } else {
-      std::cout << "If you want to run program with arguments, use:"
-        << std::endl << "[scene_numer] ?[heightmap_path]" << std::endl
-        << "where:" << std::endl <<
-        " [scene_numer] = number of scene, you want to run" << std::endl <<
-        " ?[heightmap_path] = {optional}, the path to heightmap you want to display (grayscale image)" << std::endl
-        << "example:" << std::endl << " 2 ../data/Simple.png";
-      return 0;
+      return false;
     }
-    if (argc > 2) {
-      auto path = argv[2];
-      scene::heightMaps.emplace_back(HeightMap(MapReader(path), scene::heightMapPositions[sn], scene::heightMapDimensions[sn], scene::materials[sn]));
+  }
+
+  if (positional.size() > 2) return false;
+  if (!positional.empty()) {
+    const auto &s = positional[0];
+    if (s.size() != 1 || s[0] < '0' || s[0] > '2') return false;
+    arguments.sceneNumber = s[0] - '0';
+  }
+  if (positional.size() > 1) arguments.heightMapPath = positional[1];
+  if (scene::gpuTraversal && (!arguments.outputPath.empty() || !arguments.pipeCommand.empty() || arguments.batchJobs > 0)) {
+    std::cerr << "gpu traversal draws only to the window, it can not be used with --output, --pipe or --batch" << std::endl;
+    throw std::invalid_argument("gpu traversal without window");
+  }
+  if (!arguments.cameraPathPath.empty() && arguments.outputPath.empty() && arguments.pipeCommand.empty()) {
+    std::cerr << "camera path needs --output or --pipe for the frames" << std::endl;
+    throw std::invalid_argument("missing output");
+  }
+  if (!arguments.expectedChecksum.empty() && (arguments.outputPath.empty() || !arguments.cameraPathPath.empty() || arguments.batchJobs > 0)) {
+    std::cerr << "expected checksum is checked only for the single --output image" << std::endl;
+    throw std::invalid_argument("checksum without output");
+  }
+  if (!arguments.pipeCommand.empty() && arguments.cameraPathPath.empty()) {
+    std::cerr << "frame pipe needs --camera-path" << std::endl;
+    throw std::invalid_argument("pipe without camera path");
+  }
+  if (!arguments.cameraName.empty() && arguments.sceneFilePath.empty()) {
+    std::cerr << "named camera needs --scene" << std::endl;
+    throw std::invalid_argument("camera without scene file");
+  }
+  if (!arguments.sceneFilePath.empty() && (!arguments.heightMapPath.empty() || !arguments.patchPositions.empty())) {
+    std::cerr << "scene file defines the height maps, it can not be used with the heightmap path or --patch" << std::endl;
+    throw std::invalid_argument("scene file with height maps");
+  }
+  if (!arguments.nodeCommands.empty() && (arguments.outputPath.empty() || !arguments.cameraPathPath.empty() || arguments.batchJobs > 0 || scene::gpuTraversal)) {
+    std::cerr << "render nodes render only the single --output image" << std::endl;
+    throw std::invalid_argument("nodes without output");
+  }
+  if (!arguments.nodeCommands.empty() && (arguments.printChecksum || !arguments.expectedChecksum.empty() || arguments.printMemory)) {
+    std::cerr << "checksum and memory report need the buffers of one process, they can not be used with --node" << std::endl;
+    throw std::invalid_argument("checksum with nodes");
+  }
+  if (arguments.worker && (!arguments.outputPath.empty() || !arguments.cameraPathPath.empty() || arguments.batchJobs > 0 || scene::gpuTraversal)) {
+    std::cerr << "worker only renders the regions requested on the standard input" << std::endl;
+    throw std::invalid_argument("worker with output");
+  }
+  if (!arguments.hasCenter) arguments.center = scene::defaultCenter[arguments.sceneNumber];
+  if (!arguments.hasEye) arguments.eye = scene::defaultEye[arguments.sceneNumber];
+  return true;
+}
+
+/**
+ * Format checksum of the color buffer as 16 hexadecimal digits
+ * @param context - context with the rendered color buffer
+ * @return checksum in lower case hexadecimal
+ */
+std::string getChecksum(const Context &context) {
+  std::ostringstream out;
+  out << std::hex << std::setw(16) << std::setfill('0') << context.getColorBuffer().getChecksum();
+  return out.str();
+}
+
+/**
+ * Print memory of the pixel buffers, the lights and the height maps of the context
+ * @param context - rendered context
+ */
+void printMemoryReport(const Context &context) {
+  MemoryReport report;
+  context.reportMemory(report);
+  std::cout << "memory:" << std::endl;
+  report.print(std::cout);
+}
+
+/**
+ * Quote the argument for the shell running the worker command
+ * @param argument - command line argument
+ * @return argument in single quotes
+ */
+std::string quoteArgument(const std::string &argument) {
+  std::string quoted = "'";
+  for (auto c : argument) quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+  return quoted + "'";
+}
+
+/**
+ * Render the --output image in regions by the workers of the nodes and save it, the maps are loaded only by the workers
+ * @param arguments - parsed command line arguments
+ * @param argc - number of the command line arguments
+ * @param argv - command line arguments forwarded to the workers
+ * @return exit code
+ */
+int renderDistributed(const Arguments &arguments, int argc, char **argv) {
+  // the workers get the scene and camera arguments, the options of the coordinator are left out
+  std::string workerArguments;
+  for (int i = 1; i < argc; i++) {
+    std::string argument = argv[i];
+    if (argument == "--output" || argument == "--node" || argument == "--region-size" || argument == "--trace") {
+      i++;
+      continue;
+    }
+    workerArguments += " " + quoteArgument(argument);
+  }
+  std::vector<std::string> commands;
+  for (const auto &command : arguments.nodeCommands) commands.push_back(command + workerArguments + " --worker");
+
+  // regions of whole screen tiles, so the tiles at the borders are not traced twice
+  auto regionSize = (arguments.regionSize + scene::tileSize - 1) / scene::tileSize * scene::tileSize;
+  auto start = std::chrono::steady_clock::now();
+  RenderCoordinator coordinator(commands, arguments.width, arguments.height, regionSize);
+  try {
+    coordinator.render();
+  } catch (const std::invalid_argument &) {
+    return 1; // the failed nodes were reported
+  }
+  auto renderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "rendered " << arguments.width << "x" << arguments.height << " on " << commands.size() << " nodes in " << renderTime << " ms" << std::endl;
+  coordinator.printStatistics(std::cout);
+  try {
+    ImageWriter::save(arguments.outputPath, arguments.width, arguments.height, coordinator.getPixels());
+  } catch (const std::invalid_argument &) {
+    return 1; // the failed output was reported
+  }
+  return 0;
+}
+
+/**
+ * Get name of the file of one frame, the frame number is added before the extension
+ * @param outputPath - output file given on the command line
+ * @param frame - number of the frame
+ * @return name of the frame file
+ */
+std::string getFramePath(const std::string &outputPath, unsigned frame) {
+  auto number = std::to_string(frame);
+  number = std::string(number.size() < 4 ? 4 - number.size() : 0, '0') + number;
+  auto dot = outputPath.rfind('.');
+  return outputPath.substr(0, dot) + "_" + number + outputPath.substr(dot);
+}
+
+/**
+ * Render all frames of the fly-through and save them, the height maps and the context are kept between the frames
+ * Frames are written by the frame writer on its own thread while the next frame is rendered
+ * @param arguments - parsed command line arguments
+ */
+void renderFlyThrough(const Arguments &arguments) {
+  CameraPath cameraPath(arguments.cameraPathPath);
+  auto frameCount = arguments.frameCount > 0 ? arguments.frameCount : cameraPath.getKeyCount();
+  scene::printTileStatistics = false;
+
+  Vector3d eye;
+  Point3d center;
+  double totalTime = 0.;
+  auto start = std::chrono::steady_clock::now();
+  FrameWriter writer(arguments.pipeCommand);
+  std::unique_ptr<Context> context;
+  for (unsigned frame = 0; frame < frameCount; frame++) {
+    cameraPath.getCamera(frame, frameCount, eye, center);
+    auto frameStart = std::chrono::steady_clock::now();
+    if (!context) {
+      context = std::make_unique<Context>(arguments.width, arguments.height, scene::heightMaps, scene::bgColor, center, eye, arguments.up);
     } else {
-      scene::heightMaps.emplace_back(HeightMap(MapReader(scene::heightMapPaths[sn]), scene::heightMapPositions[sn], scene::heightMapDimensions[sn], scene::materials[sn]));
+      context->setCamera(center, eye, arguments.up);
+      context->rayTrace();
+    }
+    auto frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    totalTime += frameTime;
+    std::cout << "frame " << frame << " rendered in " << frameTime << " ms";
+    if (arguments.printChecksum) std::cout << ", checksum " << getChecksum(*context);
+    std::cout << std::endl;
+    writer.submit(*context, arguments.pipeCommand.empty() ? getFramePath(arguments.outputPath, frame) : "");
+  }
+  writer.finish();
+  auto wallTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "rendered " << frameCount << " frames " << arguments.width << "x" << arguments.height << " in " << totalTime << " ms ("
+    << totalTime / double(frameCount) << " ms per frame), " << wallTime << " ms with the output" << std::endl;
+  writer.printStatistics(std::cout);
+  if (arguments.printMemory && context) printMemoryReport(*context);
+}
+
+int main(int argc, char **argv) {
+  Arguments arguments;
+  try {
+    if (!parseArguments(argc, argv, arguments)) {
+      printUsage();
+      return 0;
+    }
+  } catch (const std::invalid_argument &) {
+    printUsage();
+    return 1;
+  }
+
+  Profiler::setThreadName("main");
+  if (!arguments.tracePath.empty()) {
+    // the trace is saved on every exit, including the exit of the window
+    Profiler::start(arguments.tracePath);
+    std::atexit([] { Profiler::finish(); });
+  }
+
+  if (!arguments.nodeCommands.empty()) return renderDistributed(arguments, argc, argv);
+  // the standard output of the worker carries the rendered regions, its messages go to the error output
+  if (arguments.worker) std::cout.rdbuf(std::cerr.rdbuf());
+
+  auto sn = arguments.sceneNumber;
+  scene::sceneNumber = sn;
+  auto loadStart = std::chrono::steady_clock::now();
+  std::vector<MapLoader::Request> requests;
+  std::vector<std::string> texturePaths; // texture of every request, empty for the material color
+  std::vector<SceneFile::Camera> cameras;
+  if (!arguments.sceneFilePath.empty()) {
+    try {
+      SceneFile sceneFile(arguments.sceneFilePath, scene::materials[sn], scene::defaultBgColor, scene::bilinearPatches);
+      for (const auto &map : sceneFile.getMaps()) {
+        requests.push_back({map.path, map.position, map.size, map.material, map.terrainCachePath, map.bilinearPatches});
+        texturePaths.push_back(map.texturePath);
+      }
+      // the cache of the command line belongs to the first map, when the scene file does not give its own
+      if (requests[0].terrainCachePath.empty()) requests[0].terrainCachePath = arguments.terrainCachePath;
+      scene::sceneLights = sceneFile.getLights();
+      scene::bgColor = sceneFile.getBgColor();
+      cameras = sceneFile.getCameras();
+      const auto *camera = arguments.cameraName.empty() ? (cameras.empty() ? nullptr : &cameras[0]) : sceneFile.findCamera(arguments.cameraName);
+      if (camera == nullptr && !arguments.cameraName.empty()) {
+        std::cerr << "scene file " << arguments.sceneFilePath << " has no camera " << arguments.cameraName << std::endl;
+        return 1;
+      }
+      if (camera != nullptr && !arguments.hasEye) arguments.eye = camera->eye;
+      if (camera != nullptr && !arguments.hasCenter) arguments.center = camera->center;
+    } catch (const std::invalid_argument &) {
+      return 1; // the invalid scene file was reported
     }
-    scene::sceneNumber = sn;
   } else {
-    int sn = scene::sceneNumber;
-    scene::heightMaps.emplace_back(HeightMap(MapReader(scene::heightMapPaths[sn]), scene::heightMapPositions[sn], scene::heightMapDimensions[sn], scene::materials[sn]));
+    auto path = arguments.heightMapPath.empty() ? scene::heightMapPaths[sn] : arguments.heightMapPath;
+    const auto &size = scene::heightMapDimensions[sn];
+    const auto &material = scene::materials[sn];
+    requests.push_back({path, scene::heightMapPositions[sn], size, material, arguments.terrainCachePath, scene::bilinearPatches});
+    for (const auto &position : arguments.patchPositions) requests.push_back({path, position, size, material, "", scene::bilinearPatches});
+  }
+  texturePaths.resize(requests.size());
+  try {
+    // maps with the same image share its texture
+    std::map<std::string, std::shared_ptr<const Texture>> textures;
+    for (size_t i = 0; i < requests.size(); i++) {
+      const auto &texturePath = texturePaths[i].empty() ? arguments.texturePath : texturePaths[i];
+      if (texturePath.empty()) continue;
+      auto &texture = textures[texturePath];
+      if (!texture) texture = std::make_shared<const Texture>(texturePath);
+      requests[i].material.setTexture(texture);
+    }
+  } catch (const std::invalid_argument &) {
+    return 1; // the invalid texture was reported
   }
-  auto context = Context();
+  MapLoader loader(std::move(requests), arguments.rawWidth, arguments.rawHeight, arguments.horizonCachePath);
+  // the window renders the first map while the others are loaded, the maps must not move while the context renders them
+  scene::heightMaps.reserve(loader.getMapCount());
+  auto isWindow = arguments.outputPath.empty() && arguments.pipeCommand.empty() && arguments.batchJobs == 0 && !scene::gpuTraversal && !arguments.worker;
+  loader.waitForMaps(scene::heightMaps, isWindow ? 1 : loader.getMapCount());
+  auto loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+  std::cout << "loaded " << scene::heightMaps.size() << " of " << loader.getMapCount() << " height maps in " << loadTime << " ms" << std::endl;
+  if (arguments.printMemory) {
+    std::cout << "decoded height maps held at most " << double(loader.getPeakSourceMemory()) / (1024. * 1024.) << " MB while loading" << std::endl;
+  }
+
+  if (arguments.worker) {
+    scene::printTileStatistics = false;
+    Context context(arguments.width, arguments.height, scene::heightMaps, scene::bgColor, arguments.center, arguments.eye, arguments.up, false);
+    RenderWorker worker(context);
+    return worker.run(std::cin, stdout) ? 0 : 1;
+  }
+
+  if (arguments.batchJobs > 0) {
+    RenderServer server(scene::heightMaps, cameras, arguments.batchJobs, arguments.width, arguments.height, arguments.up);
+    if (arguments.printMemory) server.printMemory();
+    return server.run(std::cin) > 0 ? 1 : 0;
+  }
+
+  if (!arguments.cameraPathPath.empty()) {
+    try {
+      renderFlyThrough(arguments);
+    } catch (const std::invalid_argument &) {
+      return 1; // the failed output was reported
+    }
+    return 0;
+  }
+
+  if (!arguments.outputPath.empty()) {
+    auto start = std::chrono::steady_clock::now();
+    auto context = Context(arguments.width, arguments.height, scene::heightMaps, scene::bgColor, arguments.center, arguments.eye, arguments.up);
+    auto renderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "rendered " << arguments.width << "x" << arguments.height << " in " << renderTime << " ms" << std::endl;
+    for (const auto &heightMap : scene::heightMaps) heightMap.printTileCacheStatistics(std::cout);
+    if (context.getLightGrid()) {
+      std::cout << "lights: " << context.getLights().size() << ", " << context.getLightGrid()->getAverageLightCount() << " per terrain block on average" << std::endl;
+    }
+    if (arguments.printMemory) printMemoryReport(context);
+    ImageWriter::save(context, arguments.outputPath);
+    auto checksum = getChecksum(context);
+    if (arguments.printChecksum || !arguments.expectedChecksum.empty()) std::cout << "checksum: " << checksum << std::endl;
+    if (!arguments.expectedChecksum.empty() && checksum != arguments.expectedChecksum) {
+      std::cerr << "checksum " << checksum << " differs from the expected " << arguments.expectedChecksum << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  // window shows the partial image while it is refined in the background, the gpu traces the whole frame at once
+  scene::progressiveRendering = !scene::gpuTraversal;
+  auto context = Context(arguments.width, arguments.height, scene::heightMaps, scene::bgColor, arguments.center, arguments.eye, arguments.up);
+
   pContext = &context;
+  if (scene::heightMaps.size() < loader.getMapCount()) pLoader = &loader;
 
   glutInit(&argc, argv);
 
-  glutInitWindowSize((int) bitmap.width, (int) bitmap.height);
+  glutInitWindowSize((int) context.getWidth(), (int) context.getHeight());
 
   glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
 
+#ifdef GPU_TRAVERSAL
+  if (scene::gpuTraversal) {
+    glutInitContextVersion(4, 3);
+    glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
+  }
+#endif
   glutCreateWindow("Window Title");
+#ifdef GPU_TRAVERSAL
+  if (scene::gpuTraversal) {
+    try {
+      gpuTracer = std::make_unique<GpuTracer>(scene::heightMaps, context);
+    } catch (const std::invalid_argument &) {
+      return 1;
+    }
+  }
+#endif
   glutDisplayFunc(drawImage);
   glutKeyboardFunc(onKeys);
 
@@ -0,0 +1,70 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const std::string &fileName, bool sequential) {
+#ifdef _WIN32
+  auto file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+  LARGE_INTEGER fileSize;
+  if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    std::cerr << "invalid file" << std::endl;
+    throw std::invalid_argument("received invalid file");
+  }
+  auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  auto view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (!view) {
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    std::cerr << "file can not be mapped to memory" << std::endl;
+    throw std::invalid_argument("received file that can not be mapped");
+  }
+  fileHandle = file;
+  mappingHandle = mapping;
+  size = size_t(fileSize.QuadPart);
+  data = static_cast<const unsigned char *>(view);
+#else
+  auto file = open(fileName.c_str(), O_RDONLY);
+  struct stat info{};
+  if (file < 0 || fstat(file, &info) != 0 || info.st_size == 0) {
+    if (file >= 0) close(file);
+    std::cerr << "invalid file" << std::endl;
+    throw std::invalid_argument("received invalid file");
+  }
+  auto view = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+  close(file); // mapping stays valid
+  if (view == MAP_FAILED) {
+    std::cerr << "file can not be mapped to memory" << std::endl;
+    throw std::invalid_argument("received file that can not be mapped");
+  }
+  if (sequential) madvise(view, size_t(info.st_size), MADV_SEQUENTIAL);
+  size = size_t(info.st_size);
+  data = static_cast<const unsigned char *>(view);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+  UnmapViewOfFile(data);
+  CloseHandle(mappingHandle);
+  CloseHandle(fileHandle);
+#else
+  munmap(const_cast<unsigned char *>(data), size);
+#endif
+}
+
+const unsigned char *MappedFile::getData() const {
+  return data;
+}
+
+size_t MappedFile::getSize() const {
+  return size;
+}
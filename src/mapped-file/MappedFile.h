@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <stdexcept>
+#include <iostream>
+
+/**
+ * Read-only file mapped to memory
+ *
+ * Pages of the file are read by the operating system when they are accessed, so the file does not need to fit in memory
+ */
+class MappedFile {
+  const unsigned char *data = nullptr;
+  size_t size = 0;
+#ifdef _WIN32
+  void *fileHandle = nullptr, *mappingHandle = nullptr;
+#endif
+
+public:
+  /**
+   * Map the whole file to memory
+   * @param fileName - name of the file
+   * @param sequential - true if the file is going to be read from the start to the end
+   */
+  explicit MappedFile(const std::string &fileName, bool sequential = false);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /**
+   * Get the mapped content of the file
+   * @return pointer to the first byte of the file
+   */
+  [[nodiscard]] const unsigned char *getData() const;
+
+  /**
+   * Get size of the file
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getSize() const;
+};
@@ -1,9 +1,15 @@
+#include <algorithm>
+
 #include "Material.h"
 
 Material::Material(const Color &color, float kd, float ks, float shine)
   : color(color), kd(kd), ks(ks), shine(shine) {}
 
-Material::Material(ColorChanging c) : color(), kd(1.f), ks(0), shine(0), changing(c) {}
+Material::Material(ColorChanging c) : color(), kd(1.f), ks(0), shine(0), changing(c) {
+  if (!isChangeColor()) return;
+  if (c == ColorChanging::ICE) reflectivity = iceReflectivity;
+  for (unsigned i = 0; i <= gradientSegments; i++) gradient.push_back(getGradientColor(c, float(i) / float(gradientSegments)));
+}
 
 std::string Material::to_string() const {
   if (isChangeColor()) {
@@ -30,6 +36,13 @@ const Color &Material::getColor() const {
 }
 
 Color Material::getColor(float heightFactor) const {
+  auto position = std::clamp(heightFactor, 0.f, 1.f) * float(gradientSegments);
+  auto index = std::min(unsigned(position), gradientSegments - 1);
+  auto fraction = position - float(index);
+  return gradient[index] * (1.f - fraction) + gradient[index + 1] * fraction;
+}
+
+Color Material::getGradientColor(ColorChanging changing, float heightFactor) {
   heightFactor *= 3;
   auto c1 = heightFactor > 1 ? 1 : heightFactor;
   auto c2 = heightFactor > 2 ? 1 : std::max(heightFactor - 1, 0.f);
@@ -43,6 +56,18 @@ Color Material::getColor(float heightFactor) const {
   return Color(c2, c1, c3);
 }
 
+void Material::setTexture(std::shared_ptr<const Texture> texture) {
+  this->texture = std::move(texture);
+}
+
+const Texture *Material::getTexture() const {
+  return texture.get();
+}
+
+float Material::getReflectivity() const {
+  return reflectivity;
+}
+
 bool Material::isChangeColor() const {
   return changing != ColorChanging::NONE;
 }
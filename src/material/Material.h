@@ -1,6 +1,10 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "src/color/Color.h"
+#include "src/texture/Texture.h"
 
 /**
  * Color changing types
@@ -16,11 +20,25 @@ enum ColorChanging {
  * Type for storing the material values
  */
 class Material {
+  constexpr static const float iceReflectivity = .3f;
+  constexpr static const unsigned gradientSegments = 3 * 256; // multiple of 3, so the knots of the gradients lie on the table entries
+
   Color color;
   float kd;
   float ks;
   float shine;
   ColorChanging changing = ColorChanging::NONE;
+  std::vector<Color> gradient; // colors at heights 0, 1 / gradientSegments, ..., 1 for changing materials, empty otherwise
+  float reflectivity = 0.f; // part of the color given by the reflected ray
+  std::shared_ptr<const Texture> texture; // texture draped over the height map instead of the color, shared by the copies of the material
+
+  /**
+   * Compute color of the changing material
+   * @param changing - type of changing color
+   * @param heightFactor - height of the sample
+   * @return rgb color
+   */
+  [[nodiscard]] static Color getGradientColor(ColorChanging changing, float heightFactor);
 
 public:
   /**
@@ -48,12 +66,30 @@ public:
   [[nodiscard]] const Color &getColor() const;
 
   /**
-   * Get color due to height
-   * @param heightFactor - height of the sample
+   * Get color due to height, interpolated from the precomputed gradient table
+   * @param heightFactor - height of the sample, clamped to [0, 1]
    * @return rgb color
    */
   [[nodiscard]] Color getColor(float heightFactor) const ;
 
+  /**
+   * Drape the texture over the height map, its color replaces the color of the material
+   * @param texture - texture spanning the whole height map, nullptr to use the color again
+   */
+  void setTexture(std::shared_ptr<const Texture> texture);
+
+  /**
+   * Get texture of the material
+   * @return texture draped over the height map, nullptr if the material has none
+   */
+  [[nodiscard]] const Texture *getTexture() const;
+
+  /**
+   * Get reflectivity of the material, used only when the scene traces the reflections
+   * @return part of the color given by the reflected ray, 0 for materials without reflections
+   */
+  [[nodiscard]] float getReflectivity() const;
+
   /**
    * True if color is changing due to height
    * @return true if color depends on height
@@ -1,49 +1,78 @@
+#include <stdexcept>
+
 #include "Matrix4d.h"
 
-void Matrix4d::getCofactor(const float matrixData[4][4], float cofactor[4][4], int r, int c, int n) {
-  int i = 0, j = 0;
-  for (int row = 0; row < n; row++) {
-    for (int col = 0; col < n; col++) {
-      if (row != r && col != c) {
-        cofactor[i][j] = matrixData[row][col];
-        j++;
-        if (j == n - 1) {
-          j = 0;
-          i++;
-        }
-      }
-    }
-  }
+bool Matrix4d::isAffine() const {
+  return data[3][0] == 0.f && data[3][1] == 0.f && data[3][2] == 0.f && data[3][3] == 1.f;
 }
 
-float Matrix4d::getDeterminant(const float matrixData[4][4], int n) const {
-  float determinant = 0.f;
-  if (n == 1) return matrixData[0][0];
+void Matrix4d::throwSingular() {
+  std::cerr << "Matrix to invert was singular!";
+  throw std::invalid_argument("Matrix given to invert is singular");
+}
 
-  float cofactors[4][4];
-  float sign = 1.f;
+Matrix4d Matrix4d::getAffineInverted() const {
+  const auto &m = data;
+  // cofactors of the first row, the determinant is expanded along it
+  auto c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+  auto c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+  auto c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+  auto determinant = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+  if (determinant == 0.f) throwSingular();
+  auto inverse = 1.f / determinant;
 
-  for (int f = 0; f < n; f++) {
-    getCofactor(matrixData, cofactors, 0, f, n);
-    determinant += sign * matrixData[0][f] * getDeterminant(cofactors, n - 1);
-    sign = -sign;
+  Matrix4d inverted;
+  auto &r = inverted.data;
+  r[0][0] = c00 * inverse;
+  r[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inverse;
+  r[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inverse;
+  r[1][0] = c01 * inverse;
+  r[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inverse;
+  r[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inverse;
+  r[2][0] = c02 * inverse;
+  r[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inverse;
+  r[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inverse;
+  // translation is moved back by the inverted linear part
+  for (int row = 0; row < 3; row++) {
+    r[row][3] = -(r[row][0] * m[0][3] + r[row][1] * m[1][3] + r[row][2] * m[2][3]);
   }
-  return determinant;
+  r[3][3] = 1.f;
+  return inverted;
 }
 
-Matrix4d Matrix4d::getAdj() const {
-  Matrix4d adj;
-  float sign;
-  float cof[4][4];
-
-  for (int r = 0; r < 4; r++) {
-    for (int c = 0; c < 4; c++) {
-      getCofactor(data, cof, r, c);
-      sign = ((r + c) % 2 == 0) ? 1.f : -1.f;
-      adj.data[c][r] = sign * (getDeterminant(cof, 3));
-    }
-  }
-  return adj;
+Matrix4d Matrix4d::getGeneralInverted() const {
+  const auto &m = data;
+  // 2 x 2 determinants of the two upper rows and of the two lower rows, the 3 x 3 cofactors are combined from them
+  auto s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+  auto s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+  auto s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+  auto s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+  auto s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+  auto s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+  auto c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+  auto c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+  auto c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+  auto c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+  auto c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+  auto c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+  auto determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+  if (determinant == 0.f) throwSingular();
+  auto inverse = 1.f / determinant;
+
+  float r[4][4] = {
+    {m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3, -m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3,
+      m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3, -m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3},
+    {-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1, m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1,
+      -m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1, m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1},
+    {m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0, -m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0,
+      m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0, -m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0},
+    {-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0, m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0,
+      -m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0, m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0},
+  };
+  Matrix4d inverted;
+  auto scale = Float4(inverse);
+  for (int row = 0; row < 4; row++) (Float4(r[row]) * scale).store(inverted.data[row]);
+  return inverted;
 }
 
 Matrix4d::Matrix4d() : data{{0, 0, 0, 0},
@@ -58,21 +87,22 @@ Matrix4d::Matrix4d(float d[4][4]) : data{
   {d[3][0], d[3][1], d[3][2], d[3][3]}} {}
 
 Vector4d Matrix4d::operator*(const Vector4d &vector) const {
-  float result[4] = {0, 0, 0, 0};
-  for (auto r1 = 0; r1 < 4; r1++) {
-    for (auto c1 = 0; c1 < 4; c1++) {
-      result[r1] += this->data[r1][c1] * vector.get(c1);
-    }
-  }
+  // columns are scaled by the coordinates, lane r sums row r in the order of the columns
+  auto sum = Float4(data[0][0], data[1][0], data[2][0], data[3][0]) * Float4(vector.get(0));
+  for (auto c = 1; c < 4; c++) sum = sum + Float4(data[0][c], data[1][c], data[2][c], data[3][c]) * Float4(vector.get(c));
+  float result[4];
+  sum.store(result);
   return Vector4d(result);
 }
 
 Matrix4d Matrix4d::operator*(const Matrix4d &matrix) const {
-  Matrix4d result = Matrix4d();
-  for (auto r1 = 0; r1 < 4; r1++)
-    for (auto c2 = 0; c2 < 4; c2++)
-      for (auto c1 = 0; c1 < 4; c1++)
-        result.data[r1][c2] += this->data[r1][c1] * matrix.data[c1][c2];
+  // row of the result is the sum of the rows of the other matrix scaled by the elements of the row of this matrix
+  Matrix4d result;
+  for (auto r = 0; r < 4; r++) {
+    auto sum = Float4(data[r][0]) * Float4(matrix.data[0]);
+    for (auto c = 1; c < 4; c++) sum = sum + Float4(data[r][c]) * Float4(matrix.data[c]);
+    sum.store(result.data[r]);
+  }
   return result;
 }
 
@@ -103,18 +133,7 @@ Matrix4d Matrix4d::getTransposed() const {
 }
 
 Matrix4d Matrix4d::getInverted() const {
-  float determinant = getDeterminant(this->data);
-  if (determinant == 0.f) {
-    std::cerr << "Matrix to invert was singular!";
-    throw std::invalid_argument("Matrix given to invert is singular");
-  }
-
-  Matrix4d inverted;
-  Matrix4d adj = getAdj();
-  for (int row = 0; row < 4; row++)
-    for (int col = 0; col < 4; col++)
-      inverted.data[row][col] = adj.data[row][col] / determinant;
-  return inverted;
+  return isAffine() ? getAffineInverted() : getGeneralInverted();
 }
 
 
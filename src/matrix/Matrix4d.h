@@ -2,34 +2,42 @@
 
 #include <iostream>
 
+#include "src/simd/Float4.h"
 #include "src/vector/Vector4d.h"
 
 /**
  * Type for transformation matrices.
  * Provides static functions for basic matrix transformation (identity, translate, rotate (x, y, z), scale)
  * Provides multiplication by other matrix or by 4d vector, transposition and inverting
+ *
+ * Rows are stored by four floats, so the products add whole rows (SSE) in the same order as the scalar sums.
+ * Inverse is written in the closed form, the affine matrices (last row 0, 0, 0, 1) invert only their 3 x 3 part.
  */
 class Matrix4d {
-  float data[4][4];
+  alignas(16) float data[4][4];
+
+  /**
+   * Check that the matrix is affine transformation
+   * @return true if the last row is 0, 0, 0, 1
+   */
+  [[nodiscard]] bool isAffine() const;
+
   /**
-   * Save cofactors to given matrix
-   * @param cofactors - matrix data where cofactors are saved
-   * @param r - row
-   * @param c - column
+   * Get inverted affine matrix from the inverse of its 3 x 3 part and its translation
+   * @return inverted matrix
    */
-  static void getCofactor(const float matrixData[4][4], float cofactors[4][4], int r, int c, int n = 4);
+  [[nodiscard]] Matrix4d getAffineInverted() const;
+
   /**
-   * Get adjacent matrix
-   * @return adjacent matrix
+   * Get inverted matrix of any invertible matrix from its 2 x 2 sub-determinants
+   * @return inverted matrix
    */
-  [[nodiscard]] Matrix4d getAdj() const;
+  [[nodiscard]] Matrix4d getGeneralInverted() const;
+
   /**
-   * Get determinant of given matrix
-   * @param matrix - matrix we are finding determinant to
-   * @param n - size of matrix
-   * @return
+   * Report the singular matrix given to invert
    */
-  [[nodiscard]] float getDeterminant(const float matrixData[4][4], int n = 4) const;
+  [[noreturn]] static void throwSingular();
 
 public:
   /**
@@ -55,7 +63,7 @@ public:
   [[nodiscard]] Matrix4d getTransposed() const;
 
   /**
-   * Get inverted matrix
+   * Get inverted matrix, the matrix has to be invertible
    * @return inverted matrix
    */
   [[nodiscard]] Matrix4d getInverted() const;
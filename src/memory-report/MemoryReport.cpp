@@ -0,0 +1,39 @@
+#include <algorithm>
+#include <iomanip>
+
+#include "MemoryReport.h"
+
+void MemoryReport::add(const std::string &category, size_t bytes) {
+  if (bytes == 0) return;
+  auto found = std::find_if(categories.begin(), categories.end(), [&category](const auto &entry) { return entry.first == category; });
+  if (found == categories.end()) categories.emplace_back(category, bytes);
+  else found->second += bytes;
+}
+
+bool MemoryReport::addShared(const void *owner, const std::string &category, size_t bytes) {
+  if (owner == nullptr || !counted.insert(owner).second) return false;
+  add(category, bytes);
+  return true;
+}
+
+size_t MemoryReport::get(const std::string &category) const {
+  auto found = std::find_if(categories.begin(), categories.end(), [&category](const auto &entry) { return entry.first == category; });
+  return found == categories.end() ? 0 : found->second;
+}
+
+size_t MemoryReport::getTotal() const {
+  size_t total = 0;
+  for (const auto &[category, bytes] : categories) total += bytes;
+  return total;
+}
+
+void MemoryReport::print(std::ostream &out) const {
+  auto toMegabytes = [](size_t bytes) { return double(bytes) / (1024. * 1024.); };
+  auto flags = out.flags();
+  auto precision = out.precision();
+  out << std::fixed << std::setprecision(2);
+  for (const auto &[category, bytes] : categories) out << "  " << category << ": " << toMegabytes(bytes) << " MB" << std::endl;
+  out << "  total: " << toMegabytes(getTotal()) << " MB" << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * Bytes used by the structures of the renderer, summed by categories
+ *
+ * Structures shared by the copies of the height maps (tiles, normals, horizon maps, tile caches, textures) are reported with their owner,
+ * so every shared structure is counted only once however many maps use it.
+ */
+class MemoryReport {
+  std::vector<std::pair<std::string, size_t>> categories; // in the order the categories were first reported
+  std::unordered_set<const void *> counted; // owners of the shared structures already in the report
+
+public:
+  /**
+   * Add bytes to the category, empty structures do not create the category
+   * @param category - name of the category
+   * @param bytes - number of the added bytes
+   */
+  void add(const std::string &category, size_t bytes);
+
+  /**
+   * Add bytes of the shared structure to the category, unless the structure was already reported
+   * @param owner - address of the shared structure
+   * @param category - name of the category
+   * @param bytes - memory of the structure in bytes
+   * @return true if the structure was reported for the first time
+   */
+  bool addShared(const void *owner, const std::string &category, size_t bytes);
+
+  /**
+   * Get bytes of the category
+   * @param category - name of the category
+   * @return bytes of the category, 0 if nothing was reported to it
+   */
+  [[nodiscard]] size_t get(const std::string &category) const;
+
+  /**
+   * Get bytes of all categories
+   * @return sum of the categories
+   */
+  [[nodiscard]] size_t getTotal() const;
+
+  /**
+   * Print the categories and the total in megabytes, one per line
+   * @param out - output stream
+   */
+  void print(std::ostream &out) const;
+};
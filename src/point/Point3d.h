@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <ostream>
 #include <string>
+#include <type_traits>
 
 #include "src/vector/Vector3d.h"
 
@@ -9,6 +11,7 @@
  * Type for 3D point
  *
  * Provides basic meaningful operation (+, -, *, /) for point and between point and vector (moving point on vector)
+ * Operations are inline in the header, so temporaries on the per-pixel path stay in registers
  */
 class Point3d {
   float x, y, z;
@@ -17,7 +20,7 @@ public:
   /**
    * Create point in coordinates origin
    */
-  explicit Point3d();
+  constexpr explicit Point3d() : x(0.f), y(0.f), z(0.f) {}
 
   /**
    * Create point with provided x, y, z coordinates.
@@ -25,28 +28,85 @@ public:
    * @param y - y coordinate
    * @param z - z coordinate
    */
-  explicit Point3d(float x, float y, float z);
-
-  Point3d operator+(const Point3d &other) const;
-  Point3d operator+=(const Point3d &other);
-
-  Point3d operator-(const Point3d &other) const;
-  Point3d operator-=(const Point3d &other);
-
-  Point3d operator*(float k) const;
-  friend Point3d operator*(float k, const Point3d &point);
-  Point3d operator*=(float k);
-
-  Point3d operator/(float k) const;
-  Point3d operator/=(float k);
-
-  Point3d operator+(const Vector3d &vector) const;
-  friend Point3d operator+(Vector3d &vector, const Point3d &point);
-  Point3d operator+=(const Vector3d &vector);
-
-  Point3d operator-(const Vector3d &vector) const;
-  friend Vector3d operator-(Vector3d &vector, const Point3d &point);
-  Point3d operator-=(const Vector3d &vector);
+  constexpr explicit Point3d(float x, float y, float z) : x(x), y(y), z(z) {}
+
+  constexpr Point3d operator+(const Point3d &other) const {
+    return Point3d(x + other.x, y + other.y, z + other.z);
+  }
+
+  constexpr Point3d operator+=(const Point3d &other) {
+    x += other.x;
+    y += other.y;
+    z += other.z;
+    return *this;
+  }
+
+  constexpr Point3d operator-(const Point3d &other) const {
+    return Point3d(x - other.x, y - other.y, z - other.z);
+  }
+
+  constexpr Point3d operator-=(const Point3d &other) {
+    x -= other.x;
+    y -= other.y;
+    z -= other.z;
+    return *this;
+  }
+
+  constexpr Point3d operator*(float k) const {
+    return Point3d(x * k, y * k, z * k);
+  }
+
+  constexpr friend Point3d operator*(float k, const Point3d &point) {
+    return Point3d(point.x * k, point.y * k, point.z * k);
+  }
+
+  constexpr Point3d operator*=(float k) {
+    x *= k;
+    y *= k;
+    z *= k;
+    return *this;
+  }
+
+  constexpr Point3d operator/(float k) const {
+    return Point3d(x / k, y / k, z / k);
+  }
+
+  constexpr Point3d operator/=(float k) {
+    x /= k;
+    y /= k;
+    z /= k;
+    return *this;
+  }
+
+  constexpr Point3d operator+(const Vector3d &vector) const {
+    return Point3d(x + vector.getX(), y + vector.getY(), z + vector.getZ());
+  }
+
+  constexpr friend Point3d operator+(const Vector3d &vector, const Point3d &point) {
+    return point + vector;
+  }
+
+  constexpr Point3d operator+=(const Vector3d &vector) {
+    x += vector.getX();
+    y += vector.getY();
+    z += vector.getZ();
+    return *this;
+  }
+
+  constexpr Point3d operator-(const Vector3d &vector) const {
+    return Point3d(x - vector.getX(), y - vector.getY(), z - vector.getZ());
+  }
+
+  constexpr friend Vector3d operator-(const Vector3d &vector, const Point3d &point) {
+    return Vector3d(vector.getX() - point.x, vector.getY() - point.y, vector.getZ() - point.z);
+  }
+
+  constexpr Point3d operator-=(const Vector3d &vector) {
+    x -= vector.getX();
+    y -= vector.getY();
+    z -= vector.getZ();
+    return *this;
+  }
 
   [[nodiscard]] std::string to_string() const;
   friend std::ostream &operator<<(std::ostream &out, const Point3d &point);
@@ -55,50 +115,68 @@ public:
    * Get x coordinate of the point
    * @return x coordinate
    */
-  [[nodiscard]] float getX() const;
+  [[nodiscard]] constexpr float getX() const {
+    return x;
+  }
 
   /**
    * Get y coordinate of the point
    * @return y coordinate
    */
-  [[nodiscard]] float getY() const;
+  [[nodiscard]] constexpr float getY() const {
+    return y;
+  }
 
   /**
    * Get z coordinate of the point
    * @return z coordinate
    */
-  [[nodiscard]] float getZ() const;
+  [[nodiscard]] constexpr float getZ() const {
+    return z;
+  }
 
   /**
    * Get i-th coordinate of the point, for example y for i = 1.
    * @param i number of parameter in list [x, y, z]
    * @return x, y or z
    */
-  [[nodiscard]] float get(unsigned i) const;
+  [[nodiscard]] constexpr float get(unsigned i) const {
+    return i == 0 ? x : i == 1 ? y : z;
+  }
 
   /**
    * Get minimal coordinates in x, y and z separately from this and other point
    * @param other - other point
    * @return minimal coordinates in x, y and z
    */
-  [[nodiscard]] Point3d minimalCoords(Point3d &other) const;
+  [[nodiscard]] constexpr Point3d minimalCoords(const Point3d &other) const {
+    return Point3d(std::min(x, other.x), std::min(y, other.y), std::min(z, other.z));
+  }
 
   /**
    * Get maximal coordinates in x, y and z separately from this and other point
    * @param other - other point
    * @return maximal coordinates in x, y and z
    */
-  [[nodiscard]] Point3d maximalCoords(Point3d &other) const;
+  [[nodiscard]] constexpr Point3d maximalCoords(const Point3d &other) const {
+    return Point3d(std::max(x, other.x), std::max(y, other.y), std::max(z, other.z));
+  }
 
   /**
    * Get vector between this and other point
    * @return 3d vector between this and other point
    */
-  [[nodiscard]] Vector3d getVectorBetween(const Point3d &other) const;
+  [[nodiscard]] constexpr Vector3d getVectorBetween(const Point3d &other) const {
+    return Vector3d(x - other.x, y - other.y, z - other.z);
+  }
 
   /**
    * Get normalized vector between this and other point
    * @return normalized 3d vector between this and other point
    */
-  [[nodiscard]] Vector3d getNormalizedVectorBetween(const Point3d &other) const;
+  [[nodiscard]] Vector3d getNormalizedVectorBetween(const Point3d &other) const {
+    return getVectorBetween(other).normalized();
+  }
 };
+
+static_assert(std::is_trivially_copyable_v<Point3d>, "points are copied as plain floats on the per-pixel path");
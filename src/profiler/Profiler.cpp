@@ -0,0 +1,89 @@
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "Profiler.h"
+
+std::mutex Profiler::mutex;
+std::vector<std::unique_ptr<Profiler::ThreadEvents>> Profiler::threads;
+Profiler::Clock::time_point Profiler::origin;
+std::string Profiler::fileName;
+
+void Profiler::record(const Event &event) {
+  if (threadEvents == nullptr) {
+    std::lock_guard lock(mutex);
+    threads.push_back(std::make_unique<ThreadEvents>());
+    threadEvents = threads.back().get();
+    threadEvents->id = unsigned(threads.size());
+    threadEvents->name = threadName.empty() ? "thread " + std::to_string(threadEvents->id) : threadName;
+  }
+  std::lock_guard lock(threadEvents->mutex);
+  threadEvents->events.push_back(event);
+}
+
+double Profiler::getMicroseconds(Clock::time_point time) {
+  return std::chrono::duration<double, std::micro>(time - origin).count();
+}
+
+void Profiler::start(const std::string &traceFileName) {
+  fileName = traceFileName;
+  origin = Clock::now();
+  active = true;
+}
+
+bool Profiler::finish() {
+  if (!active.exchange(false)) return true;
+  std::ofstream out(fileName);
+  if (!out) {
+    std::cerr << "cannot open trace file " << fileName << std::endl;
+    return false;
+  }
+  auto writeText = [&out](const std::string &text) {
+    out << '"';
+    for (auto c : text) {
+      if (c == '"' || c == '\\') out << '\\';
+      out << c;
+    }
+    out << '"';
+  };
+  out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  auto first = true;
+  std::lock_guard lock(mutex);
+  for (const auto &thread : threads) {
+    std::lock_guard threadLock(thread->mutex);
+    out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id << ",\"args\":{\"name\":";
+    writeText(thread->name);
+    out << "}}";
+    first = false;
+    for (const auto &event : thread->events) {
+      out << ",\n{\"name\":";
+      writeText(event.name);
+      out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id << ",\"ts\":" << getMicroseconds(event.start)
+        << ",\"dur\":" << getMicroseconds(event.end) - getMicroseconds(event.start);
+      if (event.argumentCount > 0) {
+        out << ",\"args\":{";
+        for (unsigned i = 0; i < event.argumentCount; i++) {
+          out << (i > 0 ? "," : "");
+          writeText(event.argumentNames[i]);
+          out << ":" << event.argumentValues[i];
+        }
+        out << "}";
+      }
+      out << "}";
+    }
+  }
+  out << "\n]}" << std::endl;
+  if (!out) {
+    std::cerr << "cannot write trace file " << fileName << std::endl;
+    return false;
+  }
+  std::cout << "trace saved to " << fileName << std::endl;
+  return true;
+}
+
+void Profiler::setThreadName(const std::string &name) {
+  threadName = name;
+  if (threadEvents == nullptr) return;
+  std::lock_guard lock(threadEvents->mutex);
+  threadEvents->name = name;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Timeline of the rendering stages recorded by scoped timers of every thread, saved as Chrome trace JSON (chrome://tracing or Perfetto)
+ *
+ * Nothing is recorded until the profiler is started, an inactive scope only checks one flag and reads no clock. Every thread keeps
+ * its own list of events, so the threads of the pool do not wait for each other, the lists are written when the profiler finishes.
+ * The timers are placed around whole stages (decoding, grid builds, passes, tiles, frame output), the time of the per-pixel work
+ * (shading, shadow rays) is summed by the accumulating timers into the arguments of the enclosing tile.
+ */
+class Profiler {
+  using Clock = std::chrono::steady_clock;
+
+  constexpr static const unsigned maxArguments = 4;
+
+  /**
+   * One finished scope
+   */
+  struct Event {
+    const char *name;
+    Clock::time_point start, end;
+    unsigned argumentCount;
+    const char *argumentNames[maxArguments];
+    double argumentValues[maxArguments];
+  };
+
+  /**
+   * Events recorded by one thread
+   */
+  struct ThreadEvents {
+    unsigned id;
+    std::string name;
+    std::vector<Event> events;
+    std::mutex mutex; // the finishing thread reads the events while the thread can still add them
+  };
+
+  inline static std::atomic<bool> active = false;
+  inline static thread_local std::string threadName;
+  inline static thread_local ThreadEvents *threadEvents = nullptr; // events of the thread, registered with its first event
+  static std::mutex mutex;
+  static std::vector<std::unique_ptr<ThreadEvents>> threads;
+  static Clock::time_point origin;
+  static std::string fileName;
+
+  /**
+   * Store the event to the list of the calling thread
+   * @param event - finished scope
+   */
+  static void record(const Event &event);
+
+  /**
+   * Get microseconds since the start of the profiler
+   * @param time - time of the event
+   * @return microseconds
+   */
+  [[nodiscard]] static double getMicroseconds(Clock::time_point time);
+
+public:
+  /**
+   * Timer of one stage, the event is recorded when the scope ends
+   */
+  class Scope {
+    Event event;
+    bool recording;
+
+  public:
+    /**
+     * Start the timer if the profiler is active
+     * @param name - name of the stage, the text has to live until the profiler finishes (string literal)
+     */
+    explicit Scope(const char *name) : event{name, {}, {}, 0, {}, {}}, recording(isActive()) {
+      if (recording) event.start = Clock::now();
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+    /**
+     * Record the event
+     */
+    ~Scope() {
+      if (!recording) return;
+      event.end = Clock::now();
+      record(event);
+    }
+
+    /**
+     * Add number shown with the event, arguments over the limit are dropped
+     * @param name - name of the argument (string literal)
+     * @param value - value of the argument
+     */
+    void setArgument(const char *name, double value) {
+      if (!recording || event.argumentCount == maxArguments) return;
+      event.argumentNames[event.argumentCount] = name;
+      event.argumentValues[event.argumentCount++] = value;
+    }
+  };
+
+  /**
+   * Timer adding the time of its scope to a sum, for the work too fine for its own events
+   */
+  class Accumulator {
+    double *milliseconds;
+    Clock::time_point start;
+
+  public:
+    /**
+     * Start the timer if the profiler is active and there is a sum
+     * @param milliseconds - sum where the time is added, null to measure nothing
+     */
+    explicit Accumulator(double *milliseconds) : milliseconds(isActive() ? milliseconds : nullptr) {
+      if (this->milliseconds) start = Clock::now();
+    }
+
+    Accumulator(const Accumulator &) = delete;
+    Accumulator &operator=(const Accumulator &) = delete;
+
+    ~Accumulator() {
+      if (milliseconds) *milliseconds += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+  };
+
+  /**
+   * Check if the events are recorded
+   * @return true between the start and the finish of the profiler
+   */
+  [[nodiscard]] static bool isActive() {
+    return active.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Start recording the events
+   * @param traceFileName - JSON file where the trace is saved by the finish
+   */
+  static void start(const std::string &traceFileName);
+
+  /**
+   * Stop recording and save the events of all threads to the trace file, nothing happens if the profiler was not started
+   * @return false if the file could not be written (it is reported)
+   */
+  static bool finish();
+
+  /**
+   * Name the calling thread in the trace, it can be called before the profiler starts
+   * @param name - name of the thread
+   */
+  static void setThreadName(const std::string &name);
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <type_traits>
+
 #include "src/point/Point3d.h"
 #include "src/vector/Vector3d.h"
 
@@ -16,7 +18,7 @@ public:
    * @param origin - origin of the ray
    * @param direction - direction where ray is heading
    */
-  explicit Ray(const Point3d &origin, const Vector3d &direction);
+  constexpr explicit Ray(const Point3d &origin, const Vector3d &direction) : origin(origin), direction(direction) {}
 
   [[nodiscard]] std::string to_string() const;
   friend std::ostream &operator<<(std::ostream &out, const Ray &ray);
@@ -26,17 +28,25 @@ public:
    * @param t - parameter
    * @return 3d point on parameter
    */
-  [[nodiscard]] Point3d getPointOnParameter(float t) const;
+  [[nodiscard]] constexpr Point3d getPointOnParameter(float t) const {
+    return origin + t * direction;
+  }
 
   /**
    * Get ray origin
    * @return origin of the ray
    */
-  [[nodiscard]] const Point3d &getOrigin() const;
+  [[nodiscard]] constexpr const Point3d &getOrigin() const {
+    return origin;
+  }
 
   /**
    * Get ray direction
    * @return direction of the ray
    */
-  [[nodiscard]] const Vector3d &getDirection() const;
+  [[nodiscard]] constexpr const Vector3d &getDirection() const {
+    return direction;
+  }
 };
+
+static_assert(std::is_trivially_copyable_v<Ray>, "rays are copied as plain floats on the per-pixel path");
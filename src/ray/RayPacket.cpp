@@ -0,0 +1,11 @@
+#include "RayPacket.h"
+
+RayPacket::RayPacket(const Point3d &origin, const Float4 &directionX, const Float4 &directionY, const Float4 &directionZ)
+  : originX(origin.getX()), originY(origin.getY()), originZ(origin.getZ()), directionX(directionX), directionY(directionY), directionZ(directionZ) {}
+
+Ray RayPacket::getRay(unsigned lane) const {
+  float o[3][size], d[3][size];
+  originX.store(o[0]), originY.store(o[1]), originZ.store(o[2]);
+  directionX.store(d[0]), directionY.store(d[1]), directionZ.store(d[2]);
+  return Ray(Point3d(o[0][lane], o[1][lane], o[2][lane]), Vector3d(d[0][lane], d[1][lane], d[2][lane]));
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Ray.h"
+#include "src/simd/Float4.h"
+
+/**
+ * Type for packet of four rays stored as structure of arrays, so they can be processed at once by SIMD operations
+ */
+class RayPacket {
+  Float4 originX, originY, originZ;
+  Float4 directionX, directionY, directionZ;
+
+public:
+  /**
+   * Number of rays in the packet
+   */
+  constexpr static const unsigned size = 4;
+
+  /**
+   * Create packet of rays with common origin
+   * @param origin - origin of all rays
+   * @param directionX - x coordinates of the ray directions
+   * @param directionY - y coordinates of the ray directions
+   * @param directionZ - z coordinates of the ray directions
+   */
+  explicit RayPacket(const Point3d &origin, const Float4 &directionX, const Float4 &directionY, const Float4 &directionZ);
+
+  /**
+   * Get one ray of the packet
+   * @param lane - index of the ray in the packet
+   * @return ray
+   */
+  [[nodiscard]] Ray getRay(unsigned lane) const;
+
+  [[nodiscard]] const Float4 &getOriginX() const { return originX; }
+  [[nodiscard]] const Float4 &getOriginY() const { return originY; }
+  [[nodiscard]] const Float4 &getOriginZ() const { return originZ; }
+  [[nodiscard]] const Float4 &getDirectionX() const { return directionX; }
+  [[nodiscard]] const Float4 &getDirectionY() const { return directionY; }
+  [[nodiscard]] const Float4 &getDirectionZ() const { return directionZ; }
+};
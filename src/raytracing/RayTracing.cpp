@@ -1,44 +1,670 @@
+#include <chrono>
+#include <iomanip>
+
 #include "RayTracing.h"
+#include "src/counter-random/CounterRandom.h"
 #include "src/illumination/Illumination.h"
+#include "src/profiler/Profiler.h"
+#include "src/thread-pool/ThreadPool.h"
 
 RayTracing::RayTracing(const Matrix4d inverseMatrix, const Matrix4d inverseModelView, Context *context)
-  : inverseMatrix(inverseMatrix), inverseModelView(inverseModelView), contextP(context) {}
-
-void RayTracing::computeRayTrace() const {
-  auto rayOrigin = (inverseModelView * Vector4d(0, 0, 0, 1)).divideByW();
-  auto dirX = (inverseMatrix * Vector4d(1.f, 0.f, 0.f, 0.f)).ignoreW();
-  auto dirY = (inverseMatrix * Vector4d(0.f, 1.f, 0.f, 0.f)).ignoreW();
-  auto dirO = (inverseMatrix * Vector4d(.5f, .5f, -1.f, 1.f)).divideByW().getVectorBetween(rayOrigin);
-
-  for (auto y = 0; y < contextP->getHeight(); y++) {
-    auto addY = dirY * y;
-    auto minimalDir = dirO + addY;
-    for (auto x = 0; x < contextP->getWidth(); x++) {
-      auto rayDirection = (minimalDir + dirX * x).normalized();
-      Ray ray(rayOrigin, rayDirection);
+  : inverseMatrix(inverseMatrix), inverseModelView(inverseModelView), contextP(context) {
+  rayOrigin = (inverseModelView * Vector4d(0, 0, 0, 1)).divideByW();
+  dirX = (inverseMatrix * Vector4d(1.f, 0.f, 0.f, 0.f)).ignoreW();
+  dirY = (inverseMatrix * Vector4d(0.f, 1.f, 0.f, 0.f)).ignoreW();
+  dirO = (inverseMatrix * Vector4d(.5f, .5f, -1.f, 1.f)).divideByW().getVectorBetween(rayOrigin);
+  viewAxis = dirX.crossProduct(dirY).normalized();
+  if (viewAxis.dotProduct(dirO) < 0.f) viewAxis = viewAxis * -1.f;
+  pixelSize = std::max(dirX.length(), dirY.length()) / dirO.length();
+  if (scene::detailLevels > 0) footprint = pixelSize;
+}
+
+Ray RayTracing::getPrimaryRay(unsigned x, unsigned y) const {
+  auto direction = dirO + dirY * float(y) + dirX * float(x);
+  return Ray(rayOrigin, direction.normalized());
+}
+
+bool RayTracing::isShadowed(const Point3d &point, const Point3d &lightPosition, const HeightMap &heightMap, float footprintSize) const {
+  if (heightMap.getHorizonMap()) return heightMap.isBelowHorizon(point, lightPosition);
+  COUNT_TRAVERSAL(shadowRays, 1);
+  Profiler::Accumulator timer(profiledTile ? &profiledTile->shadowMilliseconds : nullptr);
+  return contextP->getHeightMaps().isOccluded(point, lightPosition, footprintSize);
+}
+
+Color RayTracing::getMaterialColor(const Ray &ray, float t, const Vector3d &normal, const HeightMap &heightMap) const {
+  const auto &material = heightMap.getMaterial();
+  auto point = ray.getPointOnParameter(t);
+  if (const auto *texture = material.getTexture()) {
+    const auto &min = heightMap.getAabbMin(), &max = heightMap.getAabbMax();
+    auto width = max.getX() - min.getX(), depth = max.getZ() - min.getZ();
+    // the pixel grows with the distance and is stretched on the surface seen at a grazing angle
+    auto cosine = std::max(std::abs(ray.getDirection().dotProduct(normal)), textureGrazingCosine);
+    auto size = pixelSize * t / cosine;
+    return texture->sample((point.getX() - min.getX()) / width, (point.getZ() - min.getZ()) / depth, size / width);
+  }
+  return material.isChangeColor() ? material.getColor(heightMap.getHeightFraction(point.getY())) : material.getColor();
+}
+
+Color RayTracing::shade(const Ray &ray, const Intersection &intersection, const HeightMap &heightMap, unsigned x, unsigned y) const {
+  Profiler::Accumulator timer(profiledTile ? &profiledTile->shadingMilliseconds : nullptr);
+  auto intersectPoint = ray.getPointOnParameter(intersection.getT());
+  auto normal = heightMap.hasVertexNormals() ? heightMap.getVertexNormal(intersectPoint) : intersection.getNormal();
+  auto materialColor = getMaterialColor(ray, intersection.getT(), normal, heightMap);
+  auto footprintSize = footprint * intersection.getT();
+  if (contextP->getLightGrid()) return shadeManyLights(ray, Intersection(intersection.getT(), normal), heightMap, materialColor, footprintSize, x, y);
+
+  auto color = Illumination::getDirectPhongIllumination(contextP->getLightBatch(), heightMap.getMaterial(), materialColor, ray, Intersection(intersection.getT(), normal));
+  for (auto &light : contextP->getLights()) {
+    if (isShadowed(intersectPoint, light.getPosition(), heightMap, footprintSize)) {
+      color *= shadowAttenuation; // leave some color
+    }
+  }
+  return color;
+}
+
+Color RayTracing::shadeManyLights(const Ray &ray, const Intersection &intersection, const HeightMap &heightMap, const Color &materialColor, float footprintSize, unsigned x, unsigned y) const {
+  const auto &lightGrid = *contextP->getLightGrid();
+  const auto &lights = contextP->getLights();
+  const auto &material = heightMap.getMaterial();
+  auto intersectPoint = ray.getPointOnParameter(intersection.getT());
+
+  auto color = Color(0, 0, 0);
+  auto addLight = [&](unsigned light, float weight) {
+    Color lightColor;
+    if (!Illumination::getPhongIllumination(lights[light], material, materialColor, ray, intersectPoint, intersection.getNormal(), lightColor)) return;
+    if (isShadowed(intersectPoint, lights[light].getPosition(), heightMap, footprintSize)) {
+      lightColor *= shadowAttenuation; // leave some color
+    }
+    color += lightColor * weight;
+  };
+  for (auto light : lightGrid.getInfiniteLights()) addLight(light, 1.f);
+
+  auto block = lightGrid.getBlock(intersectPoint);
+  auto count = lightGrid.getLightCount(block);
+  if (scene::lightSamples == 0 || count <= scene::lightSamples) {
+    for (unsigned i = 0; i < count; i++) addLight(lightGrid.getLight(block, i), 1.f);
+    return color;
+  }
+  for (unsigned sample = 0; sample < scene::lightSamples; sample++) {
+    float probability;
+    // lights of every pixel are picked by the same numbers whatever thread traces it, so every frame picks the same lights
+    auto light = lightGrid.sampleLight(block, CounterRandom::get(x, y, sample), probability);
+    addLight(light, 1.f / (float(scene::lightSamples) * probability));
+  }
+  return color;
+}
+
+void RayTracing::queueReflection(SecondaryRays &secondary, const Ray &ray, const Intersection &intersection, const HeightMap &heightMap, const Color &color,
+  unsigned x, unsigned y, unsigned blockSize) {
+  auto reflectivity = heightMap.getMaterial().getReflectivity();
+  secondary.pixels.push_back({x, y, blockSize, color * (1.f - reflectivity)});
+  secondary.rays.push_back({getReflectedRay(ray, intersection, heightMap), reflectivity, unsigned(secondary.pixels.size() - 1)});
+}
+
+Color RayTracing::traceLane(const RayPacket &packet, int hits, const float tLow[RayPacket::size], const float tHigh[RayPacket::size], unsigned lane, float tStart,
+  unsigned x, unsigned y, float &depth, SecondaryRays *secondary, unsigned blockSize, std::vector<Hit> *deferredHits) const {
+  depth = std::numeric_limits<float>::infinity();
+  if (!(hits & (1 << lane))) {
+    COUNT_TRAVERSAL(boundingBoxRejects, 1);
+    return contextP->getBgColor();
+  }
+  auto ray = packet.getRay(lane);
+  Intersection intersection;
+  const HeightMap *heightMap;
+  if (!contextP->getHeightMaps().findIntersection(ray, tLow[lane], tHigh[lane], tStart, footprint, intersection, heightMap)) return contextP->getBgColor();
+  depth = intersection.getT();
+  if (deferredHits) {
+    deferredHits->push_back({x, y, blockSize, ray, intersection, heightMap, ray.getPointOnParameter(depth), footprint * depth, Color()});
+    return Color();
+  }
+  auto color = shade(ray, intersection, *heightMap, x, y);
+  if (secondary && heightMap->getMaterial().getReflectivity() > 0.f) queueReflection(*secondary, ray, intersection, *heightMap, color, x, y, blockSize);
+  return color;
+}
+
+Ray RayTracing::getReflectedRay(const Ray &ray, const Intersection &intersection, const HeightMap &heightMap) {
+  auto point = ray.getPointOnParameter(intersection.getT());
+  auto normal = heightMap.hasVertexNormals() ? heightMap.getVertexNormal(point) : intersection.getNormal();
+  const auto &direction = ray.getDirection();
+  auto reflected = direction - normal * (2.f * direction.dotProduct(normal));
+  auto cellSize = (heightMap.getAabbMax().getX() - heightMap.getAabbMin().getX()) / float(heightMap.getGridWidth());
+  return Ray(point + normal * (cellSize * reflectionOffset), reflected.normalized());
+}
+
+unsigned RayTracing::traceSecondaryRays(SecondaryRays &secondary) const {
+  const auto &heightMaps = contextP->getHeightMaps();
+  auto &rays = secondary.rays;
+  std::vector<SecondaryRays::Reflection> next;
+  unsigned traced = 0;
+  for (unsigned bounce = 1; bounce <= scene::reflectionDepth && !rays.empty(); bounce++) {
+    // cells of the grid over the box of the origins, the octant of the direction is the most significant part of the key
+    auto infinity = std::numeric_limits<float>::infinity();
+    auto minX = infinity, minZ = infinity, maxX = -infinity, maxZ = -infinity;
+    for (const auto &reflection : rays) {
+      const auto &origin = reflection.ray.getOrigin();
+      minX = std::min(minX, origin.getX());
+      minZ = std::min(minZ, origin.getZ());
+      maxX = std::max(maxX, origin.getX());
+      maxZ = std::max(maxZ, origin.getZ());
+    }
+    auto scaleX = float(coherenceGrid) / std::max(maxX - minX, 1e-6f), scaleZ = float(coherenceGrid) / std::max(maxZ - minZ, 1e-6f);
+    auto getKey = [&](const SecondaryRays::Reflection &reflection) {
+      const auto &origin = reflection.ray.getOrigin();
+      const auto &direction = reflection.ray.getDirection();
+      auto octant = unsigned(direction.getX() < 0.f) | unsigned(direction.getY() < 0.f) << 1u | unsigned(direction.getZ() < 0.f) << 2u;
+      auto col = std::min(unsigned((origin.getX() - minX) * scaleX), coherenceGrid - 1);
+      auto row = std::min(unsigned((origin.getZ() - minZ) * scaleZ), coherenceGrid - 1);
+      return (octant * coherenceGrid + row) * coherenceGrid + col;
+    };
+    std::stable_sort(rays.begin(), rays.end(), [&getKey](const auto &first, const auto &second) { return getKey(first) < getKey(second); });
+
+    next.clear();
+    for (const auto &[ray, weight, pixel] : rays) {
+      auto &target = secondary.pixels[pixel];
       Intersection intersection;
-      auto hasIntersection = contextP->getHeightMap()->findIntersection(ray, intersection);
-      auto color = contextP->getBgColor();
-      if (hasIntersection) {
-        auto intersectPoint = ray.getPointOnParameter(intersection.getT());
-        auto heightFactor = contextP->getHeightMap()->getHeightFraction(intersectPoint.getY());
-        color = Illumination::getDirectPhongIllumination(contextP->getLights(), contextP->getHeightMap()->getMaterial(), ray, intersection, heightFactor);
-        for (auto &light : contextP->getLights()) {
-          auto shadowRay = Ray(light.getPosition(), (intersectPoint.getNormalizedVectorBetween(light.getPosition())));
-          Intersection shadowIntersection;
-          auto hasShadowIntersection = contextP->getHeightMap()->findIntersection(shadowRay, shadowIntersection);
-          if (!hasShadowIntersection) continue;
-
-          auto shIntersectPoint = shadowRay.getPointOnParameter(shadowIntersection.getT());
-          auto coords = contextP->getHeightMap()->getGridCoordinates(intersectPoint);
-          auto shCoords = contextP->getHeightMap()->getGridCoordinates(shIntersectPoint);
-          if (shCoords != coords) {
-            color *= 0.1f; // leave some color
-          }
-        }
+      const HeightMap *heightMap;
+      if (!heightMaps.findIntersection(ray, intersection, heightMap, 0.f)) {
+        target.color += contextP->getBgColor() * weight;
+        continue;
+      }
+      auto color = shade(ray, intersection, *heightMap, target.x, target.y);
+      // the last bounce takes the whole color of the reflected surface
+      auto reflectivity = bounce < scene::reflectionDepth ? heightMap->getMaterial().getReflectivity() : 0.f;
+      target.color += color * (weight * (1.f - reflectivity));
+      if (reflectivity > 0.f) next.push_back({getReflectedRay(ray, intersection, *heightMap), weight * reflectivity, pixel});
+    }
+    traced += rays.size();
+    rays.swap(next);
+  }
+  rays.clear();
+  return traced;
+}
+
+bool RayTracing::isBeamAbove(const HeightMap &heightMap, const Vector3d corners[4], float near, float far) const {
+  auto infinity = std::numeric_limits<float>::infinity();
+  auto minX = infinity, minY = infinity, minZ = infinity, maxX = -infinity, maxZ = -infinity;
+  for (unsigned i = 0; i < 8; i++) {
+    auto point = rayOrigin + corners[i % 4] * (i < 4 ? near : far);
+    minX = std::min(minX, point.getX());
+    minY = std::min(minY, point.getY());
+    minZ = std::min(minZ, point.getZ());
+    maxX = std::max(maxX, point.getX());
+    maxZ = std::max(maxZ, point.getZ());
+  }
+  if (minY > heightMap.getAabbMax().getY()) return true;
+  return minY > heightMap.getAreaMaxHeight(minX, minZ, maxX, maxZ);
+}
+
+float RayTracing::getBeamStart(const Tile &tile) const {
+  // pixel centers lie on the integer coordinates, directions of the rays inside the tile are convex combinations of the corners
+  auto firstX = float(tile.x), firstY = float(tile.y), lastX = float(tile.x + tile.width - 1), lastY = float(tile.y + tile.height - 1);
+  Vector3d corners[4] = {dirO + dirX * firstX + dirY * firstY, dirO + dirX * lastX + dirY * firstY,
+    dirO + dirX * firstX + dirY * lastY, dirO + dirX * lastX + dirY * lastY};
+  auto axisProjection = dirO.dotProduct(viewAxis); // point on parameter s of any direction has depth s * axisProjection
+
+  const auto &heightMaps = contextP->getHeightMaps();
+  auto start = std::numeric_limits<float>::infinity();
+  for (unsigned i = 0; i < heightMaps.getHeightMapCount(); i++) {
+    const auto &heightMap = heightMaps.getHeightMap(i);
+    const auto &aabbMin = heightMap.getAabbMin(), &aabbMax = heightMap.getAabbMax();
+    // the box lies between the depths of its nearest and its farthest corner
+    auto nearDepth = std::numeric_limits<float>::infinity(), farDepth = std::numeric_limits<float>::lowest();
+    for (unsigned corner = 0; corner < 8; corner++) {
+      auto point = Point3d(corner & 1 ? aabbMax.getX() : aabbMin.getX(), corner & 2 ? aabbMax.getY() : aabbMin.getY(), corner & 4 ? aabbMax.getZ() : aabbMin.getZ());
+      auto depth = point.getVectorBetween(rayOrigin).dotProduct(viewAxis);
+      nearDepth = std::min(nearDepth, depth);
+      farDepth = std::max(farDepth, depth);
+    }
+    if (farDepth <= 0.f) continue; // height map behind the eye
+    auto near = std::max(nearDepth, 0.f) / axisProjection, far = farDepth / axisProjection;
+
+    // slabs grow with the distance like the footprint of the tile, the blocked slab is halved before the walk stops
+    auto minimalStep = (far - near) / float(beamMinimalSteps);
+    auto getStep = [minimalStep](float parameter) { return std::max(parameter * (beamStepGrowth - 1.f), minimalStep); };
+    auto step = getStep(near);
+    unsigned refinements = 0;
+    while (near < far && near < start) {
+      if (isBeamAbove(heightMap, corners, near, near + step)) {
+        near += step;
+        step = getStep(near);
+        refinements = 0;
+      } else if (refinements < beamRefinements) {
+        step *= .5f;
+        refinements++;
+      } else {
+        break;
+      }
+    }
+    if (near < far) start = std::min(start, near);
+  }
+  return start;
+}
+
+void RayTracing::tracePacket(unsigned x, unsigned y, unsigned count, unsigned stride, unsigned blockSize, float beamStart, TraversalStatistics &statistics,
+  SecondaryRays *secondary, std::vector<Hit> *deferredHits) const {
+  auto rowDirection = dirO + dirY * float(y);
+  auto xs = Float4(float(x), float(x + stride), float(x + 2 * stride), float(x + 3 * stride));
+  auto dx = Float4(rowDirection.getX()) + Float4(dirX.getX()) * xs;
+  auto dy = Float4(rowDirection.getY()) + Float4(dirX.getY()) * xs;
+  auto dz = Float4(rowDirection.getZ()) + Float4(dirX.getZ()) * xs;
+  auto length = sqrt(dx * dx + dy * dy + dz * dz);
+  RayPacket packet(rayOrigin, dx / length, dy / length, dz / length);
+
+  float tLow[RayPacket::size], tHigh[RayPacket::size];
+  auto hits = contextP->getHeightMaps().hasIntersectionWithBoundingBox(packet, tLow, tHigh);
+  float lengths[RayPacket::size];
+  length.store(lengths);
+  for (unsigned lane = 0; lane < count; lane++) {
+    auto pixelX = x + lane * stride;
+    auto tStart = contextP->getStartDistance(pixelX, y);
+    if (beamStart > 0.f) tStart = std::max(tStart, beamStart * lengths[lane]);
+    TraversalStatistics pixelStatistics;
+#ifdef TRAVERSAL_STATISTICS
+    TraversalStatistics::active = &pixelStatistics;
+#endif
+    float depth;
+    auto deferred = deferredHits ? deferredHits->size() : 0;
+    auto color = traceLane(packet, hits, tLow, tHigh, lane, tStart, pixelX, y, depth, secondary, blockSize, deferredHits);
+#ifdef TRAVERSAL_STATISTICS
+    TraversalStatistics::active = nullptr;
+#endif
+    if (deferredHits && deferredHits->size() > deferred) {
+      // the pixel is counted and written with its shadows by the last stage of the wavefront pass
+      deferredHits->back().statistics = pixelStatistics;
+      continue;
+    }
+    statistics += pixelStatistics;
+    setBlock(pixelX, y, blockSize, color, depth, pixelStatistics);
+  }
+}
+
+void RayTracing::setBlock(unsigned x, unsigned y, unsigned blockSize, const Color &color, float depth, [[maybe_unused]] const TraversalStatistics &statistics) const {
+  auto blockWidth = std::min(blockSize, contextP->getWidth() - x), blockHeight = std::min(blockSize, contextP->getHeight() - y);
+  for (unsigned j = 0; j < blockHeight; j++) {
+    for (unsigned i = 0; i < blockWidth; i++) {
+      contextP->setToColorBuffer(x + i, y + j, color);
+      contextP->setToDepthBuffer(x + i, y + j, depth);
+#ifdef TRAVERSAL_STATISTICS
+      contextP->setToStatisticsBuffer(x + i, y + j, statistics);
+#endif
+    }
+  }
+}
+
+bool RayTracing::isEdge(unsigned first, unsigned second) const {
+  const auto &colors = contextP->getColorBuffer();
+  const auto &depths = contextP->getDepthBuffer();
+  auto difference = colors.get(first) - colors.get(second);
+  if (std::max(std::max(std::abs(difference.getR()), std::abs(difference.getG())), std::abs(difference.getB())) > edgeColorDifference) return true;
+  auto nearer = std::min(depths[first], depths[second]), farther = std::max(depths[first], depths[second]);
+  if (nearer == std::numeric_limits<float>::infinity()) return false; // both rays missed
+  return farther - nearer > edgeDepthDifference * nearer;
+}
+
+Color RayTracing::traceSubsamples(unsigned x, unsigned y, unsigned samplesPerSide) const {
+  auto count = samplesPerSide * samplesPerSide;
+  auto color = Color(0, 0, 0);
+  auto reflections = scene::reflectionDepth > 0;
+  SecondaryRays secondary;
+  for (unsigned first = 0; first < count; first += RayPacket::size) {
+    // regular grid of sample centers inside the pixel, the pixel center lies on the integer coordinates
+    float offsetX[RayPacket::size], offsetY[RayPacket::size];
+    for (unsigned lane = 0; lane < RayPacket::size; lane++) {
+      auto sample = std::min(first + lane, count - 1);
+      offsetX[lane] = float(x) + (float(sample % samplesPerSide) + .5f) / float(samplesPerSide) - .5f;
+      offsetY[lane] = float(y) + (float(sample / samplesPerSide) + .5f) / float(samplesPerSide) - .5f;
+    }
+    auto xs = Float4(offsetX), ys = Float4(offsetY);
+    auto dx = Float4(dirO.getX()) + Float4(dirX.getX()) * xs + Float4(dirY.getX()) * ys;
+    auto dy = Float4(dirO.getY()) + Float4(dirX.getY()) * xs + Float4(dirY.getY()) * ys;
+    auto dz = Float4(dirO.getZ()) + Float4(dirX.getZ()) * xs + Float4(dirY.getZ()) * ys;
+    auto length = sqrt(dx * dx + dy * dy + dz * dz);
+    RayPacket packet(rayOrigin, dx / length, dy / length, dz / length);
+
+    float tLow[RayPacket::size], tHigh[RayPacket::size];
+    auto hits = contextP->getHeightMaps().hasIntersectionWithBoundingBox(packet, tLow, tHigh);
+    for (unsigned lane = 0; lane < RayPacket::size && first + lane < count; lane++) {
+      float depth;
+      // reprojected start of the pixel is not used, the samples can hit surface nearer than the pixel center
+      auto queued = secondary.pixels.size();
+      auto sampleColor = traceLane(packet, hits, tLow, tHigh, lane, std::numeric_limits<float>::lowest(), x, y, depth, reflections ? &secondary : nullptr, 1, nullptr);
+      if (secondary.pixels.size() == queued) color += sampleColor; // reflective samples are added after their reflections
+    }
+  }
+  traceSecondaryRays(secondary);
+  for (const auto &pixel : secondary.pixels) color += pixel.color;
+  return color * (1.f / float(count));
+}
+
+void RayTracing::refineEdges(unsigned samplesPerSide, const std::atomic<bool> *stop, unsigned minX, unsigned minY, unsigned maxX, unsigned maxY) {
+  Profiler::Scope scope("antialiasing");
+  auto start = std::chrono::steady_clock::now();
+  auto width = contextP->getWidth(), height = contextP->getHeight();
+  auto &pool = ThreadPool::getShared();
+
+  // edges are found in the whole rectangle before any pixel is changed, every pixel is compared with all four neighbours,
+  // so the pixels on the border of the rectangle are compared with the pixels around it too
+  std::vector<uint8_t> edges(width * height, 0);
+  pool.parallelFor(maxY - minY, [&](unsigned row) {
+    auto y = minY + row;
+    for (auto x = minX; x < maxX; x++) {
+      auto pixel = y * width + x;
+      edges[pixel] = (x > 0 && isEdge(pixel, pixel - 1)) || (x + 1 < width && isEdge(pixel, pixel + 1))
+        || (y > 0 && isEdge(pixel, pixel - width)) || (y + 1 < height && isEdge(pixel, pixel + width));
+    }
+  });
+  std::vector<unsigned> edgePixels;
+  for (unsigned pixel = 0; pixel < edges.size(); pixel++) {
+    if (edges[pixel]) edgePixels.push_back(pixel);
+  }
+
+  pool.parallelForChunks(edgePixels.size(), refineChunkSize, [&](unsigned begin, unsigned end) {
+    if (stop && *stop) return;
+    Profiler::Scope chunkScope("refine edges");
+    for (auto i = begin; i < end; i++) {
+      auto x = edgePixels[i] % width, y = edgePixels[i] / width;
+      contextP->setToColorBuffer(x, y, traceSubsamples(x, y, samplesPerSide));
+    }
+    contextP->markChanged();
+  });
+  refinedPixels = edgePixels.size();
+  scope.setArgument("pixels", double(refinedPixels));
+  refineMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RayTracing::traceTileReflections(Tile &tile, SecondaryRays &secondary) const {
+  if (secondary.pixels.empty()) return;
+  {
+    Profiler::Scope scope("reflections");
+    tile.reflectionRays = traceSecondaryRays(secondary);
+    scope.setArgument("rays", double(tile.reflectionRays));
+  }
+  for (const auto &[x, y, blockSize, color] : secondary.pixels) {
+    auto blockWidth = std::min(blockSize, contextP->getWidth() - x), blockHeight = std::min(blockSize, contextP->getHeight() - y);
+    for (unsigned j = 0; j < blockHeight; j++) {
+      for (unsigned i = 0; i < blockWidth; i++) contextP->setToColorBuffer(x + i, y + j, color);
+    }
+  }
+}
+
+void RayTracing::traceTile(Tile &tile, unsigned step, bool refine, std::vector<Hit> *deferredHits) const {
+  Profiler::Scope scope("tile");
+  if (Profiler::isActive()) profiledTile = &tile;
+  auto start = std::chrono::steady_clock::now();
+  auto firstMultiple = [step](unsigned value) { return (value + step - 1) / step * step; };
+  auto endX = tile.x + tile.width;
+  if (scene::beamTraversal) tile.beamStart = getBeamStart(tile);
+  SecondaryRays secondary;
+  // reflective intersections of the wavefront pass are queued when their shadows are known
+  auto *reflections = scene::reflectionDepth > 0 && deferredHits == nullptr ? &secondary : nullptr;
+  for (auto y = firstMultiple(tile.y); y < tile.y + tile.height; y += step) {
+    // pixels on even multiples of both coordinates were traced by the previous (coarser) pass
+    auto coarseRow = refine && y % (2 * step) == 0;
+    auto stride = coarseRow ? 2 * step : step;
+    auto x = firstMultiple(tile.x);
+    if (coarseRow && x % stride == 0) x += step;
+    for (; x < endX; x += stride * RayPacket::size) {
+      tracePacket(x, y, std::min(RayPacket::size, (endX - x + stride - 1) / stride), stride, step, tile.beamStart, tile.statistics, reflections, deferredHits);
+    }
+  }
+  traceTileReflections(tile, secondary);
+  tile.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  profiledTile = nullptr;
+  scope.setArgument("x", tile.x);
+  scope.setArgument("y", tile.y);
+  scope.setArgument("shading ms", tile.shadingMilliseconds);
+  scope.setArgument("shadow ms", tile.shadowMilliseconds);
+}
+
+void RayTracing::shadeHit(Hit &hit) const {
+#ifdef TRAVERSAL_STATISTICS
+  TraversalStatistics::active = &hit.statistics;
+#endif
+  const auto &heightMap = *hit.heightMap;
+  if (contextP->getLightGrid()) {
+    // every block has its own lights, so their shadow rays are traced right away
+    hit.color = shade(hit.ray, hit.intersection, heightMap, hit.x, hit.y);
+    hit.shaded = true;
+  } else {
+    auto t = hit.intersection.getT();
+    auto normal = heightMap.hasVertexNormals() ? heightMap.getVertexNormal(hit.point) : hit.intersection.getNormal();
+    auto materialColor = getMaterialColor(hit.ray, t, normal, heightMap);
+    hit.color = Illumination::getDirectPhongIllumination(contextP->getLightBatch(), heightMap.getMaterial(), materialColor, hit.ray, Intersection(t, normal));
+  }
+#ifdef TRAVERSAL_STATISTICS
+  TraversalStatistics::active = nullptr;
+#endif
+}
+
+void RayTracing::traceShadowBatches(std::vector<Hit> &hits, const std::atomic<bool> *stop) const {
+  const auto &lights = contextP->getLights();
+  std::vector<unsigned> order;
+  for (unsigned i = 0; i < hits.size(); i++) {
+    if (!hits[i].shaded) order.push_back(i);
+  }
+  if (order.empty() || lights.empty()) return;
+
+  // origins sorted by the cells of the grid over their box, the origins are the same for every light, so they are sorted once
+  auto infinity = std::numeric_limits<float>::infinity();
+  auto minX = infinity, minZ = infinity, maxX = -infinity, maxZ = -infinity;
+  for (auto i : order) {
+    minX = std::min(minX, hits[i].point.getX());
+    minZ = std::min(minZ, hits[i].point.getZ());
+    maxX = std::max(maxX, hits[i].point.getX());
+    maxZ = std::max(maxZ, hits[i].point.getZ());
+  }
+  auto scaleX = float(coherenceGrid) / std::max(maxX - minX, 1e-6f), scaleZ = float(coherenceGrid) / std::max(maxZ - minZ, 1e-6f);
+  auto getKey = [&](unsigned i) {
+    auto col = std::min(unsigned((hits[i].point.getX() - minX) * scaleX), coherenceGrid - 1);
+    auto row = std::min(unsigned((hits[i].point.getZ() - minZ) * scaleZ), coherenceGrid - 1);
+    return row * coherenceGrid + col;
+  };
+  std::stable_sort(order.begin(), order.end(), [&getKey](unsigned first, unsigned second) { return getKey(first) < getKey(second); });
+
+  for (unsigned light = 0; light < lights.size(); light++) {
+    Profiler::Scope scope("shadow rays");
+    scope.setArgument("light", light);
+    scope.setArgument("rays", double(order.size()));
+    const auto &position = lights[light].getPosition();
+    // every hit is once in the batch, so the tasks count the shadows of different hits
+    ThreadPool::getShared().parallelForChunks(order.size(), wavefrontChunkSize, [&](unsigned begin, unsigned end) {
+      if (stop && *stop) return;
+      for (auto i = begin; i < end; i++) {
+        auto &hit = hits[order[i]];
+#ifdef TRAVERSAL_STATISTICS
+        TraversalStatistics::active = &hit.statistics;
+#endif
+        if (isShadowed(hit.point, position, *hit.heightMap, hit.footprintSize)) hit.shadowedLights++;
       }
-      contextP->setToColorBuffer(x, y, color);
+#ifdef TRAVERSAL_STATISTICS
+      TraversalStatistics::active = nullptr;
+#endif
+    });
+  }
+}
+
+void RayTracing::finishTile(Tile &tile, const std::vector<Hit> &hits) const {
+  Profiler::Scope scope("finish tile");
+  auto start = std::chrono::steady_clock::now();
+  SecondaryRays secondary;
+  for (auto i = tile.firstHit; i < tile.firstHit + tile.hitCount; i++) {
+    const auto &hit = hits[i];
+    auto color = hit.color;
+    // the same product as the shading of one pixel gives
+    for (unsigned light = 0; light < hit.shadowedLights; light++) color *= shadowAttenuation;
+    if (scene::reflectionDepth > 0 && hit.heightMap->getMaterial().getReflectivity() > 0.f) {
+      queueReflection(secondary, hit.ray, hit.intersection, *hit.heightMap, color, hit.x, hit.y, hit.blockSize);
     }
+    tile.statistics += hit.statistics;
+    setBlock(hit.x, hit.y, hit.blockSize, color, hit.intersection.getT(), hit.statistics);
   }
+  traceTileReflections(tile, secondary);
+  tile.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
+void RayTracing::traceWavefront(unsigned step, bool refine, const std::atomic<bool> *stop) {
+  auto &pool = ThreadPool::getShared();
+  std::vector<std::vector<Hit>> tileHits(tiles.size());
+  {
+    Profiler::Scope scope("primary rays");
+    pool.parallelFor(tiles.size(), [this, step, refine, stop, &tileHits](unsigned i) {
+      if (stop && *stop) return;
+      traceTile(tiles[i], step, refine, &tileHits[i]);
+    });
+  }
+
+  // intersections of all tiles in one array, the missed pixels are already written
+  std::vector<Hit> hits;
+  {
+    Profiler::Scope scope("compaction");
+    size_t count = 0;
+    for (const auto &list : tileHits) count += list.size();
+    hits.reserve(count);
+    for (unsigned i = 0; i < tiles.size(); i++) {
+      tiles[i].firstHit = unsigned(hits.size());
+      tiles[i].hitCount = unsigned(tileHits[i].size());
+      hits.insert(hits.end(), tileHits[i].begin(), tileHits[i].end());
+      std::vector<Hit>().swap(tileHits[i]);
+    }
+    scope.setArgument("hits", double(hits.size()));
+  }
+
+  {
+    Profiler::Scope scope("shading");
+    pool.parallelForChunks(hits.size(), wavefrontChunkSize, [this, stop, &hits](unsigned begin, unsigned end) {
+      if (stop && *stop) return;
+      for (auto i = begin; i < end; i++) shadeHit(hits[i]);
+    });
+  }
+  traceShadowBatches(hits, stop);
+
+  pool.parallelFor(tiles.size(), [this, stop, &hits](unsigned i) {
+    if (stop && *stop) return;
+    finishTile(tiles[i], hits);
+    contextP->markChanged();
+  });
+}
+
+void RayTracing::computePass(unsigned step, bool refine, const std::atomic<bool> *stop, unsigned minX, unsigned minY, unsigned maxX, unsigned maxY) {
+  auto width = contextP->getWidth(), height = contextP->getHeight();
+  auto tileSize = std::max(scene::tileSize, 1u);
+  // tiles keep their places on the screen, so the rectangle is extended to the whole tiles
+  auto firstX = minX / tileSize * tileSize, firstY = minY / tileSize * tileSize;
+  tileColumns = (maxX - firstX + tileSize - 1) / tileSize;
+
+  tiles.clear();
+  for (auto y = firstY; y < maxY; y += tileSize) {
+    for (auto x = firstX; x < maxX; x += tileSize) {
+      tiles.push_back(Tile{x, y, std::min(tileSize, width - x), std::min(tileSize, height - y)});
+    }
+  }
+
+  Profiler::Scope scope("render pass");
+  scope.setArgument("step", step);
+  scope.setArgument("tiles", double(tiles.size()));
+  auto start = std::chrono::steady_clock::now();
+  if (scene::wavefront) {
+    traceWavefront(step, refine, stop);
+  } else {
+    ThreadPool::getShared().parallelFor(tiles.size(), [this, step, refine, stop](unsigned i) {
+      if (stop && *stop) return;
+      traceTile(tiles[i], step, refine, nullptr);
+      contextP->markChanged();
+    });
+  }
+  totalMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RayTracing::computeRayTrace() {
+  computeRayTrace(0, 0, contextP->getWidth(), contextP->getHeight());
+}
+
+void RayTracing::computeRayTrace(unsigned minX, unsigned minY, unsigned maxX, unsigned maxY) {
+  computePass(1, false, nullptr, minX, minY, maxX, maxY);
+  if (scene::antialiasing > 1 && !tiles.empty()) {
+    const auto &last = tiles.back();
+    refineEdges(scene::antialiasing, nullptr, tiles[0].x, tiles[0].y, last.x + last.width, last.y + last.height);
+  }
+}
+
+void RayTracing::traceTilesInThread(unsigned minX, unsigned minY, unsigned maxX, unsigned maxY) const {
+  auto width = contextP->getWidth(), height = contextP->getHeight();
+  auto tileSize = std::max(scene::tileSize, 1u);
+  for (auto y = minY / tileSize * tileSize; y < maxY; y += tileSize) {
+    for (auto x = minX / tileSize * tileSize; x < maxX; x += tileSize) {
+      auto tile = Tile{x, y, std::min(tileSize, width - x), std::min(tileSize, height - y)};
+      traceTile(tile, 1, false, nullptr);
+    }
+  }
+}
+
+void RayTracing::computeProgressiveRayTrace(unsigned initialStep, const std::atomic<bool> &stop, const std::function<void(unsigned)> &onPass) {
+  auto step = 1u;
+  while (step * 2 <= initialStep) step *= 2;
+  for (auto refine = false; step >= 1 && !stop; step /= 2, refine = true) {
+    computePass(step, refine, &stop, 0, 0, contextP->getWidth(), contextP->getHeight());
+    if (!stop && onPass) onPass(step);
+  }
+  if (scene::antialiasing > 1 && !stop) {
+    refineEdges(scene::antialiasing, &stop, 0, 0, contextP->getWidth(), contextP->getHeight());
+    if (!stop && onPass) onPass(0);
+  }
+}
+
+TraversalStatistics RayTracing::getStatistics() const {
+  TraversalStatistics statistics;
+  for (const auto &tile : tiles) statistics += tile.statistics;
+  return statistics;
+}
+
+void RayTracing::printTileStatistics(std::ostream &out) const {
+  if (tiles.empty()) return;
+  double minimal = tiles[0].milliseconds, maximal = tiles[0].milliseconds, sum = 0.;
+  for (const auto &tile : tiles) {
+    minimal = std::min(minimal, tile.milliseconds);
+    maximal = std::max(maximal, tile.milliseconds);
+    sum += tile.milliseconds;
+  }
+
+  auto flags = out.flags();
+  auto precision = out.precision();
+  out << std::fixed << std::setprecision(1);
+  out << "ray tracing: " << tiles.size() << " tiles on " << ThreadPool::getShared().getThreadCount() << " threads in " << totalMilliseconds << " ms" << std::endl;
+  out << "  tile time (ms) - min: " << minimal << ", avg: " << sum / double(tiles.size()) << ", max: " << maximal << ", sum: " << sum << std::endl;
+  out << "  per tile (ms), top row first:" << std::endl;
+  for (auto row = int(tiles.size() / tileColumns) - 1; row >= 0; row--) {
+    out << "   ";
+    for (unsigned col = 0; col < tileColumns; col++) out << std::setw(7) << tiles[row * tileColumns + col].milliseconds;
+    out << std::endl;
+  }
+  if (scene::beamTraversal) {
+    unsigned culled = 0;
+    double depthSum = 0.;
+    for (const auto &tile : tiles) {
+      if (tile.beamStart == std::numeric_limits<float>::infinity()) culled++;
+      else depthSum += tile.beamStart * dirO.dotProduct(viewAxis);
+    }
+    out << "  beam traversal: " << culled << " tiles culled, other rays skip " << (culled < tiles.size() ? depthSum / double(tiles.size() - culled) : 0.)
+      << " units of depth on average" << std::endl;
+  }
+  if (scene::reflectionDepth > 0) {
+    unsigned reflectionRays = 0;
+    for (const auto &tile : tiles) reflectionRays += tile.reflectionRays;
+    out << "  reflections: " << reflectionRays << " rays up to depth " << scene::reflectionDepth << std::endl;
+  }
+  if (refinedPixels > 0) {
+    out << "  antialiasing: " << refinedPixels << " edge pixels (" << 100. * refinedPixels / double(contextP->getWidth() * contextP->getHeight())
+      << " %) with " << scene::antialiasing * scene::antialiasing << " samples in " << refineMilliseconds << " ms" << std::endl;
+  }
+#ifdef TRAVERSAL_STATISTICS
+  auto statistics = getStatistics();
+  auto pixels = double(std::max(contextP->getWidth() * contextP->getHeight(), 1u));
+  out << "  traversal per pixel - rays: " << double(statistics.rays) / pixels << ", cells: " << double(statistics.visitedCells) / pixels
+    << ", triangles: " << double(statistics.triangleTests) / pixels << ", runs: " << double(statistics.runs) / pixels
+    << ", aabb rejects: " << double(statistics.boundingBoxRejects) / pixels << ", shadow rays: " << double(statistics.shadowRays) / pixels << std::endl;
+  out << "  traversal per frame - rays: " << statistics.rays << ", cells: " << statistics.visitedCells << ", triangles: " << statistics.triangleTests
+    << ", runs: " << statistics.runs << ", aabb rejects: " << statistics.boundingBoxRejects << ", shadow rays: " << statistics.shadowRays << std::endl;
+#endif
+  out.flags(flags);
+  out.precision(precision);
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <vector>
+
 #include "src/context/Context.h"
 #include "src/matrix/Matrix4d.h"
 #include "src/vector/Vector4d.h"
@@ -7,12 +11,327 @@
 
 /**
  * Class for computing ray tracing for the screen
+ *
+ * Screen is split into square tiles, which are rendered in parallel by the shared thread pool
  */
 class RayTracing {
+  /**
+   * Rectangular part of the screen rendered by one task, with time it took to render it and its traversal counters
+   */
+  struct Tile {
+    unsigned x, y, width, height;
+    float beamStart = 0.f; // rays of the tile start at this multiple of their unnormalized direction, infinity if the tile is culled
+    double milliseconds = 0.;
+    unsigned reflectionRays = 0; // secondary rays traced for the reflective pixels of the tile
+    TraversalStatistics statistics{};
+    double shadingMilliseconds = 0., shadowMilliseconds = 0.; // summed only while the profiler runs, the shading includes its shadow rays
+    unsigned firstHit = 0, hitCount = 0; // range of the intersections of the tile in the hits of the wavefront pass
+  };
+
+  /**
+   * Intersection of the primary ray kept by the wavefront pass between its traversal, shading and shadow stages
+   */
+  struct Hit {
+    unsigned x, y, blockSize;
+    Ray ray;
+    Intersection intersection;
+    const HeightMap *heightMap;
+    Point3d point; // intersection point, origin of the shadow rays
+    float footprintSize; // size of the pixel footprint at the point
+    Color color; // illumination without the shadows of the lights
+    unsigned shadowedLights = 0; // lights found hidden from the point by the shadow stage
+    bool shaded = false; // the color already has the shadows, the shadow stage skips the hit
+    TraversalStatistics statistics{}; // counters of all stages of the pixel
+  };
+
+  /**
+   * Pixels with reflective intersections and their reflection rays waiting for the secondary stage, gathered for one tile
+   * or one supersampled pixel, the colors of the reflected intersections are added to the pixels
+   */
+  struct SecondaryRays {
+    /**
+     * Pixel whose final color is known only after its reflections are traced
+     */
+    struct Pixel {
+      unsigned x, y, blockSize;
+      Color color; // color of the pixel without the reflections traced so far
+    };
+
+    /**
+     * Reflection ray with the part of the pixel color it gives
+     */
+    struct Reflection {
+      Ray ray;
+      float weight;
+      unsigned pixel; // index of the pixel
+    };
+
+    std::vector<Pixel> pixels;
+    std::vector<Reflection> rays; // rays of the next bounce
+  };
+
   Matrix4d inverseMatrix;
   Matrix4d inverseModelView;
   Context *contextP;
 
+  Point3d rayOrigin;
+  Vector3d dirX, dirY, dirO;
+  float footprint = 0.f; // size of the pixel at distance 1 from the eye, 0 if the levels of detail are not used
+  float pixelSize; // size of the pixel at distance 1 from the eye, the ray differential of the texture samples
+  Vector3d viewAxis; // unit normal of the image plane, all unnormalized primary directions have the same projection to it
+
+  std::vector<Tile> tiles;
+  unsigned tileColumns = 0;
+  double totalMilliseconds = 0.;
+  unsigned refinedPixels = 0; // pixels supersampled by the antialiasing pass
+  double refineMilliseconds = 0.;
+  inline static thread_local Tile *profiledTile = nullptr; // tile traced by the thread while the profiler runs, it sums the shading times
+
+  constexpr static const float edgeColorDifference = 0.1f; // neighbours with larger difference in any color channel are supersampled
+  constexpr static const unsigned refineChunkSize = 64; // edge pixels supersampled by one task of the thread pool
+  constexpr static const float beamStepGrowth = 1.25f; // ratio of the far and the near depth of the frustum slab tested by one beam step
+  constexpr static const unsigned beamMinimalSteps = 256; // shortest beam step is this fraction of the depth range of the height map
+  constexpr static const unsigned beamRefinements = 3; // times the blocked beam step is halved before the beam stops
+  constexpr static const float reflectionOffset = 1e-3f; // origin of the reflection ray is this part of the cell above the surface
+  constexpr static const unsigned coherenceGrid = 64; // reflection origins are sorted by the cells of this grid over their box
+  constexpr static const float textureGrazingCosine = .25f; // pixel footprint on the surface is stretched at most by its inverse
+  constexpr static const float edgeDepthDifference = 0.05f; // neighbours with larger difference of the depths relative to the nearer one are supersampled
+  constexpr static const float shadowAttenuation = 0.1f; // part of the light color left in the shadow
+  constexpr static const unsigned wavefrontChunkSize = 256; // hits shaded or tested for the shadow of one light by one task of the thread pool
+
+  /**
+   * Find if the light is hidden from the point, by the horizon map of the height map if it was built, otherwise by the shadow ray
+   * through all height maps
+   * @param point - point on the surface of the height map
+   * @param lightPosition - position of the light
+   * @param heightMap - height map of the point
+   * @param footprintSize - size of the pixel footprint at the point
+   * @return true if the point is in the shadow
+   */
+  [[nodiscard]] bool isShadowed(const Point3d &point, const Point3d &lightPosition, const HeightMap &heightMap, float footprintSize) const;
+
+  /**
+   * Get color of the material at the intersection, the texture is sampled at the level of the pixel footprint on the surface
+   * @param ray - ray that intersected the height map
+   * @param t - parameter of the intersection
+   * @param normal - shading normal at the intersection
+   * @param heightMap - height map of the intersection
+   * @return color of the texture, of the gradient at the height of the intersection or of the material
+   */
+  [[nodiscard]] Color getMaterialColor(const Ray &ray, float t, const Vector3d &normal, const HeightMap &heightMap) const;
+
+  /**
+   * Compute color of the found intersection, with shadows of all height maps from the context lights
+   * @param ray - ray that intersected the height map
+   * @param intersection - found intersection
+   * @param heightMap - height map of the intersection
+   * @param x - x coordinate of the pixel, seeds the light sampling
+   * @param y - y coordinate of the pixel, seeds the light sampling
+   * @return color of the intersection
+   */
+  [[nodiscard]] Color shade(const Ray &ray, const Intersection &intersection, const HeightMap &heightMap, unsigned x, unsigned y) const;
+
+  /**
+   * Compute color of the intersection from the lights of the light grid which reach its terrain block, one shadow ray per shaded light
+   * Lights are picked randomly by their weight when the block has more lights than the scene light samples
+   * @param ray - ray that intersected the height map
+   * @param intersection - found intersection with the shading normal
+   * @param heightMap - height map of the intersection
+   * @param materialColor - color of the material at the intersection
+   * @param footprintSize - size of the pixel footprint at the intersection
+   * @param x - x coordinate of the pixel
+   * @param y - y coordinate of the pixel
+   * @return color of the intersection
+   */
+  [[nodiscard]] Color shadeManyLights(const Ray &ray, const Intersection &intersection, const HeightMap &heightMap, const Color &materialColor, float footprintSize, unsigned x, unsigned y) const;
+
+  /**
+   * Queue the pixel with the reflective intersection and its reflection ray for the secondary stage
+   * @param secondary - where the pixel and the ray are queued
+   * @param ray - ray that intersected the height map
+   * @param intersection - found intersection
+   * @param heightMap - height map of the intersection
+   * @param color - color of the intersection
+   * @param x - x coordinate of the pixel
+   * @param y - y coordinate of the pixel
+   * @param blockSize - size of the square block filled by the color of the pixel
+   */
+  static void queueReflection(SecondaryRays &secondary, const Ray &ray, const Intersection &intersection, const HeightMap &heightMap, const Color &color,
+    unsigned x, unsigned y, unsigned blockSize);
+
+  /**
+   * Trace one ray of the packet and shade its intersection, or leave the intersection to the later stages of the wavefront pass
+   * @param packet - traced rays
+   * @param hits - bit mask of the rays which hit the bounding box of the height maps
+   * @param tLow - parameters where the rays enter the bounding box
+   * @param tHigh - parameters where the rays leave the bounding box
+   * @param lane - index of the traced ray in the packet
+   * @param tStart - cells before the point on this parameter are not tested (lowest float to test all cells)
+   * @param x - x coordinate of the pixel
+   * @param y - y coordinate of the pixel
+   * @param depth - where the parameter of the intersection is stored, infinity if the ray missed
+   * @param secondary - where the pixel and its reflection ray are queued if the intersection is reflective, nullptr without reflections
+   * @param blockSize - size of the square block filled by the color of the pixel
+   * @param deferredHits - where the intersection is stored unshaded, nullptr to shade it
+   * @return color of the intersection or the background color, without the reflection, the deferred intersection has no color yet
+   */
+  [[nodiscard]] Color traceLane(const RayPacket &packet, int hits, const float tLow[RayPacket::size], const float tHigh[RayPacket::size], unsigned lane, float tStart,
+    unsigned x, unsigned y, float &depth, SecondaryRays *secondary, unsigned blockSize, std::vector<Hit> *deferredHits) const;
+
+  /**
+   * Create ray reflected from the intersection, its origin is moved above the surface so it does not hit the surface again
+   * @param ray - ray that intersected the height map
+   * @param intersection - found intersection
+   * @param heightMap - height map of the intersection
+   * @return reflected ray
+   */
+  [[nodiscard]] static Ray getReflectedRay(const Ray &ray, const Intersection &intersection, const HeightMap &heightMap);
+
+  /**
+   * Trace the queued reflection rays bounce by bounce up to the scene reflection depth and add their colors to the pixels
+   * Rays of every bounce are sorted by the octant of the direction and the cell of the origin before they are traced,
+   * so the neighbouring rays walk the same parts of the grids
+   * @param secondary - queued pixels and rays, the rays are consumed
+   * @return number of the traced rays
+   */
+  unsigned traceSecondaryRays(SecondaryRays &secondary) const;
+
+  /**
+   * Check if the slab of the tile frustum between two parameters lies above the height map, by the bounding box of the slab
+   * and the pyramid blocks under it, the slab is the convex hull of the corner rays on both parameters
+   * @param heightMap - tested height map
+   * @param corners - unnormalized directions of the corner rays of the tile
+   * @param near - parameter of the near side of the slab
+   * @param far - parameter of the far side of the slab
+   * @return true if no ray of the tile can hit the height map inside the slab
+   */
+  [[nodiscard]] bool isBeamAbove(const HeightMap &heightMap, const Vector3d corners[4], float near, float far) const;
+
+  /**
+   * Walk the frustum of the tile through the max-height pyramids of all height maps by growing slabs, until a slab can reach
+   * the terrain in one of them, the space before it is empty for every ray of the tile
+   * @param tile - tile of the screen
+   * @return parameter of the unnormalized directions where the rays of the tile start, infinity if the frustum misses all terrain
+   */
+  [[nodiscard]] float getBeamStart(const Tile &tile) const;
+
+  /**
+   * Check if two neighbouring pixels differ enough in the color or the depth to be supersampled
+   * @param first - index of the first pixel in the buffers
+   * @param second - index of the second pixel in the buffers
+   * @return true if the pixels lie on the edge
+   */
+  [[nodiscard]] bool isEdge(unsigned first, unsigned second) const;
+
+  /**
+   * Trace regular grid of samples inside the pixel, in packets of four rays
+   * @param x - x coordinate of the pixel
+   * @param y - y coordinate of the pixel
+   * @param samplesPerSide - number of the samples in the row and in the column of the grid
+   * @return average color of the samples
+   */
+  [[nodiscard]] Color traceSubsamples(unsigned x, unsigned y, unsigned samplesPerSide) const;
+
+  /**
+   * Supersample the pixels which differ from any neighbour in the color or the depth more than the thresholds
+   * Edges are found in the finished image first, then the edge pixels are traced in parallel
+   * @param samplesPerSide - number of the samples in the row and in the column of the pixel
+   * @param stop - if not null, the pass is stopped once it is set
+   * @param minX - first column of the refined pixels
+   * @param minY - first row of the refined pixels
+   * @param maxX - column after the last refined column
+   * @param maxY - row after the last refined row
+   */
+  void refineEdges(unsigned samplesPerSide, const std::atomic<bool> *stop, unsigned minX, unsigned minY, unsigned maxX, unsigned maxY);
+
+  /**
+   * Trace packet of pixels in one row and save them to the color and depth buffer
+   * Primary rays are generated and tested against the bounding box of all height maps at once, rays that hit it are traversed one by one
+   * @param x - x coordinate of the first pixel
+   * @param y - y coordinate of the pixels
+   * @param count - number of pixels to trace (at most the packet size)
+   * @param stride - distance between the traced pixels
+   * @param blockSize - size of the square block filled by the color of each traced pixel (1 fills the pixel only)
+   * @param beamStart - parameter of the unnormalized directions before which the rays do not hit any terrain, 0 to trace whole rays
+   * @param statistics - where the traversal counters of the pixels are added (only with TRAVERSAL_STATISTICS)
+   * @param secondary - where the reflective pixels are queued, nullptr without reflections
+   * @param deferredHits - where the intersections are stored unshaded and unwritten, nullptr to shade and write them
+   */
+  void tracePacket(unsigned x, unsigned y, unsigned count, unsigned stride, unsigned blockSize, float beamStart, TraversalStatistics &statistics,
+    SecondaryRays *secondary, std::vector<Hit> *deferredHits) const;
+
+  /**
+   * Fill the square block of the pixel in the color, depth and statistics buffers, the block is clipped by the screen
+   * @param x - x coordinate of the pixel
+   * @param y - y coordinate of the pixel
+   * @param blockSize - size of the block
+   * @param color - color of the pixel
+   * @param depth - parameter of the intersection, infinity if the ray missed
+   * @param statistics - traversal counters of the pixel (only with TRAVERSAL_STATISTICS)
+   */
+  void setBlock(unsigned x, unsigned y, unsigned blockSize, const Color &color, float depth, const TraversalStatistics &statistics) const;
+
+  /**
+   * Trace the queued reflections of the tile and write their pixels again
+   * @param tile - tile of the reflective pixels, gets the number of the reflection rays
+   * @param secondary - queued pixels and rays of the tile
+   */
+  void traceTileReflections(Tile &tile, SecondaryRays &secondary) const;
+
+  /**
+   * Trace pixels of the tile with coordinates divisible by the step, each fills block of step x step pixels, measures the tile time
+   * With the beam traversal the frustum of the tile is walked first and the rays start where it can reach the terrain
+   * Reflections of the tile are traced after all its primary rays and their pixels are written again
+   * @param tile - tile to be rendered
+   * @param step - distance between traced pixels
+   * @param refine - true if pixels traced by the pass with double step should be skipped
+   * @param deferredHits - where the intersections are left for the wavefront stages, only the missed pixels are written,
+   *   nullptr to shade and write the whole tile
+   */
+  void traceTile(Tile &tile, unsigned step, bool refine, std::vector<Hit> *deferredHits) const;
+
+  /**
+   * Compute color of the intersection without the shadows, the intersections lit from the light grid are shaded with their shadows
+   * @param hit - intersection of the wavefront pass, gets its color
+   */
+  void shadeHit(Hit &hit) const;
+
+  /**
+   * Test the hits for the shadow of every light, one light after another as a batch of the shadow rays in the order of the cells
+   * of their origins, so the neighbouring rays walk the same parts of the grids
+   * @param hits - intersections of the wavefront pass, their shadowed lights are counted
+   * @param stop - if not null, the rays are skipped once it is set
+   */
+  void traceShadowBatches(std::vector<Hit> &hits, const std::atomic<bool> *stop) const;
+
+  /**
+   * Write the final colors of the hits of the tile with the shadows and trace the reflections of the tile, adds to the tile time
+   * @param tile - tile with its range of the hits
+   * @param hits - intersections of the wavefront pass
+   */
+  void finishTile(Tile &tile, const std::vector<Hit> &hits) const;
+
+  /**
+   * Trace the tiles of the pass stage by stage over the whole screen: the primary rays of all tiles, the shading of all their
+   * intersections, the shadow rays of every light and the output of the tiles with their reflections
+   * @param step - distance between traced pixels
+   * @param refine - true if pixels traced by the pass with double step should be skipped
+   * @param stop - if not null, the stages are skipped once it is set
+   */
+  void traceWavefront(unsigned step, bool refine, const std::atomic<bool> *stop);
+
+  /**
+   * Trace one pass over the tiles of the screen overlapping the rectangle of pixels
+   * @param step - distance between traced pixels
+   * @param refine - true if pixels traced by the pass with double step should be skipped
+   * @param stop - if not null, tiles are skipped once it is set
+   * @param minX - first column of the rectangle
+   * @param minY - first row of the rectangle
+   * @param maxX - column after the last column of the rectangle
+   * @param maxY - row after the last row of the rectangle
+   */
+  void computePass(unsigned step, bool refine, const std::atomic<bool> *stop, unsigned minX, unsigned minY, unsigned maxX, unsigned maxY);
+
 public:
   /**
    * Create structure for ray tracing
@@ -22,8 +341,59 @@ public:
    */
   explicit RayTracing(Matrix4d inverseMatrix, Matrix4d inverseModelView, Context *context);
 
+  /**
+   * Get primary ray going through the center of the pixel
+   * @param x - column of the pixel
+   * @param y - row of the pixel
+   * @return ray from the eye with normalized direction
+   */
+  [[nodiscard]] Ray getPrimaryRay(unsigned x, unsigned y) const;
+
   /**
    * Computes ray tracing for screen space and saves it to color buffer in given context
+   * With the scene antialiasing the pixels on the edges are supersampled afterwards
+   */
+  void computeRayTrace();
+
+  /**
+   * Computes ray tracing of the screen tiles overlapping the rectangle of pixels, pixels of the other tiles are left unchanged
+   * With the scene antialiasing the pixels on the edges inside these tiles are supersampled afterwards
+   * @param minX - first column of the rectangle
+   * @param minY - first row of the rectangle
+   * @param maxX - column after the last column of the rectangle
+   * @param maxY - row after the last row of the rectangle
+   */
+  void computeRayTrace(unsigned minX, unsigned minY, unsigned maxX, unsigned maxY);
+
+  /**
+   * Trace the screen tiles overlapping the rectangle of pixels one after another in the calling thread, every pixel is traced and shaded
+   * by the same path as in computeRayTrace, without the thread pool, the antialiasing and the tile statistics
+   * @param minX - first column of the rectangle
+   * @param minY - first row of the rectangle
+   * @param maxX - column after the last column of the rectangle
+   * @param maxY - row after the last row of the rectangle
+   */
+  void traceTilesInThread(unsigned minX, unsigned minY, unsigned maxX, unsigned maxY) const;
+
+  /**
+   * Computes ray tracing in passes from coarse to fine, every pass halves the distance between traced pixels
+   * Each traced pixel fills the block up to the next traced pixel, so the whole screen is covered after the first pass
+   * Pixels traced by the previous passes are not traced again
+   * @param initialStep - distance between pixels traced in the first pass (rounded down to power of two)
+   * @param stop - when set, the ray tracing is stopped as soon as possible
+   * @param onPass - called with the step after each finished pass, the antialiasing pass after the last one is reported with step 0
+   */
+  void computeProgressiveRayTrace(unsigned initialStep, const std::atomic<bool> &stop, const std::function<void(unsigned)> &onPass);
+
+  /**
+   * Get traversal counters of all pixels traced by the last pass (only with TRAVERSAL_STATISTICS)
+   * @return sum of the counters of all tiles
+   */
+  [[nodiscard]] TraversalStatistics getStatistics() const;
+
+  /**
+   * Print time spent on each tile of the last computed ray tracing to the output, with the traversal counters of the frame
+   * @param out - output stream
    */
-  void computeRayTrace() const;
+  void printTileStatistics(std::ostream &out) const;
 };
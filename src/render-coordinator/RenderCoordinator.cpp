@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <csignal>
+#include <stdexcept>
+#include <thread>
+
+#include "RenderCoordinator.h"
+#include "src/render-worker/RenderWorker.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+RenderCoordinator::RenderCoordinator(const std::vector<std::string> &commands, unsigned width, unsigned height, unsigned regionSize)
+  : width(width), height(height), pixels(size_t(width) * height * 3) {
+  for (const auto &command : commands) {
+    nodes.emplace_back();
+    nodes.back().command = command;
+  }
+  for (unsigned y = 0; y < height; y += regionSize) {
+    for (unsigned x = 0; x < width; x += regionSize) queue.push_back({x, y, std::min(regionSize, width - x), std::min(regionSize, height - y)});
+  }
+  remainingRegions = unsigned(queue.size());
+}
+
+RenderCoordinator::~RenderCoordinator() {
+  for (auto &node : nodes) stop(node);
+}
+
+#ifdef _WIN32
+bool RenderCoordinator::start(Node &node) {
+  std::cerr << "distributed rendering starts the workers with fork, it is not supported on Windows" << std::endl;
+  return false;
+}
+
+void RenderCoordinator::terminate(Node &node) {}
+
+void RenderCoordinator::stop(Node &node) {}
+#else
+bool RenderCoordinator::start(Node &node) {
+  // a worker which exits early must not end the coordinator writing its requests
+  std::signal(SIGPIPE, SIG_IGN);
+  int toWorker[2], fromWorker[2];
+  if (pipe(toWorker) != 0) return false;
+  if (pipe(fromWorker) != 0) {
+    close(toWorker[0]);
+    close(toWorker[1]);
+    return false;
+  }
+  // the ends of the coordinator are not inherited by the other workers, so every worker sees the end of its requests
+  fcntl(toWorker[1], F_SETFD, FD_CLOEXEC);
+  fcntl(fromWorker[0], F_SETFD, FD_CLOEXEC);
+  auto pid = fork();
+  if (pid == 0) {
+    setpgid(0, 0); // own process group, so the worker is killed with the commands it started (e.g. ssh)
+    dup2(toWorker[0], STDIN_FILENO);
+    dup2(fromWorker[1], STDOUT_FILENO);
+    close(toWorker[0]);
+    close(fromWorker[1]);
+    execl("/bin/sh", "sh", "-c", node.command.c_str(), static_cast<char *>(nullptr));
+    _exit(127);
+  }
+  close(toWorker[0]);
+  close(fromWorker[1]);
+  if (pid < 0) {
+    close(toWorker[1]);
+    close(fromWorker[0]);
+    return false;
+  }
+  node.pid = pid;
+  node.requests = fdopen(toWorker[1], "w");
+  node.results = fdopen(fromWorker[0], "r");
+  return node.requests != nullptr && node.results != nullptr;
+}
+
+void RenderCoordinator::terminate(Node &node) {
+  if (node.pid > 0) kill(-node.pid, SIGTERM);
+}
+
+void RenderCoordinator::stop(Node &node) {
+  if (node.failed) terminate(node);
+  if (node.requests != nullptr) std::fclose(node.requests);
+  if (node.results != nullptr) std::fclose(node.results);
+  node.requests = node.results = nullptr;
+  if (node.pid > 0) {
+    int status = 0;
+    waitpid(node.pid, &status, 0);
+    if (!node.failed && (!WIFEXITED(status) || WEXITSTATUS(status) != 0)) std::cerr << "worker " << node.command << " failed at exit" << std::endl;
+  }
+  node.pid = -1;
+}
+#endif
+
+bool RenderCoordinator::waitReady(Node &node) {
+  RenderWorker::RegionHeader header{};
+  return node.results != nullptr && std::fread(&header, sizeof(header), 1, node.results) == 1 && header.width == 0 && header.height == 0;
+}
+
+bool RenderCoordinator::receive(Node &node, const Region &region) {
+  RenderWorker::RegionHeader header{};
+  if (std::fread(&header, sizeof(header), 1, node.results) != 1) return false;
+  if (header.x != region.x || header.y != region.y || header.width != region.width || header.height != region.height) return false;
+  // the regions do not overlap, so the rows are stored without the lock, the region and the frame both start with the top row
+  auto top = height - region.y - region.height;
+  for (unsigned row = 0; row < region.height; row++) {
+    auto *target = pixels.data() + ((size_t(top) + row) * width + region.x) * 3;
+    if (std::fread(target, 3, region.width, node.results) != region.width) return false;
+  }
+  node.regions++;
+  node.pixels += size_t(region.width) * region.height;
+  node.milliseconds += header.milliseconds;
+  return true;
+}
+
+void RenderCoordinator::serve(Node &node) {
+  std::deque<Region> requested; // regions sent to the node and not returned yet, in the order of the requests
+  auto ok = node.ready || waitReady(node);
+  {
+    std::unique_lock lock(mutex);
+    node.ready = ok;
+    if (!ok && remainingRegions > 0) std::cerr << "worker " << node.command << " did not start" << std::endl;
+  }
+  while (ok) {
+    auto sent = requested.size();
+    {
+      std::unique_lock lock(mutex);
+      changed.wait(lock, [this, &requested] { return !queue.empty() || !requested.empty() || remainingRegions == 0; });
+      if (remainingRegions == 0) return;
+      while (requested.size() < regionsInFlight && !queue.empty()) {
+        requested.push_back(queue.front());
+        queue.pop_front();
+      }
+    }
+    for (auto i = sent; i < requested.size(); i++) {
+      const auto &region = requested[i];
+      std::fprintf(node.requests, "%u %u %u %u\n", region.x, region.y, region.width, region.height);
+    }
+    if (std::fflush(node.requests) != 0 || !receive(node, requested.front())) {
+      std::cerr << "worker " << node.command << " failed, its regions are rendered by the other nodes" << std::endl;
+      break;
+    }
+    requested.pop_front();
+    std::unique_lock lock(mutex);
+    if (--remainingRegions == 0) changed.notify_all();
+  }
+
+  std::unique_lock lock(mutex);
+  node.failed = true;
+  queue.insert(queue.begin(), requested.begin(), requested.end());
+  changed.notify_all();
+}
+
+void RenderCoordinator::render() {
+  // the first worker builds the caches, which the others only map
+  if (!nodes.empty() && start(nodes[0])) nodes[0].ready = waitReady(nodes[0]);
+  for (size_t i = 1; i < nodes.size(); i++) start(nodes[i]);
+
+  std::vector<std::thread> threads;
+  servingNodes = unsigned(nodes.size());
+  for (auto &node : nodes) {
+    threads.emplace_back([this, &node] {
+      serve(node);
+      std::unique_lock lock(mutex);
+      servingNodes--;
+      changed.notify_all();
+    });
+  }
+  {
+    // workers still loading the maps wait for the requests, they are not needed any more
+    std::unique_lock lock(mutex);
+    changed.wait(lock, [this] { return remainingRegions == 0 || servingNodes == 0; });
+    for (auto &node : nodes) {
+      if (node.ready) continue;
+      node.failed = true;
+      terminate(node);
+    }
+  }
+  for (auto &thread : threads) thread.join();
+  for (auto &node : nodes) stop(node);
+  if (remainingRegions > 0) {
+    std::cerr << "no render node is left for " << remainingRegions << " regions of the frame" << std::endl;
+    throw std::invalid_argument("render nodes failed");
+  }
+}
+
+const std::vector<unsigned char> &RenderCoordinator::getPixels() const {
+  return pixels;
+}
+
+void RenderCoordinator::printStatistics(std::ostream &out) const {
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const auto &node = nodes[i];
+    out << "node " << i << ": " << node.regions << " regions, " << node.pixels << " pixels, " << node.milliseconds << " ms rendering";
+    if (!node.ready) out << ", not ready";
+    else if (node.failed) out << ", failed";
+    out << std::endl;
+  }
+}
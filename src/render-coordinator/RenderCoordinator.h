@@ -0,0 +1,130 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Coordinator of the distributed rendering, which splits the frame into regions rendered by the worker processes of several nodes
+ *
+ * Every node is a command starting the worker (e.g. ssh host /path/HeightField ... --worker) with the standard input and output connected
+ * to the coordinator. The first node is started alone and the others only after it loads the maps, so the first one builds
+ * the terrain cache and the others map it. The regions are not assigned in advance, every node takes the next region from the shared
+ * queue whenever it returns one, so faster nodes and nodes with the cheaper parts of the frame render more regions. Two regions
+ * are requested at once, so the node renders the next region while the pixels of the previous one are sent. The regions of a failed
+ * node are returned to the queue and rendered by the others.
+ */
+class RenderCoordinator {
+  /**
+   * Rectangle of the frame rendered by one request
+   */
+  struct Region {
+    unsigned x, y, width, height;
+  };
+
+  /**
+   * Worker process of one node
+   */
+  struct Node {
+    std::string command;
+    int pid = -1; // process of the command, -1 when it is not running
+    std::FILE *requests = nullptr; // standard input of the worker
+    std::FILE *results = nullptr; // standard output of the worker
+    bool ready = false; // worker loaded the maps, guarded by the mutex
+    bool failed = false;
+    unsigned regions = 0; // rendered regions
+    size_t pixels = 0; // pixels of the rendered regions
+    double milliseconds = 0.; // time the worker spent rendering the regions
+  };
+
+  constexpr static const unsigned regionsInFlight = 2; // regions requested from one node before it returns the first one
+
+  unsigned width, height;
+  std::vector<Node> nodes;
+  std::vector<unsigned char> pixels; // 8-bit RGB pixels of the frame
+  std::deque<Region> queue; // regions not requested yet
+  unsigned remainingRegions = 0; // regions not returned yet
+  unsigned servingNodes = 0; // nodes with their thread still running
+  std::mutex mutex;
+  std::condition_variable changed;
+
+  /**
+   * Start the worker of the node with pipes to its standard input and output
+   * @param node - node with the command, its process and pipes are set
+   * @return false if the process could not be started
+   */
+  static bool start(Node &node);
+
+  /**
+   * Wait for the header announcing the loaded maps
+   * @param node - started node
+   * @return true if the worker is ready
+   */
+  static bool waitReady(Node &node);
+
+  /**
+   * Kill the worker of the node with the processes it started, which ends the output of the worker
+   * @param node - started node
+   */
+  static void terminate(Node &node);
+
+  /**
+   * Close the pipes of the node and wait for its worker to exit, the failed worker is killed first
+   * @param node - node to stop
+   */
+  static void stop(Node &node);
+
+  /**
+   * Request regions from the node and store the returned pixels until all regions of the frame are returned
+   * @param node - started node
+   */
+  void serve(Node &node);
+
+  /**
+   * Read the pixels of the region from the node to the frame
+   * @param node - node, which rendered the region
+   * @param region - region expected from the node
+   * @return false if the node returned another region or its output ended
+   */
+  bool receive(Node &node, const Region &region);
+
+public:
+  /**
+   * Split the frame into regions for the nodes
+   * @param commands - commands starting the workers, one per node
+   * @param width - width of the frame
+   * @param height - height of the frame
+   * @param regionSize - width and height of the regions in pixels, a multiple of the screen tiles, so no tile is traced by two nodes
+   */
+  explicit RenderCoordinator(const std::vector<std::string> &commands, unsigned width, unsigned height, unsigned regionSize);
+
+  RenderCoordinator(const RenderCoordinator &) = delete;
+  RenderCoordinator &operator=(const RenderCoordinator &) = delete;
+
+  /**
+   * Stop the workers still running
+   */
+  ~RenderCoordinator();
+
+  /**
+   * Start the workers, render all regions of the frame and stop the workers, nodes not ready before the frame is finished are killed
+   * @throws std::invalid_argument if no node rendered the remaining regions
+   */
+  void render();
+
+  /**
+   * Get pixels of the rendered frame
+   * @return 8-bit RGB pixels row by row from the top, as in the image files
+   */
+  [[nodiscard]] const std::vector<unsigned char> &getPixels() const;
+
+  /**
+   * Print regions, pixels and rendering time of every node
+   * @param out - output stream
+   */
+  void printStatistics(std::ostream &out) const;
+};
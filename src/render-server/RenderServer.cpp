@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "RenderServer.h"
+#include "src/context/Context.h"
+#include "src/image-writer/ImageWriter.h"
+#include "src/memory-report/MemoryReport.h"
+
+RenderServer::RenderServer(const std::vector<HeightMap> &heightMaps, const std::vector<SceneFile::Camera> &cameras, unsigned jobSlots, unsigned defaultWidth,
+  unsigned defaultHeight, const Vector3d &up)
+  : heightMaps(heightMaps), cameras(cameras), jobSlots(std::max(jobSlots, 1u)), defaultWidth(defaultWidth), defaultHeight(defaultHeight), up(up) {}
+
+bool RenderServer::readTriple(std::istream &stream, float &x, float &y, float &z) {
+  char first = 0, second = 0;
+  stream >> x >> first >> y >> second >> z;
+  return !stream.fail() && first == ',' && second == ',';
+}
+
+bool RenderServer::parseJob(const std::string &line, Job &job) const {
+  std::istringstream stream(line);
+  std::string name;
+  stream >> name;
+  auto camera = std::find_if(cameras.begin(), cameras.end(), [&name](const SceneFile::Camera &camera) { return camera.name == name; });
+  if (camera != cameras.end()) {
+    job.eye = camera->eye;
+    job.center = camera->center;
+  } else {
+    stream.clear();
+    stream.seekg(0);
+    float ex, ey, ez, cx, cy, cz;
+    if (!readTriple(stream, ex, ey, ez) || !readTriple(stream, cx, cy, cz)) return false;
+    job.eye = Vector3d(ex, ey, ez);
+    job.center = Point3d(cx, cy, cz);
+  }
+  if (!(stream >> job.outputPath)) return false;
+  job.width = defaultWidth;
+  job.height = defaultHeight;
+  int width, height;
+  if (stream >> width) {
+    if (!(stream >> height) || width <= 0 || height <= 0) return false;
+    job.width = unsigned(width);
+    job.height = unsigned(height);
+  }
+  std::string rest;
+  return !(stream >> rest) && ImageWriter::isSupported(job.outputPath);
+}
+
+void RenderServer::workerLoop() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock lock(jobMutex);
+      jobAdded.wait(lock, [this] { return closed || !jobs.empty(); });
+      if (jobs.empty()) return;
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+    render(job);
+  }
+}
+
+void RenderServer::render(const Job &job) {
+  try {
+    auto start = std::chrono::steady_clock::now();
+    Context context(job.width, job.height, heightMaps, scene::bgColor, job.center, job.eye, up);
+    auto renderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ImageWriter::save(context, job.outputPath);
+    std::lock_guard lock(outputMutex);
+    std::cout << "job " << job.number << " rendered " << job.width << "x" << job.height << " in " << renderTime << " ms to " << job.outputPath << std::endl;
+  } catch (const std::exception &) {
+    std::lock_guard lock(outputMutex);
+    failedJobs++;
+    std::cerr << "job " << job.number << " failed" << std::endl;
+  }
+}
+
+void RenderServer::printMemory() {
+  MemoryReport report;
+  for (const auto &heightMap : heightMaps) heightMap.reportMemory(report);
+  std::lock_guard lock(outputMutex);
+  std::cout << "memory of the height maps:" << std::endl;
+  report.print(std::cout);
+}
+
+unsigned RenderServer::run(std::istream &input) {
+  // tile statistics of the concurrent jobs would be mixed, each job prints one line instead
+  scene::printTileStatistics = false;
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < jobSlots; i++) workers.emplace_back(&RenderServer::workerLoop, this);
+
+  auto start = std::chrono::steady_clock::now();
+  std::string line;
+  unsigned lineNumber = 0, jobCount = 0;
+  while (std::getline(input, line)) {
+    lineNumber++;
+    auto first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') continue;
+    if (line.compare(first, 4, "quit") == 0) break;
+    if (line.compare(first, 6, "memory") == 0) {
+      printMemory();
+      continue;
+    }
+    Job job;
+    job.number = jobCount;
+    if (!parseJob(line, job)) {
+      std::lock_guard lock(outputMutex);
+      failedJobs++;
+      std::cerr << "invalid job on line " << lineNumber << ", expected ex,ey,ez cx,cy,cz file [width] [height] or camera file [width] [height]" << std::endl;
+      continue;
+    }
+    jobCount++;
+    {
+      std::lock_guard lock(jobMutex);
+      jobs.push_back(std::move(job));
+    }
+    jobAdded.notify_one();
+  }
+  {
+    std::lock_guard lock(jobMutex);
+    closed = true;
+  }
+  jobAdded.notify_all();
+  for (auto &worker : workers) worker.join();
+
+  auto totalTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "rendered " << jobCount << " jobs in " << totalTime << " ms, " << failedJobs << " invalid or failed" << std::endl;
+  return failedJobs;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "src/heightmap/HeightMap.h"
+#include "src/point/Point3d.h"
+#include "src/scene-file/SceneFile.h"
+#include "src/vector/Vector3d.h"
+
+/**
+ * Long-running render service, which renders jobs read line by line from a stream with the height maps loaded only once
+ *
+ * Every line holds one job as eye, center and output file separated by space, optionally followed by width and height:
+ * ex,ey,ez cx,cy,cz file [width] [height]
+ * The eye and the center can be replaced by the name of a camera of the scene file: camera file [width] [height]
+ * Empty lines and lines starting with # are skipped, the line memory prints the memory of the resident height maps.
+ * Several jobs are rendered at once, each in its own context, their pixels are traced by the shared thread pool,
+ * so the grids, pyramids and tile caches stay resident between the jobs.
+ */
+class RenderServer {
+  /**
+   * One image to render
+   */
+  struct Job {
+    unsigned number; // order of the job in the stream
+    Vector3d eye;
+    Point3d center;
+    std::string outputPath;
+    unsigned width, height;
+  };
+
+  const std::vector<HeightMap> &heightMaps;
+  std::vector<SceneFile::Camera> cameras; // named cameras the jobs can use
+  unsigned jobSlots; // number of jobs rendered at once
+  unsigned defaultWidth, defaultHeight;
+  Vector3d up;
+
+  std::deque<Job> jobs;
+  std::mutex jobMutex;
+  std::condition_variable jobAdded;
+  bool closed = false; // no more jobs will be added
+  std::mutex outputMutex; // lines of the concurrent jobs are not mixed
+  unsigned failedJobs = 0; // guarded by the output mutex
+
+  /**
+   * Parse three comma separated numbers
+   * @param stream - stream with text in format x,y,z
+   * @param x - parsed x
+   * @param y - parsed y
+   * @param z - parsed z
+   * @return true if the numbers were parsed
+   */
+  static bool readTriple(std::istream &stream, float &x, float &y, float &z);
+
+  /**
+   * Parse one line of the stream to the job
+   * @param line - text of the job
+   * @param job - where the parsed job is stored, its number is kept
+   * @return true if the line holds a valid job
+   */
+  bool parseJob(const std::string &line, Job &job) const;
+
+  /**
+   * Take jobs from the queue and render them until the queue is closed and empty
+   */
+  void workerLoop();
+
+  /**
+   * Render the job and save its image, failure is reported and does not stop the server
+   * @param job - job to render
+   */
+  void render(const Job &job);
+
+public:
+  /**
+   * Create server rendering the height maps
+   * @param heightMaps - loaded height maps, they must not be changed while the server runs
+   * @param cameras - named cameras of the scene file
+   * @param jobSlots - number of jobs rendered at once
+   * @param defaultWidth - width of the images of the jobs without the size
+   * @param defaultHeight - height of the images of the jobs without the size
+   * @param up - up vector of all cameras
+   */
+  explicit RenderServer(const std::vector<HeightMap> &heightMaps, const std::vector<SceneFile::Camera> &cameras, unsigned jobSlots, unsigned defaultWidth, unsigned defaultHeight, const Vector3d &up);
+
+  /**
+   * Read the jobs from the stream and render them until the end of the stream or the line quit, all read jobs are finished
+   * @param input - stream with one job per line
+   * @return number of the jobs which failed
+   */
+  unsigned run(std::istream &input);
+
+  /**
+   * Print memory of the height maps and their tile caches, the pixel buffers of the jobs live only while they are rendered
+   */
+  void printMemory();
+};
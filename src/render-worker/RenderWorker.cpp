@@ -0,0 +1,42 @@
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "RenderWorker.h"
+#include "src/image-writer/ImageWriter.h"
+
+RenderWorker::RenderWorker(Context &context) : context(context) {}
+
+bool RenderWorker::send(std::FILE *output, const RegionHeader &header, const unsigned char *pixels, size_t size) {
+  if (std::fwrite(&header, sizeof(header), 1, output) != 1) return false;
+  if (size > 0 && std::fwrite(pixels, 1, size, output) != size) return false;
+  return std::fflush(output) == 0;
+}
+
+bool RenderWorker::run(std::istream &requests, std::FILE *output) {
+  if (!send(output, {0, 0, 0, 0, 0.f}, nullptr, 0)) {
+    std::cerr << "worker can not write to the coordinator" << std::endl;
+    return false;
+  }
+  std::vector<unsigned char> pixels;
+  std::string line;
+  while (std::getline(requests, line)) {
+    if (line.empty()) continue;
+    std::istringstream stream(line);
+    unsigned x, y, width, height;
+    if (!(stream >> x >> y >> width >> height) || width == 0 || height == 0 || x + width > context.getWidth() || y + height > context.getHeight()) {
+      std::cerr << "invalid region " << line << " of the frame " << context.getWidth() << "x" << context.getHeight() << std::endl;
+      return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    context.rayTrace(x, y, x + width, y + height);
+    auto milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ImageWriter::convertPixels(context, x, y, x + width, y + height, pixels);
+    if (!send(output, {x, y, width, height, milliseconds}, pixels.data(), pixels.size())) {
+      std::cerr << "worker can not write to the coordinator" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
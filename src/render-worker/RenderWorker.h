@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+#include "src/context/Context.h"
+
+/**
+ * Node of the distributed rendering, which renders the regions of the frame requested by the coordinator
+ *
+ * The coordinator starts the worker with the same scene arguments, so the worker loads the same height maps (mapped from the terrain cache
+ * when there is one) and sets the same camera. Every request line holds one region as x y width height, the worker answers
+ * in the order of the requests with the region header followed by the 8-bit RGB pixels of the region row by row from the top. One header without
+ * pixels (zero width and height) is sent when the maps are loaded. The worker ends at the end of the requests.
+ * The binary headers use the byte order of the node, like the terrain cache, so all nodes have to share it.
+ */
+class RenderWorker {
+public:
+  /**
+   * Header sent before the pixels of every rendered region
+   */
+  struct RegionHeader {
+    uint32_t x, y, width, height;
+    float milliseconds; // time the worker spent rendering the region
+  };
+
+private:
+  Context &context;
+
+  /**
+   * Write the header and the pixels to the output and flush it, so the coordinator can request the next region
+   * @param output - output to the coordinator
+   * @param header - header of the region
+   * @param pixels - pixels of the region, null for the header without pixels
+   * @param size - number of bytes of the pixels
+   * @return false if the output failed
+   */
+  static bool send(std::FILE *output, const RegionHeader &header, const unsigned char *pixels, size_t size);
+
+public:
+  /**
+   * Create worker rendering regions of the context
+   * @param context - context with the camera of the frame, created without rendering it
+   */
+  explicit RenderWorker(Context &context);
+
+  /**
+   * Announce the loaded maps and render the requested regions until the end of the requests
+   * @param requests - stream with the request lines
+   * @param output - binary output receiving the rendered regions
+   * @return false if a request was invalid or the output failed
+   */
+  bool run(std::istream &requests, std::FILE *output);
+};
@@ -0,0 +1,126 @@
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "SceneFile.h"
+
+SceneFile::SceneFile(const std::string &fileName, const Material &defaultMaterial, const Color &defaultBgColor, bool defaultBilinearPatches) : bgColor(defaultBgColor) {
+  std::ifstream file(fileName);
+  if (!file) {
+    std::cerr << "scene file " << fileName << " can not be read" << std::endl;
+    throw std::invalid_argument("scene file can not be read");
+  }
+  std::string line;
+  unsigned lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    auto first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') continue;
+    if (!parseLine(line, defaultMaterial, defaultBilinearPatches)) {
+      std::cerr << "invalid line " << lineNumber << " of the scene file " << fileName << ": " << line << std::endl;
+      throw std::invalid_argument("invalid scene file");
+    }
+  }
+  if (maps.empty()) {
+    std::cerr << "scene file " << fileName << " has no maps" << std::endl;
+    throw std::invalid_argument("scene file without maps");
+  }
+}
+
+bool SceneFile::readTriple(std::istream &stream, float &x, float &y, float &z) {
+  char first = 0, second = 0;
+  stream >> x >> first >> y >> second >> z;
+  return !stream.fail() && first == ',' && second == ',';
+}
+
+bool SceneFile::parseMaterial(const std::string &name, Material &material) {
+  const std::pair<const char *, ColorChanging> names[] = {{"fields", ColorChanging::FIELDS}, {"lava", ColorChanging::LAVA}, {"ice", ColorChanging::ICE}};
+  for (const auto &[materialName, changing] : names) {
+    if (name == materialName) {
+      material = Material(changing);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SceneFile::parseLine(const std::string &line, const Material &defaultMaterial, bool defaultBilinearPatches) {
+  std::istringstream stream(line);
+  std::string keyword, rest;
+  stream >> keyword;
+  float x, y, z;
+  if (keyword == "map") {
+    Map map{"", Point3d(), Vector3d(), defaultMaterial, "", "", defaultBilinearPatches};
+    float width, height, depth;
+    if (!(stream >> map.path) || !readTriple(stream, x, y, z) || !readTriple(stream, width, height, depth)) return false;
+    if (width <= 0.f || height <= 0.f || depth <= 0.f) return false;
+    map.position = Point3d(x, y, z);
+    map.size = Vector3d(width, height, depth);
+    std::string material;
+    if (stream >> material && !parseMaterial(material, map.material)) return false;
+    stream >> map.terrainCachePath;
+    maps.push_back(std::move(map));
+  } else if (keyword == "texture") {
+    if (maps.empty() || !maps.back().texturePath.empty() || !(stream >> maps.back().texturePath)) return false;
+  } else if (keyword == "cells") {
+    std::string primitive;
+    if (maps.empty() || !(stream >> primitive) || (primitive != "triangles" && primitive != "bilinear")) return false;
+    maps.back().bilinearPatches = primitive == "bilinear";
+  } else if (keyword == "light") {
+    if (!readTriple(stream, x, y, z)) return false;
+    auto color = Color(1.f, 1.f, 1.f);
+    auto range = std::numeric_limits<float>::infinity();
+    float r, g, b;
+    if (readTriple(stream, r, g, b)) {
+      color = Color(r, g, b);
+      if (!(stream >> range)) {
+        range = std::numeric_limits<float>::infinity();
+        stream.clear();
+      } else if (range <= 0.f) {
+        return false;
+      }
+    } else if (!stream.eof()) {
+      return false;
+    }
+    lights.emplace_back(Point3d(x, y, z), color, range);
+  } else if (keyword == "camera") {
+    Camera camera;
+    float cx, cy, cz;
+    if (!(stream >> camera.name) || !readTriple(stream, x, y, z) || !readTriple(stream, cx, cy, cz)) return false;
+    camera.eye = Vector3d(x, y, z);
+    camera.center = Point3d(cx, cy, cz);
+    if (findCamera(camera.name)) return false;
+    cameras.push_back(std::move(camera));
+  } else if (keyword == "background") {
+    if (!readTriple(stream, x, y, z)) return false;
+    bgColor = Color(x, y, z);
+  } else {
+    return false;
+  }
+  stream.clear();
+  return !(stream >> rest);
+}
+
+const std::vector<SceneFile::Map> &SceneFile::getMaps() const {
+  return maps;
+}
+
+const std::vector<Light> &SceneFile::getLights() const {
+  return lights;
+}
+
+const std::vector<SceneFile::Camera> &SceneFile::getCameras() const {
+  return cameras;
+}
+
+const SceneFile::Camera *SceneFile::findCamera(const std::string &name) const {
+  for (const auto &camera : cameras) {
+    if (camera.name == name) return &camera;
+  }
+  return nullptr;
+}
+
+const Color &SceneFile::getBgColor() const {
+  return bgColor;
+}
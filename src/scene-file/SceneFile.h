@@ -0,0 +1,123 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "src/color/Color.h"
+#include "src/light/Light.h"
+#include "src/material/Material.h"
+#include "src/point/Point3d.h"
+#include "src/vector/Vector3d.h"
+
+/**
+ * Scene read from a text file at the start, instead of the compiled-in scene tables of the scene number
+ *
+ * Every line starts with a keyword, numbers of the coordinates and colors are separated by commas:
+ * map path x,y,z width,height,depth [fields|lava|ice] [terrain-cache] - height map, its position, size and material
+ * texture path - color image draped over the previous map instead of its material color
+ * cells triangles|bilinear - cells of the previous map are intersected as two triangles or as the bilinear patch through their corners
+ * light x,y,z [r,g,b] [range] - light with its intensity and range where it fades out, default is white light without a range
+ * camera name ex,ey,ez cx,cy,cz - named eye and center of the view, batch jobs can use the name instead of the coordinates
+ * background r,g,b - color of the pixels which miss all height maps
+ * Empty lines and lines starting with # are skipped. Maps without material use the material of the scene number, scene without
+ * lights uses the light of the scene number.
+ */
+class SceneFile {
+public:
+  /**
+   * Height map of the scene
+   */
+  struct Map {
+    std::string path;
+    Point3d position;
+    Vector3d size; // width, height and depth of the map
+    Material material;
+    std::string terrainCachePath; // binary file with the built grid, empty if it should not be used
+    std::string texturePath; // image draped over the map, empty for the material color
+    bool bilinearPatches; // cells are intersected as the bilinear patches instead of the triangles
+  };
+
+  /**
+   * Named camera of the scene
+   */
+  struct Camera {
+    std::string name;
+    Vector3d eye;
+    Point3d center;
+  };
+
+private:
+  std::vector<Map> maps;
+  std::vector<Light> lights;
+  std::vector<Camera> cameras;
+  Color bgColor;
+
+  /**
+   * Parse three comma separated numbers
+   * @param stream - stream with text in format x,y,z
+   * @param x - parsed x
+   * @param y - parsed y
+   * @param z - parsed z
+   * @return true if the numbers were parsed
+   */
+  static bool readTriple(std::istream &stream, float &x, float &y, float &z);
+
+  /**
+   * Find material by its name
+   * @param name - one of fields, lava, ice
+   * @param material - where the material is stored
+   * @return true if the name is known
+   */
+  static bool parseMaterial(const std::string &name, Material &material);
+
+  /**
+   * Parse one line of the file to the scene
+   * @param line - text of the line, which is not a comment
+   * @param defaultMaterial - material of the map without material
+   * @param defaultBilinearPatches - cell primitive of the map without the cells line
+   * @return true if the line is valid
+   */
+  bool parseLine(const std::string &line, const Material &defaultMaterial, bool defaultBilinearPatches);
+
+public:
+  /**
+   * Read the scene from the file, the file has to have at least one map
+   * @param fileName - path of the scene file
+   * @param defaultMaterial - material of the maps without material
+   * @param defaultBgColor - background of the scene without background
+   * @param defaultBilinearPatches - the maps without the cells line are intersected as the bilinear patches
+   */
+  explicit SceneFile(const std::string &fileName, const Material &defaultMaterial, const Color &defaultBgColor, bool defaultBilinearPatches = false);
+
+  /**
+   * Get height maps of the scene
+   * @return maps in the order of the file
+   */
+  [[nodiscard]] const std::vector<Map> &getMaps() const;
+
+  /**
+   * Get lights of the scene
+   * @return lights in the order of the file, empty if the file has none
+   */
+  [[nodiscard]] const std::vector<Light> &getLights() const;
+
+  /**
+   * Get cameras of the scene
+   * @return cameras in the order of the file
+   */
+  [[nodiscard]] const std::vector<Camera> &getCameras() const;
+
+  /**
+   * Find the camera by its name
+   * @param name - name of the camera
+   * @return camera, nullptr if the scene has no camera of the name
+   */
+  [[nodiscard]] const Camera *findCamera(const std::string &name) const;
+
+  /**
+   * Get background color of the scene
+   * @return background color
+   */
+  [[nodiscard]] const Color &getBgColor() const;
+};
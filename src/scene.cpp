@@ -3,6 +3,51 @@
 
 int scene::sceneNumber = 0;
 
+unsigned scene::threadCount = 0;
+
+unsigned scene::tileSize = 32;
+
+bool scene::printTileStatistics = true;
+TraversalStatistics::Counter scene::heatmap = TraversalStatistics::Counter::none;
+
+bool scene::progressiveRendering = false;
+
+bool scene::gpuTraversal = false;
+
+unsigned scene::progressiveStep = 16;
+
+unsigned scene::terrainTileSize = 0;
+
+unsigned scene::tileCacheMegabytes = 1024;
+
+unsigned scene::memoryBudgetMegabytes = 0;
+bool scene::compactCells = false;
+
+bool scene::reprojectDepth = false;
+bool scene::beamTraversal = false;
+bool scene::wavefront = false;
+FrameBuffer::Format scene::framebufferFormat = FrameBuffer::Format::Float;
+
+unsigned scene::detailLevels = 0;
+
+float scene::lodTolerance = 1.f;
+
+bool scene::smoothNormals = false;
+
+bool scene::bilinearPatches = false;
+
+unsigned scene::cityLights = 0;
+
+unsigned scene::lightSamples = 0;
+
+unsigned scene::horizonDirections = 0;
+
+unsigned scene::antialiasing = 0;
+
+bool scene::heightCeiling = false;
+
+unsigned scene::reflectionDepth = 0;
+
 const std::vector<Point3d> scene::defaultCenter = {
   Point3d(275.f, 200.f, 0.f),
   Point3d(275.f, 200.f, 0.f),
@@ -19,12 +64,16 @@ const Vector3d scene::defaultUp = Vector3d(0.f, 1.f, 0.f);
 
 const Color scene::defaultBgColor = Color(0.01f, 0.01f, 0.01f);
 
+Color scene::bgColor = scene::defaultBgColor;
+
 const std::vector<Light> scene::lights = {
   Light(Point3d(-275, 400, -250)),
   Light(Point3d(275, 680, 50)),
   Light(Point3d(-250, 350, -275))
 };
 
+std::vector<Light> scene::sceneLights;
+
 const std::vector<Material> scene::materials = {
   Material(ColorChanging::FIELDS),
   Material(ColorChanging::LAVA),
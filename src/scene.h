@@ -7,6 +7,7 @@
 #include "src/color/Color.h"
 #include "src/material/Material.h"
 #include "src/heightmap/HeightMap.h"
+#include "src/frame-buffer/FrameBuffer.h"
 #include "light/Light.h"
 
 /**
@@ -45,6 +46,137 @@ struct scene {
    */
   constexpr static const double precision = 10000.;
 
+  /**
+   * Number of threads used for rendering, 0 for all hardware threads
+   */
+  static unsigned threadCount;
+
+  /**
+   * Size of the square tile rendered by one task (in pixels)
+   */
+  static unsigned tileSize;
+
+  /**
+   * Print per-tile timing breakdown after the ray tracing
+   */
+  static bool printTileStatistics;
+
+  /**
+   * Traversal counter shown as false-color heatmap instead of the shaded image, none for the shaded image
+   * Counters are collected only when built with TRAVERSAL_STATISTICS
+   */
+  static TraversalStatistics::Counter heatmap;
+
+  /**
+   * Render in the background from coarse to fine passes instead of rendering the whole frame in the context constructor
+   */
+  static bool progressiveRendering;
+
+  /**
+   * Trace the frames of the window in the compute shader instead of the CPU, needs GPU_TRAVERSAL build
+   */
+  static bool gpuTraversal;
+
+  /**
+   * Distance between pixels traced by the first progressive pass (power of two)
+   */
+  static unsigned progressiveStep;
+
+  /**
+   * Number of cells in the side of the terrain tile loaded on demand (power of two), 0 to read the whole height map to memory
+   */
+  static unsigned terrainTileSize;
+
+  /**
+   * Memory for the loaded terrain tiles (in megabytes)
+   */
+  static unsigned tileCacheMegabytes;
+
+  /**
+   * Memory for the height maps and their structures (in megabytes), maps which do not fit are loaded in a cheaper representation,
+   * 0 without the limit
+   */
+  static unsigned memoryBudgetMegabytes;
+
+  /**
+   * Build the triangles of the cells from the samples even when built with STORED_TRIANGLES, set when the memory budget does not fit them
+   */
+  static bool compactCells;
+
+  /**
+   * Start primary rays of the next frame near the intersections of the previous frame moved to the new camera
+   */
+  static bool reprojectDepth;
+
+  /**
+   * Walk the frustum of every tile through the max-height pyramids first, so the rays of the tile start after the common empty space
+   */
+  static bool beamTraversal;
+
+  /**
+   * Trace every pass in stages over the whole screen (primary rays, shading, shadow rays of each light, output) instead of tracing
+   * and shading pixel by pixel, the image is the same
+   */
+  static bool wavefront;
+
+  /**
+   * Storage format of the color buffer, the antialiasing averages the samples of the pixel in floats and stores the pixel once
+   */
+  static FrameBuffer::Format framebufferFormat;
+
+  /**
+   * Number of the coarser levels of detail of the height maps, 0 to always trace the full resolution
+   */
+  static unsigned detailLevels;
+
+  /**
+   * Coarser level of detail is used where its cell is smaller than this number of pixels
+   */
+  static float lodTolerance;
+
+  /**
+   * Shade with the normals interpolated from the samples of the height maps instead of the flat normals of the triangles
+   */
+  static bool smoothNormals;
+
+  /**
+   * Intersect the cells of the height maps as the bilinear patches through their corner samples instead of the two triangles,
+   * the maps of the scene file can choose their own primitive
+   */
+  static bool bilinearPatches;
+
+  /**
+   * Number of the city lights with limited range scattered over the height maps in addition to the scene light
+   * With city lights every pixel is shaded only by the lights which can reach its terrain block
+   */
+  static unsigned cityLights;
+
+  /**
+   * Number of the lights picked randomly by their weight for every pixel, 0 to shade all lights reaching the terrain block
+   */
+  static unsigned lightSamples;
+
+  /**
+   * Number of the azimuth directions of the horizon maps used for the shadows instead of the shadow rays, 0 to trace the shadow rays
+   */
+  static unsigned horizonDirections;
+
+  /**
+   * Number of the samples in the row and in the column of the supersampled pixel, pixels differing from their neighbours
+   * in the color or the depth are supersampled after the image is traced, 0 or 1 to trace only one ray per pixel
+   */
+  static unsigned antialiasing;
+
+  /**
+   * Maximal number of the bounces of the reflection rays from the reflective materials, 0 without reflections
+   */
+  static unsigned reflectionDepth;
+
+  /**
+   * Start the primary rays where they get under the coarse ceiling of the maximal heights of the height maps
+   */
+  static bool heightCeiling;
+
 
   /**
   * Default center point
@@ -67,11 +199,21 @@ struct scene {
    */
   const static Color defaultBgColor;
 
+  /**
+   * Color of the background used by the rendered contexts, the default color or the background of the scene file
+   */
+  static Color bgColor;
+
   /**
    * Definition of scene lights
    */
   static const std::vector<Light> lights;
 
+  /**
+   * Lights of the scene file used instead of the light of the scene number, empty without the scene file
+   */
+  static std::vector<Light> sceneLights;
+
   /**
    * Definition of scene materials
    */
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+/**
+ * Type for four floats processed at once (SSE), with scalar fallback when SSE is not available
+ *
+ * Comparisons return lane masks (all bits set in lanes where the comparison holds), which can be combined by & and |,
+ * used in select or turned to bits by getMask.
+ */
+class Float4 {
+#ifdef SIMD_SSE
+  __m128 v;
+
+  explicit Float4(__m128 v) : v(v) {}
+#else
+  float v[4];
+
+  template<typename F>
+  static Float4 map(const Float4 &a, const Float4 &b, F f) {
+    Float4 r;
+    for (int i = 0; i < 4; i++) r.v[i] = f(a.v[i], b.v[i]);
+    return r;
+  }
+
+  static float fromBits(unsigned bits) {
+    float f;
+    std::copy_n(reinterpret_cast<const char *>(&bits), sizeof(float), reinterpret_cast<char *>(&f));
+    return f;
+  }
+
+  static unsigned toBits(float f) {
+    unsigned bits;
+    std::copy_n(reinterpret_cast<const char *>(&f), sizeof(float), reinterpret_cast<char *>(&bits));
+    return bits;
+  }
+#endif
+
+public:
+  /**
+   * Create vector of zeros
+   */
+  Float4() : Float4(0.f) {}
+
+  /**
+   * Create vector with the same value in all lanes
+   * @param x - value of all lanes
+   */
+  explicit Float4(float x) {
+#ifdef SIMD_SSE
+    v = _mm_set1_ps(x);
+#else
+    std::fill_n(v, 4, x);
+#endif
+  }
+
+  /**
+   * Create vector with given lanes
+   */
+  explicit Float4(float a, float b, float c, float d) {
+#ifdef SIMD_SSE
+    v = _mm_setr_ps(a, b, c, d);
+#else
+    v[0] = a, v[1] = b, v[2] = c, v[3] = d;
+#endif
+  }
+
+  /**
+   * Load four floats from memory
+   * @param p - pointer to four floats (does not need to be aligned)
+   */
+  explicit Float4(const float *p) {
+#ifdef SIMD_SSE
+    v = _mm_loadu_ps(p);
+#else
+    std::copy_n(p, 4, v);
+#endif
+  }
+
+  /**
+   * Store lanes to memory
+   * @param p - pointer to four floats (does not need to be aligned)
+   */
+  void store(float *p) const {
+#ifdef SIMD_SSE
+    _mm_storeu_ps(p, v);
+#else
+    std::copy_n(v, 4, p);
+#endif
+  }
+
+  /**
+   * Store lanes truncated to bytes, lanes have to be in [0, 256)
+   * @param p - pointer to four bytes
+   */
+  void storeBytes(unsigned char *p) const {
+#ifdef SIMD_SSE
+    auto integers = _mm_cvttps_epi32(v);
+    auto bytes = _mm_packus_epi16(_mm_packs_epi32(integers, integers), integers);
+    auto packed = _mm_cvtsi128_si32(bytes);
+    std::copy_n(reinterpret_cast<const unsigned char *>(&packed), 4, p);
+#else
+    for (unsigned i = 0; i < 4; i++) p[i] = (unsigned char) v[i];
+#endif
+  }
+
+#ifdef SIMD_SSE
+  Float4 operator+(const Float4 &o) const { return Float4(_mm_add_ps(v, o.v)); }
+  Float4 operator-(const Float4 &o) const { return Float4(_mm_sub_ps(v, o.v)); }
+  Float4 operator*(const Float4 &o) const { return Float4(_mm_mul_ps(v, o.v)); }
+  Float4 operator/(const Float4 &o) const { return Float4(_mm_div_ps(v, o.v)); }
+  Float4 operator<(const Float4 &o) const { return Float4(_mm_cmplt_ps(v, o.v)); }
+  Float4 operator>(const Float4 &o) const { return Float4(_mm_cmpgt_ps(v, o.v)); }
+  Float4 operator<=(const Float4 &o) const { return Float4(_mm_cmple_ps(v, o.v)); }
+  Float4 operator>=(const Float4 &o) const { return Float4(_mm_cmpge_ps(v, o.v)); }
+  Float4 operator==(const Float4 &o) const { return Float4(_mm_cmpeq_ps(v, o.v)); }
+  Float4 operator&(const Float4 &o) const { return Float4(_mm_and_ps(v, o.v)); }
+  Float4 operator|(const Float4 &o) const { return Float4(_mm_or_ps(v, o.v)); }
+  friend Float4 min(const Float4 &a, const Float4 &b) { return Float4(_mm_min_ps(a.v, b.v)); }
+  friend Float4 max(const Float4 &a, const Float4 &b) { return Float4(_mm_max_ps(a.v, b.v)); }
+  friend Float4 sqrt(const Float4 &a) { return Float4(_mm_sqrt_ps(a.v)); }
+  friend Float4 select(const Float4 &mask, const Float4 &a, const Float4 &b) { return Float4(_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))); }
+  friend int getMask(const Float4 &mask) { return _mm_movemask_ps(mask.v); }
+#else
+  Float4 operator+(const Float4 &o) const { return map(*this, o, [](float a, float b) { return a + b; }); }
+  Float4 operator-(const Float4 &o) const { return map(*this, o, [](float a, float b) { return a - b; }); }
+  Float4 operator*(const Float4 &o) const { return map(*this, o, [](float a, float b) { return a * b; }); }
+  Float4 operator/(const Float4 &o) const { return map(*this, o, [](float a, float b) { return a / b; }); }
+  Float4 operator<(const Float4 &o) const { return map(*this, o, [](float a, float b) { return fromBits(a < b ? ~0u : 0u); }); }
+  Float4 operator>(const Float4 &o) const { return map(*this, o, [](float a, float b) { return fromBits(a > b ? ~0u : 0u); }); }
+  Float4 operator<=(const Float4 &o) const { return map(*this, o, [](float a, float b) { return fromBits(a <= b ? ~0u : 0u); }); }
+  Float4 operator>=(const Float4 &o) const { return map(*this, o, [](float a, float b) { return fromBits(a >= b ? ~0u : 0u); }); }
+  Float4 operator==(const Float4 &o) const { return map(*this, o, [](float a, float b) { return fromBits(a == b ? ~0u : 0u); }); }
+  Float4 operator&(const Float4 &o) const { return map(*this, o, [](float a, float b) { return fromBits(toBits(a) & toBits(b)); }); }
+  Float4 operator|(const Float4 &o) const { return map(*this, o, [](float a, float b) { return fromBits(toBits(a) | toBits(b)); }); }
+  friend Float4 min(const Float4 &a, const Float4 &b) { return map(a, b, [](float x, float y) { return x < y ? x : y; }); }
+  friend Float4 max(const Float4 &a, const Float4 &b) { return map(a, b, [](float x, float y) { return x > y ? x : y; }); }
+  friend Float4 sqrt(const Float4 &a) { return map(a, a, [](float x, float) { return std::sqrt(x); }); }
+  friend Float4 select(const Float4 &mask, const Float4 &a, const Float4 &b) {
+    Float4 r;
+    for (int i = 0; i < 4; i++) r.v[i] = toBits(mask.v[i]) ? a.v[i] : b.v[i];
+    return r;
+  }
+  friend int getMask(const Float4 &mask) {
+    int bits = 0;
+    for (int i = 0; i < 4; i++) bits |= (toBits(mask.v[i]) >> 31) << i;
+    return bits;
+  }
+#endif
+};
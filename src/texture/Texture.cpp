@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cmath>
+#include <corona.h>
+#include <iostream>
+#include <stdexcept>
+
+#include "Texture.h"
+
+uint32_t Texture::pack(unsigned r, unsigned g, unsigned b) {
+  return r | g << 8u | b << 16u;
+}
+
+unsigned Texture::getChannel(uint32_t texel, unsigned channel) {
+  return texel >> (8u * channel) & 0xffu;
+}
+
+void Texture::readPixels(unsigned width, unsigned height, const unsigned char *pixels, unsigned channels, bool reversed) {
+  levels.push_back({width, height, 0});
+  texels.resize(size_t(width) * height);
+  for (size_t i = 0; i < texels.size(); i++) {
+    const auto *pixel = pixels + i * channels;
+    if (channels == 1) {
+      texels[i] = pack(pixel[0], pixel[0], pixel[0]);
+    } else {
+      texels[i] = reversed ? pack(pixel[2], pixel[1], pixel[0]) : pack(pixel[0], pixel[1], pixel[2]);
+    }
+  }
+}
+
+void Texture::buildLevels() {
+  while (levels.back().width > 1 || levels.back().height > 1) {
+    auto previous = levels.back();
+    Level level{std::max(previous.width / 2, 1u), std::max(previous.height / 2, 1u), texels.size()};
+    texels.resize(level.offset + size_t(level.width) * level.height);
+    for (unsigned row = 0; row < level.height; row++) {
+      // odd last row or column of the previous level is averaged with itself
+      auto top = std::min(2 * row, previous.height - 1), bottom = std::min(2 * row + 1, previous.height - 1);
+      for (unsigned col = 0; col < level.width; col++) {
+        auto left = std::min(2 * col, previous.width - 1), right = std::min(2 * col + 1, previous.width - 1);
+        const uint32_t corners[4] = {
+          texels[previous.offset + size_t(top) * previous.width + left], texels[previous.offset + size_t(top) * previous.width + right],
+          texels[previous.offset + size_t(bottom) * previous.width + left], texels[previous.offset + size_t(bottom) * previous.width + right]
+        };
+        unsigned sums[3] = {2, 2, 2}; // rounded to the nearest value
+        for (auto corner : corners) {
+          for (unsigned channel = 0; channel < 3; channel++) sums[channel] += getChannel(corner, channel);
+        }
+        texels[level.offset + size_t(row) * level.width + col] = pack(sums[0] / 4, sums[1] / 4, sums[2] / 4);
+      }
+    }
+    levels.push_back(level);
+  }
+}
+
+Color Texture::sampleLevel(unsigned level, float u, float v) const {
+  const auto &[width, height, offset] = levels[level];
+  // texel centers lie on the half coordinates
+  auto x = std::clamp(u * float(width) - .5f, 0.f, float(width - 1));
+  auto y = std::clamp(v * float(height) - .5f, 0.f, float(height - 1));
+  auto col = std::min(unsigned(x), width - 1), row = std::min(unsigned(y), height - 1);
+  auto nextCol = std::min(col + 1, width - 1), nextRow = std::min(row + 1, height - 1);
+  auto fx = x - float(col), fy = y - float(row);
+  const auto *data = texels.data() + offset;
+  float channels[3];
+  for (unsigned channel = 0; channel < 3; channel++) {
+    auto top = float(getChannel(data[size_t(row) * width + col], channel)) * (1.f - fx) + float(getChannel(data[size_t(row) * width + nextCol], channel)) * fx;
+    auto bottom = float(getChannel(data[size_t(nextRow) * width + col], channel)) * (1.f - fx) + float(getChannel(data[size_t(nextRow) * width + nextCol], channel)) * fx;
+    channels[channel] = (top * (1.f - fy) + bottom * fy) / 255.f;
+  }
+  return Color(channels[0], channels[1], channels[2]);
+}
+
+Texture::Texture(const std::string &fileName) {
+  corona::Image *img = corona::OpenImage(fileName.c_str());
+  if (!img) {
+    std::cerr << "invalid texture file " << fileName << std::endl;
+    throw std::invalid_argument("received invalid texture file");
+  }
+
+  auto width = unsigned(img->getWidth()), height = unsigned(img->getHeight());
+  const auto *pixels = (const unsigned char *) img->getPixels();
+  switch (img->getFormat()) {
+    case corona::PF_I8:
+      readPixels(width, height, pixels, 1, false);
+      break;
+    case corona::PF_R8G8B8:
+      readPixels(width, height, pixels, 3, false);
+      break;
+    case corona::PF_B8G8R8:
+      readPixels(width, height, pixels, 3, true);
+      break;
+    case corona::PF_R8G8B8A8:
+      readPixels(width, height, pixels, 4, false);
+      break;
+    case corona::PF_B8G8R8A8:
+      readPixels(width, height, pixels, 4, true);
+      break;
+    default:
+      delete img;
+      std::cerr << "invalid texture file type " << fileName << std::endl;
+      throw std::invalid_argument("received invalid texture file type");
+  }
+  delete img;
+  buildLevels();
+}
+
+Color Texture::sample(float u, float v, float footprint) const {
+  // level whose texel has the size of the footprint, the levels between are blended
+  auto texelsCovered = footprint * float(levels[0].width);
+  auto level = texelsCovered > 1.f ? std::min(std::log2(texelsCovered), float(levels.size() - 1)) : 0.f;
+  auto first = unsigned(level);
+  auto fraction = level - float(first);
+  auto color = sampleLevel(first, u, v);
+  if (fraction == 0.f || first + 1 >= levels.size()) return color;
+  return color * (1.f - fraction) + sampleLevel(first + 1, u, v) * fraction;
+}
+
+unsigned Texture::getLevelCount() const {
+  return unsigned(levels.size());
+}
+
+size_t Texture::getMemorySize() const {
+  return texels.size() * sizeof(uint32_t);
+}
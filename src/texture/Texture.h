@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/color/Color.h"
+
+/**
+ * Color texture with the mip-map levels, sampled trilinearly from the levels matching the footprint of the sample
+ *
+ * Texels are stored as 8-bit rgb packed to four bytes, level 0 is the image and every other level averages 2 x 2 texels
+ * of the previous one, until the level of one texel. Far samples with large footprint read the small levels, so the
+ * large textures are read only near the camera and the distant terrain does not flicker.
+ */
+class Texture {
+  /**
+   * One mip-map level in the shared array of the texels
+   */
+  struct Level {
+    unsigned width, height;
+    size_t offset; // index of the first texel of the level
+  };
+
+  std::vector<Level> levels;
+  std::vector<uint32_t> texels; // texels of all levels by rows, level 0 first
+
+  /**
+   * Pack color channels to one texel
+   * @param r - red channel
+   * @param g - green channel
+   * @param b - blue channel
+   * @return packed texel
+   */
+  [[nodiscard]] static uint32_t pack(unsigned r, unsigned g, unsigned b);
+
+  /**
+   * Get channel of the packed texel
+   * @param texel - packed texel
+   * @param channel - 0 for red, 1 for green, 2 for blue
+   * @return value of the channel
+   */
+  [[nodiscard]] static unsigned getChannel(uint32_t texel, unsigned channel);
+
+  /**
+   * Store the texels of the image as level 0
+   * @param width - width of the image
+   * @param height - height of the image
+   * @param pixels - pixels of the image by rows
+   * @param channels - number of bytes of the pixel, 1 for gray, 3 or 4 for rgb
+   * @param reversed - true if the channels are stored in bgr order
+   */
+  void readPixels(unsigned width, unsigned height, const unsigned char *pixels, unsigned channels, bool reversed);
+
+  /**
+   * Build levels from level 0 until the level of one texel
+   */
+  void buildLevels();
+
+  /**
+   * Sample one level bilinearly
+   * @param level - index of the level
+   * @param u - horizontal texture coordinate in [0, 1]
+   * @param v - vertical texture coordinate in [0, 1]
+   * @return interpolated color
+   */
+  [[nodiscard]] Color sampleLevel(unsigned level, float u, float v) const;
+
+public:
+  /**
+   * Read the texture from the image file and build its levels
+   * @param fileName - path of the image
+   */
+  explicit Texture(const std::string &fileName);
+
+  /**
+   * Sample the texture between the two levels whose texels are closest to the footprint, coordinates are clamped to the texture
+   * @param u - horizontal texture coordinate, 0 at the left column and 1 at the right one
+   * @param v - vertical texture coordinate, 0 at the top row and 1 at the bottom one
+   * @param footprint - size of the sampled area as a fraction of the texture width
+   * @return filtered color
+   */
+  [[nodiscard]] Color sample(float u, float v, float footprint) const;
+
+  /**
+   * Get number of the mip-map levels
+   * @return number of the levels, including level 0
+   */
+  [[nodiscard]] unsigned getLevelCount() const;
+
+  /**
+   * Get memory taken by the texels of all levels
+   * @return size in bytes
+   */
+  [[nodiscard]] size_t getMemorySize() const;
+};
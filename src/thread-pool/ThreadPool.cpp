@@ -0,0 +1,113 @@
+#include "ThreadPool.h"
+#include "src/profiler/Profiler.h"
+#include "src/scene.h"
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+  if (threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  auto workerCount = threadCount - 1; // waiting thread works too
+  for (unsigned i = 0; i < std::max(workerCount, 1u); i++) queues.emplace_back(std::make_unique<WorkerQueue>());
+  for (unsigned i = 0; i < workerCount; i++) workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(sleepMutex);
+    stopping = true;
+  }
+  wakeUp.notify_all();
+  for (auto &worker : workers) worker.join();
+}
+
+ThreadPool &ThreadPool::getShared() {
+  static ThreadPool pool(scene::threadCount);
+  return pool;
+}
+
+unsigned ThreadPool::getThreadCount() const {
+  return workers.size() + 1;
+}
+
+bool ThreadPool::popTask(unsigned index, std::function<void()> &task) {
+  for (unsigned i = 0; i < queues.size(); i++) {
+    auto &queue = *queues[(index + i) % queues.size()];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty()) continue;
+    if (i == 0) { // own queue from the front, others are stolen from the back
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+    queuedTasks--;
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+  Profiler::setThreadName("pool worker " + std::to_string(index));
+  std::function<void()> task;
+  while (true) {
+    if (popTask(index, task)) {
+      task();
+      continue;
+    }
+    Profiler::Scope scope("idle");
+    std::unique_lock lock(sleepMutex);
+    wakeUp.wait(lock, [this] { return stopping || queuedTasks > 0; });
+    if (stopping) return;
+  }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  auto index = nextQueue++ % queues.size();
+  {
+    std::lock_guard lock(queues[index]->mutex);
+    queues[index]->tasks.emplace_back(std::move(task));
+    std::lock_guard sleepLock(sleepMutex);
+    queuedTasks++;
+  }
+  wakeUp.notify_one();
+}
+
+bool ThreadPool::runPendingTask() {
+  std::function<void()> task;
+  if (!popTask(nextQueue % queues.size(), task)) return false;
+  task();
+  return true;
+}
+
+void ThreadPool::parallelFor(unsigned count, const std::function<void(unsigned)> &body) {
+  if (count == 0) return;
+  if (workers.empty() || count == 1) {
+    for (unsigned i = 0; i < count; i++) body(i);
+    return;
+  }
+
+  std::atomic<unsigned> remaining = count;
+  std::exception_ptr error;
+  std::mutex errorMutex;
+  for (unsigned i = 0; i < count; i++) {
+    submit([&, i] {
+      try {
+        body(i);
+      } catch (...) {
+        std::lock_guard lock(errorMutex);
+        if (!error) error = std::current_exception();
+      }
+      remaining--;
+    });
+  }
+  while (remaining > 0) {
+    if (!runPendingTask()) std::this_thread::yield();
+  }
+  if (error) std::rethrow_exception(error);
+}
+
+void ThreadPool::parallelForChunks(unsigned count, unsigned chunkSize, const std::function<void(unsigned, unsigned)> &body) {
+  chunkSize = std::max(chunkSize, 1u);
+  parallelFor((count + chunkSize - 1) / chunkSize, [&](unsigned chunk) {
+    body(chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+  });
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work-stealing thread pool
+ *
+ * Every worker owns a queue of tasks, takes tasks from the front of its own queue and steals from the back of the others.
+ * Threads waiting for a group of tasks help with the work instead of blocking.
+ */
+class ThreadPool {
+  /**
+   * Queue of tasks owned by one worker
+   */
+  struct WorkerQueue {
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+  };
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues;
+  std::vector<std::thread> workers;
+  std::mutex sleepMutex;
+  std::condition_variable wakeUp;
+  std::atomic<unsigned> queuedTasks = 0;
+  std::atomic<unsigned> nextQueue = 0;
+  bool stopping = false;
+
+  /**
+   * Take task from the queue with given index or steal it from the other queues
+   * @param index - index of the preferred queue
+   * @param task - where the found task is stored
+   * @return true if any task was found
+   */
+  bool popTask(unsigned index, std::function<void()> &task);
+
+  /**
+   * Main loop of the worker thread
+   * @param index - index of the worker queue
+   */
+  void workerLoop(unsigned index);
+
+public:
+  /**
+   * Create thread pool
+   * @param threadCount - number of threads working on tasks including the thread waiting for them, 0 for hardware concurrency
+   */
+  explicit ThreadPool(unsigned threadCount = 0);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * Get thread pool shared by the whole application, created with scene thread count
+   * @return shared thread pool
+   */
+  static ThreadPool &getShared();
+
+  /**
+   * Get number of threads working on tasks (including the waiting thread)
+   * @return number of threads
+   */
+  [[nodiscard]] unsigned getThreadCount() const;
+
+  /**
+   * Add task to the pool
+   * @param task - task to be run by one of the workers
+   */
+  void submit(std::function<void()> task);
+
+  /**
+   * Run one queued task in the calling thread if there is any
+   * @return true if task was run
+   */
+  bool runPendingTask();
+
+  /**
+   * Run body for every index in [0, count) and wait until all of them are finished, calling thread helps with the work
+   * @param count - number of indices
+   * @param body - function called with the index
+   */
+  void parallelFor(unsigned count, const std::function<void(unsigned)> &body);
+
+  /**
+   * Split [0, count) to chunks, run body for every chunk and wait until all of them are finished
+   * @param count - number of indices
+   * @param chunkSize - number of indices in one chunk (the last chunk can be smaller)
+   * @param body - function called with the first index of the chunk and the index after its end
+   */
+  void parallelForChunks(unsigned count, unsigned chunkSize, const std::function<void(unsigned, unsigned)> &body);
+};
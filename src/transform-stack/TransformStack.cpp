@@ -1,8 +1,7 @@
 #include "TransformStack.h"
 
 void TransformStack::replaceTop(const Matrix4d& matrix) {
-  stack.pop();
-  stack.emplace(matrix);
+  stack.top() = matrix;
 }
 
 TransformStack::TransformStack() {
@@ -22,10 +21,14 @@ std::ostream &operator<<(std::ostream &out, const TransformStack &transformStack
   return out;
 }
 
-Matrix4d TransformStack::top() const {
+const Matrix4d &TransformStack::top() const {
   return stack.top();
 }
 
 void TransformStack::multiplyTop(const Matrix4d &matrix) {
   replaceTop(top() * matrix);
 }
+
+void TransformStack::loadIdentity() {
+  replaceTop(Matrix4d::getIdentityMatrix());
+}
@@ -27,13 +27,18 @@ public:
 
   /**
    * Return top of the transform stack
-   * @return
+   * @return reference to the top matrix, valid until the stack changes
    */
-  [[nodiscard]] Matrix4d top() const;
+  [[nodiscard]] const Matrix4d &top() const;
 
   /**
    * Multiply top with given matrix
    * @param matrix
    */
   void multiplyTop(const Matrix4d &matrix);
+
+  /**
+   * Replace top matrix by the identity matrix
+   */
+  void loadIdentity();
 };
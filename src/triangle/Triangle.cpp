@@ -1,8 +1,6 @@
 #include "Triangle.h"
 
-Triangle::Triangle(const Point3d &p, const Vector3d &v1, const Vector3d &v2) : basePoint(p), vectors{v1, v2} {
-  normal = vectors[0].crossProduct(vectors[1]).normalized();
-}
+Triangle::Triangle(const Point3d &p, const Vector3d &v1, const Vector3d &v2) : basePoint(p), vectors{v1, v2} {}
 
 Triangle::Triangle(const Point3d &p1, const Point3d &p2, const Point3d &p3) : Triangle(p1, p2.getVectorBetween(p1), p3.getVectorBetween(p1)) {}
 
@@ -13,7 +11,7 @@ std::string Triangle::to_string() const {
   auto s = "triangle (" + nl;
   s += "  point: " + basePoint.to_string();
   s += "  vectors: " + vectors[0].to_string() + ", " + vectors[1].to_string();
-  s += "  -- normal: " + normal.to_string();
+  s += "  -- normal: " + getNormal().to_string();
   s += ")";
   return s;
 }
@@ -23,8 +21,8 @@ std::ostream &operator<<(std::ostream &out, const Triangle &triangle) {
   return out;
 }
 
-const Vector3d &Triangle::getNormal() const {
-  return normal;
+Vector3d Triangle::getNormal() const {
+  return vectors[0].crossProduct(vectors[1]).normalized();
 }
 
 bool Triangle::getIntersection(const Ray &ray, float &intersectionT) const {
@@ -12,9 +12,14 @@ class Triangle {
   Point3d basePoint;
   Vector3d vectors[2];
 
-  Vector3d normal;
+  friend class TrianglePacket;
 
 public:
+  /**
+   * Create degenerated triangle with all points in coordinates origin
+   */
+  explicit Triangle() = default;
+
   /**
    * Create triangle from base point and its' vectors
    * @param p - base point of triangle
@@ -41,10 +46,10 @@ public:
   friend std::ostream &operator<<(std::ostream &out, const Triangle &triangle);
 
   /**
-   * Return triangle normal
+   * Compute triangle normal
    * @return normal of the triangle
    */
-  [[nodiscard]] const Vector3d &getNormal() const;
+  [[nodiscard]] Vector3d getNormal() const;
 
   /**
    * Finds intersection of triangle and ray
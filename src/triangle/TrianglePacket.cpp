@@ -0,0 +1,57 @@
+#include "TrianglePacket.h"
+#include "src/simd/Float4.h"
+
+void TrianglePacket::add(const Triangle &triangle) {
+  const auto &p = triangle.basePoint;
+  const auto &a = triangle.vectors[0], &b = triangle.vectors[1];
+  add(p.getX(), p.getY(), p.getZ(), a.getX(), a.getY(), a.getZ(), b.getX(), b.getY(), b.getZ());
+}
+
+Vector3d TrianglePacket::getNormal(unsigned lane) const {
+  return Vector3d(v0X[lane], v0Y[lane], v0Z[lane]).crossProduct(Vector3d(v1X[lane], v1Y[lane], v1Z[lane])).normalized();
+}
+
+int TrianglePacket::getIntersections(const Ray &ray, float tMin, float tMax, float intersectionT[size]) const {
+  // unused lanes are masked out at the end
+  auto bX = Float4(baseX), bY = Float4(baseY), bZ = Float4(baseZ);
+  auto e0X = Float4(v0X), e0Y = Float4(v0Y), e0Z = Float4(v0Z);
+  auto e1X = Float4(v1X), e1Y = Float4(v1Y), e1Z = Float4(v1Z);
+  auto dirX = Float4(ray.getDirection().getX()), dirY = Float4(ray.getDirection().getY()), dirZ = Float4(ray.getDirection().getZ());
+
+  // s1 = direction x v1, divisor = s1 . v0
+  auto s1X = dirY * e1Z - dirZ * e1Y, s1Y = dirZ * e1X - dirX * e1Z, s1Z = dirX * e1Y - dirY * e1X;
+  auto divisor = s1X * e0X + s1Y * e0Y + s1Z * e0Z;
+  auto invertedDivisor = Float4(1.f) / divisor;
+
+  // d = origin - base, s2 = d x v0
+  auto dX = Float4(ray.getOrigin().getX()) - bX, dY = Float4(ray.getOrigin().getY()) - bY, dZ = Float4(ray.getOrigin().getZ()) - bZ;
+  auto b1 = (dX * s1X + dY * s1Y + dZ * s1Z) * invertedDivisor;
+  auto s2X = dY * e0Z - dZ * e0Y, s2Y = dZ * e0X - dX * e0Z, s2Z = dX * e0Y - dY * e0X;
+  auto b2 = (dirX * s2X + dirY * s2Y + dirZ * s2Z) * invertedDivisor;
+
+  auto zero = Float4(0.f), one = Float4(1.f);
+  auto t = (e1X * s2X + e1Y * s2Y + e1Z * s2Z) * invertedDivisor;
+  auto missed = (divisor == zero) | (b1 < zero) | (b1 > one) | (b2 < zero) | (b1 + b2 > one) | (t <= Float4(tMin)) | (t >= Float4(tMax));
+  t.store(intersectionT);
+  return ~getMask(missed) & ((1 << count) - 1);
+}
+
+bool TrianglePacket::findNearestIntersection(const Ray &ray, float tMin, float tMax, Intersection &intersection) const {
+  if (count == 0) return false;
+  float t[size];
+  auto hits = getIntersections(ray, tMin, tMax, t);
+  if (!hits) return false;
+
+  int nearest = -1;
+  for (unsigned lane = 0; lane < count; lane++) {
+    if ((hits & (1 << lane)) && (nearest < 0 || t[lane] < t[nearest])) nearest = int(lane);
+  }
+  intersection = Intersection(t[nearest], getNormal(nearest));
+  return true;
+}
+
+bool TrianglePacket::hasIntersection(const Ray &ray, float tMin, float tMax) const {
+  if (count == 0) return false;
+  float t[size];
+  return getIntersections(ray, tMin, tMax, t) != 0;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Triangle.h"
+#include "src/helper-types/Intersection.h"
+
+/**
+ * Type for up to four triangles stored as structure of arrays, so they can be tested against a ray by one SIMD pass
+ *
+ * Every lane computes the same operations as Triangle::getIntersection, so the results are equal to testing the triangles one by one
+ */
+class TrianglePacket {
+  alignas(16) float baseX[4] = {}, baseY[4] = {}, baseZ[4] = {};
+  alignas(16) float v0X[4] = {}, v0Y[4] = {}, v0Z[4] = {};
+  alignas(16) float v1X[4] = {}, v1Y[4] = {}, v1Z[4] = {};
+  unsigned count = 0;
+
+public:
+  /**
+   * Maximal number of triangles in the packet
+   */
+  constexpr static const unsigned size = 4;
+
+  /**
+   * Create empty packet
+   */
+  explicit TrianglePacket() = default;
+
+  /**
+   * Add triangle to the next free lane of the packet
+   * @param triangle - added triangle
+   */
+  void add(const Triangle &triangle);
+
+  /**
+   * Add triangle given by base point and its' vectors to the next free lane of the packet
+   */
+  void add(float pX, float pY, float pZ, float aX, float aY, float aZ, float bX, float bY, float bZ) {
+    auto lane = count++;
+    baseX[lane] = pX, baseY[lane] = pY, baseZ[lane] = pZ;
+    v0X[lane] = aX, v0Y[lane] = aY, v0Z[lane] = aZ;
+    v1X[lane] = bX, v1Y[lane] = bY, v1Z[lane] = bZ;
+  }
+
+  /**
+   * Remove all triangles from the packet
+   */
+  void clear() {
+    count = 0;
+  }
+
+  [[nodiscard]] unsigned getCount() const {
+    return count;
+  }
+
+  [[nodiscard]] bool isFull() const {
+    return count == size;
+  }
+
+  /**
+   * Compute normal of one triangle of the packet
+   * @param lane - index of the triangle
+   * @return normal of the triangle
+   */
+  [[nodiscard]] Vector3d getNormal(unsigned lane) const;
+
+  /**
+   * Finds intersections of ray with all triangles of the packet at once
+   * @param ray - ray for which we are finding intersections
+   * @param tMin - intersections with parameter lower or equal are ignored
+   * @param tMax - intersections with parameter higher or equal are ignored
+   * @param intersectionT - parameters of intersections, valid for the lanes which are set in the returned mask
+   * @return bit mask of triangles intersected by the ray (bit i for i-th added triangle)
+   */
+  [[nodiscard]] int getIntersections(const Ray &ray, float tMin, float tMax, float intersectionT[size]) const;
+
+  /**
+   * Find the nearest intersection of ray with triangles of the packet and store it if there is any
+   * @param ray - investigated ray
+   * @param tMin - intersections with parameter lower or equal are ignored
+   * @param tMax - intersections with parameter higher or equal are ignored
+   * @param intersection - value where we store intersection if any is found
+   * @return true if intersection is found
+   */
+  bool findNearestIntersection(const Ray &ray, float tMin, float tMax, Intersection &intersection) const;
+
+  /**
+   * Find if the ray intersects any triangle of the packet, normal of the intersection is not computed
+   * @param ray - investigated ray
+   * @param tMin - intersections with parameter lower or equal are ignored
+   * @param tMax - intersections with parameter higher or equal are ignored
+   * @return true if intersection is found
+   */
+  [[nodiscard]] bool hasIntersection(const Ray &ray, float tMin, float tMax) const;
+};
@@ -1,13 +1,16 @@
 #pragma once
 
+#include <cmath>
 #include <ostream>
 #include <string>
+#include <type_traits>
 
 /**
  * Type for 3D vector
  *
  * Provides basic meaningful operation (+, -, *, /) for vector
  * Provides vector-specific operations as getting length, normalization, dot product and cross product between vectors
+ * Operations are inline in the header, so temporaries on the per-pixel path stay in registers
  */
 class Vector3d {
   float x, y, z;
@@ -16,7 +19,7 @@ public:
   /**
    * Create vector (0, 0, 0)
    */
-  explicit Vector3d();
+  constexpr explicit Vector3d() : x(0.f), y(0.f), z(0.f) {}
 
   /**
    * Create vector with provided x, y, z
@@ -24,74 +27,130 @@ public:
    * @param y - length in y axis
    * @param z - length in z axis
    */
-  explicit Vector3d(float x, float y, float z);
-
-  Vector3d operator+(const Vector3d &other) const;
-  Vector3d operator+=(const Vector3d &other);
-
-  Vector3d operator-(const Vector3d &other) const;
-  Vector3d operator-=(const Vector3d &other);
-
-  Vector3d operator*(float k) const;
-  friend Vector3d operator*(float k, const Vector3d &vector);
-  Vector3d operator*=(float k);
-
-  Vector3d operator/(float k) const;
-  Vector3d operator/=(float k);
+  constexpr explicit Vector3d(float x, float y, float z) : x(x), y(y), z(z) {}
+
+  constexpr Vector3d operator+(const Vector3d &other) const {
+    return Vector3d(x + other.x, y + other.y, z + other.z);
+  }
+
+  constexpr Vector3d operator+=(const Vector3d &other) {
+    x += other.x;
+    y += other.y;
+    z += other.z;
+    return *this;
+  }
+
+  constexpr Vector3d operator-(const Vector3d &other) const {
+    return Vector3d(x - other.x, y - other.y, z - other.z);
+  }
+
+  constexpr Vector3d operator-=(const Vector3d &other) {
+    x -= other.x;
+    y -= other.y;
+    z -= other.z;
+    return *this;
+  }
+
+  constexpr Vector3d operator*(float k) const {
+    return Vector3d(x * k, y * k, z * k);
+  }
+
+  constexpr friend Vector3d operator*(float k, const Vector3d &vector) {
+    return Vector3d(vector.x * k, vector.y * k, vector.z * k);
+  }
+
+  constexpr Vector3d operator*=(float k) {
+    x *= k;
+    y *= k;
+    z *= k;
+    return *this;
+  }
+
+  constexpr Vector3d operator/(float k) const {
+    return Vector3d(x / k, y / k, z / k);
+  }
+
+  constexpr Vector3d operator/=(float k) {
+    x /= k;
+    y /= k;
+    z /= k;
+    return *this;
+  }
 
   [[nodiscard]] std::string to_string() const;
   friend std::ostream &operator<<(std::ostream &out, const Vector3d &vector);
 
-  friend Vector3d operator-(const Vector3d &vector);
+  constexpr friend Vector3d operator-(const Vector3d &vector) {
+    return (-1) * vector;
+  }
 
   /**
    * Get x direction of vector
    * @return x
    */
-  [[nodiscard]] float getX() const;
+  [[nodiscard]] constexpr float getX() const {
+    return x;
+  }
 
   /**
    * Get y direction of vector
    * @return y
    */
-  [[nodiscard]] float getY() const;
+  [[nodiscard]] constexpr float getY() const {
+    return y;
+  }
 
   /**
    * Get z direction of vector
    * @return z
    */
-  [[nodiscard]] float getZ() const;
+  [[nodiscard]] constexpr float getZ() const {
+    return z;
+  }
 
   /**
    * Get i-th parameter of the vector, for example y for i = 1.
    * @param i number of parameter in list [x, y, z]
    * @return x, y or z
    */
-  [[nodiscard]] float get(unsigned i) const;
+  [[nodiscard]] constexpr float get(unsigned i) const {
+    return i == 0 ? x : i == 1 ? y : z;
+  }
 
   /**
    * Compute length of the vector.
    * @return length of the vector
    */
-  [[nodiscard]] float length() const;
+  [[nodiscard]] float length() const {
+    return std::sqrt(x * x + y * y + z * z);
+  }
 
   /**
    * Compute dot product between this vector and the other and returns it.
    * @param other - vector to compute dot product with
    * @return dot product of this and the other vector
    */
-  [[nodiscard]] float dotProduct(const Vector3d &other) const;
+  [[nodiscard]] constexpr float dotProduct(const Vector3d &other) const {
+    return x * other.x + y * other.y + z * other.z;
+  }
 
   /**
    * Compute cross product between this vector and the other and returns it.
    * @param other - vector to compute cross product with
    * @return cross product of this and the other vector
    */
-  [[nodiscard]] Vector3d crossProduct(const Vector3d &other) const;
+  [[nodiscard]] constexpr Vector3d crossProduct(const Vector3d &other) const {
+    return Vector3d(y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x);
+  }
 
   /**
    * Compute normalized vector for this vector.
    * @return normalized version of this
    */
-  [[nodiscard]] Vector3d normalized() const;
+  [[nodiscard]] Vector3d normalized() const {
+    auto l = length();
+    return Vector3d(x / l, y / l, z / l);
+  }
 };
+
+static_assert(std::is_trivially_copyable_v<Vector3d>, "vectors are copied as plain floats on the per-pixel path");
@@ -0,0 +1,34 @@
+# Compare the checksum of the scene rendered in one thread with the golden checksum of the build configuration
+# Usage: cmake -DPROGRAM=path -DSCENE=n -DGOLDEN_FILE=path -DOUTPUT_DIR=dir [-DUPDATE=ON] -P golden-image.cmake
+# Every line of the golden file holds the scene number and its checksum, UPDATE stores the rendered checksum to the file instead
+
+include(${CMAKE_CURRENT_LIST_DIR}/render-checksum.cmake)
+
+render_checksum(${SCENE} 1 checksum)
+
+set(lines "")
+set(golden "")
+if (EXISTS "${GOLDEN_FILE}")
+  file(STRINGS "${GOLDEN_FILE}" lines)
+  foreach (line IN LISTS lines)
+    if (line MATCHES "^${SCENE} ([0-9a-f]+)$")
+      set(golden ${CMAKE_MATCH_1})
+    endif ()
+  endforeach ()
+endif ()
+
+if (UPDATE)
+  list(FILTER lines EXCLUDE REGEX "^${SCENE} ")
+  list(APPEND lines "${SCENE} ${checksum}")
+  list(SORT lines)
+  list(JOIN lines "\n" content)
+  file(WRITE "${GOLDEN_FILE}" "${content}\n")
+  message(STATUS "scene ${SCENE}: golden checksum ${checksum} stored to ${GOLDEN_FILE}")
+elseif (golden STREQUAL "")
+  # reported as skipped, the configuration has no golden images yet
+  message(STATUS "scene ${SCENE}: no golden checksum in ${GOLDEN_FILE}, rendered ${checksum}, build the target update-golden-images to store it")
+elseif (NOT checksum STREQUAL golden)
+  message(FATAL_ERROR "scene ${SCENE}: checksum ${checksum} differs from the golden ${golden} (${GOLDEN_FILE})")
+else ()
+  message(STATUS "scene ${SCENE}: checksum ${checksum} matches")
+endif ()
@@ -0,0 +1,24 @@
+# Rendering of the regression tests, every image has the same size and framebuffer format, so its checksum identifies it
+# Needs PROGRAM (path of the program) and OUTPUT_DIR (directory of the rendered images), runs in the exe directory to find ../data
+
+set(IMAGE_WIDTH 256)
+set(IMAGE_HEIGHT 256)
+set(IMAGE_FRAMEBUFFER rgba8)
+
+# Render the scene with its default camera and get the checksum of its color buffer
+# scene - number of the scene
+# threads - number of the rendering threads
+# result - variable where the checksum is stored
+function(render_checksum scene threads result)
+  set(output "${OUTPUT_DIR}/scene-${scene}-threads-${threads}.ppm")
+  execute_process(COMMAND "${PROGRAM}" ${scene} --output "${output}" --width ${IMAGE_WIDTH} --height ${IMAGE_HEIGHT} --threads ${threads}
+      --framebuffer ${IMAGE_FRAMEBUFFER} --checksum
+      OUTPUT_VARIABLE out ERROR_VARIABLE err RESULT_VARIABLE code)
+  if (NOT code EQUAL 0)
+    message(FATAL_ERROR "rendering of scene ${scene} with ${threads} threads failed (${code}):\n${out}${err}")
+  endif ()
+  if (NOT out MATCHES "checksum: ([0-9a-f]+)")
+    message(FATAL_ERROR "rendering of scene ${scene} printed no checksum:\n${out}${err}")
+  endif ()
+  set(${result} ${CMAKE_MATCH_1} PARENT_SCOPE)
+endfunction()
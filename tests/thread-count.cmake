@@ -0,0 +1,11 @@
+# Check that the scene rendered in one thread and in several threads has the same checksum, no golden checksum is needed
+# Usage: cmake -DPROGRAM=path -DSCENE=n -DTHREADS=count -DOUTPUT_DIR=dir -P thread-count.cmake
+
+include(${CMAKE_CURRENT_LIST_DIR}/render-checksum.cmake)
+
+render_checksum(${SCENE} 1 single)
+render_checksum(${SCENE} ${THREADS} parallel)
+if (NOT single STREQUAL parallel)
+  message(FATAL_ERROR "scene ${SCENE}: checksum ${parallel} with ${THREADS} threads differs from ${single} with one thread")
+endif ()
+message(STATUS "scene ${SCENE}: checksum ${single} with 1 and ${THREADS} threads")